@@ -0,0 +1,90 @@
+#ifndef BENCHMARK_H_INCLUDED
+#define BENCHMARK_H_INCLUDED
+
+/*!
+ *  \file Benchmark.h
+ *  \brief Shared helpers for the "Benchmark" build target. Each suite is a function taking the remaining command line arguments.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+    using ms = std::chrono::duration<double, std::milli>;
+
+    /* Bundled .obj files, used when a suite is given no file on the command line */
+    static const char *bundled_objs[] = {"objects/cube.obj", "objects/cylinder.obj", "objects/lowpolytree.obj", "objects/nature.obj",
+                                         "objects/plain_plane.obj", "objects/plane.obj", "objects/shadow_testscene.obj",
+                                         "objects/space_scene.obj", "objects/spaceship.obj", "objects/sphere.obj"};
+
+    inline std::vector<std::string> files_or_bundled(const std::vector<std::string> &args)
+    {
+        if(!args.empty()) return args;
+        return std::vector<std::string>(bundled_objs, bundled_objs + sizeof(bundled_objs) / sizeof(bundled_objs[0]));
+    }
+
+    /* Runs f() repeat times and returns the best time in ms */
+    template<typename F>
+    double best_of(int repeat, F f)
+    {
+        double best = 0.0;
+        for(int i = 0;i < repeat;i++) {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            double elapsed = std::chrono::duration_cast<ms>(std::chrono::steady_clock::now() - start).count();
+            if(i == 0 || elapsed < best) best = elapsed;
+        }
+
+        return best;
+    }
+
+    /* Camera at eye looking along yaw (around y), 70° perspective, 16/9 : projection * view (column-major) */
+    inline void view_projection(const float eye[3], float yaw, float farPlane, float clip[16])
+    {
+        float f = 1.0 / tan(0.5 * 70.0 * 3.14159265 / 180.0), aspect = 16.0 / 9.0, zNear = 0.1;
+        float projection[16] = {0.0f};
+        projection[0] = f / aspect;
+        projection[5] = f;
+        projection[10] = -(farPlane + zNear) / (farPlane - zNear);
+        projection[11] = -1.0;
+        projection[14] = -2.0 * farPlane * zNear / (farPlane - zNear);
+
+        /* Rotation of -yaw around y, then translation of -eye */
+        float c = cos(yaw), s = sin(yaw);
+        float view[16] = {c, 0.0f, s, 0.0f,   0.0f, 1.0f, 0.0f, 0.0f,   -s, 0.0f, c, 0.0f,   0.0f, 0.0f, 0.0f, 1.0f};
+        for(int row = 0;row < 3;row++) view[12 + row] = -(view[row] * eye[0] + view[4 + row] * eye[1] + view[8 + row] * eye[2]);
+
+        for(int column = 0;column < 4;column++) {
+            for(int row = 0;row < 4;row++) {
+                clip[4 * column + row] = 0.0f;
+                for(int k = 0;k < 4;k++) clip[4 * column + row] += projection[4 * k + row] * view[4 * column + k];
+            }
+        }
+    }
+
+    long peak_rss_kb(); // Peak resident memory of the process so far (bench/main.cpp)
+
+    /* Suites */
+    int obj_tokenizer(const std::vector<std::string> &args);
+    int obj_parser(const std::vector<std::string> &args);
+    int mesh_optimizer(const std::vector<std::string> &args);
+    int vertex_normals(const std::vector<std::string> &args);
+    int mesh_cache(const std::vector<std::string> &args);
+    int scene_format(const std::vector<std::string> &args);
+    int render_queue(const std::vector<std::string> &args);
+    int frustum_culler(const std::vector<std::string> &args);
+    int scene_bvh(const std::vector<std::string> &args);
+    int static_batch(const std::vector<std::string> &args);
+    int range_allocator(const std::vector<std::string> &args);
+    int vertex_layout(const std::vector<std::string> &args);
+    int shadow_cascades(const std::vector<std::string> &args);
+    int shadow_atlas(const std::vector<std::string> &args);
+    int frame_allocations(const std::vector<std::string> &args);
+    int render_allocations(const std::vector<std::string> &args); // Needs a GL context ("frameallocs render")
+    int pooled_draw(const std::vector<std::string> &args); // Needs a GL context
+}
+
+#endif // BENCHMARK_H_INCLUDED
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <random>
+#include <cstdlib>
+#include "Benchmark.h"
+#include "AllocationCounter.h"
+#include "RenderQueue.h"
+#include "ShadowAtlas.h"
+
+using namespace std;
+
+namespace
+{
+    struct Light {
+        float distance, range;
+    };
+
+    /* One frame of the per-frame structures of the renderer : the render queue of the meshes and the shadow atlas of the spot lights */
+    void frame(RenderQueue &queue, ShadowAtlas &atlas, const vector<uint64_t> &keys, const vector<Light> &lights)
+    {
+        queue.clear();
+        for(size_t i = 0;i < keys.size();i++) queue.push(keys[i], reinterpret_cast<AbstractMesh*>(i + 1));
+        queue.sort();
+
+        float projectionScale = 1.0 / tan(0.5 * 70.0 * 3.14159265 / 180.0);
+        atlas.clear();
+        for(const Light &light : lights) atlas.request(ShadowAtlas::importance(light.distance, light.range, projectionScale));
+        atlas.pack();
+    }
+}
+
+/*!
+ *  \brief Counts the heap allocations of steady state frames (after a warm-up, as Renderer does with RENDER_WARMUP_FRAMES) : fails if
+ *  there is any, or if the allocations aren't counted (CONRAD_COUNT_ALLOCATIONS, defined by the Benchmark target).
+ *  "frameallocs render [side]" counts those of Renderer::render() itself, in a GL context (see render_allocations()).
+ */
+int bench::frame_allocations(const vector<string> &args)
+{
+    if(!args.empty() && args[0] == "render") return render_allocations(vector<string>(args.begin() + 1, args.end()));
+
+    size_t meshCount = args.empty() ? 10000 : (size_t) atol(args[0].c_str());
+    const int warmup = 10, frames = 100;
+
+    if(!AllocationCounter::isEnabled()) {
+        cout << "Allocations aren't counted : build with CONRAD_COUNT_ALLOCATIONS" << endl;
+        return 1;
+    }
+
+    mt19937 random(1234);
+    uniform_int_distribution<unsigned int> textures(1, 24), materials(0, 63);
+    uniform_real_distribution<float> unit(0.0, 1.0);
+
+    vector<uint64_t> keys(meshCount);
+    vector<Light> lights(48);
+    RenderQueue queue;
+    ShadowAtlas atlas;
+
+    unsigned long long allocations = 0;
+    for(int f = 0;f < warmup + frames;f++) {
+        /* The scene moves : new depths and light distances every frame */
+        for(uint64_t &key : keys) {
+            unsigned int pass = (unit(random) < 0.1) ? RENDER_PASS_TRANSLUCENT : RENDER_PASS_OPAQUE;
+            key = RenderQueue::makeKey(pass, 3, textures(random), materials(random), unit(random));
+        }
+        for(Light &light : lights) light = {2.0f + 58.0f * unit(random), 5.0f + 10.0f * unit(random)};
+
+        unsigned long long before = AllocationCounter::getCount();
+        frame(queue, atlas, keys, lights);
+        if(f >= warmup) allocations += AllocationCounter::getCount() - before;
+    }
+
+    cout << meshCount << " draw items, " << lights.size() << " spot lights : " << allocations << " heap allocations in " << frames
+         << " steady state frames" << endl;
+    return (allocations == 0) ? 0 : 1;
+}
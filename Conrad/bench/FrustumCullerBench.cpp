@@ -0,0 +1,78 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include "Benchmark.h"
+#include "FrustumCuller.h"
+
+using namespace std;
+
+namespace
+{
+    /* glm::perspective(70°, 16/9, 0.1, 100) with the camera at the origin looking down -z (column-major) */
+    void make_projection(float matrix[16])
+    {
+        float f = 1.0 / tan(0.5 * 70.0 * 3.14159265 / 180.0), aspect = 16.0 / 9.0, zNear = 0.1, zFar = 100.0;
+
+        for(int i = 0;i < 16;i++) matrix[i] = 0.0;
+        matrix[0] = f / aspect;
+        matrix[5] = f;
+        matrix[10] = -(zFar + zNear) / (zFar - zNear);
+        matrix[11] = -1.0;
+        matrix[14] = -2.0 * zFar * zNear / (zFar - zNear);
+    }
+
+    /* count objects scattered all around the camera (most of them out of the frustum, as a forest is) */
+    void make_volumes(size_t count, FrustumCuller &culler)
+    {
+        mt19937 random(42);
+        uniform_real_distribution<float> position(-100.0, 100.0), size(0.2, 3.0);
+
+        culler.resize(count);
+        for(size_t i = 0;i < count;i++) {
+            float center[3] = {position(random), 0.5f * position(random), position(random)},
+                  extents[3] = {size(random), size(random), size(random)};
+            float radius = sqrt(extents[0] * extents[0] + extents[1] * extents[1] + extents[2] * extents[2]);
+
+            culler.setVolume(i, center, extents, radius);
+        }
+    }
+}
+
+/// \brief FrustumCuller::cull() (SSE when available) against the scalar kernel, on the same volumes.
+int bench::frustum_culler(const vector<string> &args)
+{
+    vector<size_t> counts = {1000, 10000, 100000};
+    if(!args.empty()) counts.assign(1, (size_t) atol(args[0].c_str()));
+
+#ifdef FRUSTUM_CULLER_SSE
+    cout << "Kernel : SSE" << endl;
+#else
+    cout << "Kernel : scalar (no SSE)" << endl;
+#endif
+
+    float matrix[16], planes[6][4];
+    make_projection(matrix);
+    FrustumCuller::extractPlanes(matrix, planes);
+
+    bool ok = true;
+    for(size_t count : counts) {
+        FrustumCuller culler;
+        make_volumes(count, culler);
+
+        vector<unsigned char> visible(count), reference(count);
+        size_t visibleCount = 0, referenceCount = 0;
+
+        double simd_time = best_of(20, [&]() { visibleCount = culler.cull(planes, visible.data()); });
+        double scalar_time = best_of(20, [&]() { referenceCount = culler.cullScalar(planes, reference.data()); });
+
+        bool same = (visibleCount == referenceCount && visible == reference);
+        ok = ok && same;
+
+        cout << setw(7) << count << " volumes | " << visibleCount << " visible, " << count - visibleCount << " culled | cull : " << fixed << setprecision(3)
+             << simd_time << " ms | scalar : " << scalar_time << " ms" << (same ? "" : " MISMATCH") << endl;
+    }
+
+    return ok ? 0 : 1;
+}
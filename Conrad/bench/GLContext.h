@@ -0,0 +1,60 @@
+#ifndef GLCONTEXT_H_INCLUDED
+#define GLCONTEXT_H_INCLUDED
+
+/*!
+ *  \file GLContext.h
+ *  \brief Hidden window and GL context for the suites that need one (see Benchmark.h).
+ */
+
+#include <SDL2/SDL.h>
+#include "GLState.h"
+
+namespace bench
+{
+    /*!
+     *  \class GLContext
+     *  \brief Hidden window and core context, as Application makes (GL 3.3). Current from create() until it is destroyed : declare it
+     *  before the GL objects, so that they are deleted while it is still current.
+     */
+    class GLContext
+    {
+        public:
+            GLContext() : m_window(0), m_context(0) {}
+            ~GLContext()
+            {
+                if(m_context != 0) SDL_GL_DeleteContext(m_context);
+                if(m_window != 0) SDL_DestroyWindow(m_window);
+                SDL_Quit();
+            }
+
+            bool create(int width, int height) // \return false if there is no GL 3.3 core context (see SDL_GetError())
+            {
+                if(SDL_Init(SDL_INIT_VIDEO) < 0) return false;
+
+                SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+                SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+                SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+                m_window = SDL_CreateWindow("ConradBench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL);
+                if(m_window == 0) return false;
+
+                m_context = SDL_GL_CreateContext(m_window);
+                if(m_context == 0) return false;
+
+                #ifdef WIN32
+                    glewExperimental = GL_TRUE; // Core context
+                    if(glewInit() != GLEW_OK) return false;
+                    glGetError(); // glewInit() may leave GL_INVALID_ENUM
+                #endif // WIN32
+
+                GLState::invalidate();
+                return true;
+            }
+
+        private:
+            SDL_Window *m_window;
+            SDL_GLContext m_context;
+    };
+}
+
+#endif // GLCONTEXT_H_INCLUDED
@@ -0,0 +1,114 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <unordered_map>
+#include "Benchmark.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "OBJParser.h"
+#include "VertexNormals.h"
+
+using namespace std;
+
+namespace
+{
+    /* The streams of one cooked object (the arrays CookedMesh points to) */
+    struct Streams {
+        vector<float> vertices, colors, texCoords, vertexNormals;
+        vector<unsigned int> indices;
+    };
+
+    /* What OBJ_Static_Handler does on a miss, without the GL part : index, average the normals, optimize */
+    void cook_object(OBJParser &parser, OBJParser::Object &object, Streams &streams, MeshCache::CookedMesh &mesh)
+    {
+        vector<coordinate3d> &vertices = parser.getVertices();
+        vector<coordinate2d> &tex = parser.getTexCoords();
+
+        vector<float> averaged;
+        size_t first;
+        VertexNormals::average(parser.getNormals(), object.vertex_normals_mapper, vertices.size(), averaged, first);
+
+        unordered_map<long long, unsigned int> unique;
+        for(size_t i = 0;i < object.faces_vertex_index.size();i++) {
+            int v = object.faces_vertex_index[i], t = object.faces_tex_index[i];
+            if(v < 0 || v >= (int) vertices.size()) continue;
+
+            auto inserted = unique.insert(make_pair((long long) v * 1000003 + t, (unsigned int) (streams.vertices.size() / 3)));
+            if(inserted.second) {
+                streams.vertices.push_back(get<0>(vertices[v])); streams.vertices.push_back(get<1>(vertices[v])); streams.vertices.push_back(get<2>(vertices[v]));
+
+                bool hasTex = t >= 0 && t < (int) tex.size();
+                streams.texCoords.push_back(hasTex ? get<0>(tex[t]) : 0.0f); streams.texCoords.push_back(hasTex ? get<1>(tex[t]) : 0.0f);
+
+                const float *normal = &averaged[3 * (v - first)];
+                streams.vertexNormals.insert(streams.vertexNormals.end(), normal, normal + 3);
+            }
+
+            streams.indices.push_back(inserted.first->second);
+        }
+
+        size_t vertexCount = streams.vertices.size() / 3;
+        streams.colors.assign(3 * vertexCount, 1.0f);
+
+        vector<MeshOptimizer::VertexStream> optimized = {{streams.vertices.data(), 3}, {streams.colors.data(), 3}, {streams.texCoords.data(), 2}, {streams.vertexNormals.data(), 3}};
+        MeshOptimizer::optimize(streams.indices, vertexCount, optimized);
+
+        mesh.name = object.name;
+        mesh.usesMaterial = object.usesMaterial;
+        mesh.material = object.material;
+        mesh.verticesCount = vertexCount;
+        mesh.indicesCount = streams.indices.size();
+        mesh.indexSize = sizeof(unsigned int);
+        mesh.vertices = streams.vertices.data();
+        mesh.colors = streams.colors.data();
+        mesh.texCoords = streams.texCoords.data();
+        mesh.vertexNormals = streams.vertexNormals.data();
+        mesh.indices = streams.indices.data();
+    }
+}
+
+/// \brief Cold start (parse, index, optimize and cook each file) against warm start (hash the file, map and validate the cooked one).
+int bench::mesh_cache(const vector<string> &args)
+{
+    bool ok = true;
+    for(const string &path : files_or_bundled(args)) {
+        string cookedPath = MeshCache::cookedPath(path + ".bench");
+
+        size_t meshes = 0;
+        bool written = false;
+        double cold = best_of(3, [&]() {
+            MappedFile file(path);
+            uint64_t key = MeshCache::hash(file.data(), file.size());
+
+            OBJParser parser;
+            parser.parse(file.data(), file.end());
+
+            vector<OBJParser::Object> &objects = parser.getObjects();
+            vector<Streams> streams(objects.size());
+            vector<MeshCache::CookedMesh> cooked(objects.size());
+            for(size_t i = 0;i < objects.size();i++) cook_object(parser, objects[i], streams[i], cooked[i]);
+
+            written = MeshCache::write(cookedPath, key, cooked);
+            meshes = cooked.size();
+        });
+
+        unsigned int hits = MeshCache::getHits();
+        double warm = best_of(3, [&]() {
+            MappedFile file(path);
+            MeshCache cache;
+            cache.open(cookedPath, MeshCache::hash(file.data(), file.size()));
+        });
+
+        bool hit = written && MeshCache::getHits() == hits + 3;
+        ok = ok && hit;
+
+        cout << left << setw(32) << path << right << setw(3) << meshes << " meshes | cold : " << fixed << setprecision(2) << setw(8) << cold
+             << " ms | warm : " << setw(6) << warm << " ms" << (hit ? "" : " (NO HIT)") << endl;
+
+        remove(cookedPath.c_str());
+    }
+
+    cout << "Cache hits : " << MeshCache::getHits() << ", misses : " << MeshCache::getMisses() << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+#include <iostream>
+#include <iomanip>
+#include <unordered_map>
+#include "Benchmark.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "OBJParser.h"
+
+using namespace std;
+
+/// \brief Indexes every object of each file the way StaticMeshFromArrays does, then reports the ACMR/ATVR before and after the optimization.
+int bench::mesh_optimizer(const vector<string> &args)
+{
+    for(const string &path : files_or_bundled(args)) {
+        MappedFile file(path);
+        if(!file.isOpen()) {
+            cout << "Can't load (" << path << ")" << endl;
+            continue;
+        }
+
+        OBJParser parser;
+        parser.parse(file.data(), file.end());
+
+        vector<coordinate3d> &vertices = parser.getVertices();
+        vector<coordinate2d> &tex = parser.getTexCoords();
+
+        for(OBJParser::Object &object : parser.getObjects()) {
+            /* Unique (vertex, texture, normal) corners */
+            unordered_map<long long, unsigned int> unique;
+            vector<unsigned int> indices;
+            vector<float> positions, texCoords;
+
+            for(size_t i = 0;i < object.faces_vertex_index.size();i++) {
+                int v = object.faces_vertex_index[i], t = object.faces_tex_index[i], n = object.faces_normal_index[i];
+                if(v < 0 || v >= (int) vertices.size()) continue;
+
+                long long key = ((long long) v * 1000003 + t) * 1000003 + n;
+                auto found = unique.find(key);
+                if(found == unique.end()) {
+                    found = unique.insert(make_pair(key, (unsigned int) (positions.size() / 3))).first;
+                    positions.push_back(get<0>(vertices[v])); positions.push_back(get<1>(vertices[v])); positions.push_back(get<2>(vertices[v]));
+
+                    bool hasTex = t >= 0 && t < (int) tex.size();
+                    texCoords.push_back(hasTex ? get<0>(tex[t]) : 0.0f); texCoords.push_back(hasTex ? get<1>(tex[t]) : 0.0f);
+                }
+
+                indices.push_back(found->second);
+            }
+
+            size_t vertexCount = positions.size() / 3;
+            if(indices.size() < 3) continue;
+
+            vector<MeshOptimizer::VertexStream> streams = {{positions.data(), 3}, {texCoords.data(), 2}};
+            MeshOptimizer::Stats stats;
+            double elapsed = best_of(1, [&]() { stats = MeshOptimizer::optimize(indices, vertexCount, streams); });
+
+            cout << left << setw(32) << path << setw(20) << object.name << right << setw(8) << stats.triangles << " tris | ACMR "
+                 << fixed << setprecision(3) << stats.acmrBefore << " -> " << stats.acmrAfter << " | ATVR " << stats.atvrBefore << " -> " << stats.atvrAfter
+                 << " | " << stats.clusters << " clusters | " << setprecision(2) << elapsed << " ms" << endl;
+        }
+    }
+
+    return 0;
+}
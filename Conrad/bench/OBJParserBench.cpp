@@ -0,0 +1,64 @@
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include "Benchmark.h"
+#include "MappedFile.h"
+#include "OBJParser.h"
+
+using namespace std;
+
+namespace
+{
+    bool same_objects(vector<OBJParser::Object> &a, vector<OBJParser::Object> &b)
+    {
+        if(a.size() != b.size()) return false;
+
+        for(size_t i = 0;i < a.size();i++) {
+            if(a[i].name != b[i].name || a[i].usesMaterial != b[i].usesMaterial || a[i].material != b[i].material) return false;
+            if(a[i].faces_vertex_index != b[i].faces_vertex_index || a[i].faces_tex_index != b[i].faces_tex_index) return false;
+            if(a[i].faces_normal_index != b[i].faces_normal_index || a[i].vertex_normals_mapper != b[i].vertex_normals_mapper) return false;
+        }
+
+        return true;
+    }
+}
+
+/// \brief Parses each file with 1, 2, 4, ... threads, reports the times and checks every result against the serial one.
+int bench::obj_parser(const vector<string> &args)
+{
+    unsigned int cores = thread::hardware_concurrency();
+    if(cores == 0) cores = 1;
+
+    vector<unsigned int> threadCounts;
+    for(unsigned int count = 1;count < cores;count *= 2) threadCounts.push_back(count);
+    threadCounts.push_back(cores);
+
+    bool identical = true;
+    for(const string &path : files_or_bundled(args)) {
+        MappedFile file(path);
+        if(!file.isOpen()) {
+            cout << "Can't load (" << path << ")" << endl;
+            continue;
+        }
+
+        OBJParser serial(1);
+        double serial_time = best_of(3, [&]() { serial.parse(file.data(), file.end()); });
+
+        cout << left << setw(32) << path << "1 thread : " << fixed << setprecision(2) << serial_time << " ms";
+
+        for(size_t i = 1;i < threadCounts.size();i++) {
+            OBJParser parallel(threadCounts[i]);
+            double parallel_time = best_of(3, [&]() { parallel.parse(file.data(), file.end()); });
+
+            bool same = parallel.getVertices() == serial.getVertices() && parallel.getTexCoords() == serial.getTexCoords()
+                     && parallel.getNormals() == serial.getNormals() && same_objects(parallel.getObjects(), serial.getObjects());
+            identical = identical && same;
+
+            cout << " | " << threadCounts[i] << " threads (" << parallel.getChunkCount() << " chunks) : " << parallel_time << " ms" << (same ? "" : " MISMATCH");
+        }
+
+        cout << endl;
+    }
+
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include "Benchmark.h"
+#include "MappedFile.h"
+#include "OBJTokenizer.h"
+
+using namespace std;
+
+namespace
+{
+    /* What both parsers produce, compared at the end to make sure the tokenizer reads the same values */
+    struct Parsed {
+        vector<float> floats;
+        vector<int> indexes;
+        size_t objects = 0;
+    };
+
+    /* The former path : the whole file in a vector<string>, then one stringstream per line and per face corner */
+    void parse_stringstream(const string &path, Parsed &out)
+    {
+        ifstream file(path.c_str());
+        string line;
+        vector<string> lines;
+        while(getline(file, line)) lines.push_back(line);
+
+        for(vector<string>::iterator it = lines.begin();it != lines.end();it++) {
+            stringstream stream(*it);
+            string c; stream >> c;
+
+            if(c == "v" || c == "vn") {
+                float x, y, z; stream >> x >> y >> z;
+                out.floats.push_back(x); out.floats.push_back(y); out.floats.push_back(z);
+            } else if(c == "vt") {
+                float u, v; stream >> u >> v;
+                out.floats.push_back(u); out.floats.push_back(v);
+            } else if(c == "f") {
+                string vert[3];
+                stream >> vert[0] >> vert[1] >> vert[2];
+                for(int i = 0;i < 3;i++) {
+                    stringstream sub_stream(vert[i]);
+                    int indexes[3] = {0, 0, 0}, value, j = 0;
+                    while(j < 3) {
+                        if(sub_stream.peek() == '/') { sub_stream.ignore(); j++; continue; }
+                        if(!(sub_stream >> value)) break;
+                        indexes[j] = value;
+                    }
+                    out.indexes.insert(out.indexes.end(), indexes, indexes + 3);
+                }
+            } else if(c == "o") {
+                out.objects++;
+            }
+        }
+    }
+
+    void parse_tokenizer(const string &path, Parsed &out)
+    {
+        MappedFile file(path);
+        OBJTokenizer tokenizer(file.data(), file.end());
+        OBJTokenizer::Record record;
+
+        while(tokenizer.next(record)) {
+            switch(record.type) {
+                case VERTEX:
+                case NORMAL:    out.floats.insert(out.floats.end(), record.values, record.values + 3); break;
+                case TEXTURE:   out.floats.insert(out.floats.end(), record.values, record.values + 2); break;
+                case FACE:      for(int i = 0;i < 3;i++) out.indexes.insert(out.indexes.end(), record.indexes[i], record.indexes[i] + 3); break;
+                case OBJECT:    out.objects++; break;
+                default: break;
+            }
+        }
+    }
+}
+
+/// \brief Reports the parsing throughput (MB/s) of the stringstream path and of the mapped OBJTokenizer for each file.
+int bench::obj_tokenizer(const vector<string> &args)
+{
+    bool identical = true;
+
+    cout << left << setw(32) << "file" << setw(12) << "size (kB)" << setw(18) << "stringstream MB/s" << setw(18) << "tokenizer MB/s" << "speedup" << endl;
+    for(const string &path : files_or_bundled(args)) {
+        MappedFile probe(path);
+        if(!probe.isOpen()) {
+            cout << "Can't load (" << path << ")" << endl;
+            continue;
+        }
+        double megabytes = probe.size() / (1024.0 * 1024.0);
+        probe.close();
+
+        Parsed reference, tokenized;
+        double stream_time = best_of(3, [&]() { reference = Parsed(); parse_stringstream(path, reference); });
+        double token_time = best_of(3, [&]() { tokenized = Parsed(); parse_tokenizer(path, tokenized); });
+
+        if(reference.floats != tokenized.floats || reference.indexes != tokenized.indexes || reference.objects != tokenized.objects) {
+            cout << "MISMATCH between both parsers on " << path << endl;
+            identical = false;
+        }
+
+        cout << left << setw(32) << path << setw(12) << fixed << setprecision(1) << megabytes * 1024.0
+             << setw(18) << megabytes / (stream_time / 1000.0)
+             << setw(18) << megabytes / (token_time / 1000.0)
+             << "x" << stream_time / token_time << endl;
+    }
+
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+#include <iostream>
+#include "Benchmark.h"
+#include "GLContext.h"
+#include "AbstractMesh.h"
+#include "DepthBuffer.h"
+#include "Shader.h"
+#include "GLState.h"
+
+using namespace std;
+
+namespace
+{
+    const GLsizei targetSize = 64;
+}
+
+/*!
+ *  \brief Draws a static mesh loaded into the GeometryPool through AbstractMesh::draw() (the path of the shadow passes) into a depth
+ *  target : fails if the mesh didn't go to the pool, or if nothing was drawn (no VAO bound : GL_INVALID_OPERATION in a core context).
+ *  Run from the Conrad directory (shaders and blank texture).
+ */
+int bench::pooled_draw(const vector<string> &args)
+{
+    bench::GLContext context;
+    if(!context.create(targetSize, targetSize)) {
+        cout << "No GL 3.3 core context : " << SDL_GetError() << endl;
+        return 1;
+    }
+
+    bool ok = true;
+    {
+        Shader depthShader("shaders/advanced/depth.vert", "shaders/advanced/depth.frag");
+        DepthBuffer target;
+        ok = depthShader.load();
+        target.load(DEPTHBUFFER_SIMPLE, targetSize);
+
+        /* One triangle covering the whole target, at depth 0.5 */
+        float vertices[9] = {-1.0f, -1.0f, 0.0f,   3.0f, -1.0f, 0.0f,   -1.0f, 3.0f, 0.0f},
+              colors[9] = {1.0f, 1.0f, 1.0f,   1.0f, 1.0f, 1.0f,   1.0f, 1.0f, 1.0f},
+              normals[9] = {0.0f, 0.0f, 1.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f, 1.0f};
+        AbstractMesh mesh(3, vertices, 3, colors, normals, GL_STATIC_DRAW);
+        mesh.load();
+
+        bool pooled = mesh.usesSharedBuffers();
+        cout << "Mesh " << (pooled ? "in the GeometryPool" : "NOT in the GeometryPool") << endl;
+        ok = ok && pooled;
+
+        target.bind();
+        GLState::viewport(0, 0, targetSize, targetSize);
+        GLState::enable(GL_DEPTH_TEST);
+        GLState::depthFunc(GL_LESS);
+        GLState::disable(GL_CULL_FACE);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        depthShader.bind();
+        Shader::sendMatrix(depthShader.getUniformLocation("world"), glm::mat4(1.0));
+        Shader::sendMatrix(depthShader.getUniformLocation("modelview"), mesh.getVertexModelview());
+        GLState::bindVertexArray(0); // draw() must bind the VAO of the pool page itself
+        mesh.draw();
+
+        float depth = 1.0f;
+        glReadPixels(targetSize / 2, targetSize / 2, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
+        GLenum error = glGetError();
+        DepthBuffer::unbind();
+        Shader::unbind();
+
+        bool drawn = (error == GL_NO_ERROR && depth < 0.75f);
+        cout << "draw() : depth " << depth << ", GL error 0x" << hex << error << dec << (drawn ? "" : " -> NOTHING DRAWN") << endl;
+        ok = ok && drawn;
+    } // GL objects deleted with the context still current
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <random>
+#include <cstdlib>
+#include "Benchmark.h"
+#include "RangeAllocator.h"
+
+using namespace std;
+
+namespace
+{
+    struct Mesh {
+        size_t firstVertex, vertexCount, firstIndex, indexCount;
+    };
+
+    /* The ranges must be disjoint and inside the allocator, and their sum must be what it counts as used */
+    bool check_ranges(const vector<Mesh> &meshes, const RangeAllocator &vertices, const RangeAllocator &indices)
+    {
+        vector<pair<size_t, size_t> > vertexRanges, indexRanges;
+        for(const Mesh &mesh : meshes) {
+            vertexRanges.push_back(make_pair(mesh.firstVertex, mesh.vertexCount));
+            indexRanges.push_back(make_pair(mesh.firstIndex, mesh.indexCount));
+        }
+
+        for(int pass = 0;pass < 2;pass++) {
+            vector<pair<size_t, size_t> > &ranges = (pass == 0) ? vertexRanges : indexRanges;
+            const RangeAllocator &allocator = (pass == 0) ? vertices : indices;
+            sort(ranges.begin(), ranges.end());
+
+            size_t used = 0;
+            for(size_t i = 0;i < ranges.size();i++) {
+                if(i > 0 && ranges[i - 1].first + ranges[i - 1].second > ranges[i].first) return false;
+                used += ranges[i].second;
+            }
+            if(!ranges.empty() && ranges.back().first + ranges.back().second > allocator.getCapacity()) return false;
+            if(used != allocator.getUsed()) return false;
+        }
+
+        return true;
+    }
+
+    void print_state(size_t operations, const RangeAllocator &vertices, const RangeAllocator &indices, size_t meshes, size_t failures)
+    {
+        RangeAllocator::Stats v = vertices.getStats(), i = indices.getStats();
+        cout << setw(9) << operations << " ops | " << setw(5) << meshes << " meshes | vertices " << setw(3) << 100 * v.used / v.capacity << "% used, "
+             << setw(4) << v.freeBlocks << " free blocks, largest " << setw(7) << v.largestFree << ", " << setw(3) << (int) (100 * v.fragmentation) << "% fragmented | indices "
+             << setw(3) << 100 * i.used / i.capacity << "% used, " << setw(4) << i.freeBlocks << " free blocks, " << setw(3) << (int) (100 * i.fragmentation) << "% fragmented | "
+             << failures << " failed" << endl;
+    }
+}
+
+/*!
+ *  \brief Stress test of the GeometryPool allocator : a page (vertex and index ranges) is filled with meshes of random sizes, then meshes are
+ *  unloaded and loaded at random. Prints how the free space fragments over time, the loads that didn't fit (they would get a new page)
+ *  and the cost of an allocation and of a free.
+ */
+int bench::range_allocator(const vector<string> &args)
+{
+    size_t operations = 200000;
+    if(!args.empty()) operations = (size_t) atol(args[0].c_str());
+
+    const size_t vertexCapacity = 1 << 22, indexCapacity = 1 << 24;
+    RangeAllocator vertices(vertexCapacity), indices(indexCapacity);
+
+    mt19937 random(1234);
+    uniform_real_distribution<double> logSize(log(24.0), log(60000.0)), indexRatio(1.5, 6.0);
+    auto random_mesh = [&](Mesh &mesh) {
+        mesh.vertexCount = (size_t) exp(logSize(random));
+        mesh.indexCount = (size_t) (mesh.vertexCount * indexRatio(random)) / 3 * 3;
+    };
+
+    /* Loads a mesh. false if a range doesn't fit */
+    auto load = [&](Mesh &mesh) {
+        mesh.firstVertex = vertices.allocate(mesh.vertexCount);
+        if(mesh.firstVertex == RANGE_ALLOCATOR_FAILED) return false;
+
+        mesh.firstIndex = indices.allocate(mesh.indexCount);
+        if(mesh.firstIndex == RANGE_ALLOCATOR_FAILED) {
+            vertices.free(mesh.firstVertex);
+            return false;
+        }
+
+        return true;
+    };
+
+    /* Fill : up to 75% of the vertices */
+    vector<Mesh> meshes;
+    while(vertices.getUsed() < vertexCapacity * 3 / 4) {
+        Mesh mesh;
+        random_mesh(mesh);
+        if(!load(mesh)) break;
+        meshes.push_back(mesh);
+    }
+    print_state(0, vertices, indices, meshes.size(), 0);
+
+    /* Churn : one mesh unloaded, one loaded */
+    size_t failures = 0;
+    double allocationTime = 0.0, freeTime = 0.0;
+    bool ok = true;
+
+    for(size_t operation = 1;operation <= operations;operation++) {
+        size_t victim = uniform_int_distribution<size_t>(0, meshes.size() - 1)(random);
+
+        auto start = chrono::steady_clock::now();
+        ok = vertices.free(meshes[victim].firstVertex) && ok;
+        ok = indices.free(meshes[victim].firstIndex) && ok;
+        freeTime += chrono::duration_cast<ms>(chrono::steady_clock::now() - start).count();
+
+        meshes[victim] = meshes.back();
+        meshes.pop_back();
+
+        Mesh mesh;
+        random_mesh(mesh);
+        start = chrono::steady_clock::now();
+        bool loaded = load(mesh);
+        allocationTime += chrono::duration_cast<ms>(chrono::steady_clock::now() - start).count();
+
+        if(loaded)  meshes.push_back(mesh);
+        else        failures++;
+
+        if(operation % (operations / 5) == 0) {
+            print_state(operation, vertices, indices, meshes.size(), failures);
+            ok = check_ranges(meshes, vertices, indices) && ok;
+        }
+    }
+
+    /* Everything unloaded : a single free block again */
+    for(const Mesh &mesh : meshes) {
+        vertices.free(mesh.firstVertex);
+        indices.free(mesh.firstIndex);
+    }
+    ok = ok && vertices.isEmpty() && vertices.getStats().freeBlocks == 1 && indices.getStats().freeBlocks == 1;
+
+    cout << fixed << setprecision(1) << "Allocation : " << 1e6 * allocationTime / operations << " ns (vertices + indices) | free : " << 1e6 * freeTime / operations
+         << " ns | " << (ok ? "ranges checked" : "INVALID RANGES") << endl;
+
+    return ok ? 0 : 1;
+}
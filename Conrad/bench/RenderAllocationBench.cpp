@@ -0,0 +1,91 @@
+#include <iostream>
+#include <cstdlib>
+#include <glm/gtx/transform.hpp>
+#include "Benchmark.h"
+#include "GLContext.h"
+#include "AllocationCounter.h"
+#include "Renderer.h"
+#include "PointLight.h"
+#include "SpotLight.h"
+#include "SunLight.h"
+
+using namespace std;
+
+namespace
+{
+    const int viewportWidth = 320, viewportHeight = 180;
+}
+
+/*!
+ *  \brief Counts the heap allocations of Renderer::render() (Renderer::getFrameAllocations()) in the steady state, i.e. after
+ *  RENDER_WARMUP_FRAMES frames : a grid of meshes, some of them moving, under a sun, a spot and a point light casting shadows, seen by a
+ *  turning camera (new cascades, atlas tiles and shadow maps every frame). Fails if there is any allocation, or if there is no GL context.
+ *  Run from the Conrad directory (shaders and blank texture).
+ */
+int bench::render_allocations(const vector<string> &args)
+{
+    int side = args.empty() ? 20 : atoi(args[0].c_str());
+    const int frames = 100, moving = 10;
+
+    if(!AllocationCounter::isEnabled()) {
+        cout << "Allocations aren't counted : build with CONRAD_COUNT_ALLOCATIONS" << endl;
+        return 1;
+    }
+
+    bench::GLContext context;
+    if(!context.create(viewportWidth, viewportHeight)) {
+        cout << "No GL 3.3 core context : " << SDL_GetError() << endl;
+        return 1;
+    }
+
+    unsigned long long allocations = 0, worst = 0;
+    {
+        Renderer renderer(viewportWidth, viewportHeight);
+        renderer.setShader(Shader("shaders/advanced/materials.vert", "shaders/advanced/materials.frag"));
+        renderer.setDepthShader(Shader("shaders/advanced/depth.vert", "shaders/advanced/depth.frag"));
+        renderer.setCubeDepthShader(Shader("shaders/advanced/depth_cube.vert", "shaders/advanced/depth_cube.frag", "shaders/advanced/depth_cube.geom"));
+        renderer.setGUIShader(Shader("shaders/advanced/gui.vert", "shaders/advanced/gui.frag"));
+        renderer.setShadowBlurShader(Shader("shaders/advanced/shadow_blur.vert", "shaders/advanced/shadow_blur.frag"));
+
+        /* One triangle per mesh, on the ground (Z up), sharing the arrays */
+        float vertices[9] = {-0.5f, -0.5f, 0.0f,   0.5f, -0.5f, 0.0f,   0.0f, 0.5f, 0.0f},
+              colors[9] = {1.0f, 1.0f, 1.0f,   1.0f, 1.0f, 1.0f,   1.0f, 1.0f, 1.0f},
+              normals[9] = {0.0f, 0.0f, 1.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f, 1.0f};
+        vector<AbstractMesh *> meshes;
+        for(int i = 0;i < side * side;i++) {
+            AbstractMesh *mesh = new AbstractMesh(3, vertices, 3, colors, normals, GL_STATIC_DRAW);
+            mesh->get_modelview() = glm::translate(glm::vec3(2.0f * (i % side - side / 2), 2.0f * (i / side), 0.0f));
+            mesh->load();
+            renderer.addMesh(mesh);
+            meshes.push_back(mesh);
+        }
+
+        SunLight sun(glm::vec3(0.0, 0.0, 20.0), glm::vec3(-1.0, 0.5, -1.0), glm::vec3(1.0, 0.9, 0.8), 1.0, true);
+        SpotLight spot(glm::vec3(0.0, 4.0, 5.0), glm::vec3(1.0), glm::vec3(0.0, 0.5, -1.0), 50.0, 60.0, 1.0, true, 0.08, 0.001, 20.0);
+        PointLight point(glm::vec3(3.0, 8.0, 2.0), glm::vec3(1.0), 1.0, true, 0.5, 0.001, 10.0);
+        renderer.addLight(&sun);
+        renderer.addLight(&spot);
+        renderer.addLight(&point);
+
+        renderer.get_camera()->setPosition(0.0, -5.0, 3.0);
+        for(int f = 0;f < RENDER_WARMUP_FRAMES + frames;f++) {
+            /* The scene moves : the camera turns, the first meshes slide along x */
+            renderer.get_camera()->rotate(0.5, 0.0);
+            for(int i = 0;i < moving && i < (int) meshes.size();i++) meshes[i]->get_modelview() *= glm::translate(glm::vec3((f % 2) ? 0.1f : -0.1f, 0.0f, 0.0f));
+
+            renderer.render();
+            if(f >= RENDER_WARMUP_FRAMES) {
+                allocations += renderer.getFrameAllocations();
+                if(renderer.getFrameAllocations() > worst) worst = renderer.getFrameAllocations();
+            }
+        }
+        glFinish();
+
+        cout << meshes.size() << " meshes, 3 shadow casting lights : " << allocations << " heap allocations in " << frames
+             << " steady state render() (at most " << worst << " in one frame)" << endl;
+
+        for(AbstractMesh *mesh : meshes) delete mesh;
+    } // GL objects deleted with the context still current
+
+    return (allocations == 0) ? 0 : 1;
+}
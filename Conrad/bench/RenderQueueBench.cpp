@@ -0,0 +1,104 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <random>
+#include <cstdlib>
+#include "Benchmark.h"
+#include "RenderQueue.h"
+
+using namespace std;
+
+namespace
+{
+    /* A scene of count meshes : few textures, more materials, random depths. The mesh pointer is only used as an identifier. */
+    void make_scene(size_t count, vector<RenderQueue::DrawItem> &items)
+    {
+        mt19937 random(1234);
+        uniform_int_distribution<unsigned int> textures(1, 24), materials(0, 63);
+        uniform_real_distribution<float> depths(0.0, 1.0), alphas(0.0, 1.0);
+
+        items.clear();
+        for(size_t i = 0;i < count;i++) {
+            unsigned int pass = (alphas(random) < 0.1) ? RENDER_PASS_TRANSLUCENT : RENDER_PASS_OPAQUE;
+
+            RenderQueue::DrawItem item;
+            item.key = RenderQueue::makeKey(pass, 3, textures(random), materials(random), depths(random));
+            item.mesh = reinterpret_cast<AbstractMesh*>(i + 1);
+            items.push_back(item);
+        }
+    }
+
+    /* Pass, shader, texture and material of a key, without the depth (see the layouts in RenderQueue.h) */
+    uint64_t key_state(uint64_t key)
+    {
+        const int passShift = RENDER_KEY_STATE_BITS + RENDER_KEY_DEPTH_BITS;
+        uint64_t pass = key >> passShift;
+
+        if(pass == RENDER_PASS_TRANSLUCENT) return (pass << RENDER_KEY_STATE_BITS) | (key & ((1ull << RENDER_KEY_STATE_BITS) - 1));
+        return key >> RENDER_KEY_DEPTH_BITS;
+    }
+
+    /* Texture and material changes when drawing in this order (what the renderer binds) */
+    size_t state_changes(const vector<RenderQueue::DrawItem> &items)
+    {
+        size_t changes = 0;
+
+        for(size_t i = 0;i < items.size();i++) {
+            if(i == 0 || key_state(items[i].key) != key_state(items[i - 1].key)) changes++;
+        }
+
+        return changes;
+    }
+
+    /* Two overlapping translucent surfaces : the far one must be drawn first whatever their materials, and after the opaque ones */
+    bool translucent_order()
+    {
+        RenderQueue queue;
+        AbstractMesh *farMesh = reinterpret_cast<AbstractMesh*>(1), *nearMesh = reinterpret_cast<AbstractMesh*>(2),
+                     *opaqueMesh = reinterpret_cast<AbstractMesh*>(3);
+
+        queue.push(RenderQueue::makeKey(RENDER_PASS_TRANSLUCENT, 3, 1, 40, 0.8f), farMesh); // Greater state than the near one
+        queue.push(RenderQueue::makeKey(RENDER_PASS_TRANSLUCENT, 3, 1, 2, 0.2f), nearMesh);
+        queue.push(RenderQueue::makeKey(RENDER_PASS_OPAQUE, 3, 7, 50, 0.9f), opaqueMesh);
+        queue.sort();
+
+        return queue[0].mesh == opaqueMesh && queue[1].mesh == farMesh && queue[2].mesh == nearMesh;
+    }
+}
+
+/// \brief RenderQueue::sort() (with its push loop) against a std::sort of a copy on the same keys, and the state changes saved by the sorted order.
+int bench::render_queue(const vector<string> &args)
+{
+    vector<size_t> counts = {100, 1000, 10000, 100000};
+    if(!args.empty()) counts.assign(1, (size_t) atol(args[0].c_str()));
+
+    bool ok = translucent_order();
+    cout << "Translucent items : " << (ok ? "back to front" : "WRONG ORDER") << endl;
+
+    for(size_t count : counts) {
+        vector<RenderQueue::DrawItem> items;
+        make_scene(count, items);
+
+        RenderQueue queue;
+        double queue_time = best_of(20, [&]() {
+            queue.clear();
+            for(const RenderQueue::DrawItem &item : items) queue.push(item.key, item.mesh);
+            queue.sort();
+        });
+
+        vector<RenderQueue::DrawItem> sorted;
+        double std_time = best_of(20, [&]() {
+            sorted = items;
+            sort(sorted.begin(), sorted.end(), [](const RenderQueue::DrawItem &a, const RenderQueue::DrawItem &b) { return a.key < b.key; });
+        });
+
+        bool same = (queue.size() == sorted.size());
+        for(size_t i = 0;same && i < sorted.size();i++) same = (queue[i].key == sorted[i].key);
+        ok = ok && same;
+
+        cout << setw(7) << count << " items | queue : " << fixed << setprecision(3) << queue_time << " ms | std::sort : " << std_time << " ms"
+             << " | state changes : " << state_changes(items) << " unsorted, " << state_changes(sorted) << " sorted" << (same ? "" : " MISMATCH") << endl;
+    }
+
+    return ok ? 0 : 1;
+}
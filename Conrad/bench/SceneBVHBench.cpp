@@ -0,0 +1,298 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <limits>
+#include "Benchmark.h"
+#include "MappedFile.h"
+#include "OBJParser.h"
+#include "SceneBVH.h"
+#include "FrustumCuller.h"
+
+using namespace std;
+
+namespace
+{
+    /* One object of the bundled files, placed in the scene : its triangles stay in place, the offset moves it (as a modelview would) */
+    struct Primitive {
+        const vector<float> *triangles; // 9 floats per triangle
+        float offset[3];
+        float boundsMin[3], boundsMax[3]; // World
+    };
+
+    struct Scene {
+        vector< vector<float> > objects; // Triangles of each distinct object
+        vector<float> objectMin, objectMax; // Their bounds, 3 floats each
+        vector<Primitive> primitives;
+        vector<float> boundsMin, boundsMax; // The SceneBVH::build() arrays
+        float sceneMin[3], sceneMax[3];
+    };
+
+    void load_objects(const vector<string> &files, Scene &scene)
+    {
+        for(const string &path : files) {
+            MappedFile file(path);
+            if(!file.isOpen()) {
+                cout << "Can't open " << path << endl;
+                continue;
+            }
+
+            OBJParser parser;
+            parser.parse(file.data(), file.end());
+            vector<coordinate3d> &vertices = parser.getVertices();
+
+            for(OBJParser::Object &object : parser.getObjects()) {
+                vector<float> triangles;
+                float boundsMin[3] = {numeric_limits<float>::max(), numeric_limits<float>::max(), numeric_limits<float>::max()},
+                      boundsMax[3] = {-numeric_limits<float>::max(), -numeric_limits<float>::max(), -numeric_limits<float>::max()};
+
+                for(size_t i = 0;i + 2 < object.faces_vertex_index.size();i += 3) {
+                    bool valid = true;
+                    for(int corner = 0;corner < 3;corner++) {
+                        int v = object.faces_vertex_index[i + corner];
+                        valid = valid && v >= 0 && v < (int) vertices.size();
+                    }
+                    if(!valid) continue;
+
+                    for(int corner = 0;corner < 3;corner++) {
+                        const coordinate3d &vertex = vertices[object.faces_vertex_index[i + corner]];
+                        float position[3] = {get<0>(vertex), get<1>(vertex), get<2>(vertex)};
+                        for(int axis = 0;axis < 3;axis++) {
+                            triangles.push_back(position[axis]);
+                            boundsMin[axis] = min(boundsMin[axis], position[axis]);
+                            boundsMax[axis] = max(boundsMax[axis], position[axis]);
+                        }
+                    }
+                }
+
+                if(triangles.empty()) continue;
+                scene.objects.push_back(triangles);
+                scene.objectMin.insert(scene.objectMin.end(), boundsMin, boundsMin + 3);
+                scene.objectMax.insert(scene.objectMax.end(), boundsMax, boundsMax + 3);
+            }
+        }
+    }
+
+    void place(Scene &scene, size_t primitive, const float offset[3])
+    {
+        Primitive &p = scene.primitives[primitive];
+        size_t object = p.triangles - scene.objects.data();
+
+        for(int axis = 0;axis < 3;axis++) {
+            p.offset[axis] = offset[axis];
+            p.boundsMin[axis] = scene.boundsMin[3 * primitive + axis] = scene.objectMin[3 * object + axis] + offset[axis];
+            p.boundsMax[axis] = scene.boundsMax[3 * primitive + axis] = scene.objectMax[3 * object + axis] + offset[axis];
+        }
+    }
+
+    /* tiles x tiles copies of all the objects, each copy on its own cell of the ground */
+    void tile_scene(Scene &scene, int tiles)
+    {
+        float cell = 0.0f;
+        for(size_t i = 0;i < scene.objects.size();i++) {
+            cell = max(cell, max(scene.objectMax[3*i] - scene.objectMin[3*i], scene.objectMax[3*i + 2] - scene.objectMin[3*i + 2]));
+        }
+        cell *= 1.1f;
+
+        size_t count = scene.objects.size() * tiles * tiles;
+        scene.primitives.resize(count);
+        scene.boundsMin.resize(3 * count);
+        scene.boundsMax.resize(3 * count);
+
+        size_t primitive = 0;
+        for(int x = 0;x < tiles;x++) {
+            for(int z = 0;z < tiles;z++) {
+                for(size_t object = 0;object < scene.objects.size();object++) {
+                    float offset[3] = {(x - 0.5f * tiles) * cell * 3.0f + (object % 3) * cell, 0.0f,
+                                       (z - 0.5f * tiles) * cell * 3.0f + (object / 3 % 3) * cell};
+                    scene.primitives[primitive].triangles = &scene.objects[object];
+                    place(scene, primitive++, offset);
+                }
+            }
+        }
+
+        for(int axis = 0;axis < 3;axis++) {
+            scene.sceneMin[axis] = numeric_limits<float>::max();
+            scene.sceneMax[axis] = -numeric_limits<float>::max();
+            for(size_t i = 0;i < count;i++) {
+                scene.sceneMin[axis] = min(scene.sceneMin[axis], scene.boundsMin[3*i + axis]);
+                scene.sceneMax[axis] = max(scene.sceneMax[axis], scene.boundsMax[3*i + axis]);
+            }
+        }
+    }
+
+    bool intersect_primitive(const Scene &scene, size_t primitive, const float origin[3], const float direction[3], float tMax, float &t, unsigned int &triangle)
+    {
+        const Primitive &p = scene.primitives[primitive];
+        float localOrigin[3] = {origin[0] - p.offset[0], origin[1] - p.offset[1], origin[2] - p.offset[2]};
+
+        bool hit = false;
+        t = tMax;
+        const vector<float> &triangles = *p.triangles;
+        for(size_t i = 0;i < triangles.size();i += 9) {
+            float distance;
+            if(SceneBVH::intersectTriangle(localOrigin, direction, &triangles[i], &triangles[i + 3], &triangles[i + 6], distance) && distance < t) {
+                t = distance;
+                triangle = i / 9;
+                hit = true;
+            }
+        }
+
+        return hit;
+    }
+
+    void make_frustum(const float eye[3], float yaw, float farPlane, float planes[6][4])
+    {
+        float clip[16];
+        bench::view_projection(eye, yaw, farPlane, clip);
+        FrustumCuller::extractPlanes(clip, planes);
+    }
+}
+
+/*!
+ *  \brief SceneBVH on the bundled objects, tiled on a ground : build, refit of 10% moving objects, frustum culls against testing every box,
+ *  nearest hit rays against testing every object (checked on the first rays).
+ */
+int bench::scene_bvh(const vector<string> &args)
+{
+    Scene scene;
+    load_objects(files_or_bundled(args), scene);
+    if(scene.objects.empty()) {
+        cout << "No object loaded" << endl;
+        return 1;
+    }
+
+    size_t triangleCount = 0;
+    for(const vector<float> &triangles : scene.objects) triangleCount += triangles.size() / 9;
+    cout << scene.objects.size() << " objects, " << triangleCount << " triangles" << endl;
+
+    bool ok = true;
+    for(int tiles : {1, 8, 32}) {
+        tile_scene(scene, tiles);
+        size_t count = scene.primitives.size();
+
+        SceneBVH bvh;
+        double buildTime = best_of(5, [&]() { bvh.build(count, scene.boundsMin.data(), scene.boundsMax.data()); });
+
+        /* Refit : 10% of the objects move by up to a cell */
+        mt19937 random(42);
+        uniform_real_distribution<float> step(-1.0, 1.0);
+        vector<size_t> moving;
+        for(size_t i = 0;i < count;i += 10) moving.push_back(i);
+
+        double refitTime = best_of(5, [&]() {
+            for(size_t i : moving) {
+                float offset[3] = {scene.primitives[i].offset[0] + step(random), scene.primitives[i].offset[1], scene.primitives[i].offset[2] + step(random)};
+                place(scene, i, offset);
+                bvh.refit(i, scene.primitives[i].boundsMin, scene.primitives[i].boundsMax);
+            }
+        });
+
+        /* Frustum queries from the middle of the scene, all around */
+        FrustumCuller flat;
+        flat.resize(count);
+        for(size_t i = 0;i < count;i++) {
+            const Primitive &p = scene.primitives[i];
+            float center[3], extents[3];
+            for(int axis = 0;axis < 3;axis++) {
+                center[axis] = 0.5f * (p.boundsMin[axis] + p.boundsMax[axis]);
+                extents[axis] = 0.5f * (p.boundsMax[axis] - p.boundsMin[axis]);
+            }
+            flat.setVolume(i, center, extents, numeric_limits<float>::max()); // Boxes only, as the BVH
+        }
+
+        float eye[3], diagonal = 0.0f;
+        for(int axis = 0;axis < 3;axis++) {
+            eye[axis] = 0.5f * (scene.sceneMin[axis] + scene.sceneMax[axis]);
+            diagonal += (scene.sceneMax[axis] - scene.sceneMin[axis]) * (scene.sceneMax[axis] - scene.sceneMin[axis]);
+        }
+        diagonal = sqrt(diagonal);
+
+        const int frustums = 64;
+        vector<unsigned char> visible(count), reference(count);
+        size_t visibleCount = 0;
+        bool sameCull = true;
+
+        double bvhCullTime = best_of(5, [&]() {
+            visibleCount = 0;
+            for(int i = 0;i < frustums;i++) {
+                float planes[6][4];
+                make_frustum(eye, i * 2.0 * 3.14159265 / frustums, 0.25f * diagonal, planes);
+                visibleCount += bvh.cullFrustum(planes, visible.data());
+            }
+        });
+        double flatCullTime = best_of(5, [&]() {
+            for(int i = 0;i < frustums;i++) {
+                float planes[6][4];
+                make_frustum(eye, i * 2.0 * 3.14159265 / frustums, 0.25f * diagonal, planes);
+                flat.cullScalar(planes, reference.data());
+            }
+        });
+
+        for(int i = 0;i < frustums;i++) {
+            float planes[6][4];
+            make_frustum(eye, i * 2.0 * 3.14159265 / frustums, 0.25f * diagonal, planes);
+            bvh.cullFrustum(planes, visible.data());
+            flat.cullScalar(planes, reference.data());
+            sameCull = sameCull && (visible == reference);
+        }
+
+        /* Rays from above the scene, towards random points of the ground */
+        const int rays = 2000, checkedRays = 50;
+        uniform_real_distribution<float> unit(0.0, 1.0);
+        vector<float> origins(3 * rays), directions(3 * rays);
+        for(int i = 0;i < rays;i++) {
+            float target[3] = {scene.sceneMin[0] + unit(random) * (scene.sceneMax[0] - scene.sceneMin[0]), scene.sceneMin[1],
+                               scene.sceneMin[2] + unit(random) * (scene.sceneMax[2] - scene.sceneMin[2])};
+            for(int axis = 0;axis < 3;axis++) {
+                origins[3*i + axis] = eye[axis];
+                directions[3*i + axis] = target[axis] - eye[axis];
+            }
+            origins[3*i + 1] = scene.sceneMax[1] + 1.0f;
+            directions[3*i + 1] = target[1] - origins[3*i + 1];
+        }
+
+        SceneBVH::RayCallback intersect;
+        vector<SceneBVH::RayHit> hits(rays);
+        vector<char> found(rays);
+        const float *origin = nullptr, *direction = nullptr;
+        intersect = [&](size_t primitive, float tMax, float &t, unsigned int &triangle) {
+            return intersect_primitive(scene, primitive, origin, direction, tMax, t, triangle);
+        };
+
+        size_t hitCount = 0;
+        double rayTime = best_of(3, [&]() {
+            hitCount = 0;
+            for(int i = 0;i < rays;i++) {
+                origin = &origins[3*i];
+                direction = &directions[3*i];
+                found[i] = bvh.raycast(origin, direction, numeric_limits<float>::max(), intersect, hits[i]);
+                hitCount += found[i];
+            }
+        });
+
+        bool sameRays = true;
+        for(int i = 0;i < checkedRays;i++) {
+            float nearest = numeric_limits<float>::max();
+            for(size_t primitive = 0;primitive < count;primitive++) {
+                float t;
+                unsigned int triangle;
+                if(intersect_primitive(scene, primitive, &origins[3*i], &directions[3*i], nearest, t, triangle)) nearest = t;
+            }
+
+            bool hit = nearest < numeric_limits<float>::max();
+            sameRays = sameRays && (hit == (bool) found[i]) && (!hit || nearest == hits[i].distance);
+        }
+
+        ok = ok && sameCull && sameRays;
+        cout << setw(7) << count << " objects | " << bvh.getNodeCount() << " nodes | build : " << fixed << setprecision(3) << buildTime
+             << " ms | refit (" << moving.size() << " moved) : " << refitTime << " ms | cull : " << 1000.0 * bvhCullTime / frustums
+             << " us/frustum (flat " << 1000.0 * flatCullTime / frustums << " us, " << visibleCount / frustums << " visible)"
+             << (sameCull ? "" : " MISMATCH") << " | rays : " << setprecision(0) << rays / (rayTime / 1000.0) << "/s (" << hitCount << "/" << rays << " hit)"
+             << (sameRays ? "" : " MISMATCH") << endl;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,372 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "Benchmark.h"
+#include "SceneFormatReader.h"
+#include "DecodePool.h"
+#include "MeshOptimizer.h"
+
+using namespace std;
+
+namespace
+{
+    const char *generated_path = "bench_generated.scene";
+
+    template<typename T>
+    void put(vector<char> &body, T value)
+    {
+        body.insert(body.end(), (const char *) &value, (const char *) &value + sizeof(T));
+    }
+
+    void put_string(vector<char> &body, const string &value)
+    {
+        body.insert(body.end(), value.c_str(), value.c_str() + value.size() + 1);
+    }
+
+    /* v2 objects start aligned : the body offset gives the padding */
+    void put_padding(vector<char> &body)
+    {
+        body.resize(body.size() + (SCENE_ALIGNMENT - body.size() % SCENE_ALIGNMENT) % SCENE_ALIGNMENT, 0);
+    }
+
+    void put_vector_array(vector<char> &body, int count, int dimension, float seed, int version)
+    {
+        put(body, count);
+        put(body, dimension);
+        if(version >= 2) put_padding(body);
+        for(int i = 0;i < count * dimension;i++) put(body, seed + 0.001f * i);
+    }
+
+    /* v1 : [code][size][data]. v2 : aligned data, the entry goes to the table of contents */
+    void put_object(ofstream &file, char type, const string &name, const vector<char> &body, int version, vector<char> &toc)
+    {
+        unsigned int size = body.size();
+
+        if(version >= 2) {
+            vector<char> padding;
+            padding.resize((SCENE_ALIGNMENT - (size_t) file.tellp() % SCENE_ALIGNMENT) % SCENE_ALIGNMENT, 0);
+            file.write(padding.data(), padding.size());
+
+            put(toc, type);
+            put(toc, (unsigned int) file.tellp());
+            put(toc, size);
+            put_string(toc, name);
+        } else {
+            file.put(type);
+            file.write((const char *) &size, sizeof(size));
+        }
+
+        file.write(body.data(), body.size());
+    }
+
+    /* A scene as conrad_export.py writes it : one material, then meshCount non-indexed meshes */
+    void generate_scene(const string &path, int meshCount, int verticesPerMesh, int version = 1)
+    {
+        ofstream file(path.c_str(), ios::out | ios::binary | ios::trunc);
+
+        vector<char> toc;
+        if(version >= 2) {
+            unsigned int header[3] = {SCENE_VERSION, 0, 0}; // Count and table offset are written at the end
+            file.write(SCENE_MAGIC, 4);
+            file.write((const char *) header, sizeof(header));
+        }
+
+        vector<char> material;
+        put_string(material, "Generated");
+        for(int c = 0;c < 2;c++) { put(material, 3); put(material, 0.5f); put(material, 0.5f); put(material, 0.5f); }
+        put(material, 0.5f);
+        for(int c = 0;c < 2;c++) { put(material, 3); put(material, 0.5f); put(material, 0.5f); put(material, 0.5f); }
+        put(material, 32);
+        put_string(material, "textures/blank.png");
+        put_object(file, MATERIAL_OBJECT_CODE, "Generated", material, version, toc);
+
+        for(int m = 0;m < meshCount;m++) {
+            vector<char> mesh;
+            put(mesh, (char) OBJTYPE_STATIC);
+            put_string(mesh, "Mesh_" + to_string(m));
+            put_vector_array(mesh, verticesPerMesh, 3, m, version);
+            put_string(mesh, "Generated");
+            put_vector_array(mesh, verticesPerMesh, 2, m, version);
+            put_vector_array(mesh, verticesPerMesh, 3, m, version);
+            put_object(file, MESH_OBJECT_CODE, "Mesh_" + to_string(m), mesh, version, toc);
+        }
+
+        if(version >= 2) {
+            unsigned int header[2] = {(unsigned int) meshCount + 1, (unsigned int) file.tellp()};
+            file.write(toc.data(), toc.size());
+            file.seekp(8);
+            file.write((const char *) header, sizeof(header));
+        }
+    }
+
+    /* Stands for the upload : glBufferSubData copies the arrays to the driver */
+    struct Upload {
+        vector<char> staging;
+        double checksum = 0.0;
+
+        void operator()(const void *data, size_t size)
+        {
+            if(staging.size() < size) staging.resize(size);
+            memcpy(staging.data(), data, size);
+
+            float last = 0.0;
+            if(size >= sizeof(float)) memcpy(&last, staging.data() + size - sizeof(float), sizeof(float));
+            checksum += last;
+        }
+    };
+
+    /* The former path : one malloc + ifstream::read per object, raw pointers into the buffer. The meshes keep pointing into their
+       buffers after the upload (ray queries, batching) : the buffers are kept in bodies, freed by the caller */
+    size_t load_legacy(const string &path, Upload &upload, vector<char *> &bodies)
+    {
+        ifstream file(path.c_str(), ios::in | ios::binary);
+        size_t meshes = 0;
+
+        while(true) {
+            char type; file.get(type);
+            if(file.eof()) break;
+
+            char buffer[4];
+            file.read(buffer, 4);
+            unsigned int size;
+            memcpy(&size, buffer, 4);
+            if(file.eof()) break;
+
+            char *data = (char *) malloc(size);
+            file.read(data, size);
+
+            if(type == MESH_OBJECT_CODE) {
+                char *pointer = data + 1;
+                pointer += strlen(pointer) + 1; // Name
+
+                for(int a = 0;a < 3;a++) { // Vertices, (material name), texture coordinates, normals
+                    int count, dimension;
+                    memcpy(&count, pointer, 4);
+                    memcpy(&dimension, pointer + 4, 4);
+                    upload(pointer + 8, count * dimension * sizeof(float));
+                    pointer += 8 + count * dimension * sizeof(float);
+
+                    if(a == 0) pointer += strlen(pointer) + 1; // Material name
+                }
+
+                meshes++;
+                bodies.push_back(data);
+            } else {
+                free(data);
+            }
+        }
+
+        return meshes;
+    }
+
+    /* One mesh by name : table of contents (v2) or object headers walk (v1), then that mesh only */
+    size_t load_one(const string &path, const string &name, Upload &upload, bool &aligned)
+    {
+        SceneFormatReader reader;
+        reader.open(path);
+
+        SceneFormatReader::Object object;
+        SceneFormatReader::MeshData mesh;
+        if(!reader.find_object(MESH_OBJECT_CODE, name, object) || !SceneFormatReader::decodeMesh(object, mesh)) return 0;
+
+        upload(mesh.vertices, mesh.verticesCount * 3 * sizeof(float));
+        upload(mesh.texCoords, mesh.texCount * 2 * sizeof(float));
+        upload(mesh.vertexNormals, mesh.normalsCount * 3 * sizeof(float));
+
+        aligned = ((uintptr_t) mesh.vertices % SCENE_ALIGNMENT == 0) && ((uintptr_t) mesh.texCoords % SCENE_ALIGNMENT == 0)
+                  && ((uintptr_t) mesh.vertexNormals % SCENE_ALIGNMENT == 0);
+        return 1;
+    }
+
+    /* Same scene written in v1 and v2 : lookup of the last mesh */
+    int lookup(int meshCount, int verticesPerMesh)
+    {
+        string name = "Mesh_" + to_string(meshCount - 1);
+        double checksums[2] = {0.0, 0.0};
+
+        for(int version = 1;version <= 2;version++) {
+            generate_scene(generated_path, meshCount, verticesPerMesh, version);
+
+            Upload upload;
+            size_t found = 0;
+            bool aligned = false;
+            double elapsed = bench::best_of(5, [&]() { found = load_one(generated_path, name, upload, aligned); });
+            checksums[version - 1] = upload.checksum / 5;
+
+            cout << "v" << version << " " << name << (found ? "" : " NOT FOUND") << " : " << fixed << setprecision(3) << elapsed << " ms, arrays "
+                 << (aligned ? "aligned" : "unaligned") << endl;
+
+            remove(generated_path);
+            if(!found) return 1;
+        }
+
+        bool same = checksums[0] == checksums[1];
+        if(!same) cout << "MISMATCH between the two versions" << endl;
+
+        return same ? 0 : 1;
+    }
+
+    /* A parse() mesh task : decoded, welded, optimized and bounded on a worker, "uploaded" on the calling thread */
+    struct MeshTask {
+        SceneFormatReader::Object object;
+        vector<MeshOptimizer::VertexStream> streams;
+        vector<unsigned int> indices;
+        size_t vertexCount = 0;
+        float bounds[6];
+    };
+
+    double load_parallel(const string &path, unsigned int threadCount, Upload &upload, unsigned int &workers)
+    {
+        SceneFormatReader reader;
+        reader.open(path);
+
+        vector<MeshTask> tasks;
+        SceneFormatReader::Object object;
+        while(reader.read_object(object)) {
+            if(object.type != MESH_OBJECT_CODE) continue;
+            tasks.push_back(MeshTask());
+            tasks.back().object = object;
+        }
+
+        DecodePool pool(threadCount);
+        double elapsed = bench::best_of(1, [&]() {
+            pool.run(tasks.size(),
+                [&](size_t i) {
+                    MeshTask &task = tasks[i];
+                    SceneFormatReader::MeshData mesh;
+                    if(!SceneFormatReader::decodeMesh(task.object, mesh)) return;
+
+                    task.streams = {{(float *) mesh.vertices, 3}, {(float *) mesh.texCoords, 2}, {(float *) mesh.vertexNormals, 3}};
+                    task.vertexCount = MeshOptimizer::weld(task.streams, mesh.verticesCount, task.indices);
+                    MeshOptimizer::optimize(task.indices, task.vertexCount, task.streams);
+
+                    const float *positions = task.streams[0].data;
+                    for(int c = 0;c < 3;c++) task.bounds[c] = task.bounds[3 + c] = positions[c];
+                    for(size_t v = 1;v < task.vertexCount;v++) {
+                        for(int c = 0;c < 3;c++) {
+                            task.bounds[c] = min(task.bounds[c], positions[3*v + c]);
+                            task.bounds[3 + c] = max(task.bounds[3 + c], positions[3*v + c]);
+                        }
+                    }
+                },
+                [&](size_t i) {
+                    MeshTask &task = tasks[i];
+                    for(const MeshOptimizer::VertexStream &stream : task.streams) {
+                        upload(stream.data, task.vertexCount * stream.components * sizeof(float));
+                        free(stream.data); // Welded copies
+                    }
+                    upload(task.indices.data(), task.indices.size() * sizeof(unsigned int));
+                    upload(task.bounds, sizeof(task.bounds));
+                });
+        });
+
+        workers = pool.getWorkerCount();
+        return elapsed;
+    }
+
+    /* 500 meshes scene : startup time against the worker count */
+    int parallel(unsigned int maxThreads)
+    {
+        generate_scene(generated_path, 500, 4096, SCENE_VERSION);
+
+        double serial = 0.0, reference = 0.0;
+        bool same = true;
+        for(unsigned int threads = 1;threads <= maxThreads;threads *= 2) {
+            Upload upload;
+            unsigned int workers;
+            double elapsed = load_parallel(generated_path, threads, upload, workers);
+
+            if(threads == 1) {
+                serial = elapsed;
+                reference = upload.checksum;
+            } else if(upload.checksum != reference) {
+                same = false;
+            }
+
+            cout << setw(3) << threads << " threads (" << workers << " workers) : " << fixed << setprecision(2) << elapsed << " ms, speedup x"
+                 << serial / elapsed << endl;
+        }
+
+        remove(generated_path);
+        if(!same) cout << "MISMATCH between the thread counts" << endl;
+
+        return same ? 0 : 1;
+    }
+
+    /* The mapped path : views into the mapping, uploaded as is. The meshes keep the mapping open (SceneFormatParser shares its reader
+       with them), but the released pages leave the working set : they are paged in again if a mesh reads its arrays */
+    size_t load_mapped(const string &path, Upload &upload, SceneFormatReader &reader)
+    {
+        reader.open(path);
+        size_t meshes = 0;
+
+        SceneFormatReader::Object object;
+        while(reader.read_object(object)) {
+            if(object.type != MESH_OBJECT_CODE) continue;
+
+            SceneFormatReader::MeshData mesh;
+            if(!SceneFormatReader::decodeMesh(object, mesh)) continue;
+
+            upload(mesh.vertices, mesh.verticesCount * 3 * sizeof(float));
+            upload(mesh.texCoords, mesh.texCount * 2 * sizeof(float));
+            upload(mesh.vertexNormals, mesh.normalsCount * 3 * sizeof(float));
+            reader.release(object);
+            meshes++;
+        }
+
+        return meshes;
+    }
+}
+
+/*!
+ *  \brief Loads a large .scene with the former ifstream path and with the mapped reader : time and peak RSS. The mesh arrays are kept
+ *  until the end, as the meshes keep them.
+ *  Usage : scene [legacy|mapped|both] [file.scene]. The peak RSS only grows during a run : measure one path per run to compare them.
+ *  Without a file, a 256 meshes x 65536 vertices scene (~512 MB) is generated, then deleted.
+ *  scene lookup : loads the last mesh by name of a 4096 meshes x 1024 vertices scene, written in v1 then in v2.
+ *  scene parallel [threads] : two-phase load (DecodePool) of a 500 meshes scene with 1, 2, 4, ... threads (default : up to the core count).
+ */
+int bench::scene_format(const vector<string> &args)
+{
+    string mode = args.empty() ? "both" : args[0];
+    if(mode == "lookup") return lookup(4096, 1024);
+    if(mode == "parallel") return parallel((args.size() > 1) ? atoi(args[1].c_str()) : max(1u, thread::hardware_concurrency()));
+
+    string path = (args.size() > 1) ? args[1] : generated_path;
+
+    bool generated = (args.size() <= 1);
+    if(generated) generate_scene(path, 256, 65536);
+
+    cout << "Peak RSS before loading : " << peak_rss_kb() / 1024 << " MB" << endl;
+
+    double checksums[2] = {0.0, 0.0};
+    const char *names[2] = {"mapped", "legacy"};
+    bool ran[2] = {false, false};
+
+    for(int p = 0;p < 2;p++) {
+        if(mode != "both" && mode != names[p]) continue;
+
+        Upload upload;
+        size_t meshes = 0;
+        vector<char *> bodies;
+        SceneFormatReader reader;
+        double elapsed = best_of(1, [&]() { meshes = (p == 0) ? load_mapped(path, upload, reader) : load_legacy(path, upload, bodies); });
+
+        checksums[p] = upload.checksum;
+        ran[p] = true;
+        cout << left << setw(8) << names[p] << right << setw(6) << meshes << " meshes : " << fixed << setprecision(2) << elapsed << " ms, peak RSS "
+             << peak_rss_kb() / 1024 << " MB" << endl;
+        for(char *body : bodies) free(body);
+    }
+
+    if(generated) remove(path.c_str());
+
+    bool same = !(ran[0] && ran[1]) || checksums[0] == checksums[1];
+    if(!same) cout << "MISMATCH between the two paths" << endl;
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+#include "Benchmark.h"
+#include "ShadowAtlas.h"
+
+using namespace std;
+
+namespace
+{
+    /* Every tile inside the atlas, none overlapping (checked on the grid of the smallest tiles) */
+    bool valid(const ShadowAtlas &atlas, size_t count)
+    {
+        unsigned int cells = atlas.getSize() / SHADOW_ATLAS_MIN_TILE;
+        vector<unsigned char> used(cells * cells, 0);
+
+        for(size_t i = 0;i < count;i++) {
+            const ShadowAtlas::Tile &tile = atlas.getTile(i);
+            if(tile.size == 0) continue;
+            if(tile.x % tile.size != 0 || tile.y % tile.size != 0 || tile.x + tile.size > atlas.getSize() || tile.y + tile.size > atlas.getSize()) return false;
+
+            for(unsigned int y = tile.y / SHADOW_ATLAS_MIN_TILE;y < (tile.y + tile.size) / SHADOW_ATLAS_MIN_TILE;y++) {
+                for(unsigned int x = tile.x / SHADOW_ATLAS_MIN_TILE;x < (tile.x + tile.size) / SHADOW_ATLAS_MIN_TILE;x++) {
+                    if(used[y * cells + x]) return false;
+                    used[y * cells + x] = 1;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /* count spot lights of range 5 to 15 m scattered up to 60 m from the camera (70°) : one frame of requests */
+    void request(ShadowAtlas &atlas, size_t count, unsigned int seed)
+    {
+        srand(seed);
+        float projectionScale = 1.0 / tan(0.5 * 70.0 * 3.14159265 / 180.0);
+
+        atlas.clear();
+        for(size_t i = 0;i < count;i++) {
+            float distance = 2.0f + 58.0f * rand() / RAND_MAX, range = 5.0f + 10.0f * rand() / RAND_MAX;
+            atlas.request(ShadowAtlas::importance(distance, range, projectionScale));
+        }
+    }
+}
+
+/*!
+ *  \brief Packs the atlas for growing numbers of spot lights : tiles given, their sizes, the texels used and the pack time. The memory is
+ *  the one of the atlas whatever the count, against one SHADOWMAP_SIZE map per light.
+ */
+int bench::shadow_atlas(const vector<string> &args)
+{
+    const size_t counts[] = {8, 24, 48, 96, 256};
+    ShadowAtlas atlas;
+    bool ok = true;
+
+    double atlasMiB = (double) atlas.getSize() * atlas.getSize() * 4 / (1024 * 1024);
+    cout << "Atlas : " << atlas.getSize() << "x" << atlas.getSize() << " = " << fixed << setprecision(0) << atlasMiB << " MiB of depth" << endl;
+
+    for(size_t c = 0;c < sizeof(counts) / sizeof(counts[0]);c++) {
+        size_t count = counts[c];
+        request(atlas, count, 1234);
+        unsigned int tiles = atlas.pack();
+        ok = ok && valid(atlas, count);
+
+        unsigned int largest = 0, smallest = 0;
+        for(size_t i = 0;i < count;i++) {
+            unsigned int size = atlas.getTile(i).size;
+            if(size == 0) continue;
+            largest = max(largest, size);
+            smallest = (smallest == 0) ? size : min(smallest, size);
+        }
+
+        double time = best_of(20, [&]() {
+            for(int i = 0;i < 100;i++) {
+                request(atlas, count, 1234);
+                atlas.pack();
+            }
+        }) * 10.0; // us per frame
+
+        double separateMiB = (double) count * SHADOWMAP_SIZE * SHADOWMAP_SIZE * 4 / (1024 * 1024);
+        cout << setw(4) << count << " lights : " << setw(4) << tiles << " tiles (" << smallest << " to " << largest << " texels), "
+             << setprecision(1) << setw(5) << 100.0 * atlas.getUsedTexels() / ((double) atlas.getSize() * atlas.getSize()) << "% used, "
+             << setprecision(2) << time << " us per frame (requests + pack) ; separate maps : " << setprecision(0) << separateMiB << " MiB" << endl;
+    }
+
+    cout << (ok ? "Tiles inside the atlas, no overlap" : "Invalid packing") << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include "Benchmark.h"
+#include "ShadowCascades.h"
+
+using namespace std;
+
+namespace
+{
+    /* glm::lookAt(eye, eye + direction, up) (column-major) */
+    void look_at(const float eye[3], const float direction[3], const float up[3], float view[16])
+    {
+        float f[3], s[3], u[3];
+        float length = sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+        for(int axis = 0;axis < 3;axis++) f[axis] = direction[axis] / length;
+
+        s[0] = f[1] * up[2] - f[2] * up[1];
+        s[1] = f[2] * up[0] - f[0] * up[2];
+        s[2] = f[0] * up[1] - f[1] * up[0];
+        length = sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+        for(int axis = 0;axis < 3;axis++) s[axis] /= length;
+
+        u[0] = s[1] * f[2] - s[2] * f[1];
+        u[1] = s[2] * f[0] - s[0] * f[2];
+        u[2] = s[0] * f[1] - s[1] * f[0];
+
+        for(int axis = 0;axis < 3;axis++) {
+            view[4 * axis] = s[axis];
+            view[4 * axis + 1] = u[axis];
+            view[4 * axis + 2] = -f[axis];
+            view[4 * axis + 3] = 0.0f;
+        }
+        view[12] = -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]);
+        view[13] = -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]);
+        view[14] = f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2];
+        view[15] = 1.0f;
+    }
+
+    /* Camera of the engine (70°, 16/9, z up) at eye, looking horizontally at yaw : near plane corners, then far plane ones */
+    void frustum_corners(const float eye[3], float yaw, float nearDepth, float farDepth, float corners[8][3])
+    {
+        float forward[3] = {sin(yaw), cos(yaw), 0.0f}, right[3] = {cos(yaw), -sin(yaw), 0.0f}, up[3] = {0.0f, 0.0f, 1.0f};
+        float tangent = tan(0.5 * 70.0 * 3.14159265 / 180.0);
+
+        for(int corner = 0;corner < 8;corner++) {
+            float depth = (corner < 4) ? nearDepth : farDepth;
+            float x = ((corner & 1) ? 1.0f : -1.0f) * depth * tangent * 16.0f / 9.0f,
+                  y = ((corner & 2) ? 1.0f : -1.0f) * depth * tangent;
+
+            for(int axis = 0;axis < 3;axis++) corners[corner][axis] = eye[axis] + depth * forward[axis] + x * right[axis] + y * up[axis];
+        }
+    }
+
+    void transform(const float *matrix, const float point[3], float result[3])
+    {
+        for(int row = 0;row < 3;row++) {
+            result[row] = matrix[row] * point[0] + matrix[4 + row] * point[1] + matrix[8 + row] * point[2] + matrix[12 + row];
+        }
+    }
+
+    /* Walks the camera along a curve : largest change of the sub-texel position of the maps, in texels, and frames where the matrix of
+       each cascade changed (the Renderer re-renders it then). false if a slice leaves its map */
+    bool walk(ShadowCascades &cascades, const float lightView[16], vector<double> &drift, vector<int> &changes)
+    {
+        const float sceneMin[3] = {-100.0f, -100.0f, -5.0f}, sceneMax[3] = {100.0f, 100.0f, 20.0f}, origin[3] = {0.0f, 0.0f, 0.0f};
+        const float nearDepth = 0.001f, farDepth = 100.0f; // RENDER_NEAR_PLANE, RENDER_FAR_PLANE
+
+        vector<float> firstU(cascades.getCount()), firstV(cascades.getCount());
+        drift.assign(cascades.getCount(), 0.0);
+        changes.assign(cascades.getCount(), 0);
+        vector<float> previous(16 * cascades.getCount(), 0.0f);
+        bool covered = true;
+
+        for(int frame = 0;frame < 2000;frame++) {
+            float eye[3] = {0.013f * frame, 0.007f * frame, 1.7f}, corners[8][3];
+            frustum_corners(eye, 0.3f + 0.0005f * frame, nearDepth, farDepth, corners);
+            cascades.fit(corners, nearDepth, farDepth, lightView, sceneMin, sceneMax);
+
+            for(unsigned int i = 0;i < cascades.getCount();i++) {
+                const float *matrix = cascades.getMatrix(i);
+                if(frame > 0 && !equal(matrix, matrix + 16, &previous[16 * i])) changes[i]++;
+                copy(matrix, matrix + 16, &previous[16 * i]);
+
+                /* A fixed world point : where it falls inside its texel must not change */
+                float projected[3];
+                transform(matrix, origin, projected);
+                float u = (projected[0] * 0.5f + 0.5f) * cascades.getResolution(), v = (projected[1] * 0.5f + 0.5f) * cascades.getResolution();
+                u -= floor(u);
+                v -= floor(v);
+
+                if(frame == 0) {
+                    firstU[i] = u;
+                    firstV[i] = v;
+                }
+
+                double du = fabs(u - firstU[i]), dv = fabs(v - firstV[i]);
+                drift[i] = max(drift[i], max(min(du, 1.0 - du), min(dv, 1.0 - dv))); // Wrapped around the texel
+
+                /* The slice must be inside its map */
+                float sliceCorners[8][3];
+                float sliceNear = (i == 0) ? nearDepth : cascades.getSplit(i - 1), sliceFar = cascades.getSplit(i);
+                frustum_corners(eye, 0.3f + 0.0005f * frame, sliceNear, sliceFar, sliceCorners);
+                for(int corner = 0;corner < 8;corner++) {
+                    transform(matrix, sliceCorners[corner], projected);
+                    if(fabs(projected[0]) > 1.0f || fabs(projected[1]) > 1.0f || fabs(projected[2]) > 1.0f) covered = false;
+                }
+            }
+        }
+
+        return covered;
+    }
+}
+
+/*!
+ *  \brief Cascades of a sun over the engine camera (near 0.001, far 100) : splits and texel sizes against the single 100 m map the sun
+ *  used, the fit time, and the shimmer of a walk (sub-texel drift of a fixed point) with and without texel snapping.
+ */
+int bench::shadow_cascades(const vector<string> &args)
+{
+    const float sunEye[3] = {0.0f, 0.0f, 0.0f}, sunDirection[3] = {-1.0f, 0.0f, -1.0f}, up[3] = {0.0f, 0.0f, 1.0f};
+    float lightView[16];
+    look_at(sunEye, sunDirection, up, lightView);
+
+    ShadowCascades cascades, unsnapped;
+    unsnapped.setTexelSnapping(false);
+
+    const float sceneMin[3] = {-100.0f, -100.0f, -5.0f}, sceneMax[3] = {100.0f, 100.0f, 20.0f}, eye[3] = {0.0f, 0.0f, 1.7f};
+    float corners[8][3];
+    frustum_corners(eye, 0.3f, 0.001f, 100.0f, corners);
+
+    double time = best_of(20, [&]() {
+        for(int i = 0;i < 1000;i++) cascades.fit(corners, 0.001f, 100.0f, lightView, sceneMin, sceneMax);
+    });
+
+    cout << "Single map : 100 m over " << SHADOWMAP_SIZE << " texels = " << fixed << setprecision(4) << 100.0 / SHADOWMAP_SIZE << " m per texel" << endl;
+    for(unsigned int i = 0;i < cascades.getCount();i++) {
+        cout << "Cascade " << i << " : up to " << setw(8) << setprecision(3) << cascades.getSplit(i) << " m, " << cascades.getResolution() << " texels, "
+             << setprecision(4) << cascades.getTexelSize(i) << " m per texel" << endl;
+    }
+    cout << "Fit : " << setprecision(3) << time << " us" << endl;
+
+    vector<double> drift, unsnappedDrift;
+    vector<int> changes, unsnappedChanges;
+    bool covered = walk(cascades, lightView, drift, changes);
+    bool unsnappedCovered = walk(unsnapped, lightView, unsnappedDrift, unsnappedChanges);
+
+    bool fewerChanges = true;
+    for(unsigned int i = 0;i < cascades.getCount();i++) {
+        cout << "Cascade " << i << " : sub-texel drift over the walk " << setprecision(4) << drift[i] << " texels (" << unsnappedDrift[i] << " without snapping), "
+             << changes[i] << " matrix changes in 1999 frames (" << unsnappedChanges[i] << ")" << endl;
+        fewerChanges = fewerChanges && changes[i] < unsnappedChanges[i];
+    }
+    cout << (covered && unsnappedCovered ? "Slices inside their maps" : "A slice leaves its map") << endl;
+
+    double worst = *max_element(drift.begin(), drift.end());
+    return (covered && unsnappedCovered && worst < 0.05 && fewerChanges) ? 0 : 1;
+}
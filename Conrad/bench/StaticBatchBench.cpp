@@ -0,0 +1,188 @@
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <limits>
+#include <algorithm>
+#include "Benchmark.h"
+#include "MappedFile.h"
+#include "OBJParser.h"
+#include "MeshBatcher.h"
+#include "FrustumCuller.h"
+
+using namespace std;
+
+namespace
+{
+    /* The objects of a file as triangle lists, grouped by material */
+    struct Object {
+        string material;
+        vector<float> vertices, texCoords;
+        float boundsMin[3], boundsMax[3];
+    };
+
+    bool load_objects(const string &path, vector<Object> &objects)
+    {
+        MappedFile file(path);
+        if(!file.isOpen()) return false;
+
+        OBJParser parser;
+        parser.parse(file.data(), file.end());
+        vector<coordinate3d> &vertices = parser.getVertices();
+        vector<coordinate2d> &tex = parser.getTexCoords();
+
+        for(OBJParser::Object &parsed : parser.getObjects()) {
+            Object object;
+            object.material = parsed.material;
+            for(int axis = 0;axis < 3;axis++) {
+                object.boundsMin[axis] = numeric_limits<float>::max();
+                object.boundsMax[axis] = -numeric_limits<float>::max();
+            }
+
+            for(size_t i = 0;i + 2 < parsed.faces_vertex_index.size();i += 3) {
+                bool valid = true;
+                for(int corner = 0;corner < 3;corner++) {
+                    int v = parsed.faces_vertex_index[i + corner];
+                    valid = valid && v >= 0 && v < (int) vertices.size();
+                }
+                if(!valid) continue;
+
+                for(int corner = 0;corner < 3;corner++) {
+                    const coordinate3d &vertex = vertices[parsed.faces_vertex_index[i + corner]];
+                    float position[3] = {get<0>(vertex), get<1>(vertex), get<2>(vertex)};
+                    for(int axis = 0;axis < 3;axis++) {
+                        object.vertices.push_back(position[axis]);
+                        object.boundsMin[axis] = min(object.boundsMin[axis], position[axis]);
+                        object.boundsMax[axis] = max(object.boundsMax[axis], position[axis]);
+                    }
+
+                    int t = parsed.faces_tex_index[i + corner];
+                    bool hasTex = t >= 0 && t < (int) tex.size();
+                    object.texCoords.push_back(hasTex ? get<0>(tex[t]) : 0.0f);
+                    object.texCoords.push_back(hasTex ? get<1>(tex[t]) : 0.0f);
+                }
+            }
+
+            if(!object.vertices.empty()) objects.push_back(object);
+        }
+
+        return true;
+    }
+}
+
+/*!
+ *  \brief MeshBatcher on each file, as is and tiled (copies placed by their modelview, as a level reuses props) : draw calls without and
+ *  with batching, merge time, then with culling : visible objects (one draw each) against the multi-draw calls and their ranges.
+ *  Frame times need a GL context : see the Renderer stats printed after RENDER_WARMUP_FRAMES frames.
+ */
+int bench::static_batch(const vector<string> &args)
+{
+    vector<string> files = args;
+    if(files.empty()) files = {"objects/space_scene.obj", "objects/nature.obj"};
+
+    for(const string &path : files) {
+        vector<Object> objects;
+        if(!load_objects(path, objects) || objects.empty()) {
+            cout << "Can't load " << path << endl;
+            continue;
+        }
+
+        float sceneMin[3], sceneMax[3];
+        for(int axis = 0;axis < 3;axis++) {
+            sceneMin[axis] = numeric_limits<float>::max();
+            sceneMax[axis] = -numeric_limits<float>::max();
+            for(const Object &object : objects) {
+                sceneMin[axis] = min(sceneMin[axis], object.boundsMin[axis]);
+                sceneMax[axis] = max(sceneMax[axis], object.boundsMax[axis]);
+            }
+        }
+
+        set<string> materials;
+        for(const Object &object : objects) materials.insert(object.material);
+        cout << path << " : " << objects.size() << " objects, " << materials.size() << " materials" << endl;
+
+        for(int tiles : {1, 8}) {
+            float spacing[3] = {1.2f * (sceneMax[0] - sceneMin[0]), 0.0f, 1.2f * (sceneMax[2] - sceneMin[2])};
+
+            /* One source per object copy, grouped by material */
+            map<string, vector<MeshBatcher::Source> > groups;
+            size_t drawCalls = 0;
+            for(int x = 0;x < tiles;x++) {
+                for(int z = 0;z < tiles;z++) {
+                    for(const Object &object : objects) {
+                        MeshBatcher::Source source;
+                        source.verticesCount = object.vertices.size() / 3;
+                        source.vertices = object.vertices.data();
+                        source.texCoords = object.texCoords.data();
+
+                        for(int i = 0;i < 16;i++) source.modelview[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+                        source.modelview[12] = (x - 0.5f * (tiles - 1)) * spacing[0];
+                        source.modelview[14] = (z - 0.5f * (tiles - 1)) * spacing[2];
+
+                        groups[object.material].push_back(source);
+                        drawCalls++;
+                    }
+                }
+            }
+
+            vector<MeshBatcher::Batch> batches;
+            double mergeTime = best_of(3, [&]() {
+                batches.clear();
+                for(map<string, vector<MeshBatcher::Source> >::iterator group = groups.begin();group != groups.end();group++) {
+                    MeshBatcher::merge(group->second, batches);
+                }
+            });
+
+            /* Culling : a camera in the middle, turning */
+            float eye[3] = {0.0f, 0.5f * (sceneMin[1] + sceneMax[1]), 0.0f};
+            float farPlane = 0.5f * tiles * max(spacing[0], spacing[2]);
+            const int frustums = 16;
+
+            vector<FrustumCuller> cullers(batches.size());
+            for(size_t b = 0;b < batches.size();b++) {
+                cullers[b].resize(batches[b].pieces.size());
+                for(size_t p = 0;p < batches[b].pieces.size();p++) {
+                    const MeshBatcher::Piece &piece = batches[b].pieces[p];
+                    float center[3], extents[3], radius = 0.0f;
+                    for(int axis = 0;axis < 3;axis++) {
+                        center[axis] = 0.5f * (piece.boundsMin[axis] + piece.boundsMax[axis]);
+                        extents[axis] = 0.5f * (piece.boundsMax[axis] - piece.boundsMin[axis]);
+                        radius += extents[axis] * extents[axis];
+                    }
+                    cullers[b].setVolume(p, center, extents, sqrt(radius));
+                }
+            }
+
+            size_t visiblePieces = 0, multiDraws = 0, ranges = 0;
+            vector<unsigned char> visible;
+            vector<unsigned int> firsts;
+            vector<int> counts;
+            double cullTime = best_of(3, [&]() {
+                visiblePieces = multiDraws = ranges = 0;
+                for(int f = 0;f < frustums;f++) {
+                    float clip[16], planes[6][4];
+                    view_projection(eye, f * 2.0 * 3.14159265 / frustums, farPlane, clip);
+                    FrustumCuller::extractPlanes(clip, planes);
+
+                    for(size_t b = 0;b < batches.size();b++) {
+                        size_t count = batches[b].pieces.size();
+                        visible.resize(count);
+                        firsts.resize(count);
+                        counts.resize(count);
+
+                        visiblePieces += cullers[b].cull(planes, visible.data());
+                        size_t batchRanges = MeshBatcher::coalesce(batches[b].pieces, visible.data(), firsts.data(), counts.data());
+                        ranges += batchRanges;
+                        multiDraws += (batchRanges > 0);
+                    }
+                }
+            });
+
+            cout << "  " << setw(3) << tiles << "x" << tiles << " | draw calls : " << drawCalls << " -> " << batches.size() << " | merge : " << fixed << setprecision(3)
+                 << mergeTime << " ms | culled, per frame : " << setprecision(1) << (double) visiblePieces / frustums << " visible objects -> "
+                 << (double) multiDraws / frustums << " multi-draws of " << (double) ranges / frustums << " ranges (" << setprecision(3) << 1000.0 * cullTime / frustums << " us)" << endl;
+        }
+    }
+
+    return 0;
+}
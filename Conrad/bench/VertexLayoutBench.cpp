@@ -0,0 +1,149 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "Benchmark.h"
+#include "MappedFile.h"
+#include "OBJParser.h"
+#include "VertexLayout.h"
+
+using namespace std;
+
+namespace
+{
+    /* One vertex per face corner, as a non-indexed mesh */
+    struct Arrays {
+        vector<float> positions, texCoords, normals;
+    };
+
+    void corner_arrays(OBJParser &parser, const OBJParser::Object &object, Arrays &arrays)
+    {
+        vector<coordinate3d> &vertices = parser.getVertices(), &normals = parser.getNormals();
+        vector<coordinate2d> &tex = parser.getTexCoords();
+
+        for(size_t i = 0;i < object.faces_vertex_index.size();i++) {
+            int v = object.faces_vertex_index[i], t = object.faces_tex_index[i], n = object.faces_normal_index[i];
+            if(v < 0 || v >= (int) vertices.size()) continue;
+
+            arrays.positions.insert(arrays.positions.end(), {get<0>(vertices[v]), get<1>(vertices[v]), get<2>(vertices[v])});
+
+            bool hasTex = t >= 0 && t < (int) tex.size();
+            arrays.texCoords.insert(arrays.texCoords.end(), {hasTex ? get<0>(tex[t]) : 0.0f, hasTex ? get<1>(tex[t]) : 0.0f});
+
+            float normal[3] = {0.0f, 0.0f, 1.0f};
+            if(n >= 0 && n < (int) normals.size()) {
+                normal[0] = get<0>(normals[n]); normal[1] = get<1>(normals[n]); normal[2] = get<2>(normals[n]);
+                float length = sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+                for(int axis = 0;axis < 3;axis++) normal[axis] = (length > 0.0f) ? normal[axis] / length : ((axis == 2) ? 1.0f : 0.0f);
+            }
+            arrays.normals.insert(arrays.normals.end(), normal, normal + 3);
+        }
+    }
+
+    struct Errors {
+        double position = 0.0; // Relative to the largest extent of the box
+        double normal = 0.0; // Degrees
+        double texCoord = 0.0;
+    };
+
+    /* Decodes the compact vertices (16 bits positions, octahedral normals, half texture coordinates) against the source arrays */
+    void measure_errors(const VertexLayout &layout, const Arrays &arrays, const vector<char> &encoded, const float decodeOffset[3], const float decodeScale[3], Errors &errors)
+    {
+        const vector<VertexLayout::Attribute> &attributes = layout.getAttributes();
+        size_t count = arrays.positions.size() / 3;
+        float extent = max(decodeScale[0], max(decodeScale[1], decodeScale[2]));
+
+        for(size_t i = 0;i < count;i++) {
+            const char *vertex = encoded.data() + i * layout.getStride();
+
+            for(const VertexLayout::Attribute &attribute : attributes) {
+                const char *source = vertex + attribute.offset;
+
+                if(attribute.location == VERTEX_BUFFER && extent > 0.0f) {
+                    uint16_t stored[3];
+                    memcpy(stored, source, sizeof(stored));
+                    for(int axis = 0;axis < 3;axis++) {
+                        float decoded = decodeOffset[axis] + decodeScale[axis] * (stored[axis] / 65535.0f);
+                        errors.position = max(errors.position, (double) fabs(decoded - arrays.positions[3*i + axis]) / extent);
+                    }
+                } else if(attribute.location == VERTEX_NORMAL_BUFFER) {
+                    int16_t stored[2];
+                    float decoded[3];
+                    memcpy(stored, source, sizeof(stored));
+                    VertexLayout::decodeOctahedral(stored, decoded);
+
+                    const float *normal = &arrays.normals[3*i];
+                    double cosine = min(1.0, (double) (decoded[0]*normal[0] + decoded[1]*normal[1] + decoded[2]*normal[2]));
+                    errors.normal = max(errors.normal, acos(cosine) * 180.0 / 3.14159265);
+                } else if(attribute.location == TEX_BUFFER) {
+                    uint16_t stored[2];
+                    memcpy(stored, source, sizeof(stored));
+                    for(int component = 0;component < 2;component++) {
+                        errors.texCoord = max(errors.texCoord, (double) fabs(VertexLayout::fromHalf(stored[component]) - arrays.texCoords[2*i + component]));
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*!
+ *  \brief GPU vertex memory of each file in the float layout against VertexLayout::compact(), the encoding time, and the largest
+ *  quantization errors (positions relative to the extent of their mesh, normals in degrees, texture coordinates in uv units).
+ */
+int bench::vertex_layout(const vector<string> &args)
+{
+    VertexLayout floats, compact = VertexLayout::compact();
+    cout << "float : " << floats.getStride() << " bytes per vertex | compact : " << compact.getStride() << " bytes per vertex (" << compact.getName() << ")" << endl;
+
+    for(const string &path : files_or_bundled(args)) {
+        MappedFile file(path);
+        if(!file.isOpen()) {
+            cout << "Can't open " << path << endl;
+            continue;
+        }
+
+        OBJParser parser;
+        parser.parse(file.data(), file.end());
+
+        vector<Arrays> objects;
+        size_t vertices = 0;
+        for(const OBJParser::Object &object : parser.getObjects()) {
+            Arrays arrays;
+            corner_arrays(parser, object, arrays);
+            if(arrays.positions.empty()) continue;
+
+            vertices += arrays.positions.size() / 3;
+            objects.push_back(arrays);
+        }
+
+        Errors errors;
+        vector<vector<char> > encoded(objects.size());
+        vector<float> decodeOffsets(3 * objects.size()), decodeScales(3 * objects.size());
+
+        double floatTime = best_of(5, [&]() {
+            for(size_t i = 0;i < objects.size();i++) {
+                encoded[i].resize(objects[i].positions.size() / 3 * floats.getStride());
+                floats.encode(objects[i].positions.size() / 3, objects[i].positions.data(), nullptr, objects[i].texCoords.data(), objects[i].normals.data(),
+                              encoded[i].data(), &decodeOffsets[3*i], &decodeScales[3*i]);
+            }
+        });
+
+        double compactTime = best_of(5, [&]() {
+            for(size_t i = 0;i < objects.size();i++) {
+                encoded[i].resize(objects[i].positions.size() / 3 * compact.getStride());
+                compact.encode(objects[i].positions.size() / 3, objects[i].positions.data(), nullptr, objects[i].texCoords.data(), objects[i].normals.data(),
+                               encoded[i].data(), &decodeOffsets[3*i], &decodeScales[3*i]);
+            }
+        });
+
+        for(size_t i = 0;i < objects.size();i++) measure_errors(compact, objects[i], encoded[i], &decodeOffsets[3*i], &decodeScales[3*i], errors);
+
+        cout << left << setw(32) << path << right << setw(8) << vertices << " vertices | " << setw(6) << vertices * floats.getStride() / 1024 << " -> " << setw(5) << vertices * compact.getStride() / 1024
+             << " KiB | encode " << fixed << setprecision(2) << floatTime << " / " << compactTime << " ms | max error : position " << scientific << setprecision(1) << errors.position
+             << ", normal " << fixed << setprecision(3) << errors.normal << " deg, uv " << scientific << setprecision(1) << errors.texCoord << defaultfloat << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <thread>
+#include <cmath>
+#include "Benchmark.h"
+#include "MappedFile.h"
+#include "OBJParser.h"
+#include "VertexNormals.h"
+
+using namespace std;
+
+namespace
+{
+    /* The former implementation (utilities.hpp) : one red-black tree node per vertex */
+    map<int, coordinate3d> generate_average_vertex_normals(vector<coordinate3d> *normals, vector<mapper> *vertex_normals_mapper)
+    {
+        map<int, coordinate3d> averaged_normals_vertex_mapper;
+
+        for(vector<mapper>::iterator it = vertex_normals_mapper->begin();it != vertex_normals_mapper->end();it++) {
+            coordinate3d normal = normals->at(get<1>(*it));
+            coordinate3d &vertex_current_normal = averaged_normals_vertex_mapper[get<0>(*it)];
+
+            get<0>(vertex_current_normal) += get<0>(normal);
+            get<1>(vertex_current_normal) += get<1>(normal);
+            get<2>(vertex_current_normal) += get<2>(normal);
+        }
+
+        return averaged_normals_vertex_mapper;
+    }
+
+    /* Same direction once normalized (the sums of the parallel version are added in another order) */
+    bool same_direction(const coordinate3d &a, const float *b)
+    {
+        float la = sqrt(get<0>(a)*get<0>(a) + get<1>(a)*get<1>(a) + get<2>(a)*get<2>(a)),
+              lb = sqrt(b[0]*b[0] + b[1]*b[1] + b[2]*b[2]);
+        if(la < 1e-6 || lb < 1e-6) return fabs(la - lb) < 1e-4;
+
+        float dot = (get<0>(a)*b[0] + get<1>(a)*b[1] + get<2>(a)*b[2]) / (la * lb);
+        return dot > 0.9999;
+    }
+
+    /* A smooth n x n grid (2 triangles per quad), as big as the scenes the map struggles with */
+    void make_grid(int n, vector<coordinate3d> &vertices, vector<coordinate3d> &normals, vector<mapper> &corners)
+    {
+        for(int y = 0;y <= n;y++) {
+            for(int x = 0;x <= n;x++) {
+                float h = 0.1 * sin(x * 0.05) * cos(y * 0.05);
+                vertices.push_back(make_tuple((float) x, h, (float) y));
+            }
+        }
+
+        for(int y = 0;y < n;y++) {
+            for(int x = 0;x < n;x++) {
+                int a = y * (n + 1) + x, b = a + 1, c = a + n + 1, d = c + 1;
+                float tilt = 0.01 * ((x + y) % 7);
+
+                normals.push_back(make_tuple(tilt, 1.0f, 0.0f));
+                int na = normals.size() - 1;
+                normals.push_back(make_tuple(0.0f, 1.0f, tilt));
+                int nb = normals.size() - 1;
+
+                corners.push_back(make_tuple(a, na)); corners.push_back(make_tuple(c, na)); corners.push_back(make_tuple(b, na));
+                corners.push_back(make_tuple(b, nb)); corners.push_back(make_tuple(c, nb)); corners.push_back(make_tuple(d, nb));
+            }
+        }
+    }
+
+    bool run(const string &name, vector<coordinate3d> &vertices, vector<coordinate3d> &normals, vector<mapper> &corners, const vector<unsigned int> &threadCounts)
+    {
+        map<int, coordinate3d> legacy;
+        double legacy_time = bench::best_of(3, [&]() { legacy = generate_average_vertex_normals(&normals, &corners); });
+
+        cout << left << setw(40) << name << right << setw(9) << corners.size() << " corners | map : " << fixed << setprecision(2) << legacy_time << " ms";
+
+        bool identical = true;
+        vector<float> averaged;
+        size_t first;
+
+        for(size_t i = 0;i < threadCounts.size();i++) {
+            double flat_time = bench::best_of(3, [&]() { VertexNormals::average(normals, corners, vertices.size(), averaged, first, NORMALS_WEIGHT_NONE, nullptr, threadCounts[i]); });
+
+            bool same = true;
+            for(map<int, coordinate3d>::iterator it = legacy.begin();it != legacy.end() && same;it++) {
+                same = same_direction(it->second, &averaged[3 * (it->first - first)]);
+            }
+            identical = identical && same;
+
+            cout << " | flat " << threadCounts[i] << "t : " << flat_time << " ms" << (same ? "" : " MISMATCH");
+        }
+
+        double area_time = bench::best_of(3, [&]() { VertexNormals::average(normals, corners, vertices.size(), averaged, first, NORMALS_WEIGHT_AREA, &vertices); });
+        double angle_time = bench::best_of(3, [&]() { VertexNormals::average(normals, corners, vertices.size(), averaged, first, NORMALS_WEIGHT_ANGLE, &vertices); });
+        cout << " | area : " << area_time << " ms | angle : " << angle_time << " ms" << endl;
+
+        return identical;
+    }
+}
+
+/// \brief Compares the std::map averaging with the flat array one (1, 2, 4, ... threads) on each object, then on a large generated grid.
+int bench::vertex_normals(const vector<string> &args)
+{
+    unsigned int cores = thread::hardware_concurrency();
+    if(cores == 0) cores = 1;
+
+    vector<unsigned int> threadCounts;
+    for(unsigned int count = 1;count < cores;count *= 2) threadCounts.push_back(count);
+    threadCounts.push_back(cores);
+
+    bool identical = true;
+    for(const string &path : files_or_bundled(args)) {
+        MappedFile file(path);
+        if(!file.isOpen()) {
+            cout << "Can't load (" << path << ")" << endl;
+            continue;
+        }
+
+        OBJParser parser;
+        parser.parse(file.data(), file.end());
+
+        for(OBJParser::Object &object : parser.getObjects()) {
+            identical = run(path + " " + object.name, parser.getVertices(), parser.getNormals(), object.vertex_normals_mapper, threadCounts) && identical;
+        }
+    }
+
+    vector<coordinate3d> vertices, normals;
+    vector<mapper> corners;
+    make_grid(600, vertices, normals, corners);
+    identical = run("grid 600x600", vertices, normals, corners, threadCounts) && identical;
+
+    return identical ? 0 : 1;
+}
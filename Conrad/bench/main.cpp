@@ -0,0 +1,68 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+
+#ifdef WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+using namespace std;
+
+long bench::peak_rss_kb()
+{
+#ifdef WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // KB on Linux
+#endif
+}
+
+/* Usage : ConradBench <suite> [files...] (run from the Conrad directory so that the bundled objects are found) */
+int main(int argc, char **argv)
+{
+    struct Suite {
+        const char *name;
+        int (*run)(const vector<string> &);
+    } suites[] = {
+        {"obj", bench::obj_tokenizer},
+        {"objparallel", bench::obj_parser},
+        {"vcache", bench::mesh_optimizer},
+        {"normals", bench::vertex_normals},
+        {"meshcache", bench::mesh_cache},
+        {"scene", bench::scene_format},
+        {"renderqueue", bench::render_queue},
+        {"cull", bench::frustum_culler},
+        {"bvh", bench::scene_bvh},
+        {"batch", bench::static_batch},
+        {"pool", bench::range_allocator},
+        {"layout", bench::vertex_layout},
+        {"cascades", bench::shadow_cascades},
+        {"atlas", bench::shadow_atlas},
+        {"frameallocs", bench::frame_allocations},
+        {"pooldraw", bench::pooled_draw},
+    };
+
+    if(argc < 2) {
+        cout << "Usage : " << argv[0] << " <suite> [files...]" << endl << "Suites :";
+        for(const Suite &suite : suites) cout << " " << suite.name;
+        cout << endl;
+        return 1;
+    }
+
+    vector<string> args(argv + 2, argv + argc);
+    for(const Suite &suite : suites) {
+        if(string(argv[1]) == suite.name) return suite.run(args);
+    }
+
+    cout << "Unknown suite " << argv[1] << endl;
+    return 1;
+}
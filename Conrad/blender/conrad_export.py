@@ -28,6 +28,11 @@ VEC_OBJECT_CODE = 254
 STR_OBJECT_CODE = 253
 IMG_OBJECT_CODE = 252
 
+# Format v2 : header, 16 bytes aligned objects, table of contents
+SCENE_MAGIC = b'CSCN'
+SCENE_VERSION = 2
+SCENE_ALIGNMENT = 16
+
 def triangulate_mesh(mesh):
     bm = bmesh.new()
     bm.from_mesh(mesh)
@@ -41,6 +46,13 @@ class ConradExporter:
     def __init__(self, filetarget):
         self.filetarget = filetarget
         self.file = open(filetarget, 'wb') # write in bytes
+        self.toc = [] # (type, name, offset, size) for each object
+        
+        # Header : magic, version, object count, table of contents offset. The last two are written by close()
+        self.file.write(SCENE_MAGIC)
+        self.writeInt(SCENE_VERSION)
+        self.writeInt(0)
+        self.writeInt(0)
         
     def writeBool(self, value):
         self.file.write(bytes([value]))
@@ -75,6 +87,19 @@ class ConradExporter:
         self.writeChar('\0')
         
         return len(string) + 1
+    
+    def writePadding(self): # Zeroes up to the next SCENE_ALIGNMENT bytes offset
+        padding = (SCENE_ALIGNMENT - self.file.tell() % SCENE_ALIGNMENT) % SCENE_ALIGNMENT
+        self.file.write(bytes(padding))
+        
+        return padding
+    
+    def beginObject(self): # Objects start aligned. Returns their offset
+        self.writePadding()
+        return self.file.tell()
+    
+    def endObject(self, code, name, offset, totalSize):
+        self.toc.append((code, name, offset, totalSize))
                     
         
     def writeVec(self, vec): # 4 bytes of meta
@@ -90,7 +115,7 @@ class ConradExporter:
         return 4 + len(vec) * 4
 
     
-    def writeVecArray(self, vec_array): # 8 bytes of meta
+    def writeVecArray(self, vec_array): # 8 bytes of meta, then padding : the floats start aligned
         if len(vec_array) == 0:
             return
         
@@ -98,12 +123,13 @@ class ConradExporter:
         
         self.writeInt(len(vec_array)) # Count (number of sub vectors)
         self.writeInt(len(vec_array[0])) # Dimension
+        padding = self.writePadding()
         
         for vec in vec_array:
             for c in vec:
                 self.writeFloat(c)
                 
-        return 8 + 4*len(vec_array)*len(vec_array[0])
+        return 8 + padding + 4*len(vec_array)*len(vec_array[0])
                 
     def writeImage(self, image): # 9 bytes of meta
         self.writeChar(IMG_OBJECT_CODE)
@@ -125,8 +151,7 @@ class ConradExporter:
         
         node = light.data.node_tree.nodes['Emission']    
         
-        self.writeChar(LIGHT_OBJECT_CODE)
-        self.writeInt(0) # Total size
+        offset = self.beginObject()
         
         if("Sun" in light.name_full):
             totalSize += self.writeChar(LIGHT_SUN_CODE)        
@@ -150,10 +175,7 @@ class ConradExporter:
         castShadow = 0 #For now
         totalSize += self.writeBool(castShadow)
         
-        # Writing data size
-        self.file.seek(-(totalSize+4), 1)
-        self.writeInt(totalSize)
-        self.file.seek(0, 2) # File end
+        self.endObject(LIGHT_OBJECT_CODE, light.name_full, offset, totalSize)
         return totalSize
     
     def writeMaterial(self, material): # 1 byte of meta
@@ -161,8 +183,7 @@ class ConradExporter:
         
         totalSize = 0
         
-        self.writeChar(MATERIAL_OBJECT_CODE)
-        self.writeInt(0) # Reserving 4 bytes for the total size
+        offset = self.beginObject()
         
         totalSize += self.writeString(material.name_full)
         
@@ -196,17 +217,13 @@ class ConradExporter:
         #print("\t Material data size :", totalSize / 1000, "kB")
         print("Material data size :", totalSize)
         
-        # Writing data size
-        self.file.seek(-(totalSize+4), 1)
-        self.writeInt(totalSize)
-        self.file.seek(0, 2) # File end
+        self.endObject(MATERIAL_OBJECT_CODE, material.name_full, offset, totalSize)
         return totalSize
         
     def writeMesh(self, object, type = OBJTYPE_STATIC):
         totalSize = 0
         
-        self.writeChar(MESH_OBJECT_CODE)        
-        self.writeInt(0) # Reserving 4 bytes for the total size
+        offset = self.beginObject()
         
         # Extracting datas
         name = object.name
@@ -247,15 +264,27 @@ class ConradExporter:
         totalSize += self.writeVecArray(tex_coord)
         totalSize += self.writeVecArray(normals_coord)
         
-        # Writing data size
-        self.file.seek(-(totalSize+4), 1)
-        self.writeInt(totalSize)
-        self.file.seek(0, 2) # File end
+        self.endObject(MESH_OBJECT_CODE, name, offset, totalSize)
         
         print("Total size for mesh :", totalSize)
         return totalSize
             
+    def writeTableOfContents(self): # Entries : type, offset, size, name
+        tocOffset = self.file.tell()
+        
+        for code, name, offset, size in self.toc:
+            self.writeChar(code)
+            self.writeInt(offset)
+            self.writeInt(size)
+            self.writeString(name)
+        
+        self.file.seek(8, 0) # Header object count and table offset
+        self.writeInt(len(self.toc))
+        self.writeInt(tocOffset)
+        self.file.seek(0, 2) # File end
+            
     def close(self):
+        self.writeTableOfContents()
         self.file.close()
     
 
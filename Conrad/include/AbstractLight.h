@@ -6,10 +6,9 @@
  */
 
 #include <string>
-#include <string.h>
-#include <sstream>
 #include "scope.h"
 #include "Shader.h"
+#include "UniformBlocks.h"
 
 #include <iostream>
 
@@ -43,10 +42,14 @@ typedef unsigned int light_type;
 
 /* Shadow mapping */
 #define SHADOWMAP_SIZE 1024
+#define SHADOW_ORTHO_EXTENT 50.0 // Half width and depth of the default shadow projection
+#define SHADOW_SPOT_NEAR 0.05 // Near plane of the perspective shadow projections
 
 /*!
  *  \class AbstractLight
  *  \brief Represents a generic source of light
+ *  Its DepthBuffer is only loaded by the lights whose shadow map is their own (cascades, cube map) : the other shadow casting lights
+ *  render into a tile of the shadow atlas of the Renderer.
  */
 class AbstractLight
 {
@@ -54,8 +57,11 @@ class AbstractLight
         AbstractLight(glm::vec3 position, glm::vec3 color, glm::vec3 direction, float intensity = 1.0, bool castShadow = false, float linearAttenuation = 0.1, float quadraticAttenuation = 0.0);
         virtual ~AbstractLight();
 
-        virtual void sendUniforms(const Shader &shader, size_t index) = 0; // Virtual pure
-        virtual void sendShadowUniforms(const Shader &shader, size_t index);
+        virtual void fillUniformBlock(LightBlock &block); // The derived lights set their type and their specific members
+        virtual bool isCascaded(); // Its shadow map is a DEPTHBUFFER_ARRAY of cascades (see SunLight)
+        virtual bool isOmnidirectional(); // Its shadow map is a DEPTHBUFFER_CUBE of distances (see PointLight)
+        virtual glm::mat4 getShadowProjection(); // Of its tile of the shadow atlas, when it is neither. Orthographic by default
+        virtual float getShadowRange(); // How far its shadows reach
 
         /* Setters */
         void set_world(glm::mat4 world);
@@ -71,10 +77,9 @@ class AbstractLight
         glm::mat4 &get_world();
 
         bool castsShadow();
+        unsigned int getRevision(); // Incremented by setPosition() and setDirection() : a shadow map rendered at an older revision is stale
 
     protected:
-        const char *uniform_str(size_t index, const char* property);
-
         /* World */
         float m_intensity;
 
@@ -85,6 +90,8 @@ class AbstractLight
 
         RGB       m_color;
 
+        unsigned int m_revision = 0;
+
         /* Attenuation */
         float   m_linearAttenuation,
                 m_quadraticAttenuation;
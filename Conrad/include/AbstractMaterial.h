@@ -8,6 +8,7 @@
 
  #include "scope.h" // RGB structure
  #include "AbstractTexture.h"
+ #include "UniformBlocks.h"
  #include <string>
 
 /*!
@@ -21,6 +22,10 @@ class AbstractMaterial
         AbstractMaterial(RGB ambient, RGB diffuse, RGB specular, RGB emit, float specularExponent, float alpha, float ambientStrength = 0.01, float diffuseStrength = 1.0, float specularStrength = 1.0, float emitStrength = 1.0, std::string name = "");
         virtual ~AbstractMaterial();
 
+        void fillUniformBlock(MaterialBlock &block);
+        unsigned int getRevision(); // Incremented by every value setter : a uniform block filled at an older revision is stale
+        unsigned int getID(); // Unique for the whole run, unlike the address of the material that can be reused once it is deleted
+
         /* Getters */
         RGB getAmbientColor();
         RGB getDiffuseColor();
@@ -85,14 +90,18 @@ class AbstractMaterial
         float   m_specularExponent = 0,
                 m_alpha = 1;
 
-        /* Textures */
-        AbstractTexture *m_diffuseTexture,
-                        *m_specularTexture;
+        /* Textures (one TextureCache reference each) */
+        AbstractTexture *m_diffuseTexture = nullptr,
+                        *m_specularTexture = nullptr;
 
         bool    m_diffuseTextured = false,
                 m_specularTextured = false;
 
         std::string m_name;
+        unsigned int m_revision = 0;
+
+        static unsigned int s_nextID;
+        unsigned int m_id = s_nextID++;
 };
 
 #endif // ABSTRACTMATERIAL_H
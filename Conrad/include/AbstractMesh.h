@@ -11,9 +11,14 @@
  #include "scope.h"
  #include <iostream>
  #include <algorithm>
+ #include <memory>
 
  #include "AbstractTexture.h"
  #include "AbstractMaterial.h"
+ #include "GLState.h"
+ #include "MeshOptimizer.h"
+ #include "SceneBVH.h"
+ #include "GeometryPool.h"
 
  /* GLM */
 #include <glm/glm.hpp>
@@ -34,9 +39,21 @@
 
 #endif
 
+/* Arrays of a mesh, for adoptArrays() and disownArrays() */
+#define MESH_ARRAY_VERTICES     1
+#define MESH_ARRAY_COLORS       2
+#define MESH_ARRAY_TEXCOORDS    4
+#define MESH_ARRAY_NORMALS      8
+#define MESH_ARRAY_INDICES      16
+#define MESH_ARRAYS_ALL         31
+
 /*!
  * \class AbstractMesh AbstractMesh.h
  * \brief AbstractMesh represents an abstract mesh. This class provides a minimal support for meshes, and interfaces with the GPU for the loading process.
+ * A static mesh is loaded into the shared buffers of the GeometryPool (one VAO for many meshes), the other ones get their own VBO and VAO.
+ * The vertices are interleaved and may be quantized (see VertexLayout) : draw them with getVertexModelview().
+ * The arrays given to the mesh stay the caller's, unless it hands them over with adoptArrays() : the mesh then frees them (free()).
+ * Arrays that point into a shared storage (a file mapping) keep it alive through setArraysStorage().
  */
 class AbstractMesh
 {
@@ -52,41 +69,126 @@ class AbstractMesh
         bool setTexCoords(float *texCoords, int length);
         bool setVertexNormals(float *vertexNormals, int length);
         bool setMaterial(AbstractMaterial *material);
+        bool setIndices(void *indices, int count, GLenum indexType); // indexType : GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+        void adoptArrays(unsigned int arrays); // MESH_ARRAY_* : malloc'd arrays the mesh frees when they are replaced and when it is deleted
+        unsigned int disownArrays(unsigned int arrays); // Hands the owned ones back to the caller. \return The ones the mesh owned
+        void setArraysStorage(std::shared_ptr<const void> storage); // What the arrays it doesn't own point into : kept alive with the mesh
+
+        MeshOptimizer::Stats optimize(); // Reorders the triangles and vertices for the GPU caches. Before loading only.
+        void setSharedBuffersEnabled(bool enabled); // GL_STATIC_DRAW meshes only, on by default. Before loading only
+        void setVertexLayout(const VertexLayout &layout);
+        static void setDefaultVertexLayout(const VertexLayout &layout);
 
-        void load();
+        virtual void load();
         void draw();
+        virtual void drawBound(); // The draw call only : the VAO and the textures are bound by the caller (see Renderer::render())
+        virtual bool isInstanced(); // Drawn with the instanced variant of the shaders (see InstancedMesh)
+        virtual void cullParts(const glm::mat4 &viewProjection); // Called by the Renderer when the mesh is visible, before drawing it (see BatchedMesh)
 
         /* Getters */
         glm::mat4 &get_modelview();
+        glm::mat4 getVertexModelview(); // For the shaders (modelview uniform)
+        const glm::mat4 &getNormalMatrix(); // transpose(inverse(modelview)), for the shaders (normalMatrix uniform). Updated with the world bounds
+        const VertexLayout &getVertexLayout();
         AbstractMaterial *getMaterial();
+        GLuint getVertexArrayID();
+        GLenum getMeshType();
+
+        int getVerticesCount();
+        int getIndicesCount();
+        bool isIndexed();
+        bool isLoaded();
+        bool usesSharedBuffers(); // Loaded into the GeometryPool
+        size_t getVertexBytes();
+        size_t getIndexBytes();
+
+        /* Mesh data as given to the mesh (read-only) */
+        const float *getVertices();
+        const float *getColors();
+        const float *getTexCoords();
+        const float *getVertexNormals();
+        const void *getIndices();
+        GLenum getIndexType();
+
+        /* Axis aligned bounding box (model space). Computed from the vertices at load time if it wasn't set before. */
+        void computeBounds();
+        void setBounds(glm::vec3 boundsMin, glm::vec3 boundsMax);
+        glm::vec3 getBoundsMin();
+        glm::vec3 getBoundsMax();
+        float getBoundingRadius(); // Bounding sphere centered on the AABB, computed with the bounds
+
+        /* World space bounds (through the modelview), for the culling. Recomputed when the modelview changed since the last call. */
+        virtual bool updateWorldBounds(); // \return true if they were recomputed
+        glm::vec3 getWorldCenter();
+        glm::vec3 getWorldExtents(); // Half sizes of the world AABB
+        float getWorldRadius();
+
+        /* Nearest triangle hit by the world space ray origin + t * direction (t > 0, in units of direction). Uses the vertices given to the mesh. */
+        virtual bool intersectRay(const glm::vec3 &origin, const glm::vec3 &direction, float &t, unsigned int &triangle);
+        int getTriangleCount();
 
     protected:
         /* World */
         glm::mat4 m_modelview = glm::mat4(1.0);
 
         void setBlankTex();
+        void setWorldBounds(glm::vec3 center, glm::vec3 extents, float radius);
+        void updateNormalMatrix(); // From m_modelview : by updateWorldBounds(), when it changed
+        bool intersectLocalRay(const glm::vec3 &origin, const glm::vec3 &direction, float &t, unsigned int &triangle); // Model space
+
+        /* Where the indices start in the bound element buffer (always GLuint in the shared buffers) */
+        const GLvoid *getIndexOffset(); // Bytes
+        GLint getBaseVertex();
 
     private:
+        bool loadShared(const void *vertices); // Into the GeometryPool. false if the mesh can't go there
+        void freeArrays(unsigned int arrays); // The owned ones among them
+
         /* Mesh datas */
-        float   *m_vertices,
-                *m_colors,
-                *m_texCoords,
-                *m_vertexNormals; // Not faces normals ! There is one normal per vertex that has been averaged from the normals of the faces the vertex is involved in.
+        float   *m_vertices = nullptr,
+                *m_colors = nullptr,
+                *m_texCoords = nullptr,
+                *m_vertexNormals = nullptr; // Not faces normals ! There is one normal per vertex that has been averaged from the normals of the faces the vertex is involved in.
+
+        void *m_indices = nullptr; // Optional index buffer (triangles), 16 or 32 bits
+        unsigned int m_ownedArrays = 0; // MESH_ARRAY_* : adopted, or allocated by optimize() (weld, new index buffer)
+        std::shared_ptr<const void> m_arraysStorage; // See setArraysStorage()
 
         AbstractMaterial *m_material = new AbstractMaterial;
 
         int m_verticesCount, // Number of vertices
             m_colorsCount,
-            m_texCount; // No vertex normal count : it's the same as m_verticesCount as there will always be one normal per vertex.
-        int m_verticesSize,
-            m_colorsSize,
-            m_texSize,
-            m_vertexNormalsSize;
+            m_texCount, // No vertex normal count : it's the same as m_verticesCount as there will always be one normal per vertex.
+            m_indicesCount = 0; // 0 when the mesh isn't indexed (drawn with glDrawArrays)
+
+        /* GPU layout */
+        static VertexLayout s_defaultVertexLayout;
+        VertexLayout    m_vertexLayout = s_defaultVertexLayout,
+                        m_uploadedLayout; // m_vertexLayout without the colors if they are all white
+        glm::mat4 m_positionDecode = glm::mat4(1.0); // Stored positions -> model space
 
         /* OpenGL */
         GLuint  m_vboID = 0, // 0 is always unused
-                m_vaoID = 0;
+                m_vaoID = 0,
+                m_eboID = 0; // Element buffer (indexed meshes only)
         GLenum m_meshType; // GL_STATIC_DRAW / GL_DYNAMIC_DRAW / GL_STREAM_DRAW
+        GLenum m_indexType = GL_UNSIGNED_INT;
+
+        GeometryPool::Range m_sharedRange; // Its ranges in the GeometryPool (m_vboID, m_vaoID and m_eboID are then 0)
+        bool m_sharedBuffersEnabled = true;
+
+        /* Bounds */
+        glm::vec3   m_boundsMin = glm::vec3(0.0),
+                    m_boundsMax = glm::vec3(0.0);
+        float m_boundingRadius = 0.0;
+        bool m_boundsSet = false;
+
+        glm::mat4 m_worldModelview; // The modelview the world bounds were computed with
+        glm::mat4 m_normalMatrix = glm::mat4(1.0); // Of the modelview of the last updateWorldBounds()
+        glm::vec3   m_worldCenter = glm::vec3(0.0),
+                    m_worldExtents = glm::vec3(0.0);
+        float m_worldRadius = 0.0;
+        bool m_worldBoundsValid = false;
 
         bool m_loaded = false;
         bool m_tex_loaded = false;
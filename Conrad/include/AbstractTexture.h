@@ -16,6 +16,7 @@
 #endif
 
 #include "scope.h"
+#include "GLState.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <iostream>
@@ -33,6 +34,7 @@ class AbstractTexture
         AbstractTexture(std::string filepath);
         virtual ~AbstractTexture();
 
+        bool decode(); // CPU side of load() for a file texture, no GL call : can run on any thread
         bool load();
         bool loadFromSDL(SDL_Surface *surface, GLvoid* &data_ptr, GLenum &internalFormat, GLenum &format, bool reverse = true);
 
@@ -60,10 +62,12 @@ class AbstractTexture
         GLuint getID();
         GLsizei getWidth();
         GLsizei getHeight();
+        size_t getByteSize(); // Pixels size (width x height x bytes per pixel)
         bool isLoaded();
 
     protected:
         static SDL_Surface *reverse_SDL_surface(SDL_Surface *source);
+        static bool surfaceFormat(SDL_Surface *surface, GLenum &internalFormat, GLenum &format);
 
     private:
         std::string m_filepath;
@@ -72,6 +76,8 @@ class AbstractTexture
         GLenum  m_internalFormat,
                 m_format;
 
+        SDL_Surface *m_decoded = nullptr; // Decoded image waiting for its upload (file textures)
+
         /* OpenGL */
         GLuint m_id = 0; // 0 is always unused
 
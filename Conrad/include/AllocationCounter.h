@@ -0,0 +1,21 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+/*!
+ *  \file AllocationCounter.h
+ */
+
+/*!
+ *  \class AllocationCounter
+ *  \brief Counts the heap allocations (operator new) of the whole process, to check that the per-frame code doesn't allocate.
+ *  Only compiled in with CONRAD_COUNT_ALLOCATIONS (Debug and Benchmark targets) : the global operator new / delete are then replaced.
+ *  Without it, the count stays 0 and isEnabled() is false. malloc() isn't counted.
+ */
+class AllocationCounter
+{
+    public:
+        static unsigned long long getCount(); // Allocations since the start
+        static bool isEnabled();
+};
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,56 @@
+#ifndef BATCHEDMESH_H
+#define BATCHEDMESH_H
+
+/*!
+ * \file BatchedMesh.h
+ */
+
+#include "StaticMesh.h"
+#include "MeshBatcher.h"
+#include "FrustumCuller.h"
+#include <vector>
+
+/*!
+ * \class BatchedMesh BatchedMesh.h
+ * \brief Static meshes of one material merged into one vertex and index range at load (see MeshBatcher) : their modelviews are baked into the vertices.
+ * Each merged mesh stays a piece with its bounds : cullParts() drops the pieces out of the frustum and drawBound() draws the visible
+ * ones with a single glMultiDrawElementsBaseVertex, adjacent pieces merged into one range.
+ * \warning The merged meshes can't move anymore. Moving the batch (get_modelview()) moves all of them.
+ */
+class BatchedMesh : public StaticMesh
+{
+    public:
+        BatchedMesh(MeshBatcher::Batch &batch); // Takes the arrays of batch (left empty)
+        virtual ~BatchedMesh();
+
+        /* Replaces the batchable meshes that share a material by BatchedMeshes (the merged meshes are deleted), keeps the others.
+           destination[i] is the index, in the returned list, of what meshes[i] became. Before load(). */
+        static std::vector<StaticMesh *> batch(const std::vector<StaticMesh *> &meshes, std::vector<size_t> &destination);
+        static bool isBatchable(StaticMesh *mesh); // Static and not loaded yet, neither instanced nor translucent
+        static void setReport(bool report); // batch() prints how many meshes it merged (off by default)
+
+        virtual void cullParts(const glm::mat4 &viewProjection);
+        virtual void drawBound();
+
+        /* Getters */
+        size_t getPieceCount();
+        size_t getDrawRangeCount(); // After the last cullParts()
+
+    private:
+        static bool s_report;
+
+        MeshBatcher::Batch m_batch;
+
+        /* Pieces culling (same index as m_batch.pieces) */
+        FrustumCuller m_culler;
+        std::vector<unsigned char> m_visible;
+
+        /* Draw ranges of the visible pieces (glMultiDrawElementsBaseVertex arguments) */
+        std::vector<unsigned int> m_rangeFirsts;
+        std::vector<GLsizei> m_rangeCounts;
+        std::vector<const GLvoid *> m_rangeOffsets;
+        std::vector<GLint> m_rangeBaseVertices;
+        size_t m_rangeCount = 0;
+};
+
+#endif // BATCHEDMESH_H
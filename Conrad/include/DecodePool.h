@@ -0,0 +1,43 @@
+#ifndef DECODEPOOL_H
+#define DECODEPOOL_H
+
+/*!
+ *  \file DecodePool.h
+ */
+
+#include <functional>
+#include <cstddef>
+
+#define DECODE_POOL_THREADS_AUTO 0 // One worker per hardware core
+
+/*!
+ *  \class DecodePool
+ *  \brief Two-phase loading of independent objects. Worker threads run the CPU side (decode, validation, vertex preparation) of every
+ *  task, taking the next task as soon as they are done with one. Each decoded task goes to a ready queue that the calling thread
+ *  drains : the GPU side (upload) runs there, which must be the thread owning the GL context. Uploads start with the first decoded task.
+ */
+class DecodePool
+{
+    public:
+        DecodePool(unsigned int threadCount = DECODE_POOL_THREADS_AUTO);
+        virtual ~DecodePool();
+
+        /*!
+         *  \brief Runs decode(i) for every task i in [0; taskCount) on the workers, and upload(i) on the calling thread once task i is decoded.
+         *  The uploads follow the decode completion order, not the task order. Returns when every task is uploaded.
+         *  decode must only touch task i data (and read-only shared data).
+         */
+        void run(size_t taskCount, const std::function<void(size_t)> &decode, const std::function<void(size_t)> &upload);
+
+        /* Setters */
+        void setThreadCount(unsigned int threadCount); // DECODE_POOL_THREADS_AUTO, 1 for a serial load (decode and upload on the calling thread)
+
+        /* Getters */
+        unsigned int getWorkerCount(); // Number of workers used by the last run (0 : serial)
+
+    private:
+        unsigned int m_threadCount;
+        unsigned int m_workerCount = 0;
+};
+
+#endif // DECODEPOOL_H
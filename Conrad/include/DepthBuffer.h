@@ -7,6 +7,7 @@
 
 #include <iostream>
 #include "scope.h"
+#include "GLState.h"
 
 /* GLM */
 #include <glm/glm.hpp>
@@ -31,6 +32,7 @@ typedef unsigned int depthbuffer_type;
 // Types of depth buffer
 #define DEPTHBUFFER_SIMPLE  0 // Simple texture is used
 #define DEPTHBUFFER_CUBE    1 // Cube texture is used (useful for point lights)
+#define DEPTHBUFFER_ARRAY   2 // 2D texture array, one layer per cascade (SunLight)
 
 /*!
  *  \class DepthBuffer
@@ -39,21 +41,25 @@ typedef unsigned int depthbuffer_type;
 class DepthBuffer
 {
     public:
-        DepthBuffer(); // Uses simple depth map by default
+        DepthBuffer(); // Empty : no GL object until load()
         DepthBuffer(depthbuffer_type type);
         virtual ~DepthBuffer();
 
         void load();
+        void load(depthbuffer_type type, GLsizei size, GLsizei layers = 1); // Replaces the textures (square maps)
 
         void bindTexture(size_t index);
-        static inline void unbindTexture() { glBindTexture(GL_TEXTURE_2D, 0); };
+        static inline void unbindTexture() { GLState::bindTexture(GL_TEXTURE_2D, 0); };
 
         void bind();
-        static inline void unbind() { glBindFramebuffer(GL_FRAMEBUFFER, 0); };
+        void bindLayer(GLint layer); // DEPTHBUFFER_ARRAY : the frame buffer, rendering into that layer
+        void setComparison(bool enabled); // DEPTHBUFFER_SIMPLE : read through a sampler2DShadow (bilinear comparisons), or as depths
+        static inline void unbind() { GLState::bindFramebuffer(0); };
 
         /* Getters */
         GLsizei getShadowMapWidth();
         GLsizei getShadowMapHeight();
+        GLsizei getLayers();
         GLuint getTextureID();
 
     protected:
@@ -64,6 +70,7 @@ class DepthBuffer
                 m_depthMapTextureID = 0; // The depth map is stored in a texture
 
         GLsizei m_shadowMapWidth = SHADOWMAP_SIZE, m_shadowMapHeight = SHADOWMAP_SIZE;
+        GLsizei m_layers = 1;
         depthbuffer_type m_type;
 };
 
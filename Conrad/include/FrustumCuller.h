@@ -0,0 +1,51 @@
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+/*!
+ *  \file FrustumCuller.h
+ */
+
+#include <vector>
+#include <cstddef>
+
+/* The SSE kernel is used when the compiler targets it (-msse2 in Conrad.cbp, default on x86-64) */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define FRUSTUM_CULLER_SSE
+#endif
+
+/*!
+ *  \class FrustumCuller
+ *  \brief World space bounding volumes of the meshes, stored as a structure of arrays, tested against the 6 planes of a frustum.
+ *  Each volume is an AABB (center and half extents) and a bounding sphere with the same center : for every plane, the tighter of the two
+ *  radii is used. The test is conservative (a volume that crosses a corner outside of the frustum can be kept).
+ *  Four volumes are tested at once with SSE, one at a time otherwise.
+ */
+class FrustumCuller
+{
+    public:
+        FrustumCuller();
+        virtual ~FrustumCuller();
+
+        void resize(size_t count);
+        size_t size() const;
+
+        void setVolume(size_t index, const float center[3], const float extents[3], float radius);
+
+        /* Gribb-Hartmann : planes (a, b, c, d) of a view-projection matrix (column-major, as glm stores them), normals pointing inside */
+        static void extractPlanes(const float matrix[16], float planes[6][4]);
+
+        /* visible[i] is set to 1 if volume i may intersect the frustum, 0 otherwise. \return The number of visible volumes */
+        size_t cull(const float planes[6][4], unsigned char *visible) const;
+        size_t cullScalar(const float planes[6][4], unsigned char *visible) const; // Reference kernel (also the non-SSE path)
+
+        static bool intersectsBox(const float planes[6][4], const float center[3], const float extents[3]); // A single AABB, same test
+
+    private:
+        size_t cullRange(const float planes[6][4], unsigned char *visible, size_t first, size_t last) const; // Scalar
+
+        std::vector<float>  m_centerX, m_centerY, m_centerZ,
+                            m_extentX, m_extentY, m_extentZ,
+                            m_radius;
+};
+
+#endif // FRUSTUMCULLER_H
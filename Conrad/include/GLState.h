@@ -0,0 +1,96 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+/*!
+ *  \file GLState.h
+ */
+
+/* Cross-plateform includes */
+#ifdef WIN32
+    #include <GL/glew.h>
+
+#elif __APPLE__
+    #define GL3_PROTOTYPES 1
+    #include <OpenGL/gl3.h>
+
+#else // UNIX / Linux
+    #define GL3_PROTOTYPES 1
+    #include <GL3/gl3.h>
+
+#endif
+
+#define GLSTATE_TEXTURE_UNITS 32 // Tracked units (the shadow maps start at DEPTHBUFFER_TEXTURE0)
+
+/*!
+ *  \class GLState
+ *  \brief Shadow copy of the GL state the engine changes : program, VAO, textures per unit, framebuffer, viewport, capabilities,
+ *  cull face, blend and depth functions, polygon mode. Every engine call site goes through it : a call that wouldn't change the current
+ *  state is dropped. Each call is counted as issued or filtered, per frame (see endFrame()).
+ *  A state is unknown until it is first set (or after invalidate()) : that call is always issued.
+ *  \warning The objects must be forgotten before being deleted : GL unbinds them, and their name can be reused by a new object.
+ */
+class GLState
+{
+    public:
+        enum Call {
+            PROGRAM, VERTEX_ARRAY, ACTIVE_TEXTURE, TEXTURE, FRAMEBUFFER, VIEWPORT,
+            CAPABILITY, CULL_FACE, BLEND_FUNC, DEPTH_FUNC, DEPTH_MASK, POLYGON_MODE,
+            CALL_COUNT
+        };
+
+        static void useProgram(GLuint program);
+        static void bindVertexArray(GLuint vertexArray);
+        static void activeTexture(GLuint unit); // 0 for GL_TEXTURE0
+        static void bindTexture(GLenum target, GLuint texture); // On the active unit
+        static void bindTexture(GLuint unit, GLenum target, GLuint texture);
+        static void bindFramebuffer(GLuint framebuffer); // GL_FRAMEBUFFER
+        static void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+        static void enable(GLenum capability);
+        static void disable(GLenum capability);
+        static void cullFace(GLenum mode);
+        static void blendFunc(GLenum source, GLenum destination);
+        static void depthFunc(GLenum function);
+        static void depthMask(GLboolean mask);
+        static void polygonMode(GLenum mode); // GL_FRONT_AND_BACK
+
+        /* Deletion */
+        static void forgetProgram(GLuint program);
+        static void forgetVertexArray(GLuint vertexArray);
+        static void forgetTexture(GLuint texture);
+        static void forgetFramebuffer(GLuint framebuffer);
+        static void invalidate(); // The state was changed outside of GLState : everything is unknown again
+
+        /* Stats */
+        static void endFrame(); // The current counters become the last frame ones
+        static unsigned long long getIssued(); // Every call issued since the last endFrame()
+        static unsigned long long getFrameIssued(Call call);
+        static unsigned long long getFrameFiltered(Call call);
+        static unsigned long long getFrameIssued(); // Every call
+        static unsigned long long getFrameFiltered();
+        static void report(); // Prints the last frame histogram
+
+    private:
+        static bool filter(Call call, bool redundant); // Counts the call. true if it must be dropped
+        static int capabilityIndex(GLenum capability); // -1 if it isn't tracked
+        static int targetIndex(GLenum target);
+
+        struct State {
+            bool known;
+            GLuint value;
+        };
+
+        static State s_program, s_vertexArray, s_activeTexture, s_framebuffer;
+        static State s_textures[GLSTATE_TEXTURE_UNITS][3]; // 2D, cube map, 2D array
+        static State s_capabilities[3]; // Cull face, blend, depth test
+        static State s_cullFace, s_depthFunc, s_depthMask, s_polygonMode;
+
+        static bool s_viewportKnown, s_blendFuncKnown;
+        static GLint s_viewport[4];
+        static GLenum s_blendFunc[2];
+
+        static unsigned long long s_issued[CALL_COUNT], s_filtered[CALL_COUNT];
+        static unsigned long long s_frameIssued[CALL_COUNT], s_frameFiltered[CALL_COUNT];
+};
+
+#endif // GLSTATE_H
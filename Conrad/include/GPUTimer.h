@@ -0,0 +1,56 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+/*!
+ *  \file GPUTimer.h
+ */
+
+/* Cross-plateform includes */
+#ifdef WIN32
+    #include <GL/glew.h>
+
+#elif __APPLE__
+    #define GL3_PROTOTYPES 1
+    #include <OpenGL/gl3.h>
+
+#else // UNIX / Linux
+    #define GL3_PROTOTYPES 1
+    #include <GL3/gl3.h>
+
+#endif
+
+#define GPU_TIMER_QUERIES 4 // In flight : a measure is read GPU_TIMER_QUERIES frames after it was made, when the GPU is done with it
+
+/*!
+ *  \class GPUTimer
+ *  \brief Measures the GPU time of the commands issued between begin() and end(), once per frame (GL_TIME_ELAPSED queries).
+ *  The queries are reused in a ring : a result is only read when its query comes back, a few frames later, so the CPU doesn't wait for
+ *  the GPU. getTime() is therefore late by GPU_TIMER_QUERIES frames.
+ *  Timer queries are GL 3.3 (or ARB_timer_query) : without them, begin() and end() do nothing and getCount() stays 0 (see isAvailable()).
+ *  \warning GL_TIME_ELAPSED queries can't be nested : two timers must measure separate ranges.
+ */
+class GPUTimer
+{
+    public:
+        GPUTimer();
+        virtual ~GPUTimer();
+
+        void begin();
+        void end();
+
+        double getTime(); // Milliseconds of the last measure read. 0 before the first one
+        unsigned long long getCount(); // Measures read
+
+        static bool isAvailable(); // The context has timer queries. Once there is a context
+
+    private:
+        GPUTimer(const GPUTimer &); // Owns its queries
+        GPUTimer &operator=(const GPUTimer &);
+
+        GLuint m_queries[GPU_TIMER_QUERIES] = {0};
+        unsigned int m_next = 0;
+        unsigned long long m_issued = 0, m_read = 0;
+        double m_time = 0.0;
+};
+
+#endif // GPUTIMER_H
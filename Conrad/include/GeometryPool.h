@@ -0,0 +1,74 @@
+#ifndef GEOMETRYPOOL_H
+#define GEOMETRYPOOL_H
+
+/*!
+ *  \file GeometryPool.h
+ */
+
+#include <vector>
+#include <map>
+#include <cstddef>
+
+#include "scope.h"
+#include "RangeAllocator.h"
+#include "VertexLayout.h"
+#include "GLState.h"
+
+#define GEOMETRY_POOL_PAGE_VERTICES (1 << 18) // Vertex capacity of a page. A larger mesh gets a page of its own size
+#define GEOMETRY_POOL_PAGE_INDICES  (1 << 20) // GLuint
+
+/*!
+ *  \class GeometryPool
+ *  \brief Shared vertex and index buffers of the static meshes. The meshes of a VertexLayout are packed into a few large pages, each
+ *  with one VBO, one EBO and the VAO that binds them : consecutive draws of a page don't change the vertex array anymore.
+ *  A page holds interleaved vertices (VertexLayout::encode()) and 32 bits indices.
+ *  A mesh gets a range of vertices and a range of indices (RangeAllocator) : it is drawn with glDrawElementsBaseVertex, and the draw
+ *  ranges of a page can go together in a glMultiDrawElementsBaseVertex. Freed ranges are reused, an empty page is deleted.
+ *  \warning GL thread only. The meshes that add their own attributes to their VAO (InstancedMesh) can't use the pool.
+ */
+class GeometryPool
+{
+    public:
+        struct Range {
+            int layout = -1; // VertexLayout::getKey(). -1 : nothing allocated
+            size_t page = 0;
+            GLuint vertexArray = 0; // VAO of the page
+
+            size_t firstVertex = 0, vertexCount = 0, // Base vertex of the indices
+                   firstIndex = 0, indexCount = 0;
+        };
+
+        struct Stats {
+            size_t pages = 0,
+                   ranges = 0,
+                   bytes = 0; // GPU memory of the pages
+            RangeAllocator::Stats vertices, indices; // Summed over the pages. largestFree is the largest of the pages
+        };
+
+        /* A vertex array and an index array of the mesh */
+        static bool allocate(const VertexLayout &layout, size_t vertexCount, size_t indexCount, Range &range); // false if no page could be created
+        static void uploadVertices(const Range &range, const void *vertices); // Encoded with the layout of the range
+        static void uploadIndices(const Range &range, const void *indices, GLenum indexType); // Widened to GLuint. nullptr : 0 to vertexCount - 1 (non-indexed mesh)
+        static void free(Range &range);
+
+        /* The attributes of layout, read from the bound GL_ARRAY_BUFFER (from offset bytes) by the bound VAO */
+        static void setAttributePointers(const VertexLayout &layout, GLintptr offset = 0);
+
+        /* Stats */
+        static Stats getStats(const VertexLayout &layout);
+        static void report(); // Prints the stats of every layout in use
+
+    private:
+        struct Page {
+            VertexLayout layout;
+            GLuint vboID, eboID, vaoID;
+            RangeAllocator vertices, indices;
+        };
+
+        static Page *createPage(const VertexLayout &layout, size_t vertexCapacity, size_t indexCapacity);
+        static void deletePage(Page *page);
+
+        static std::map<int, std::vector<Page *> > s_pages; // Per layout key. nullptr for the deleted pages (their index is reused)
+};
+
+#endif // GEOMETRYPOOL_H
@@ -0,0 +1,59 @@
+#ifndef INSTANCEDMESH_H
+#define INSTANCEDMESH_H
+
+/*!
+ * \file InstancedMesh.h
+ */
+
+#include "StaticMesh.h"
+#include <vector>
+
+/*!
+ * \class InstancedMesh InstancedMesh.h
+ * \brief A StaticMesh drawn several times in one call (hardware instancing) : one VAO and one copy of the vertices for all the instances.
+ * Each instance has its own modelview, applied before the mesh one (world = get_modelview() * instance). The instance modelviews and
+ * normal matrices live in a per-instance attribute buffer (INSTANCE_MODELVIEW_BUFFER, INSTANCE_NORMAL_BUFFER), uploaded when they changed.
+ * The instances are culled together : the world bounds cover all of them.
+ * \warning Needs the instanced variant of the shaders (INSTANCED_SHADER_DEFINE, see Renderer::setShader()).
+ */
+class InstancedMesh : public StaticMesh
+{
+    public:
+        InstancedMesh(int bufferCount, float *vertices, float *colors, float *texCoords, float *vertexNormals);
+        virtual ~InstancedMesh();
+
+        size_t addInstance(const glm::mat4 &modelview); // \return The instance index
+        void setInstance(size_t instance, const glm::mat4 &modelview);
+        const glm::mat4 &getInstance(size_t instance);
+        size_t getInstanceCount();
+        void clearInstances();
+
+        virtual void load();
+        virtual void drawBound(); // One glDraw*Instanced for all the instances
+        virtual bool isInstanced();
+
+        virtual bool updateWorldBounds(); // Union of the instance bounds
+        virtual bool intersectRay(const glm::vec3 &origin, const glm::vec3 &direction, float &t, unsigned int &triangle); // triangle = instance * getTriangleCount() + triangle of the mesh
+
+    private:
+        struct InstanceData { // Per-instance attributes
+            float modelview[16];
+            float normalMatrix[9];
+        };
+
+        void uploadInstances();
+
+        std::vector<glm::mat4> m_instances;
+        std::vector<InstanceData> m_instanceData; // CPU copy of m_instanceVboID
+
+        GLuint m_instanceVboID = 0;
+        size_t m_instanceCapacity = 0; // Instances the buffer can hold
+        bool m_instancesDirty = true;
+
+        unsigned int m_revision = 0; // Bumped on every instance change, for the world bounds
+        unsigned int m_boundsRevision = 0;
+        glm::mat4 m_boundsModelview;
+        bool m_boundsValid = false;
+};
+
+#endif // INSTANCEDMESH_H
@@ -0,0 +1,52 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+/*!
+ *  \file MappedFile.h
+ */
+
+#include <string>
+#include <cstddef>
+
+/*!
+ *  \class MappedFile
+ *  \brief Read-only memory mapping of a whole file. The content is paged in by the OS on access, nothing is copied.
+ *  \warning The mapped data is NOT null terminated. Always use size() to know where it ends.
+ */
+class MappedFile
+{
+    public:
+        MappedFile();
+        MappedFile(std::string filepath);
+        virtual ~MappedFile();
+
+        bool open(std::string filepath);
+        void close();
+        void release(const char *begin, const char *end); // Memory usage hint, see MappedFile.cpp
+
+        /* Getters */
+        inline const char *data() const     { return m_data; };
+        inline const char *end() const      { return m_data + m_size; };
+        inline size_t size() const          { return m_size; };
+        inline bool isOpen() const          { return m_open; };
+
+    private:
+        /* A mapping can't be shared between two owners (the destructor unmaps it) */
+        MappedFile(const MappedFile &);
+        MappedFile &operator=(const MappedFile &);
+
+        const char *m_data = nullptr;
+        size_t m_size = 0;
+
+        /* OS handles */
+        #ifdef WIN32
+            void    *m_fileHandle = nullptr,
+                    *m_mappingHandle = nullptr;
+        #else
+            int m_fd = -1;
+        #endif
+
+        bool m_open = false;
+};
+
+#endif // MAPPEDFILE_H
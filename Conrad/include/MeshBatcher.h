@@ -0,0 +1,57 @@
+#ifndef MESHBATCHER_H
+#define MESHBATCHER_H
+
+/*!
+ *  \file MeshBatcher.h
+ */
+
+#include <vector>
+#include <cstddef>
+
+#define MESH_BATCH_MAX_VERTICES (1 << 20) // A group with more vertices is split into several batches
+
+/*!
+ *  \class MeshBatcher
+ *  \brief Static batching : merges meshes that share a material into one vertex and index array, each mesh becoming a piece (an index range).
+ *  The positions and normals are transformed by the mesh modelview on the way : a batch is drawn with the identity.
+ *  The pieces are kept in Morton order of their centers, so that the pieces visible together tend to be contiguous : after culling,
+ *  coalesce() turns the visible pieces into few draw ranges. No GL call (see BatchedMesh).
+ */
+class MeshBatcher
+{
+    public:
+        /* A mesh to merge. Only the positions are required */
+        struct Source {
+            int verticesCount = 0;
+            const float *vertices = nullptr,        // 3 per vertex
+                        *colors = nullptr,          // 3 per vertex (white if nullptr)
+                        *texCoords = nullptr,       // 2 per vertex
+                        *vertexNormals = nullptr;   // 3 per vertex
+
+            const void *indices = nullptr; // Triangles. nullptr : the vertices are a triangle list
+            int indicesCount = 0;
+            bool shortIndices = false; // 16 bits indices, 32 bits otherwise
+
+            float modelview[16]; // Column-major
+        };
+
+        struct Piece {
+            size_t source; // Index in the merged sources
+            unsigned int firstIndex, indexCount;
+            float boundsMin[3], boundsMax[3]; // Of the transformed vertices
+        };
+
+        struct Batch {
+            std::vector<float> vertices, colors, texCoords, vertexNormals;
+            std::vector<unsigned int> indices;
+            std::vector<Piece> pieces;
+        };
+
+        /* Merges sources (one material) into batches of up to MESH_BATCH_MAX_VERTICES vertices. A source bigger than that gets its own batch */
+        static void merge(const std::vector<Source> &sources, std::vector<Batch> &batches);
+
+        /* Draw ranges of the visible pieces (1 per piece), adjacent pieces merged. firsts and counts must hold one entry per piece. \return The range count */
+        static size_t coalesce(const std::vector<Piece> &pieces, const unsigned char *visible, unsigned int *firsts, int *counts);
+};
+
+#endif // MESHBATCHER_H
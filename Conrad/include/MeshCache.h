@@ -0,0 +1,82 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+/*!
+ *  \file MeshCache.h
+ */
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "MappedFile.h"
+
+#define MESH_CACHE_MAGIC        0x48534D43  // "CMSH"
+#define MESH_CACHE_VERSION      1
+#define MESH_CACHE_EXTENSION    ".cooked"   // Written next to the source file
+#define MESH_CACHE_SEED         0x9E3779B97F4A7C15ULL
+
+/*!
+ *  \class MeshCache
+ *  \brief Cooked (binary) meshes, ready to be uploaded : the vertex streams and index buffer of every mesh of a source file,
+ *  with its material binding and bounds. The file is tagged with a key (content hash of the sources and the loading options) :
+ *  it is only used when the key matches, and is then read straight from a memory mapping.
+ *
+ *  Layout (native endianness) : a header, then for every mesh a record (counts and bounds), the name, the material name, and the
+ *  positions, colors, texture coordinates, normals (floats) and indices. Every record and every array starts on a 16 bytes boundary.
+ */
+class MeshCache
+{
+    public:
+        /* One mesh. When read from a cache, every pointer points into the mapping (read-only, valid while the MeshCache is open). */
+        struct CookedMesh {
+            std::string name;
+            bool usesMaterial = false;
+            std::string material;
+
+            unsigned int verticesCount = 0,
+                         indicesCount = 0,  // 0 : not indexed
+                         indexSize = 0;     // Bytes : 2 or 4
+
+            const float *vertices = nullptr, // 3 per vertex
+                        *colors = nullptr,   // 3 per vertex
+                        *texCoords = nullptr,// 2 per vertex
+                        *vertexNormals = nullptr; // 3 per vertex
+            const void *indices = nullptr;
+
+            float boundsMin[3] = {0.0, 0.0, 0.0},
+                  boundsMax[3] = {0.0, 0.0, 0.0};
+        };
+
+        MeshCache();
+        virtual ~MeshCache();
+
+        bool open(const std::string &path, uint64_t key); // Counts a hit (true) or a miss (false)
+        void close();
+        const std::vector<CookedMesh> &getMeshes() const;
+
+        static bool write(const std::string &path, uint64_t key, const std::vector<CookedMesh> &meshes);
+
+        static uint64_t hash(const void *data, size_t size, uint64_t seed = MESH_CACHE_SEED);
+        static std::string cookedPath(const std::string &sourcePath);
+
+        /* Stats (every cache since the start) */
+        static unsigned int getHits();
+        static unsigned int getMisses();
+
+    private:
+        /* A mapping can't be shared between two owners */
+        MeshCache(const MeshCache &);
+        MeshCache &operator=(const MeshCache &);
+
+        bool read(uint64_t key);
+
+        MappedFile m_file;
+        std::vector<CookedMesh> m_meshes;
+
+        static unsigned int s_hits;
+        static unsigned int s_misses;
+};
+
+#endif // MESHCACHE_H
@@ -0,0 +1,66 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+/*!
+ *  \file MeshOptimizer.h
+ */
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#define VERTEX_CACHE_SIZE 16 // Post-transform cache size (FIFO) used for the optimization and the ACMR measure
+
+/*!
+ *  \class MeshOptimizer
+ *  \brief At-load optimization of indexed triangle lists for the GPU :
+ *  triangles are reordered for the post-transform vertex cache (Tipsify, Sander et al. 2007), the resulting clusters are sorted
+ *  outside-in to reduce overdraw, then the vertices are reordered in first-use order for fetch locality.
+ */
+class MeshOptimizer
+{
+    public:
+        /* One float attribute array of a mesh (positions, colors, texture coordinates, normals, ...) */
+        struct VertexStream {
+            float *data;
+            int components;
+        };
+
+        struct Stats {
+            bool optimized = false;
+            size_t vertices = 0, triangles = 0, clusters = 0;
+
+            float   acmrBefore = 0.0, acmrAfter = 0.0, // Average cache miss ratio : transformed vertices per triangle (0.5 is ideal, 3 is worst)
+                    atvrBefore = 0.0, atvrAfter = 0.0; // Average transformed vertex ratio : transformed vertices per vertex (1 is ideal)
+        };
+
+        /* Complete pass. streams[0] MUST be the positions. Reorders indices and every stream in place. */
+        static Stats optimize(std::vector<unsigned int> &indices, size_t vertexCount, const std::vector<VertexStream> &streams, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+        /* Steps */
+        static std::vector<unsigned int> optimizeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize, std::vector<size_t> &clusters);
+        static void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<size_t> &clusters, const float *positions);
+        static void optimizeVertexFetch(std::vector<unsigned int> &indices, size_t vertexCount, const std::vector<VertexStream> &streams);
+
+        /* Turns a non-indexed triangle list into an indexed one (exact attribute match). The streams are replaced by new malloc'd compacted arrays. */
+        static size_t weld(std::vector<VertexStream> &streams, size_t vertexCount, std::vector<unsigned int> &indices);
+
+        /* Measures */
+        static float computeACMR(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+        static float computeATVR(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+        /* Settings (set from the command line, see main.cpp) */
+        static void setEnabled(bool enabled);
+        static void setReport(bool report);
+        static bool isEnabled();
+        static bool isReporting();
+        static void report(const std::string &meshname, const Stats &stats); // Prints the stats if reporting is on
+
+    private:
+        static size_t cacheMisses(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize);
+
+        static bool s_enabled;
+        static bool s_report;
+};
+
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,99 @@
+#ifndef OBJPARSER_H
+#define OBJPARSER_H
+
+/*!
+ *  \file OBJParser.h
+ */
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <cstddef>
+
+#include "OBJTokenizer.h"
+
+using coordinate3d  = std::tuple<float, float, float>;
+using coordinate2d  = std::tuple<float, float>;
+using mapper        = std::tuple<int, int>;
+
+#define OBJ_PARSER_THREADS_AUTO 0           // One thread per hardware core
+#define OBJ_PARSER_MIN_CHUNK    (256*1024)  // Bytes. Smaller chunks aren't worth a thread
+
+/*!
+ *  \class OBJParser
+ *  \brief Parses a whole .obj buffer into global attribute arrays and a list of objects (one per "o", as OBJ_Static_Handler expects).
+ *  The buffer is split at line boundaries and every chunk is tokenized on its own thread. The chunks are then merged in file
+ *  order : a prefix sum over the per-chunk attribute counts rebases the relative indexes, and the objects that cross a chunk
+ *  boundary are stitched back together. The result doesn't depend on the thread count.
+ */
+class OBJParser
+{
+    public:
+        struct Object {
+            std::string name;
+
+            bool usesMaterial = false; // A "usemtl" was found. The last one of the object wins.
+            std::string material;
+
+            /* Indexes starting at 0, -1 when omitted (one entry per face corner) */
+            std::vector<int> faces_vertex_index,
+                             faces_tex_index,
+                             faces_normal_index;
+
+            std::vector<mapper> vertex_normals_mapper; // (vertex index, normal index)
+        };
+
+        OBJParser(unsigned int threadCount = OBJ_PARSER_THREADS_AUTO);
+        virtual ~OBJParser();
+
+        bool parse(const char *begin, const char *end);
+
+        /* Setters */
+        void setThreadCount(unsigned int threadCount); // OBJ_PARSER_THREADS_AUTO, 1 for a serial parse
+
+        /* Getters */
+        std::vector<coordinate3d> &getVertices();
+        std::vector<coordinate2d> &getTexCoords();
+        std::vector<coordinate3d> &getNormals();
+        std::vector<Object> &getObjects();
+
+        unsigned int getChunkCount(); // Number of chunks used by the last parse
+
+    protected:
+        /* Faces read between two "o" of a single chunk */
+        struct Segment {
+            std::string name; // Unused for the leading segment of a chunk (it continues the object opened before the chunk)
+
+            bool usesMaterial = false;
+            std::string material;
+
+            std::vector<int> corners;           // 9 ints per face, (vertex, texture, normal) * 3, as written in the file
+            std::vector<size_t> relativeSlots;  // Slots of corners that were relative (negative) indexes, resolved within the chunk
+        };
+
+        struct Chunk {
+            const char *begin, *end;
+
+            std::vector<coordinate3d> vertices;
+            std::vector<coordinate2d> tex;
+            std::vector<coordinate3d> normals;
+
+            Segment leading;
+            std::vector<Segment> objects;
+        };
+
+        static void parseChunk(Chunk &chunk);
+        void merge(std::vector<Chunk> &chunks);
+
+    private:
+        unsigned int m_threadCount;
+        unsigned int m_chunkCount = 0;
+
+        std::vector<coordinate3d> m_vertices;
+        std::vector<coordinate2d> m_tex;
+        std::vector<coordinate3d> m_normals;
+
+        std::vector<Object> m_objects;
+};
+
+#endif // OBJPARSER_H
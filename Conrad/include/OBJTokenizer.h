@@ -0,0 +1,57 @@
+#ifndef OBJTOKENIZER_H
+#define OBJTOKENIZER_H
+
+/*!
+ *  \file OBJTokenizer.h
+ */
+
+#include <cstddef>
+
+/* .obj record types */
+#define VERTEX  0
+#define TEXTURE 1
+#define NORMAL  2
+#define FACE    3
+#define OBJECT  4
+#define USEMTL  5
+
+/*!
+ *  \class OBJTokenizer
+ *  \brief Scans a .obj text buffer (typically a MappedFile) record by record with a hand-written cursor.
+ *  No memory is allocated : names are returned as views into the buffer and numbers are parsed in place.
+ *  \warning Only triangulated faces are read (the first three corners of each "f" line).
+ */
+class OBJTokenizer
+{
+    public:
+        struct Record {
+            int type = -1; // VERTEX, TEXTURE, NORMAL, FACE, OBJECT or USEMTL
+
+            float values[3];    // VERTEX (x y z), TEXTURE (u v), NORMAL (x y z)
+            int indexes[3][3];  // FACE : indexes[corner][0 : vertex, 1 : texture, 2 : normal], as written in the file (starting at 1). 0 when omitted.
+
+            const char *name = nullptr; // OBJECT and USEMTL : points into the buffer, NOT null terminated
+            size_t nameLength = 0;
+        };
+
+        OBJTokenizer(const char *begin, const char *end);
+        virtual ~OBJTokenizer();
+
+        bool next(Record &record); // Reads the next known record. Returns false at the end of the buffer.
+
+        inline const char *position() const { return m_cursor; };
+
+    protected:
+        inline void skipBlanks();
+        inline void skipLine();
+
+        inline float parseFloat();
+        inline int parseInt();
+        inline void parseCorner(int *corner);
+
+    private:
+        const char  *m_cursor,
+                    *m_end;
+};
+
+#endif // OBJTOKENIZER_H
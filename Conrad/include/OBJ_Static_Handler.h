@@ -13,10 +13,24 @@
 #include <vector>
 #include "scope.h"
 #include "utilities.hpp"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "OBJParser.h"
+#include "InstancedMesh.h"
+#include "BatchedMesh.h"
+
+#define OBJ_INSTANCING_MIN_COPIES   2       // Identical objects collapsed into one InstancedMesh from this many copies
+#define OBJ_INSTANCING_TOLERANCE    1e-5    // Relative, on the vertex attributes (the .obj values are rounded)
 
 /*!
  *  \class OBJ_Static_Handler
  *  \brief Handles the loading of a .obj scene with its associated .mtl
+ *  The meshes are cooked into OBJ_path + MESH_CACHE_EXTENSION after a parse, and read back from it (mapped) as long as the .obj, the .mtl
+ *  and the options don't change. Every mesh owns its arrays, the cooked ones included (copied out of the mapping).
+ *  Objects with the same geometry and material up to a translation (a tree placed many times) are collapsed into one InstancedMesh :
+ *  getMesh() returns it for each of their names, findInstance() gives the instance of a name.
+ *  With static batching on, the static meshes that share a material are then merged into BatchedMeshes : getMesh() returns the batch
+ *  of a merged object.
  */
 class OBJ_Static_Handler
 {
@@ -26,19 +40,42 @@ class OBJ_Static_Handler
 
         void load(bool loadTextures = true, bool loadMeshes = true, bool computeVertexNormals = true);
 
+        /* Setters */
+        void setParserThreadCount(unsigned int threadCount);
+        void setNormalsWeighting(int weighting); // NORMALS_WEIGHT_NONE (default), NORMALS_WEIGHT_AREA or NORMALS_WEIGHT_ANGLE
+        void setMeshCacheEnabled(bool enabled);
+        void setInstancingEnabled(bool enabled);
+        void setStaticBatchingEnabled(bool enabled); // Off by default : the batched objects can't move anymore
+
         /* Getters */
         StaticMesh *getMesh(std::string meshname);
-        vector<StaticMesh *> getAllMeshes();
+        vector<StaticMesh *> getAllMeshes(); // Each InstancedMesh once
+        bool findInstance(std::string meshname, InstancedMesh *&mesh, size_t &instance); // false if the object wasn't collapsed
 
     protected:
         void loadOBJ(bool loadMeshes, bool computeVertexNormals);
         void loadMTL(bool loadTextures);
+        void loadCooked(bool loadMeshes);
+        uint64_t cacheKey(const MappedFile &objFile, bool computeVertexNormals);
+        void collapseInstances();
+        void batchMeshes();
+        static bool sameGeometry(StaticMesh *reference, StaticMesh *mesh, glm::vec3 &offset); // mesh = reference translated by offset
 
     private:
         std::string m_OBJ_path, m_MTL_path;
 
         map<std::string, AbstractMaterial *>  m_materials;
-        map<std::string, StaticMesh *>        m_meshes;
+        map<std::string, StaticMesh *>        m_meshes; // Without the collapsed copies
+        map<std::string, std::pair<InstancedMesh *, size_t> > m_instances; // Collapsed object -> its instance
+        map<std::string, StaticMesh *> m_batches; // Batched object -> its BatchedMesh
+
+        unsigned int m_parserThreadCount = OBJ_PARSER_THREADS_AUTO;
+        int m_normalsWeighting = NORMALS_WEIGHT_NONE;
+
+        MeshCache m_cache;
+        bool m_meshCacheEnabled = true;
+        bool m_instancingEnabled = true;
+        bool m_staticBatchingEnabled = false;
 
         bool m_MTL_loaded = false;
 };
@@ -24,9 +24,13 @@
 
 #endif
 
+#define SHADOW_CUBE_NEAR 0.05 // Near plane of the cube faces
+
 /*!
  *  \class PointLight
  *  \brief Represents a point light (radial)
+ *  Its shadow map is a DEPTHBUFFER_CUBE of SHADOW_CUBE_SIZE faces, covering maxDistance around the light : each texel holds the distance
+ *  to the light divided by that range (see shaders/advanced/depth_cube.*).
  */
 
 class PointLight : public AbstractLight
@@ -35,14 +39,16 @@ class PointLight : public AbstractLight
         PointLight(glm::vec3 position, glm::vec3 color, float intensity = 1.0, bool castShadow = false, float linearAttenuation = 1.0, float minIntensity = 0.001, float maxDistance = 10.0);
         virtual ~PointLight();
 
-        void sendUniforms(const Shader &Shader, size_t index);
-        //void sendShadowUniforms(const Shader &shader, size_t index);
-        // TODO : Implement cubemap shadowing for point lightsard
+        void fillUniformBlock(LightBlock &block);
+        virtual bool isOmnidirectional(); // If it casts shadows
+
+        virtual float getShadowRange();
+        void getCubeFaces(glm::mat4 faces[6]); // Projection * view of each face, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i order
 
     protected:
 
     private:
-
+        float m_shadowRange;
 };
 
 #endif // POINTLIGHT_H
@@ -0,0 +1,59 @@
+#ifndef RANGEALLOCATOR_H
+#define RANGEALLOCATOR_H
+
+/*!
+ *  \file RangeAllocator.h
+ */
+
+#include <map>
+#include <cstddef>
+
+#define RANGE_ALLOCATOR_FAILED ((size_t) -1) // allocate() found no free block large enough
+
+/*!
+ *  \class RangeAllocator
+ *  \brief Sub-allocates [0; capacity) in units (vertices, indices, bytes...) : the offsets of the ranges a GPU buffer is shared between.
+ *  No memory is touched, only the offsets are managed. The free blocks are kept twice, by offset (to merge a freed range with its free
+ *  neighbours) and by size (best fit, in O(log n)) : two free blocks are never adjacent.
+ */
+class RangeAllocator
+{
+    public:
+        struct Stats {
+            size_t capacity = 0,
+                   used = 0,
+                   allocations = 0,
+                   freeBlocks = 0,
+                   largestFree = 0;
+            float fragmentation = 0.0; // 1 - largestFree / free units : 0 when the free space is one block
+        };
+
+        RangeAllocator();
+        RangeAllocator(size_t capacity);
+        virtual ~RangeAllocator();
+
+        void reset(size_t capacity); // Everything is free again
+
+        size_t allocate(size_t size); // \return The offset of the range, RANGE_ALLOCATOR_FAILED if no free block fits (or size is 0)
+        bool free(size_t offset); // false if offset isn't the start of an allocated range
+        size_t getSize(size_t offset) const; // Of an allocated range, 0 otherwise
+
+        size_t getCapacity() const;
+        size_t getUsed() const;
+        size_t getLargestFree() const;
+        bool isEmpty() const; // No range allocated
+        Stats getStats() const;
+
+    private:
+        void addFree(size_t offset, size_t size);
+        void removeFree(std::map<size_t, size_t>::iterator block);
+
+        std::map<size_t, size_t> m_freeByOffset; // Offset -> size
+        std::multimap<size_t, size_t> m_freeBySize; // Size -> offset
+        std::map<size_t, size_t> m_allocations; // Offset -> size
+
+        size_t m_capacity = 0,
+               m_used = 0;
+};
+
+#endif // RANGEALLOCATOR_H
@@ -0,0 +1,64 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+/*!
+ *  \file RenderQueue.h
+ */
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class AbstractMesh;
+
+/* Sort key layout, most significant first : the draw order is the key order.
+   Opaque pass : pass, shader, texture, material, depth (front to back, breaks the ties).
+   Translucent pass : pass, depth (back to front, the blending needs it), shader, texture, material (break the ties). */
+#define RENDER_KEY_PASS_BITS        4   // Opaque before translucent
+#define RENDER_KEY_SHADER_BITS      8
+#define RENDER_KEY_TEXTURE_BITS     16
+#define RENDER_KEY_MATERIAL_BITS    16
+#define RENDER_KEY_DEPTH_BITS       20
+#define RENDER_KEY_STATE_BITS       (RENDER_KEY_SHADER_BITS + RENDER_KEY_TEXTURE_BITS + RENDER_KEY_MATERIAL_BITS)
+
+#define RENDER_QUEUE_RADIX_MIN      2048 // Smaller queues are sorted with std::sort : the radix histograms cost more than they save
+
+#define RENDER_PASS_OPAQUE          0
+#define RENDER_PASS_TRANSLUCENT     1
+
+/*!
+ *  \class RenderQueue
+ *  \brief The draw items of one frame, each with a packed 64 bits sort key (see makeKey()). Once sorted, the items sharing a shader,
+ *  a texture or a material are consecutive : the renderer only changes a state when the key field changes.
+ *  The storage is kept from one frame to the next : a steady state frame doesn't allocate.
+ */
+class RenderQueue
+{
+    public:
+        struct DrawItem {
+            uint64_t key;
+            AbstractMesh *mesh;
+        };
+
+        RenderQueue();
+        virtual ~RenderQueue();
+
+        void clear(); // Keeps the storage
+        void push(uint64_t key, AbstractMesh *mesh);
+        void sort(); // By increasing key. Items with the same key share every state : their order is unspecified.
+
+        size_t size() const;
+        const DrawItem &operator[](size_t index) const;
+
+        /*!
+         *  \brief Packs a sort key. Every field is truncated to its width. depth is the normalized view distance, in [0; 1] :
+         *  for the translucent pass, it is inverted (the sort still goes in increasing key order) and placed above the state fields.
+         */
+        static uint64_t makeKey(unsigned int pass, unsigned int shader, unsigned int texture, unsigned int material, float depth);
+
+    private:
+        std::vector<DrawItem>   m_items,
+                                m_scratch; // Radix sort buffer
+};
+
+#endif // RENDERQUEUE_H
@@ -8,6 +8,7 @@
  */
 
 #include <vector>
+#include <map>
 
 /* GLM */
 #include <glm/glm.hpp>
@@ -17,15 +18,62 @@
 #include "utilities.hpp"
 
 #include "Shader.h"
+#include "GLState.h"
 #include "AbstractMesh.h"
 #include "AbstractCamera.h"
 #include "AbstractLight.h"
+#include "SunLight.h"
+#include "PointLight.h"
 #include "GUIRenderer.h"
 #include "SimpleTextureGUI.h"
+#include "AllocationCounter.h"
+#include "UniformBuffer.h"
+#include "UniformBlocks.h"
+#include "RenderQueue.h"
+#include "FrustumCuller.h"
+#include "SceneBVH.h"
+#include "ShadowAtlas.h"
+#include "ShadowBlur.h"
+#include "GPUTimer.h"
+
+#define RENDER_NEAR_PLANE 0.001
+#define RENDER_FAR_PLANE 100.0 // Also the depth range of the render queue keys
+
+#define RENDER_SHADOW_MAX_LAYERS SHADOW_CASCADES // Layers of a shadow map : the cascades of a SunLight
+
+/* Shadow texture units : DepthBuffer::bindTexture() indices */
+#define RENDER_ATLAS_UNIT 0
+#define RENDER_CASCADES_UNIT 1 // MAX_CASCADED_LIGHTS units
+#define RENDER_CUBES_UNIT (RENDER_CASCADES_UNIT + MAX_CASCADED_LIGHTS) // MAX_CUBE_LIGHTS units
+
+#define RENDER_BVH_MIN_MESHES 64 // Below, testing every volume (FrustumCuller) is cheaper than walking the hierarchy
+
+#define RENDER_WARMUP_FRAMES 60 // Frames after which render() must not allocate anymore (reported with CONRAD_COUNT_ALLOCATIONS, asserted in Debug)
 
 /*!
  * \class Renderer
  * \brief This class takes care of the rendering process for a given list of meshes.
+ * Camera and lights are uploaded once per frame to the Frame and Lights uniform blocks. Every material has its slot in a shared materials
+ * buffer, written when the material is first met or changed : a mesh only costs its two matrices and, if its material differs from the
+ * previous mesh one, a range bind.
+ * The meshes are drawn through a RenderQueue sorted by pass, shader, texture, material then depth (front to back for the opaque meshes,
+ * for early-Z) : the program, VAO, texture and material bindings are only issued when they change. The static meshes share the VAOs of
+ * the GeometryPool pages : the VAO rarely changes.
+ * An InstancedMesh is drawn in one call by the instanced variant of the shaders, which setShader() and setDepthShader() build.
+ * Only the meshes whose world bounds intersect the frustum are queued : the camera one for render(), the light one for generateShadowMap().
+ * From RENDER_BVH_MIN_MESHES meshes, the culling walks a SceneBVH over the world bounds. It is rebuilt after addMesh() and refitted for the
+ * meshes that moved. raycast() also goes through it.
+ * The shadow maps of the added lights are cached : render() only renders again the ones that are stale, because their light moved
+ * (AbstractLight::getRevision()) or a mesh moved, or was added, inside their frustum.
+ * A SunLight gets cascades fitted to the camera frustum every frame (the first MAX_CASCADED_LIGHTS ones, the next ones cast no shadow) :
+ * a cascade is rendered again when its matrix changed, i.e. when the camera moved by a texel of that cascade.
+ * A shadow casting PointLight gets a cube map (the first MAX_CUBE_LIGHTS ones), rendered in one pass by the cube depth shader : its geometry
+ * shader sends each triangle to the faces the mesh intersects (layered rendering).
+ * The other shadow casting lights (spot lights) share the shadow atlas : every frame, each one gets a tile sized by the screen size of its
+ * range (none if its range is out of the camera frustum), and its map is rendered again when its tile changed. One texture unit serves
+ * them all, the tile goes to the shader with the light (LightBlock::atlasRect).
+ * How the atlas shadows are filtered is selected at runtime (setShadowFilter()) : the shadow maps and the meshes are timed on the GPU,
+ * and the averages are reported per filter.
  */
 class Renderer
 {
@@ -36,16 +84,30 @@ class Renderer
 
         void setShader(Shader shader);
         void setDepthShader(Shader shader);
+        void setCubeDepthShader(Shader shader); // Vertex, geometry and fragment stages (see shaders/advanced/depth_cube.*)
+        void setShadowBlurShader(Shader shader); // shaders/advanced/shadow_blur.* : needed by SHADOW_FILTER_ESM
         void setGUIShader(Shader shader);
 
+        void setShadowFilter(int filter, int poissonTaps = SHADOW_POISSON_TAPS); // SHADOW_FILTER_* of the atlas lights. Rebuilds the materials shaders
+        int getShadowFilter();
+        static const char *getShadowFilterName(int filter);
+        void reportShadowFilter(); // Average GPU times since the filter was selected (also printed when it is changed), n/a without timer queries
+
         void render(); // Pushes next frame into buffer
         void toggleWireframe(); // Toggles wireframe rendering
 
-        void generateShadowMap(AbstractLight *source);
+        void generateShadowMap(AbstractLight *source); // Renders it now (a light of the atlas : in its tile of the last frame, if it got one). Not needed for the added lights : render() keeps their maps up to date
 
         int addMesh(AbstractMesh *mesh);
         AbstractMesh *getMesh(int meshID);
 
+        struct RayHit {
+            AbstractMesh *mesh;
+            unsigned int triangle; // See AbstractMesh::intersectRay()
+            float distance; // In units of direction
+        };
+        bool raycast(glm::vec3 origin, glm::vec3 direction, RayHit &hit); // Nearest mesh triangle along the ray. \return false if nothing is hit
+
         int addLight(AbstractLight *light);
         AbstractLight *getLight(int lightID);
 
@@ -55,45 +117,154 @@ class Renderer
         Shader *getShader();
         GUIRenderer *gui(); // Getter for the GUI Renderer
 
+        /* Frame stats */
+        unsigned long long getFrameCount();
+        unsigned long long getFrameUniformCalls(); // glUniform* calls of the last render()
+        unsigned long long getFrameBufferCalls(); // Uniform buffer updates and binds of the last render()
+        unsigned long long getFrameDrawCalls();
+        unsigned long long getFrameBinds(); // Program, VAO, texture and material bindings of the last render()
+        unsigned long long getFrameVisible(); // Meshes drawn by the last render()
+        unsigned long long getFrameCulled(); // Meshes out of the camera frustum in the last render()
+        unsigned long long getFrameShadowPasses(); // Shadow maps rendered for the last render() (since the previous one)
+        unsigned int getFrameAtlasTiles(); // Lights that got a tile of the shadow atlas in the last render()
+        double getFrameShadowGPUTime(); // Milliseconds, late by GPU_TIMER_QUERIES frames (see GPUTimer). 0 without timer queries
+        double getFrameSceneGPUTime(); // The meshes, without the shadow maps nor the GUI
+        unsigned long long getFrameAllocations(); // Heap allocations of the last render() (always 0 without CONRAD_COUNT_ALLOCATIONS)
+        void reportMemory(bool perMesh); // Prints the GPU memory of the meshes, against the float layout
+
         void clear();
 
     protected:
 
     private:
+        GLintptr registerMaterial(AbstractMaterial *material); // Offset of its slot in m_materialsBuffer, refreshed if the material changed
+        void reclaimMaterialSlots(); // Frees the slots of the materials no mesh uses anymore (deleted or replaced)
+        void updateVolumes(); // Culling volumes of the meshes that moved, BVH rebuild if meshes were added
+        size_t cullMeshes(const glm::mat4 &viewProjection); // Fills m_visible. \return The number of visible meshes
+
+        void updateShadowMaps(); // Renders the stale shadow maps of the added lights
+        void assignAtlasTiles(); // Packs the shadow atlas for this frame
+        void renderShadowMap(AbstractLight *source, unsigned int layers); // Bit i of layers : renders layer i (cascade i)
+        void fitCascades(SunLight *sun); // To the camera, the casters being in the scene bounds
+        void renderCubeShadowMap(PointLight *light); // The six faces in one pass
+        void invalidateShadowMaps(const float boundsMin[3], const float boundsMax[3]); // Something changed inside these world bounds
+
+        void loadMeshShaders(); // The materials shader variants, with the shadow filter defines
+        void setSamplers(Shader &shader);
+        Shader &getMeshShader(AbstractMesh *mesh);
+
         Shader m_shader, m_depthShader;
+        Shader m_instancedShader, m_instancedDepthShader; // Same sources, with INSTANCED_SHADER_DEFINE (InstancedMesh)
+        Shader m_octahedralShader; // With OCTAHEDRAL_NORMALS_SHADER_DEFINE (VertexLayout::compact() meshes). Positions need no variant
+        Shader m_cubeDepthShader, m_instancedCubeDepthShader;
 
         /* Scene */
         std::vector<AbstractMesh*>  m_meshes;
         std::vector<AbstractLight*> m_lights;
 
         glm::mat4 m_perspective = glm::mat4(1.0);
-        glm::mat4 m_ortho       = glm::mat4(1.0);
         AbstractCamera *m_camera;
 
         /* OpenGL */
         bool m_wireframe = false;
 
-        struct {
-            GLint   cameraPos,
-                    projection,
-                    camera,
-                    modelview,
-                    normalMatrix,
-                    nbrLights,
+        struct UniformLocations {
+            GLint   modelview,
+                    normalMatrix;
+        } m_uniformLocations, m_instancedUniformLocations, m_octahedralUniformLocations;
+        const UniformLocations &getMeshUniformLocations(AbstractMesh *mesh);
+
+        struct DepthUniformLocations {
+            GLint   world,
+                    modelview;
+        } m_depthUniformLocations, m_instancedDepthUniformLocations;
+
+        struct CubeDepthUniformLocations {
+            GLint   modelview,
+                    faces,
+                    faceMask,
+                    lightPos,
+                    shadowRange;
+        } m_cubeDepthUniformLocations, m_instancedCubeDepthUniformLocations;
 
-                    ambientColor,
-                    diffuseColor,
-                    specularColor,
+        /* Shadow maps */
+        struct ShadowState {
+            bool rendered = false;
+            unsigned int revision = 0; // AbstractLight::getRevision() when it was rendered
+            unsigned int layers = 1,
+                         dirtyLayers = 0; // Bit i : a caster changed in the frustum of layer i since it was rendered
 
-                    ambientStrength,
-                    diffuseStrength,
-                    specularStrength,
-                    specularExponent;
-        } m_uniformLocations;
+            /* Each layer when it was rendered */
+            glm::mat4 worlds[RENDER_SHADOW_MAX_LAYERS];
+            float planes[RENDER_SHADOW_MAX_LAYERS][6][4];
+
+            /* Shadow atlas */
+            int atlasRequest = -1; // This frame
+            ShadowAtlas::Tile tile; // Where the map was rendered. Empty while the light has no tile
+        };
+        std::map<AbstractLight*, ShadowState> m_shadowStates;
+
+        ShadowAtlas m_shadowAtlas;
+        DepthBuffer m_atlasBuffer; // Loaded by setDepthShader()
+        SimpleTextureGUI *m_atlasPreview = nullptr; // Debug view of the atlas
+        unsigned int m_frameAtlasTiles = 0;
+
+        /* Shadow filtering */
+        int m_shadowFilter = SHADOW_FILTER_PCF,
+            m_poissonTaps = SHADOW_POISSON_TAPS;
+        ShadowBlur m_shadowBlur; // SHADOW_FILTER_ESM
+
+        GPUTimer m_shadowTimer, m_sceneTimer;
+        unsigned long long m_filterFrames = 0, // Rendered since the filter was selected
+                           m_filterMeasures = 0, // Of them, timed
+                           m_filterTimerStart = 0; // m_sceneTimer.getCount() when it was selected
+        double m_filterShadowTime = 0.0, m_filterSceneTime = 0.0; // Sums, in ms
+
+        /* Uniform blocks */
+        struct MaterialSlot {
+            GLintptr offset;
+            unsigned int revision; // AbstractMaterial::getRevision() when the slot was written
+        };
+
+        UniformBuffer   m_frameBuffer,
+                        m_lightsBuffer,
+                        m_materialsBuffer;
+
+        RenderQueue m_queue;
+
+        /* Culling : one volume per mesh (same index as m_meshes) */
+        FrustumCuller m_culler;
+        std::vector<unsigned char> m_visible;
+
+        SceneBVH m_bvh;
+        std::vector<float> m_worldMin, m_worldMax; // World AABBs, 3 floats per mesh
+        bool m_bvhDirty = true; // Meshes were added since the last build
+
+        FrameBlock  m_frameBlock;
+        LightsBlock m_lightsBlock;
+
+        std::map<unsigned int, MaterialSlot> m_materialSlots; // By AbstractMaterial::getID() : a material allocated at the address of a deleted one gets its own slot
+        std::vector<GLintptr> m_freeMaterialSlots; // Offsets reclaimed by reclaimMaterialSlots(), reused before growing m_materialsData
+        std::vector<char> m_materialsData; // CPU copy of m_materialsBuffer, to grow it
+        GLsizeiptr m_materialStride = sizeof(MaterialBlock); // Rounded up to the offset alignment
 
         float   m_viewport_width,
                 m_viewport_height;
 
+        /* Frame stats */
+        unsigned long long  m_frameCount = 0,
+                            m_frameAllocations = 0,
+                            m_frameUniformCalls = 0,
+                            m_frameBufferCalls = 0,
+                            m_frameDrawCalls = 0,
+                            m_frameBinds = 0,
+                            m_frameVisible = 0,
+                            m_frameCulled = 0,
+                            m_frameShadowPasses = 0,
+                            m_shadowPasses = 0, // Since the start
+                            m_shadowPassesAtFrame = 0; // m_shadowPasses at the end of the last render()
+        bool m_allocationReported = false;
+
         /* GUI */
         GUIRenderer *m_guiRenderer;
 };
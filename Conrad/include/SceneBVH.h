@@ -0,0 +1,76 @@
+#ifndef SCENEBVH_H
+#define SCENEBVH_H
+
+/*!
+ *  \file SceneBVH.h
+ */
+
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+#define BVH_BINS            12  // SAH candidate splits per axis
+#define BVH_MAX_LEAF_SIZE   4   // A node with more primitives is always split (if their centroids differ)
+#define BVH_STACK_SIZE      64  // Traversal stack entries, bounds the tree depth
+
+/*!
+ *  \class SceneBVH
+ *  \brief Bounding volume hierarchy over world space AABBs (one per primitive, a mesh for the Renderer).
+ *  Built top-down with a binned surface area heuristic, flattened into one node array : the two children of a node are consecutive and
+ *  come after it, a leaf holds a range of the primitive index array. Every subtree is a contiguous range of that array too.
+ *  A primitive that moves is refitted : the nodes above it grow or shrink, the topology is kept (rebuild when it has degraded).
+ */
+class SceneBVH
+{
+    public:
+        struct Node { // 32 bytes
+            float boundsMin[3];
+            unsigned int left; // First child, 0 for a leaf (the root is never a child)
+            float boundsMax[3];
+            unsigned int count; // Leaf primitives
+        };
+
+        /* Primitive intersection, called for the primitives whose box the ray enters (nearest boxes first). t must be < tMax to count. */
+        typedef std::function<bool(size_t primitive, float tMax, float &t, unsigned int &triangle)> RayCallback;
+
+        struct RayHit {
+            size_t primitive;
+            unsigned int triangle;
+            float distance; // In units of the ray direction
+        };
+
+        SceneBVH();
+        virtual ~SceneBVH();
+
+        void build(size_t count, const float *boundsMin, const float *boundsMax); // 3 floats per primitive
+        void refit(size_t primitive, const float boundsMin[3], const float boundsMax[3]);
+        void clear();
+
+        /* Queries */
+        size_t cullFrustum(const float planes[6][4], unsigned char *visible) const; // Planes as FrustumCuller::extractPlanes(). \return Visible count
+        bool raycast(const float origin[3], const float direction[3], float tMax, const RayCallback &intersect, RayHit &hit) const;
+
+        /* Möller-Trumbore. \return true if the ray hits the triangle at t > 0 */
+        static bool intersectTriangle(const float origin[3], const float direction[3], const float *v0, const float *v1, const float *v2, float &t);
+
+        /* Getters */
+        size_t getPrimitiveCount() const;
+        size_t getNodeCount() const;
+        bool isBuilt() const;
+
+    private:
+        void subdivide(unsigned int node, unsigned int first, unsigned int count, unsigned int depth);
+        void fitNode(unsigned int node, unsigned int first, unsigned int count);
+        void markVisible(unsigned int node, unsigned char *visible, size_t &visibleCount) const; // Whole subtree
+
+        std::vector<Node> m_nodes;
+        std::vector<unsigned int> m_parents;
+        std::vector<unsigned int> m_first; // First primitive index of each node subtree (its range in m_indices)
+        std::vector<unsigned int> m_subtreeCount;
+
+        std::vector<unsigned int> m_indices; // Primitives, grouped by leaf
+        std::vector<unsigned int> m_leafOf; // Primitive -> leaf node
+        std::vector<float> m_primitiveMin, m_primitiveMax, m_centroids;
+};
+
+#endif // SCENEBVH_H
@@ -1,7 +1,6 @@
 #ifndef SCENEFORMATPARSER_H
 #define SCENEFORMATPARSER_H
 
-#include <fstream>
 #include <algorithm>
 #include <vector>
 #include "StaticMesh.h"
@@ -10,10 +9,14 @@
 #include "SunLight.h"
 #include "SpotLight.h"
 
+#include "SceneFormatReader.h" // Object codes
+#include "DecodePool.h"
+#include "BatchedMesh.h"
 
 #include "AbstractMaterial.h"
 #include <string>
 #include <map>
+#include <memory>
 //#include "scope.h"
 
  /* GLM */
@@ -21,27 +24,18 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-/* Object codes */
-#define MESH_OBJECT_CODE    0
-#define MATERIAL_OBJECT_CODE 1
-
-#define LIGHT_OBJECT_CODE   2
-    #define LIGHT_POINT_CODE 0
-    #define LIGHT_SUN_CODE 1
-    #define LIGHT_SPOT_CODE 2
-
-#define CAMERA_OBJECT_CODE  3
-
-#define VEC_ARRAY_OBJECT_CODE   255
-#define VEC_OBJECT_CODE         254 // Vectors of float
-#define STR_OBJECT_CODE         253
-
-#define OBJTYPE_STATIC 0
-#define OBJTYPE_DYNAMIC 1
-#define OBJTYPE_STREAM 2
-
-/* IMPORTANT : BY DEFAULT, EVERYTHING CONTAINED IN A VECTOR OR AN ARRAY VECTOR ARE FLOAT TYPES */
-
+/*!
+ *  \class SceneFormatParser
+ *  \brief Builds the meshes, materials and lights of a .scene file. The file is memory mapped (see SceneFormatReader) and the
+ *  vertex arrays are uploaded straight from the mapped pages. The reader is shared with the meshes whose arrays still point into it
+ *  (AbstractMesh::setArraysStorage()) : the mapping stays open until the parser and the last of these meshes are deleted.
+ *  parse() builds the whole file. loadMesh() and loadMaterial() build a single object on demand, found through the table of contents :
+ *  load() then only maps the file.
+ *  parse() loads in two phases (see DecodePool) : the workers decode the textures and prepare the meshes (validation, colors, optimization,
+ *  bounds) in parallel, while the calling thread, which must own the GL context, uploads them as they are ready.
+ *  With static batching on, parse() uploads the meshes at the end instead, once merged per material (see BatchedMesh) : getMeshes() then
+ *  lists the batches, loadMesh() returns the batch of a merged mesh.
+ */
 class SceneFormatParser
 {
     public:
@@ -52,81 +46,56 @@ class SceneFormatParser
         bool load(std::string filepath);
         bool parse();
 
+        void setThreadCount(unsigned int threadCount); // parse() workers. DECODE_POOL_THREADS_AUTO (default), 1 for a serial parse
+        void setStaticBatchingEnabled(bool enabled); // parse() only. Off by default : the batched meshes can't move anymore
+
+        /* On demand. An object is only built once : the next calls return it. nullptr if there is no such object. */
+        StaticMesh *loadMesh(std::string name); // Also loads its material
+        AbstractMaterial *loadMaterial(std::string name);
+
         std::vector<StaticMesh *> *getMeshes();
         std::map<std::string, AbstractMaterial *> *getMaterials();
         std::vector<AbstractLight *> *getLights();
 
     protected:
-        /* ##### TYPE STRUCTURES ##### */
+        /* ##### METHODS #####*/
 
-        /* An abstract structure for any block of data */
-        struct Object {
-            char type;
-            int datasize = 0;
+        StaticMesh *parseMesh(SceneFormatReader::Object meshObject); // The mesh arrays point into the mapping (read-only)
+        AbstractMaterial *parseMaterial(SceneFormatReader::Object materialObject);
+        AbstractLight *parseLight(SceneFormatReader::Object lightObject);
 
-            char *data_pointer = nullptr;
-        };
+        /* The two phases of parseMesh() and parseMaterial() */
+        static bool decodeMesh(SceneFormatReader::Object meshObject, SceneFormatReader::MeshData &data); // Decoded and validated
+        static StaticMesh *prepareMesh(const SceneFormatReader::MeshData &data, AbstractMaterial *material, MeshOptimizer::Stats &stats,
+                                       const std::shared_ptr<SceneFormatReader> &reader); // No GL call. reader : where data points
+        StaticMesh *uploadMesh(StaticMesh *mesh, const SceneFormatReader::Object &meshObject, const std::string &name, const MeshOptimizer::Stats &stats, bool load = true); // load false : registered only
+        void batchMeshes(); // Merges, then loads, the registered meshes
+        AbstractMaterial *buildMaterial(SceneFormatReader::Object materialObject); // Its texture isn't loaded
 
-        /* ##### METHODS #####*/
+    private:
+        /* One parse() object decoded by a worker */
+        struct LoadTask {
+            SceneFormatReader::Object object;
 
-        /* Reads an object as stored in the .scene format */
-        bool read_object(Object &object);
+            AbstractTexture *texture = nullptr; // Texture task, mesh task otherwise
+            bool decoded = false;
 
-        template<typename T>
-        inline char *extract(char *data_pointer, T &target); // Extracts a T type from the data_pointer. Returns the forwarded data pointer
-        inline char *extractVectorArray(char *data_pointer, int &count, int &dimension, float *&target_pointer);
-        inline char *extractVector(char *data_pointer, int &dimension, float *&target_pointer);
-        inline char *extractString(char *data_pointer, std::string &target);
+            SceneFormatReader::MeshData data;
+            StaticMesh *mesh = nullptr; // nullptr if the mesh object is malformed
+            MeshOptimizer::Stats stats;
+        };
 
-        StaticMesh *parseMesh(Object meshObject); /* IMPORTANT : MUST COPY THE DATA FROM THE DATA_POINTER (NOT JUST FORWARD THE POINTER), IT WILL BE DELETED RIGHT AFTER !!! */
-        AbstractMaterial *parseMaterial(Object materialObject); /* SAME */
-        AbstractLight *parseLight(Object lightObject); /* SAME */
-
-    private:
-        std::ifstream m_file;
-        size_t m_filesize; // in bytes
+        std::shared_ptr<SceneFormatReader> m_reader = std::make_shared<SceneFormatReader>(); // Shared with the meshes that point into its mapping
+        DecodePool m_pool;
 
         bool m_loaded = false;
-
-        char *m_iterator;
+        bool m_staticBatchingEnabled = false;
 
         std::vector<StaticMesh *>  m_meshes;
+        std::map<std::string, StaticMesh *> m_meshesByName;
         std::map<std::string, AbstractMaterial *> m_materials;
         std::vector<AbstractLight *> m_lights;
 
 };
 
-// Inline functions must be in the same scope file as their definition
-
-// Note that we could have used a &*data_pointer to directly modify the pointer instead of returning it, but returning it allows for more flexibility
-template<typename T>
-inline char *SceneFormatParser::extract(char *data_pointer, T &target)
-{
-    target = *reinterpret_cast<T*>(data_pointer); // Treats data_pointer as a pointing at a T type value
-    return data_pointer + sizeof(T);
-}
-
-inline char *SceneFormatParser::extractVectorArray(char *data_pointer, int &count, int &dimension, float *&target_pointer)
-{
-    data_pointer = extract(data_pointer, count);
-    data_pointer = extract(data_pointer, dimension);
-    target_pointer = reinterpret_cast<float*>(data_pointer);
-
-    return data_pointer + sizeof(float) * count * dimension;
-}
-
-inline char *SceneFormatParser::extractVector(char *data_pointer, int &dimension, float *&target_pointer)
-{
-    data_pointer = extract(data_pointer, dimension);
-    target_pointer = reinterpret_cast<float*>(data_pointer);
-
-    return data_pointer + sizeof(float) * dimension;
-}
-
-inline char *SceneFormatParser::extractString(char *data_pointer, std::string &target)
-{
-    target = std::string(data_pointer); // .scene format includes the end of sequence '\0' character so this should work fine.
-    return data_pointer + target.length() + 1; // +1 to count the null terminator '\0'
-}
-
 #endif // SCENEFORMATPARSER_H
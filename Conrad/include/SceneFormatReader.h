@@ -0,0 +1,231 @@
+#ifndef SCENEFORMATREADER_H
+#define SCENEFORMATREADER_H
+
+/*!
+ *  \file SceneFormatReader.h
+ */
+
+#include <string>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <map>
+
+#include "MappedFile.h"
+
+/* Object codes */
+#define MESH_OBJECT_CODE    0
+#define MATERIAL_OBJECT_CODE 1
+
+#define LIGHT_OBJECT_CODE   2
+    #define LIGHT_POINT_CODE 0
+    #define LIGHT_SUN_CODE 1
+    #define LIGHT_SPOT_CODE 2
+
+#define CAMERA_OBJECT_CODE  3
+
+#define VEC_ARRAY_OBJECT_CODE   255
+#define VEC_OBJECT_CODE         254 // Vectors of float
+#define STR_OBJECT_CODE         253
+
+#define OBJTYPE_STATIC 0
+#define OBJTYPE_DYNAMIC 1
+#define OBJTYPE_STREAM 2
+
+/* IMPORTANT : BY DEFAULT, EVERYTHING CONTAINED IN A VECTOR OR AN ARRAY VECTOR ARE FLOAT TYPES */
+
+/* Format v2 : header, 16 bytes aligned objects, table of contents (see notes/blender_import_export) */
+#define SCENE_MAGIC             "CSCN"
+#define SCENE_VERSION           2
+#define SCENE_HEADER_SIZE       16
+#define SCENE_ALIGNMENT         16
+
+/*!
+ *  \class SceneFormatReader
+ *  \brief Reads the objects of a .scene file from a read-only memory mapping of the whole file. Nothing is copied : every object,
+ *  string and float array is a view into the mapping, so they stay valid as long as the reader is open.
+ *  Every extraction is bounds-checked against its object : a truncated or corrupted object is flagged (Object::overflow), never read past.
+ *  Both versions are read. A v2 file carries a table of contents, a v1 file (a flat [code][size][data] stream) gets one built at open()
+ *  by walking the object headers : either way, an object can be found by name without decoding the ones before it.
+ *  \warning v1 doesn't align anything : the float arrays may be unaligned. v2 vector arrays start on SCENE_ALIGNMENT bytes.
+ */
+class SceneFormatReader
+{
+    public:
+        /* ##### TYPE STRUCTURES ##### */
+
+        /* An abstract structure for any block of data : a view into the mapping */
+        struct Object {
+            char type;
+            unsigned int datasize = 0;
+
+            const char *data_pointer = nullptr, // Forwarded by the extract functions
+                       *data_end = nullptr;
+            bool overflow = false; // An extraction didn't fit in the object
+            bool aligned = false; // v2 : the floats of the vector arrays are padded to SCENE_ALIGNMENT bytes
+        };
+
+        /* Table of contents entry */
+        struct Entry {
+            char type;
+            std::string name; // Empty for the objects that have none (v1 lights)
+            size_t offset; // Of the object data, in bytes from the beginning of the file
+            unsigned int size;
+        };
+
+        /* Decoded objects. The arrays point into the mapping. */
+        struct MeshData {
+            char meshType = OBJTYPE_STATIC;
+            std::string name, material;
+
+            int verticesCount = 0, texCount = 0, normalsCount = 0;
+            const float *vertices = nullptr,        // 3 per vertex
+                        *texCoords = nullptr,       // 2 per vertex
+                        *vertexNormals = nullptr;   // 3 per vertex
+        };
+
+        struct MaterialData {
+            std::string name, texturePath;
+            float ambient[3], diffuse[3], specular[3], emit[3];
+            float specularIntensity;
+            int specularExponent;
+        };
+
+        struct LightData {
+            char lightType;
+            float position[3], color[3], direction[3];
+            float intensity;
+            bool castShadow;
+        };
+
+        SceneFormatReader();
+        virtual ~SceneFormatReader();
+
+        bool open(std::string filepath);
+        void close();
+        bool isOpen();
+        size_t size(); // Bytes
+
+        int getVersion(); // 1 or SCENE_VERSION, 0 if no file is open
+        const std::vector<Entry> &getTableOfContents();
+
+        bool read_object(Object &object); // Next object in the file order. false after the last one
+        bool find_object(char type, const std::string &name, Object &object); // Random access through the table of contents
+        void rewind();
+        void release(const Object &object); // The object data has been consumed : its pages can leave the working set
+
+        static bool decodeMesh(Object meshObject, MeshData &mesh);
+        static bool decodeMaterial(Object materialObject, MaterialData &material);
+        static bool decodeLight(Object lightObject, LightData &light);
+
+        /* Extraction : forwards object.data_pointer. If the value doesn't fit, object.overflow is set and target gets an empty value. */
+        template<typename T>
+        static inline void extract(Object &object, T &target);
+        static inline void extractVectorArray(Object &object, int &count, int &dimension, const float *&target_pointer);
+        static inline void extractVector(Object &object, int &dimension, const float *&target_pointer);
+        static inline void extractVec3(Object &object, float target[3]); // A vector that must have at least 3 components
+        static inline void extractString(Object &object, std::string &target);
+
+    private:
+        /* A mapping can't be shared between two owners */
+        SceneFormatReader(const SceneFormatReader &);
+        SceneFormatReader &operator=(const SceneFormatReader &);
+
+        bool readTableOfContents(); // v2
+        void buildTableOfContents(); // v1
+        void addEntry(const Entry &entry);
+        Object view(const Entry &entry);
+
+        MappedFile m_file;
+        int m_version = 0;
+
+        std::vector<Entry> m_toc;
+        std::map<std::pair<char, std::string>, size_t> m_index; // (type, name) -> m_toc index. The first object of a name wins
+        size_t m_next = 0; // read_object position in m_toc
+};
+
+// Inline functions must be in the same scope file as their definition
+
+template<typename T>
+inline void SceneFormatReader::extract(Object &object, T &target)
+{
+    if(object.overflow || (size_t) (object.data_end - object.data_pointer) < sizeof(T)) {
+        object.overflow = true;
+        target = T();
+        return;
+    }
+
+    memcpy(&target, object.data_pointer, sizeof(T)); // The value may be unaligned
+    object.data_pointer += sizeof(T);
+}
+
+inline void SceneFormatReader::extractVectorArray(Object &object, int &count, int &dimension, const float *&target_pointer)
+{
+    extract(object, count);
+    extract(object, dimension);
+    target_pointer = nullptr;
+
+    if(object.aligned && !object.overflow) {
+        // The mapping starts on a page : the alignment of the address is the alignment of the file offset
+        size_t padding = (SCENE_ALIGNMENT - ((uintptr_t) object.data_pointer % SCENE_ALIGNMENT)) % SCENE_ALIGNMENT;
+        if(padding > (size_t) (object.data_end - object.data_pointer)) object.overflow = true;
+        else object.data_pointer += padding;
+    }
+
+    if(object.overflow || count < 0 || dimension < 0
+       || (unsigned long long) count * dimension * sizeof(float) > (unsigned long long) (object.data_end - object.data_pointer)) {
+        object.overflow = true;
+        count = dimension = 0;
+        return;
+    }
+
+    target_pointer = reinterpret_cast<const float*>(object.data_pointer);
+    object.data_pointer += sizeof(float) * count * dimension;
+}
+
+inline void SceneFormatReader::extractVector(Object &object, int &dimension, const float *&target_pointer)
+{
+    extract(object, dimension);
+    target_pointer = nullptr;
+
+    if(object.overflow || dimension < 0 || (unsigned long long) dimension * sizeof(float) > (unsigned long long) (object.data_end - object.data_pointer)) {
+        object.overflow = true;
+        dimension = 0;
+        return;
+    }
+
+    target_pointer = reinterpret_cast<const float*>(object.data_pointer);
+    object.data_pointer += sizeof(float) * dimension;
+}
+
+inline void SceneFormatReader::extractVec3(Object &object, float target[3])
+{
+    int dimension;
+    const float *vector_pointer;
+    extractVector(object, dimension, vector_pointer);
+
+    if(dimension < 3) {
+        object.overflow = true;
+        target[0] = target[1] = target[2] = 0.0;
+        return;
+    }
+
+    memcpy(target, vector_pointer, 3 * sizeof(float));
+}
+
+inline void SceneFormatReader::extractString(Object &object, std::string &target)
+{
+    // .scene format includes the end of sequence '\0' character : it must be found inside the object
+    const char *terminator = object.overflow ? nullptr : (const char *) memchr(object.data_pointer, '\0', object.data_end - object.data_pointer);
+    if(terminator == nullptr) {
+        object.overflow = true;
+        target.clear();
+        return;
+    }
+
+    target.assign(object.data_pointer, terminator);
+    object.data_pointer = terminator + 1; // +1 to count the null terminator '\0'
+}
+
+#endif // SCENEFORMATREADER_H
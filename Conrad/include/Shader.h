@@ -25,6 +25,9 @@
 #include <iostream>
 #include <string>
 
+#include "GLState.h"
+#include "VertexLayout.h"
+
 class Shader
 {
     public:
@@ -36,25 +39,33 @@ class Shader
         void setVertexPath(std::string vertexPath);
         void setFragmentPath(std::string fragmentPath);
         void setGeometryPath(std::string geometryPath);
+        void addDefine(std::string name); // #define inserted after the #version line of every stage. Before load()
+        void setDefine(std::string name, int value); // A valued define, that a later call replaces. load() again to apply it
+        void setVertexLayout(const VertexLayout &layout); // Adds the defines that decode its attributes. Before load()
 
         bool load();
 
         void bind();
-        static inline void unbind() { glUseProgram(0); };
+        static inline void unbind() { GLState::useProgram(0); };
 
         inline GLint getUniformLocation(const GLchar *name) const       { return glGetUniformLocation(m_programID, name); };
+        bool hasUniformBlock(const GLchar *name) const;
+
+        /* Uniform sends (counted : see getUniformCallCount()) */
+        static inline void sendVector(GLint location, glm::vec2 vector) { s_uniformCalls++; glUniform2f(location, vector[0], vector[1]); };
+        static inline void sendVector(GLint location, glm::vec3 vector) { s_uniformCalls++; glUniform3f(location, vector[0], vector[1], vector[2]); };
+        static inline void sendVector(GLint location, glm::vec4 vector) { s_uniformCalls++; glUniform4f(location, vector[0], vector[1], vector[2], vector[3]); };
+        static inline void sendRGB(GLint location, RGB color)           { s_uniformCalls++; glUniform3f(location, color.r, color.g, color.b); };
 
-        /* Uniform sends */
-        static inline void sendVector(GLint location, glm::vec2 vector) { glUniform2f(location, vector[0], vector[1]); };
-        static inline void sendVector(GLint location, glm::vec3 vector) { glUniform3f(location, vector[0], vector[1], vector[2]); };
-        static inline void sendRGB(GLint location, RGB color)           { glUniform3f(location, color.r, color.g, color.b); };
+        static inline void sendMatrix(GLint location, glm::mat3 matrix) { s_uniformCalls++; glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(matrix)); };
+        static inline void sendMatrix(GLint location, glm::mat4 matrix) { s_uniformCalls++; glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(matrix)); };
+        static inline void sendMatrices(GLint location, GLsizei count, const glm::mat4 *matrices) { s_uniformCalls++; glUniformMatrix4fv(location, count, GL_FALSE, glm::value_ptr(matrices[0])); }; // A mat4 array
 
-        static inline void sendMatrix(GLint location, glm::mat3 matrix) { glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(matrix)); };
-        static inline void sendMatrix(GLint location, glm::mat4 matrix) { glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(matrix)); };
+        static inline void sendFloat(GLint location, float value)       { s_uniformCalls++; glUniform1f(location, value); };
+        static inline void sendInt(GLint location, int value)           { s_uniformCalls++; glUniform1i(location, value); };
+        static inline void sendBool(GLint location, bool value)         { s_uniformCalls++; glUniform1i(location, value); };
 
-        static inline void sendFloat(GLint location, float value)       { glUniform1f(location, value); };
-        static inline void sendInt(GLint location, int value)           { glUniform1i(location, value); };
-        static inline void sendBool(GLint location, bool value)         { glUniform1i(location, value); };
+        static unsigned long long getUniformCallCount(); // glUniform* calls made through the send functions since the start
 
         /* Getters */
         GLuint getProgramID();
@@ -65,7 +76,8 @@ class Shader
         std::string getFragmentPath() const;
 
     protected:
-        static bool compile(GLuint &id, GLenum type, std::string const path);
+        static bool compile(GLuint &id, GLenum type, std::string const path, std::string const defines = "");
+        void bindUniformBlocks();
 
     private:
         GLuint  m_vertexID      = 0,
@@ -76,8 +88,11 @@ class Shader
         std::string m_vertexPath,
                     m_fragmentPath,
                     m_geometryPath;
+        std::string m_defines; // "#define NAME\n" lines
 
         bool m_usesGeometryShader = false;
+
+        static unsigned long long s_uniformCalls;
 };
 
 #endif // SHADER_H
@@ -0,0 +1,56 @@
+#ifndef SHADOWATLAS_H
+#define SHADOWATLAS_H
+
+/*!
+ *  \file ShadowAtlas.h
+ */
+
+#include <vector>
+#include <cstddef>
+
+#include "scope.h" // SHADOW_ATLAS_SIZE, SHADOW_ATLAS_MAX_TILE, SHADOW_ATLAS_MIN_TILE
+
+/*!
+ *  \class ShadowAtlas
+ *  \brief Shares one square depth texture between the shadow maps of many lights. Every frame, each light asks for a tile by its
+ *  importance (the screen size of its range, see importance()) and gets a power of two tile, from the minimum to the maximum size.
+ *  When the tiles don't fit, the least important lights are halved first, then dropped once at the minimum size : the memory stays the
+ *  one of the atlas, whatever the number of lights.
+ *  Power of two tiles placed from the largest along a Z-order curve can't overlap nor leave holes : the packing never fails once the
+ *  tiles fit in the atlas area. No GL call : the Renderer renders each tile through its viewport.
+ */
+class ShadowAtlas
+{
+    public:
+        struct Tile {
+            unsigned int x = 0, y = 0, size = 0; // Texels. size 0 : no tile
+        };
+
+        ShadowAtlas(unsigned int size = SHADOW_ATLAS_SIZE, unsigned int maxTile = SHADOW_ATLAS_MAX_TILE, unsigned int minTile = SHADOW_ATLAS_MIN_TILE);
+        virtual ~ShadowAtlas();
+
+        /* Per frame : clear(), one request() per light, then pack() */
+        void clear(); // Keeps the memory
+        size_t request(float importance); // [0; 1], 0 : no tile. \return The index of the request
+        unsigned int pack(); // \return The number of tiles given
+
+        static float importance(float distance, float range, float projectionScale); // projectionScale : projection[1][1] of the camera
+
+        /* Getters */
+        unsigned int getSize() const;
+        const Tile &getTile(size_t request) const;
+        void getRect(size_t request, float rect[4]) const; // Atlas coordinates of the tile : offset (x, y), scale (z, w)
+        unsigned int getUsedTexels() const; // Of the last pack(), against getSize()²
+
+    private:
+        static unsigned int tileSize(float importance, unsigned int minTile, unsigned int maxTile); // Power of two
+
+        unsigned int m_size, m_maxTile, m_minTile;
+
+        std::vector<float> m_importances;
+        std::vector<Tile> m_tiles; // Same index as the requests
+        std::vector<size_t> m_order;
+        unsigned int m_usedTexels = 0;
+};
+
+#endif // SHADOWATLAS_H
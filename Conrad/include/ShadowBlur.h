@@ -0,0 +1,72 @@
+#ifndef SHADOWBLUR_H
+#define SHADOWBLUR_H
+
+/*!
+ *  \file ShadowBlur.h
+ */
+
+#include "scope.h"
+#include "Shader.h"
+#include "GLState.h"
+#include "ShadowAtlas.h"
+
+/* Cross-plateform includes */
+#ifdef WIN32
+    #include <GL/glew.h>
+
+#elif __APPLE__
+    #define GL3_PROTOTYPES 1
+    #include <OpenGL/gl3.h>
+
+#else // UNIX / Linux
+    #define GL3_PROTOTYPES 1
+    #include <GL3/gl3.h>
+
+#endif
+
+/*!
+ *  \class ShadowBlur
+ *  \brief Exponential shadow map of the shadow atlas (SHADOW_FILTER_ESM). A tile of the depth atlas is converted to exp(c * (d - 1)),
+ *  d being its linear depth, and blurred into the same tile of a float atlas, in two passes (horizontal into a tile sized texture,
+ *  then vertical) : the materials shader filters it with a single bilinear fetch.
+ *  The passes draw a full screen triangle with shaders/advanced/shadow_blur.* (no vertex buffer).
+ */
+class ShadowBlur
+{
+    public:
+        ShadowBlur();
+        virtual ~ShadowBlur();
+
+        void setShader(Shader shader);
+        bool load(GLsizei atlasSize, GLsizei maxTile); // Float textures (R32F). Once : the next calls do nothing
+        bool isLoaded();
+
+        /* Reads the tile of the depth atlas, writes the same tile of the exponential atlas. shadowRange : far plane of a perspective map, 0 for
+           an orthographic one (its depth is already linear) */
+        void filter(GLuint depthAtlas, const ShadowAtlas::Tile &tile, float shadowRange);
+
+        void bindTexture(size_t index); // Unit DEPTHBUFFER_TEXTURE0 + index, as DepthBuffer::bindTexture()
+        GLuint getTextureID();
+
+    private:
+        struct Target {
+            GLuint frameBuffer = 0, texture = 0;
+            GLsizei size = 0;
+        };
+        static void loadTarget(Target &target, GLsizei size);
+        void pass(GLuint source, GLsizei sourceSize, const float sourceRect[4], bool horizontal, bool exponential, float shadowRange);
+
+        Shader m_shader;
+        struct {
+            GLint   source,
+                    sourceRect,
+                    texelStep,
+                    exponential,
+                    shadowRange;
+        } m_locations;
+
+        GLuint m_vertexArray = 0; // Empty : the triangle is made from gl_VertexID
+        Target m_atlas, m_temporary; // Exponential atlas, horizontal pass of one tile
+};
+
+#endif // SHADOWBLUR_H
@@ -0,0 +1,55 @@
+#ifndef SHADOWCASCADES_H
+#define SHADOWCASCADES_H
+
+/*!
+ *  \file ShadowCascades.h
+ */
+
+#include <vector>
+#include <cstddef>
+
+#include "scope.h" // SHADOW_CASCADES, SHADOW_CASCADE_SIZE
+
+#define SHADOW_CASCADE_LAMBDA 0.75 // Practical split scheme : 1 is the logarithmic split, 0 the uniform one
+
+/*!
+ *  \class ShadowCascades
+ *  \brief Light space matrices of the cascades of a directional light. The camera frustum is cut along its depth (practical split scheme,
+ *  a blend of the logarithmic and the uniform splits) and each slice gets an orthographic projection fitted to its bounding sphere.
+ *  The sphere only depends on the slice shape : its size doesn't change when the camera turns. Its center is snapped to the texels
+ *  of the cascade : when the camera moves, the map moves by whole texels and the shadow edges don't shimmer.
+ *  Matrices are column-major (as glm stores them). The view depth of a slice is the distance along the camera axis.
+ */
+class ShadowCascades
+{
+    public:
+        ShadowCascades(unsigned int count = SHADOW_CASCADES, unsigned int resolution = SHADOW_CASCADE_SIZE, float lambda = SHADOW_CASCADE_LAMBDA);
+        virtual ~ShadowCascades();
+
+        void setSplitLambda(float lambda);
+        void setTexelSnapping(bool enabled); // On by default
+
+        /* corners : the camera frustum in world space, near plane then far plane (same order on both), at view depths nearDepth and farDepth.
+           sceneMin, sceneMax : world AABB of the casters, which are kept in the maps even when they are behind the slices. */
+        void fit(const float corners[8][3], float nearDepth, float farDepth, const float lightView[16], const float sceneMin[3], const float sceneMax[3]);
+
+        static void computeSplits(unsigned int count, float nearDepth, float farDepth, float lambda, float *splits); // count + 1 depths
+
+        /* Getters */
+        unsigned int getCount() const;
+        unsigned int getResolution() const;
+        const float *getMatrix(unsigned int cascade) const; // Orthographic projection * light view
+        float getSplit(unsigned int cascade) const; // View depth where the cascade ends
+        float getTexelSize(unsigned int cascade) const; // World units
+
+    private:
+        unsigned int m_count, m_resolution;
+        float m_lambda;
+        bool m_texelSnapping = true;
+
+        std::vector<float>  m_matrices, // 16 per cascade
+                            m_splits, // m_count + 1, from the near depth
+                            m_texelSizes;
+};
+
+#endif // SHADOWCASCADES_H
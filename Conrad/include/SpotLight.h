@@ -21,19 +21,29 @@
 
 #endif
 
+#define SHADOW_SPOT_MAX_FOV 170.0 // Degrees : a wider cone is clamped in its shadow projection
+
+/*!
+ *  \class SpotLight
+ *  \brief Represents a spot light (cone of coneAngle degrees around its direction)
+ *  Its shadows are rendered into a tile of the shadow atlas (see ShadowAtlas), with a perspective projection of the cone up to maxDistance.
+ */
 class SpotLight : public AbstractLight
 {
     public:
         SpotLight(glm::vec3 position, glm::vec3 color, glm::vec3 direction, float coneAngle, float spotExponent, float intensity = 1.0, bool castShadow = false, float linearAttenuation = 1.0, float minIntensity = 0.001, float maxDistance = 10.0);
         virtual ~SpotLight();
 
-        void sendUniforms(const Shader &Shader, size_t index);
+        void fillUniformBlock(LightBlock &block);
+        virtual glm::mat4 getShadowProjection();
+        virtual float getShadowRange();
 
     protected:
 
     private:
         /* Cone */
         float m_coneAngle, m_spotExponent;
+        float m_shadowRange;
 };
 
 #endif // SPOTLIGHT_H
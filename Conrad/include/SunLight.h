@@ -6,6 +6,7 @@
  */
 
 #include "AbstractLight.h"
+#include "ShadowCascades.h"
 
 /* GLM */
 #include <glm/glm.hpp>
@@ -28,6 +29,8 @@
 /*!
  *  \class SunLight
  *  \brief Represents a sun. The light behaves as directional only.
+ *  Its shadow map is made of SHADOW_CASCADES cascades (layers of a DEPTHBUFFER_ARRAY), fitted to slices of the camera frustum by
+ *  fitCascades() : the fragment shader picks the cascade of a fragment by its view depth.
  */
 class SunLight : public AbstractLight
 {
@@ -35,12 +38,18 @@ class SunLight : public AbstractLight
         SunLight(glm::vec3 position, glm::vec3 direction, glm::vec3 color, float intensity = 1.0, bool castShadow = true);
         virtual ~SunLight();
 
-        void sendUniforms(const Shader &shader, size_t index);
+        void fillUniformBlock(LightBlock &block);
+        void fillCascadesBlock(CascadesBlock &block);
+        virtual bool isCascaded(); // If it casts shadows
+
+        /* cameraViewProjection covers the view depths [nearDepth; farDepth]. The casters are looked for in the world AABB [sceneMin; sceneMax]. */
+        void fitCascades(const glm::mat4 &cameraViewProjection, float nearDepth, float farDepth, glm::vec3 sceneMin, glm::vec3 sceneMax);
+        ShadowCascades &getCascades();
 
     protected:
 
     private:
-
+        ShadowCascades m_cascades;
 };
 
 #endif // SUNLIGHT_H
@@ -0,0 +1,47 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+/*!
+ *  \file TextureCache.h
+ */
+
+#include <string>
+#include <map>
+#include <cstddef>
+
+#include "AbstractTexture.h"
+
+/*!
+ *  \class TextureCache
+ *  \brief Path-keyed, reference counted cache of the file textures : every image is decoded and uploaded once, whoever uses it.
+ *  acquire() gives one reference to the caller, release() takes it back. The texture is deleted with its last reference.
+ *  A material owns the references of its textures (they are released when it is destroyed or when the texture is replaced).
+ *  \warning Not thread safe : textures are acquired and released on the GL thread.
+ */
+class TextureCache
+{
+    public:
+        static AbstractTexture *acquire(const std::string &filepath, bool load = true); // load : upload it now if it isn't yet
+        static void release(AbstractTexture *texture); // Ignores the textures that don't come from the cache (nullptr included)
+
+        /* Stats */
+        static unsigned int getHits();
+        static unsigned int getMisses();
+        static size_t getResidentBytes(); // Pixels of the loaded textures (GPU side, no mipmaps)
+        static size_t getTextureCount();
+        static void report(); // Prints the stats
+
+    private:
+        struct Entry {
+            AbstractTexture *texture;
+            unsigned int references;
+        };
+
+        static std::map<std::string, Entry> s_entries;
+        static std::map<AbstractTexture *, std::string> s_paths; // Texture -> s_entries key
+
+        static unsigned int s_hits;
+        static unsigned int s_misses;
+};
+
+#endif // TEXTURECACHE_H
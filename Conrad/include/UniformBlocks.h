@@ -0,0 +1,92 @@
+#ifndef UNIFORMBLOCKS_H
+#define UNIFORMBLOCKS_H
+
+/*!
+ *  \file UniformBlocks.h
+ *  \brief CPU images of the std140 uniform blocks of the materials shaders. Member order and padding follow the std140 rules :
+ *  a vec3 takes 16 bytes unless a scalar fills its last 4. Must be synced with shaders/advanced/materials.vert and .frag.
+ */
+
+/* Cross-plateform includes */
+#ifdef WIN32
+    #include <GL/glew.h>
+
+#elif __APPLE__
+    #define GL3_PROTOTYPES 1
+    #include <OpenGL/gl3.h>
+
+#else // UNIX / Linux
+    #define GL3_PROTOTYPES 1
+    #include <GL3/gl3.h>
+
+#endif
+
+#include "scope.h" // MAX_LIGHTS, MAX_CASCADED_LIGHTS, SHADOW_CASCADES
+
+/* Block names in the shaders and their binding points (set by Shader::load()) */
+#define FRAME_BLOCK_NAME        "Frame"
+#define LIGHTS_BLOCK_NAME       "Lights"
+#define MATERIAL_BLOCK_NAME     "Material"
+
+#define FRAME_BLOCK_BINDING     0
+#define LIGHTS_BLOCK_BINDING    1
+#define MATERIAL_BLOCK_BINDING  2
+
+/* Per frame : camera and projection */
+struct FrameBlock {
+    GLfloat projection[16];     // 0
+    GLfloat camera[16];         // 64
+    GLfloat cameraPos[3];       // 128
+    GLint   nbrLights;          // 140
+};
+
+/* One light (Light struct of the Lights block) */
+struct LightBlock {
+    GLfloat world[16];          // 0 : light space matrix
+    GLfloat position[3];        // 64
+    GLfloat intensity;          // 76
+    GLfloat color[3];           // 80
+    GLfloat linearAttenuation;  // 92
+    GLfloat direction[3];       // 96
+    GLfloat quadAttenuation;    // 108
+    GLint   type;               // 112
+    GLfloat spotExponent;       // 116
+    GLfloat coneAngle;          // 120
+    GLint   castShadow;         // 124 : bool
+    GLint   cascades;           // 128 : index in the cascades array, -1 if the light has no cascades
+    GLint   cubeMap;            // 132 : index in the cube maps array, -1 if the light has no cube map
+    GLfloat shadowRange;        // 136 : a cube map stores the distance to the light divided by it, a spot light map ends there
+    GLint   padding;            // 140
+    GLfloat atlasRect[4];       // 144 : tile of the light in the shadow atlas, offset (xy) and scale (zw). Empty if it has none
+};
+
+/* Shadow cascades of a light (Cascades struct of the Lights block) */
+struct CascadesBlock {
+    GLfloat world[SHADOW_CASCADES][16]; // 0 : light space matrix of each cascade
+    GLfloat splits[4];                  // 64 * SHADOW_CASCADES : view depth where each cascade ends (vec4)
+};
+
+/* Per frame : every light */
+struct LightsBlock {
+    LightBlock lights[MAX_LIGHTS];
+    CascadesBlock cascades[MAX_CASCADED_LIGHTS];
+};
+
+/* Per material, built once */
+struct MaterialBlock {
+    GLfloat ambientColor[3];    // 0
+    GLfloat ambientStrength;    // 12
+    GLfloat diffuseColor[3];    // 16
+    GLfloat diffuseStrength;    // 28
+    GLfloat specularColor[3];   // 32
+    GLfloat specularStrength;   // 44
+    GLfloat specularExponent;   // 48
+    GLfloat padding[3];         // The block size is rounded up to 16 bytes
+};
+
+static_assert(sizeof(FrameBlock) == 144, "FrameBlock doesn't match the std140 layout");
+static_assert(sizeof(LightBlock) == 160, "LightBlock doesn't match the std140 layout");
+static_assert(SHADOW_CASCADES <= 4, "The cascade splits are a vec4");
+static_assert(sizeof(MaterialBlock) == 64, "MaterialBlock doesn't match the std140 layout");
+
+#endif // UNIFORMBLOCKS_H
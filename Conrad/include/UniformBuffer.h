@@ -0,0 +1,57 @@
+#ifndef UNIFORMBUFFER_H
+#define UNIFORMBUFFER_H
+
+/*!
+ *  \file UniformBuffer.h
+ */
+
+/* Cross-plateform includes */
+#ifdef WIN32
+    #include <GL/glew.h>
+
+#elif __APPLE__
+    #define GL3_PROTOTYPES 1
+    #include <OpenGL/gl3.h>
+
+#else // UNIX / Linux
+    #define GL3_PROTOTYPES 1
+    #include <GL3/gl3.h>
+
+#endif
+
+/*!
+ *  \class UniformBuffer
+ *  \brief A uniform buffer object (GL_UNIFORM_BUFFER) : the storage of one or several uniform blocks (see UniformBlocks.h).
+ *  Every update and bind is counted, for the per-frame stats.
+ */
+class UniformBuffer
+{
+    public:
+        UniformBuffer();
+        virtual ~UniformBuffer();
+
+        void allocate(GLsizeiptr size, const void *data = nullptr); // (Re)creates the storage. data may be nullptr.
+        void update(GLintptr offset, GLsizeiptr size, const void *data);
+
+        void bindBase(GLuint binding); // The whole buffer
+        void bindRange(GLuint binding, GLintptr offset, GLsizeiptr size); // offset must be a multiple of getOffsetAlignment()
+
+        /* Getters */
+        GLuint getID();
+        GLsizeiptr getSize();
+
+        static GLint getOffsetAlignment(); // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+        static unsigned long long getCallCount(); // Updates and binds since the start, every buffer
+
+    private:
+        /* The destructor deletes the GL buffer */
+        UniformBuffer(const UniformBuffer &);
+        UniformBuffer &operator=(const UniformBuffer &);
+
+        GLuint m_id = 0;
+        GLsizeiptr m_size = 0;
+
+        static unsigned long long s_calls;
+};
+
+#endif // UNIFORMBUFFER_H
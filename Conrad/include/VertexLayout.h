@@ -0,0 +1,88 @@
+#ifndef VERTEXLAYOUT_H
+#define VERTEXLAYOUT_H
+
+/*!
+ *  \file VertexLayout.h
+ */
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include "scope.h"
+
+/*!
+ *  \class VertexLayout
+ *  \brief How the vertices of a mesh are stored on the GPU : one interleaved attribute per array, each with its encoding.
+ *  - Positions : floats, or 16 bits normalized against the bounding box of the mesh (the box goes into the modelview, see encode())
+ *  - Normals : floats, or octahedral (2 x 16 bits, decoded by the shaders built with OCTAHEDRAL_NORMALS_SHADER_DEFINE)
+ *  - Texture coordinates : floats or half floats
+ *  - Colors : floats, 8 bits normalized, or none (the shaders then read the constant white of the attribute)
+ *  Every attribute starts on 4 bytes. The float layout (the default constructor) takes 44 bytes per vertex, compact() 16.
+ *  No GL call : the GL types are given by the GeometryPool.
+ */
+class VertexLayout
+{
+    public:
+        enum Positions  { POSITIONS_FLOAT, POSITIONS_UNORM16 };
+        enum Normals    { NORMALS_FLOAT, NORMALS_OCTAHEDRAL };
+        enum TexCoords  { TEXCOORDS_FLOAT, TEXCOORDS_HALF };
+        enum Colors     { COLORS_NONE, COLORS_FLOAT, COLORS_UNORM8 };
+
+        enum Encoding { FLOAT, HALF, UNORM16, SNORM16, UNORM8 }; // Of the components
+
+        struct Attribute {
+            unsigned int location; // VERTEX_BUFFER, COLOR_BUFFER...
+            const char *name; // In the shaders
+            int components;
+            Encoding encoding;
+            size_t offset; // Bytes, in the vertex
+        };
+
+        VertexLayout(Positions positions = POSITIONS_FLOAT, Normals normals = NORMALS_FLOAT, TexCoords texCoords = TEXCOORDS_FLOAT, Colors colors = COLORS_FLOAT);
+        static VertexLayout compact(); // 16 bits positions, octahedral normals, half texture coordinates, no colors
+
+        Positions getPositions() const;
+        Normals getNormals() const;
+        TexCoords getTexCoords() const;
+        Colors getColors() const;
+        void setColors(Colors colors);
+
+        const std::vector<Attribute> &getAttributes() const;
+        size_t getStride() const; // Bytes per vertex
+        int getKey() const; // Same key, same layout
+        std::string getName() const;
+        std::vector<std::string> getShaderDefines() const; // For Shader::addDefine()
+
+        bool operator==(const VertexLayout &layout) const;
+        bool operator!=(const VertexLayout &layout) const;
+
+        /*!
+         *  \brief Interleaves count vertices into destination (getStride() bytes each). Only positions is required : missing colors are white,
+         *  missing texture coordinates 0 and missing normals +z.
+         *  \param decodeOffset, decodeScale The stored positions p are decodeOffset + decodeScale * p : the box of the positions for
+         *  POSITIONS_UNORM16, 0 and 1 otherwise.
+         */
+        void encode(size_t count, const float *positions, const float *colors, const float *texCoords, const float *normals,
+                    void *destination, float decodeOffset[3], float decodeScale[3]) const;
+
+        /* Encodings */
+        static uint16_t toHalf(float value); // Round to nearest even, overflows to infinity
+        static float fromHalf(uint16_t half);
+        static void encodeOctahedral(const float normal[3], int16_t encoded[2]); // normal must be normalized
+        static void decodeOctahedral(const int16_t encoded[2], float normal[3]);
+
+    private:
+        void build();
+
+        Positions m_positions;
+        Normals m_normals;
+        TexCoords m_texCoords;
+        Colors m_colors;
+
+        std::vector<Attribute> m_attributes;
+        size_t m_stride = 0;
+};
+
+#endif // VERTEXLAYOUT_H
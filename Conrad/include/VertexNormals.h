@@ -0,0 +1,46 @@
+#ifndef VERTEXNORMALS_H
+#define VERTEXNORMALS_H
+
+/*!
+ *  \file VertexNormals.h
+ */
+
+#include <vector>
+#include <cstddef>
+
+#include "OBJParser.h" // coordinate3d, mapper
+
+#define NORMALS_WEIGHT_NONE     0 // Plain sum of the corner normals
+#define NORMALS_WEIGHT_AREA     1 // Each corner normal weighted by the area of its triangle
+#define NORMALS_WEIGHT_ANGLE    2 // Each corner normal weighted by the angle of the triangle at that corner
+
+#define NORMALS_THREADS_AUTO            0           // One thread per hardware core
+#define NORMALS_MIN_CORNERS_PER_THREAD  (64*1024)   // Smaller ranges aren't worth a thread
+
+/*!
+ *  \class VertexNormals
+ *  \brief Averages the .obj corner normals into one normal per vertex position (smooth shading).
+ *  The sums go to a flat array indexed by the vertex index. The corners are split across threads, each one accumulating
+ *  into its own array, and the arrays are then reduced (also in parallel, one vertex range per thread).
+ */
+class VertexNormals
+{
+    public:
+        /*!
+         *  \param vertexCount Number of vertex positions. Corners using an index out of [0; vertexCount) are ignored.
+         *  \param out Receives the normals of the vertices [firstVertex; firstVertex + out.size() / 3), which covers every vertex
+         *  the corners use (an object only spans its own part of the file positions) : x, y, z of vertex i at 3*(i - firstVertex).
+         *  \param positions Vertex positions. Only needed for the area and angle weightings.
+         *  The normals aren't normalized (they are in the shader). A vertex used by no corner gets (0, 0, 0).
+         */
+        static void average(const std::vector<coordinate3d> &normals, const std::vector<mapper> &vertex_normals_mapper, size_t vertexCount,
+                            std::vector<float> &out, size_t &firstVertex, int weighting = NORMALS_WEIGHT_NONE,
+                            const std::vector<coordinate3d> *positions = nullptr, unsigned int threadCount = NORMALS_THREADS_AUTO);
+
+    private:
+        static void accumulate(const std::vector<coordinate3d> &normals, const std::vector<mapper> &vertex_normals_mapper, size_t begin, size_t end,
+                               float *sums, size_t firstVertex, size_t vertexCount, int weighting, const std::vector<coordinate3d> *positions);
+        static float cornerWeight(const std::vector<mapper> &vertex_normals_mapper, size_t corner, int weighting, const std::vector<coordinate3d> &positions);
+};
+
+#endif // VERTEXNORMALS_H
@@ -15,16 +15,40 @@
 #define COLOR_BUFFER            1
 #define TEX_BUFFER              2
 #define VERTEX_NORMAL_BUFFER    3
+#define INSTANCE_MODELVIEW_BUFFER   4 // mat4 : 4 to 7 (InstancedMesh)
+#define INSTANCE_NORMAL_BUFFER      8 // mat3 : 8 to 10
 
 /* Paths */
 #define TEXPATH "textures"
 #define BLANKONE_PATH TEXPATH "/blank_onepx.png" // One pixel 100% blank texture
 
 /* Shader defines */
+#define INSTANCED_SHADER_DEFINE "INSTANCED" // Defined in the instanced variants of the shaders
+#define OCTAHEDRAL_NORMALS_SHADER_DEFINE "OCTAHEDRAL_NORMALS" // Variants for VertexLayout::NORMALS_OCTAHEDRAL
 #define LIGHTS_ARRAY_SHADER "lights"
+#define MAX_LIGHTS 32 // Size of the lights array (must be synced with the shaders)
 
 /* Shadow mapping */
 #define SHADOWMAP_SIZE 1024
+#define SHADOW_CASCADES 4 // Per cascaded light (SunLight), at most 4 : the splits are a vec4 (must be synced with the shaders)
+#define SHADOW_CASCADE_SIZE 512 // SHADOW_CASCADES maps of 512 : the texels of one SHADOWMAP_SIZE map
+#define SHADOW_CASCADE_DEPTH_STEPS 8 // The depth range of a cascade is snapped to steps of radius / SHADOW_CASCADE_DEPTH_STEPS
+#define MAX_CASCADED_LIGHTS 2 // Size of the cascades array (must be synced with the shaders)
+#define SHADOW_CUBE_SIZE 512 // Faces of the cube shadow maps (PointLight)
+#define MAX_CUBE_LIGHTS 2 // Size of the cube maps array (must be synced with the shaders)
+#define SHADOW_ATLAS_SIZE 4096 // Shared by the other shadow casting lights (spot lights) : 64 MiB of depth, whatever their number
+#define SHADOW_ATLAS_MAX_TILE 1024 // Tile of a light that fills the screen
+#define SHADOW_ATLAS_MIN_TILE 128 // Smallest tile : below, a light gets none
+
+/* Shadow filtering of the atlas (must be synced with the shaders) */
+#define SHADOW_FILTER_PCF       0 // 5x5 depth fetches compared in the shader
+#define SHADOW_FILTER_HARDWARE  1 // 4 bilinear comparison fetches (sampler2DShadow)
+#define SHADOW_FILTER_POISSON   2 // SHADOW_POISSON_TAPS comparison fetches on a rotated Poisson disk
+#define SHADOW_FILTER_ESM       3 // 1 fetch of an exponential shadow map, prefiltered by a separable blur (ShadowBlur)
+#define SHADOW_FILTER_COUNT     4
+#define SHADOW_POISSON_TAPS 8 // Default, at most SHADOW_POISSON_MAX_TAPS
+#define SHADOW_POISSON_MAX_TAPS 16
+#define SHADOW_ESM_EXPONENT 80.0 // Sharpness of the exponential shadow maps : exp(80) still fits in a float
 
 /* Textures IDs */
 #define DEPTHBUFFER_TEXTURE0 10 // First index of a depth buffer texture OpenGL binding
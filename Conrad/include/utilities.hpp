@@ -8,6 +8,7 @@
 #include <map>
 #include <vector>
 #include <tuple>
+#include <unordered_map>
 
 /* GLM */
 #include <glm/glm.hpp>
@@ -15,19 +16,18 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "StaticMesh.h"
+#include "MappedFile.h"
+#include "OBJTokenizer.h" // VERTEX, TEXTURE, NORMAL, FACE, OBJECT, USEMTL
+#include "OBJParser.h" // coordinate3d, coordinate2d, mapper
+#include "VertexNormals.h"
+#include "MeshOptimizer.h" // isReporting()
 
 #define X_coord 0
 #define Y_coord 1
 #define Z_coord 2
 
-#define VERTEX  0
-#define TEXTURE 1
-#define NORMAL  2
-#define FACE    3
-#define OBJECT  4
-#define USEMTL  5
-
 #include "AbstractMaterial.h"
+#include "TextureCache.h"
 
 #define AMBIENT         0
 #define DIFFUSE         1
@@ -40,14 +40,10 @@
 #define SPECULAR_TEX    9
 
 using namespace std;
-using coordinate3d  = tuple<float, float, float>;
-using coordinate2d  = tuple<float, float>;
-using mapper        = tuple<int, int>;
 
 /* Definitions */
 static vector<StaticMesh*> loadOBJ_static(string, bool);
-static StaticMesh *StaticMeshFromArrays(vector<coordinate3d>*, vector<coordinate2d>*, vector<coordinate3d>*, vector<int>*, vector<int>*, vector<int>*, vector<mapper>* = nullptr);
-static map<int, coordinate3d> generate_average_vertex_normals(vector<coordinate3d>*, vector<mapper>*);
+static StaticMesh *StaticMeshFromArrays(vector<coordinate3d>*, vector<coordinate2d>*, vector<coordinate3d>*, vector<int>*, vector<int>*, vector<int>*, vector<mapper>* = nullptr, int = NORMALS_WEIGHT_NONE);
 
 static vector<AbstractMaterial*> loadMTL(string, bool);
 
@@ -69,20 +65,13 @@ static vector<StaticMesh*> loadOBJ_static(string filepath, bool load = true, boo
 {
     vector<StaticMesh*> meshes;
 
-    ifstream file(filepath.c_str());
-    if(!file) {
+    MappedFile file(filepath);
+    if(!file.isOpen()) {
         cout << "Can't load (" << filepath << ")" << endl;
         return meshes; // empty
     }
 
-    /* Getting the file in memory */
-    string line;
-    vector<string> lines;
-    while(getline(file, line)) {
-        lines.push_back(line);
-    } file.close();
-
-    /* Parsing the .obj lines */
+    /* Parsing the .obj records (straight from the mapped file) */
     vector<coordinate3d> vertices;
     vector<coordinate2d> tex;
     vector<coordinate3d> normals;
@@ -93,21 +82,12 @@ static vector<StaticMesh*> loadOBJ_static(string filepath, bool load = true, boo
     vector<int> faces_tex_index;
     vector<int> faces_normal_index;
 
-    bool firstO = true; // Checks if the first "o.." has been read (in order not to create an invalid mesh with the infos above the first object). true = we are still at the first one
-    for(vector<string>::iterator it = lines.begin(); it != lines.end(); it++) {
-        line = (*it);
-        stringstream stream(line);
-        string c; stream >> c; // First char of the string
+    OBJTokenizer tokenizer(file.data(), file.end());
+    OBJTokenizer::Record record;
 
-        int index = -1;
-        if(c == "v")        index = VERTEX;
-        else if(c == "vt")  index = TEXTURE;
-        else if(c == "vn")  index = NORMAL;
-        else if(c == "f")   index = FACE;
-        else if(c == "o")   index = OBJECT;
-        else                continue; // Unknown char
-
-        switch(index) { // First char of the line
+    bool firstO = true; // Checks if the first "o.." has been read (in order not to create an invalid mesh with the infos above the first object). true = we are still at the first one
+    while(tokenizer.next(record)) {
+        switch(record.type) {
             case OBJECT: // Next object has been detected
             {
                 if(firstO)  { // We don't want to create "last" object if it's the first one
@@ -134,49 +114,27 @@ static vector<StaticMesh*> loadOBJ_static(string filepath, bool load = true, boo
 
             case VERTEX: // Vertex
             {
-                float x, y, z;
-                stream >> x >> y >> z;
-                vertices.push_back(make_tuple(x, y, z));
-
+                vertices.push_back(make_tuple(record.values[0], record.values[1], record.values[2]));
                 break;
             }
 
             case TEXTURE:  // Texture coordinate
             {
-                float u, v;
-                stream >> u >> v;
-                tex.push_back(make_tuple(u, v));
-
+                tex.push_back(make_tuple(record.values[0], record.values[1]));
                 break;
             }
 
             case NORMAL: // Normal
             {
-                float x, y, z;
-                stream >> x >> y >> z;
-                normals.push_back(make_tuple(x, y, z));
-
+                normals.push_back(make_tuple(record.values[0], record.values[1], record.values[2]));
                 break;
             }
 
             case FACE: // Face
             {
-                string vert[3];
-                stream >> vert[0] >> vert[1] >> vert[2];
-
                 for(int i = 0;i < 3;i++) { // One vertex
-                    stringstream sub_stream(vert[i]);
-                    int indexes[3];
-
-                    /* Parsing "1/2/3" */
-                    int value, j = 0;
-                    while(sub_stream >> value) {
-                        indexes[j] = value;
-
-                        if(sub_stream.peek() == '/') sub_stream.ignore();
-                        j++;
-                    }
-                    /* Now indexes[0] is vertex ; indexes[1] is texture ; indexes[2] is normal */
+                    int *indexes = record.indexes[i];
+                    /* indexes[0] is vertex ; indexes[1] is texture ; indexes[2] is normal */
 
                     // Indexes start at 1 on .obj. The indexes now stored are the real indexes ready to be accessed from.
 
@@ -206,38 +164,85 @@ static vector<StaticMesh*> loadOBJ_static(string filepath, bool load = true, boo
     return meshes;
 }
 
+/* Identifies a unique vertex of an indexed mesh : (position index, texture index, normal index) */
+struct VertexKey {
+    int vertex, texture, normal;
+
+    bool operator==(const VertexKey &other) const { return vertex == other.vertex && texture == other.texture && normal == other.normal; }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey &key) const
+    {
+        size_t h = (size_t) key.vertex * 73856093u;
+        h ^= (size_t) key.texture * 19349663u;
+        h ^= (size_t) key.normal * 83492791u;
+        return h;
+    }
+};
+
+/*!
+ *  \brief Builds an indexed StaticMesh from the .obj arrays. Every face corner is hashed by its (position, uv, normal) indexes so that
+ *  a vertex shared by several triangles is stored once, and the triangles are described by a 16 bits (up to 65536 vertices) or 32 bits index buffer.
+ *  \param vertex_normals_mapper nullptr for not computing the vertex normals. Otherwise the normal only depends on the position.
+ *  \param normals_weighting NORMALS_WEIGHT_NONE, NORMALS_WEIGHT_AREA or NORMALS_WEIGHT_ANGLE (computed vertex normals only)
+ */
 static StaticMesh *StaticMeshFromArrays(vector<coordinate3d> *vertices, vector<coordinate2d> *textures, vector<coordinate3d> *normals,
                                         vector<int> *faces_vertex_index, vector<int> *faces_tex_index, vector<int> *faces_normal_index,
-                                        vector<mapper> *vertex_normals_mapper) // nullptr for not computing the vertex normals
+                                        vector<mapper> *vertex_normals_mapper, int normals_weighting) // nullptr for not computing the vertex normals
 {
+    size_t corners = faces_vertex_index->size();
+
+    /* Unique vertices table */
+    unordered_map<VertexKey, unsigned int, VertexKeyHash> unique_vertices;
+    unique_vertices.reserve(corners);
+
+    vector<unsigned int> corner_to_vertex(corners); // Index of the unique vertex used by each corner
+    vector<size_t> vertex_first_corner;             // First corner that used each unique vertex (to fetch its attributes)
+    vertex_first_corner.reserve(corners);
+
+    for(size_t i = 0;i < corners;i++) {
+        VertexKey key = {faces_vertex_index->at(i), faces_tex_index->at(i), (vertex_normals_mapper != nullptr) ? -1 : faces_normal_index->at(i)}; // Averaged normals only depend on the position
+
+        auto inserted = unique_vertices.insert(make_pair(key, (unsigned int) vertex_first_corner.size()));
+        if(inserted.second) vertex_first_corner.push_back(i); // New vertex
+
+        corner_to_vertex[i] = inserted.first->second;
+    }
+
+    size_t verticesCount = vertex_first_corner.size();
+    bool short_indices = (verticesCount <= 65536);
+
     /* Creating the mesh */
     float *vertices_array;
     float *colors_array;
     float *tex_array;
     float *normals_array;
-    vertices_array = (float*) malloc(faces_vertex_index->size() * 3 * sizeof(float)); // vertices counted with multiplicity
-    colors_array = (float*) malloc(faces_vertex_index->size() * 3 * sizeof(float));
-    tex_array = (float*) malloc(faces_tex_index->size() * 2 * sizeof(float));
-    normals_array = (float*) malloc(faces_normal_index->size() * 3 * sizeof(float)); // Only allocating if necessary
-
-    if(vertices_array == 0 || colors_array == 0 || tex_array == 0) {
+    void *indices_array;
+    vertices_array = (float*) malloc(verticesCount * 3 * sizeof(float)); // unique vertices
+    colors_array = (float*) malloc(verticesCount * 3 * sizeof(float));
+    tex_array = (float*) malloc(verticesCount * 2 * sizeof(float));
+    normals_array = (float*) malloc(verticesCount * 3 * sizeof(float));
+    indices_array = malloc(corners * (short_indices ? sizeof(GLushort) : sizeof(GLuint)));
+
+    if(vertices_array == 0 || colors_array == 0 || tex_array == 0 || normals_array == 0 || indices_array == 0) {
         std::cout << "(StaticMeshFromArrays) Error parsing .obj : out of memory" << std::endl;
         return nullptr;
     }
 
-    std::fill_n(colors_array, faces_vertex_index->size() * 3, 1.0); // Colors aren't used for textured materials
+    std::fill_n(colors_array, verticesCount * 3, 1.0); // Colors aren't used for textured materials
 
-    /* Filling arrays with faces order */
-    for(int i = 0;i < faces_vertex_index->size();i++) { // One vertex
-        coordinate3d vertex_coords = vertices->at(faces_vertex_index->at(i));
+    /* Filling arrays with the unique vertices */
+    for(size_t i = 0;i < verticesCount;i++) { // One vertex
+        coordinate3d vertex_coords = vertices->at(faces_vertex_index->at(vertex_first_corner[i]));
 
         vertices_array[3*i]     = get<X_coord>(vertex_coords);
         vertices_array[3*i + 1] = get<Y_coord>(vertex_coords);
         vertices_array[3*i + 2] = get<Z_coord>(vertex_coords);
     }
 
-    for(int i = 0;i < faces_tex_index->size();i++) { // One texture
-        coordinate2d tex_coords = textures->at(faces_tex_index->at(i));
+    for(size_t i = 0;i < verticesCount;i++) { // One texture
+        coordinate2d tex_coords = textures->at(faces_tex_index->at(vertex_first_corner[i]));
 
         tex_array[2*i]      = get<X_coord>(tex_coords); // U
         tex_array[2*i + 1]  = get<Y_coord>(tex_coords); // V
@@ -245,19 +250,21 @@ static StaticMesh *StaticMeshFromArrays(vector<coordinate3d> *vertices, vector<c
 
     /* Computing normals */
     if(vertex_normals_mapper != nullptr) { // Should compute vertex normals
-        map<int, coordinate3d> averaged_normals = generate_average_vertex_normals(normals, vertex_normals_mapper);
-        // averaged_normals[i] is the normal of the i-th vertex
-
-        for(int i = 0;i < faces_normal_index->size();i++) {
-            coordinate3d normal = averaged_normals.at(faces_vertex_index->at(i)); // Getting the averaged normal of the i-th vertex USED at index faces_normal_index->at(i)
-            normals_array[3*i]      = get<X_coord>(normal);
-            normals_array[3*i + 1]  = get<Y_coord>(normal);
-            normals_array[3*i + 2]  = get<Z_coord>(normal);
+        vector<float> averaged_normals;
+        size_t first_vertex;
+        VertexNormals::average(*normals, *vertex_normals_mapper, vertices->size(), averaged_normals, first_vertex, normals_weighting, vertices);
+        // averaged_normals[3*(i - first_vertex) .. + 2] is the normal of the i-th position
+
+        for(size_t i = 0;i < verticesCount;i++) {
+            const float *normal = &averaged_normals[3 * (faces_vertex_index->at(vertex_first_corner[i]) - first_vertex)]; // Averaged normal of the position used by the i-th unique vertex
+            normals_array[3*i]      = normal[X_coord];
+            normals_array[3*i + 1]  = normal[Y_coord];
+            normals_array[3*i + 2]  = normal[Z_coord];
         }
         // Now normals_array contains the averaged normals of each vertex!
     } else {
-        for(int i = 0;i < faces_normal_index->size();i++) {
-            coordinate3d normal_coords = normals->at(faces_normal_index->at(i));
+        for(size_t i = 0;i < verticesCount;i++) {
+            coordinate3d normal_coords = normals->at(faces_normal_index->at(vertex_first_corner[i]));
 
             normals_array[3*i]      = get<X_coord>(normal_coords);
             normals_array[3*i + 1]  = get<Y_coord>(normal_coords);
@@ -265,36 +272,22 @@ static StaticMesh *StaticMeshFromArrays(vector<coordinate3d> *vertices, vector<c
         }
     }
 
+    /* Index buffer */
+    for(size_t i = 0;i < corners;i++) {
+        if(short_indices)   ((GLushort*) indices_array)[i] = (GLushort) corner_to_vertex[i];
+        else                ((GLuint*) indices_array)[i] = corner_to_vertex[i];
+    }
 
-    StaticMesh *mesh = new StaticMesh(faces_vertex_index->size(), vertices_array, colors_array, tex_array, normals_array);
-    return mesh;
-}
-
-/*!
- *  \brief This functions generates the normals of the vertex from one normal per vertex (averaging)
- *  \return A map<int, coordinate3d> of the indexes of the vertex associated with its averaged normal
- */
-static map<int, coordinate3d> generate_average_vertex_normals(vector<coordinate3d> *normals, vector<mapper> *vertex_normals_mapper)
-{
-    map<int, coordinate3d> averaged_normals_vertex_mapper; // at index i : (normal vector) of the vertex i (one entry per vertex)
-
-    for(vector<mapper>::iterator it = vertex_normals_mapper->begin();it != vertex_normals_mapper->end();it++) {
-        mapper _map = (*it);
-        int vertex_index = get<0>(_map);
-        int normal_index = get<1>(_map);
-
-        coordinate3d normal = normals->at(normal_index);
-        coordinate3d &vertex_current_normal = averaged_normals_vertex_mapper[vertex_index]; // reference in order to change the value
+    StaticMesh *mesh = new StaticMesh(verticesCount, vertices_array, colors_array, tex_array, normals_array);
+    mesh->setIndices(indices_array, corners, short_indices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+    mesh->adoptArrays(MESH_ARRAYS_ALL); // Freed with the mesh, the index buffer as soon as optimize() replaces it
 
-        // Adding normal to vertex_current_normal
-        get<X_coord>(vertex_current_normal) += get<X_coord>(normal);
-        get<Y_coord>(vertex_current_normal) += get<Y_coord>(normal);
-        get<Z_coord>(vertex_current_normal) += get<Z_coord>(normal);
+    if(MeshOptimizer::isReporting()) { // --report-acmr
+        cout << "(StaticMeshFromArrays) " << verticesCount << " vertices, " << corners << " indices (" << (short_indices ? 16 : 32) << " bits), dedup ratio "
+             << ((verticesCount > 0) ? (float) corners / verticesCount : 0.0) << endl;
     }
 
-    /* Averaging would require to divide by the number of occurrences, but the vectors will be normalized in the shader anyway */
-
-    return averaged_normals_vertex_mapper;
+    return mesh;
 }
 
 /* ############# MATERIALS ############# */
@@ -425,8 +418,8 @@ static vector<AbstractMaterial*> loadMTL(string filepath, bool load_textures = t
                 string path;
                 stream >> path;
 
-                diffuseTexture = new AbstractTexture(path);
-                if(load_textures)   diffuseTexture->load();
+                if(setDiffTex) TextureCache::release(diffuseTexture); // Overridden before being used
+                diffuseTexture = TextureCache::acquire(path, load_textures);
 
                 setDiffTex = true;
                 break;
@@ -437,8 +430,8 @@ static vector<AbstractMaterial*> loadMTL(string filepath, bool load_textures = t
                 string path;
                 stream >> path;
 
-                specularTexture = new AbstractTexture(path);
-                if(load_textures)   specularTexture->load();
+                if(setSpecTex) TextureCache::release(specularTexture);
+                specularTexture = TextureCache::acquire(path, load_textures);
 
                 setSpecTex = true;
                 break;
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <cstdlib>
 #include "Application.h"
 #include "Shader.h"
 #include "TestCube.h"
@@ -9,6 +10,9 @@
 #include "PointLight.h"
 #include "SpotLight.h"
 #include "SunLight.h"
+#include "MeshOptimizer.h"
+#include "BatchedMesh.h"
+#include "TextureCache.h"
 
 using namespace std;
 
@@ -16,6 +20,24 @@ int main(int argc, char **argv)
 {
     cout << "Hello world!" << endl;
 
+    /* Command line : --report-acmr prints the deduplication and vertex cache stats of every loaded mesh, --no-mesh-optimize loads the meshes as exported,
+       --report-batches prints how many meshes the static batching merged,
+       --shadow-filter pcf|hardware|poisson|esm selects how the spot light shadows are filtered (G cycles them), --poisson-taps n */
+    int shadowFilter = SHADOW_FILTER_PCF, poissonTaps = SHADOW_POISSON_TAPS;
+    for(int i = 1;i < argc;i++) {
+        string arg = argv[i];
+        if(arg == "--report-acmr")           MeshOptimizer::setReport(true);
+        else if(arg == "--no-mesh-optimize") MeshOptimizer::setEnabled(false);
+        else if(arg == "--report-batches")   BatchedMesh::setReport(true);
+        else if(arg == "--shadow-filter" && i + 1 < argc) {
+            string filter = argv[++i];
+            if(filter == "hardware")        shadowFilter = SHADOW_FILTER_HARDWARE;
+            else if(filter == "poisson")    shadowFilter = SHADOW_FILTER_POISSON;
+            else if(filter == "esm")        shadowFilter = SHADOW_FILTER_ESM;
+        }
+        else if(arg == "--poisson-taps" && i + 1 < argc) poissonTaps = atoi(argv[++i]);
+    }
+
     Application *app = new Application("Conrad Engine", 1280, 720);
     if(!app->init()) {
         cout << "Error setting up SDL or context" << endl;
@@ -26,11 +48,16 @@ int main(int argc, char **argv)
 
     Shader shader("shaders/advanced/materials.vert", "shaders/advanced/materials.frag");
     Shader depthShader("shaders/advanced/depth.vert", "shaders/advanced/depth.frag");
+    Shader cubeDepthShader("shaders/advanced/depth_cube.vert", "shaders/advanced/depth_cube.frag", "shaders/advanced/depth_cube.geom");
     Shader guiShader("shaders/advanced/gui.vert", "shaders/advanced/gui.frag");
+    Shader shadowBlurShader("shaders/advanced/shadow_blur.vert", "shaders/advanced/shadow_blur.frag");
 
     app->getRenderer()->setShader(shader); // loads the shader
     app->getRenderer()->setDepthShader(depthShader);
+    app->getRenderer()->setCubeDepthShader(cubeDepthShader);
     app->getRenderer()->setGUIShader(guiShader);
+    app->getRenderer()->setShadowBlurShader(shadowBlurShader);
+    app->getRenderer()->setShadowFilter(shadowFilter, poissonTaps);
 
 
     Uint32 start = SDL_GetTicks();
@@ -38,6 +65,7 @@ int main(int argc, char **argv)
     SceneFormatParser parser("D:/GitHub/ConradGameEngine/Conrad/blender/testfile.scene");
 
     cout << "Loaded in " << SDL_GetTicks() - start << " ms" << endl;
+    TextureCache::report();
 
     vector<StaticMesh *> *meshes = parser.getMeshes();
     for(int i = 0;i < meshes->size();i++) {
@@ -49,7 +77,7 @@ int main(int argc, char **argv)
         app->getRenderer()->addLight(lights->at(i));
     }
 
-    app->getRenderer()->generateShadowMap(lights->at(0));
+    // render() keeps the shadow maps of the added lights up to date
 
     //PointLight *light = new PointLight(glm::vec3(5.0, 0.0, 3.0), glm::vec3(1.0), 1.0, false);
     //app->getRenderer()->addLight(light);
@@ -1,7 +1,10 @@
-#version 150 core
+#version 330 core
 
 // Inputs
 in vec3 in_Vertex;
+#ifdef INSTANCED
+in mat4 in_InstanceModelview; // InstancedMesh
+#endif
 
 // Uniforms
 uniform mat4 world; // (Projection * Light view) matrix
@@ -9,5 +12,9 @@ uniform mat4 modelview;
 
 void main()
 {
+#ifdef INSTANCED
+	gl_Position = world * modelview * in_InstanceModelview * vec4(in_Vertex, 1.0);
+#else
 	gl_Position = world * modelview * vec4(in_Vertex, 1.0);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 330 core
+
+// Inputs
+in vec3 frag_WorldPos;
+
+// Uniforms
+uniform vec3 lightPos;
+uniform float shadowRange; // PointLight::getShadowRange()
+
+void main()
+{
+	gl_FragDepth = length(frag_WorldPos - lightPos) / shadowRange; // Distance to the light, the same whatever the face
+}
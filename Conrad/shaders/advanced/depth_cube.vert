@@ -0,0 +1,22 @@
+#version 330 core
+
+// Inputs
+in vec3 in_Vertex;
+#ifdef INSTANCED
+in mat4 in_InstanceModelview; // InstancedMesh
+#endif
+
+// Uniforms
+uniform mat4 modelview;
+
+// Outputs
+out vec4 geom_WorldPos; // The geometry shader projects it on every face
+
+void main()
+{
+#ifdef INSTANCED
+	geom_WorldPos = modelview * in_InstanceModelview * vec4(in_Vertex, 1.0);
+#else
+	geom_WorldPos = modelview * vec4(in_Vertex, 1.0);
+#endif
+}
@@ -1,4 +1,4 @@
-#version 150 core
+#version 330 core
 
 in vec2 frag_texCoord0;
 uniform sampler2D tex;
@@ -1,5 +1,8 @@
-#version 150 core
-#define MAX_LIGHTS 10 // Must by synced with vertex shader!
+#version 330 core
+#define MAX_LIGHTS 32 // Must by synced with vertex shader!
+#define MAX_CASCADED_LIGHTS 2 // Must be synced with scope.h
+#define SHADOW_CASCADES 4
+#define MAX_CUBE_LIGHTS 2
 #define GAMMA 0.454545
 
 /* Light types */
@@ -9,6 +12,22 @@
 
 #define SHADOW_BIAS_MIN 0.005
 #define SHADOW_BIAS_MAX 0.01
+#define SHADOW_SPOT_NEAR 0.05 // Must be synced with AbstractLight.h
+#define SHADOW_ATLAS_SIZE 4096 // Must be synced with scope.h
+
+/* Shadow filters of the atlas (must be synced with scope.h). The Renderer defines SHADOW_FILTER and SHADOW_POISSON_TAPS */
+#define SHADOW_FILTER_PCF		0
+#define SHADOW_FILTER_HARDWARE	1
+#define SHADOW_FILTER_POISSON	2
+#define SHADOW_FILTER_ESM		3
+#ifndef SHADOW_FILTER
+#define SHADOW_FILTER SHADOW_FILTER_PCF
+#endif
+#ifndef SHADOW_POISSON_TAPS
+#define SHADOW_POISSON_TAPS 8 // At most 16
+#endif
+#define SHADOW_POISSON_RADIUS 2.5 // Texels
+#define SHADOW_ESM_EXPONENT 80.0
 
 // Inputs
 in vec3 frag_VertexColor;
@@ -20,58 +39,86 @@ in vec3 frag_Normal;
 // Uniforms
 uniform sampler2D tex;
 uniform mat4 normalMatrix; // Transformations for the normals (same for every pixels so calculated by the CPU)
-uniform vec3 cameraPos;
 
-/* Mesh-related uniforms (material) */
-uniform float ambientStrength; 
-uniform vec3 ambientColor;
-
-uniform float diffuseStrength;
-uniform vec3 diffuseColor;
-
-uniform float specularStrength;
-uniform vec3 specularColor;
-
-uniform float specularExponent; // [0; 100]
-// uniform vec3 emitColor; // emitting is not supported yet.
+/* Mesh-related uniforms (material, one range of the materials buffer) */
+layout(std140) uniform Material { // Must be synced with MaterialBlock (UniformBlocks.h)
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	float diffuseStrength;
+	vec3 specularColor;
+	float specularStrength;
+	float specularExponent; // [0; 100]
+	// vec3 emitColor; // emitting is not supported yet.
+};
 
 /* Light-related */
-
-uniform int nbrLights;
-uniform struct Light {
-	int type;
+struct Light { // Must be synced with LightBlock (UniformBlocks.h)
+	/* Shadow */
+	mat4 world; // Light space matrix
 
 	vec3 position;
-	vec3 color;
 	float intensity;
-	
+	vec3 color;
 	float linearAttenuation; // linear (a coeff)
-	float quadAttenuation; // quadratic (b coeff)
-
-	float spotExponent;
 
 	/* Directional and cone */
 	vec3 direction;
+	float quadAttenuation; // quadratic (b coeff)
+
+	int type;
+	float spotExponent;
 	float coneAngle;
 
-	/* Shadow */
-	mat4 world; // Light space matrix
 	bool castShadow;
-	sampler2D shadowMapTex;
-} lights[MAX_LIGHTS];
-uniform vec2 shadowMapTexelSize;
-in vec4 fragPos_lightspace[MAX_LIGHTS];
+	int cascades; // Index in the cascades array, -1 : no cascades
+	int cubeMap; // Index in the cube maps array, -1 : no cube map (tile of the shadow atlas if neither)
+	float shadowRange; // The cube maps store the distance to the light divided by it, a spot light map ends there
+	vec4 atlasRect; // Tile of the light in the shadow atlas : offset (xy), scale (zw)
+};
+
+struct Cascades { // Must be synced with CascadesBlock (UniformBlocks.h)
+	mat4 world[SHADOW_CASCADES]; // Light space matrix of each cascade
+	vec4 splits; // View depth where each cascade ends
+};
+
+layout(std140) uniform Frame { // Once per frame (FrameBlock)
+	mat4 projection;
+	mat4 camera;
+	vec3 cameraPos;
+	int nbrLights;
+};
+
+layout(std140) uniform Lights { // Once per frame (LightsBlock)
+	Light lights[MAX_LIGHTS];
+	Cascades cascades[MAX_CASCADED_LIGHTS];
+};
+#if SHADOW_FILTER == SHADOW_FILTER_HARDWARE || SHADOW_FILTER == SHADOW_FILTER_POISSON
+uniform sampler2DShadow shadowAtlas; // Texture unit DEPTHBUFFER_TEXTURE0 (set once by the Renderer) : one tile per light (spot lights)
+#else
+uniform sampler2D shadowAtlas; // Depth, or exp(c * (depth - 1)) blurred for SHADOW_FILTER_ESM
+#endif
+uniform sampler2DArray cascadeMaps[MAX_CASCADED_LIGHTS]; // Texture units DEPTHBUFFER_TEXTURE0 + 1 + i, one layer per cascade
+uniform samplerCube cubeMaps[MAX_CUBE_LIGHTS]; // Texture units DEPTHBUFFER_TEXTURE0 + 1 + MAX_CASCADED_LIGHTS + i (point lights)
 
 
 // Outputs
 out vec4 out_Color;
 
 vec3 computeLight(Light, vec3);
-vec3 computeShadow(Light, vec4, vec3);
+vec3 computeShadow(Light, vec3);
+float linearShadowDepth(float, float);
+float perspectiveShadowDepth(float, float);
+vec3 computeCascadeShadow(Light, Cascades, sampler2DArray, vec3);
+vec3 computeCubeShadow(Light, samplerCube, vec3);
 
 void main()
 {
+#ifdef INSTANCED
+	vec3 transformed_normal = normalize(frag_Normal); // Transformed by the vertex shader
+#else
 	vec3 transformed_normal = normalize(mat3(normalMatrix) * frag_Normal);
+#endif
 
 	/* Lightning */
 	vec3 global_light = vec3(0.0);
@@ -79,12 +126,23 @@ void main()
 
 	/* Light objects (diffuse and specular) */
 	int nbr_lights_castshadow = 0;
-	for(int i = 0; i < nbrLights; i++) {	
+	for(int i = 0; i < MAX_LIGHTS; i++) { // Constant bound, nbrLights ends the loop
+		if(i >= nbrLights) break;
 		global_light += computeLight(lights[i], transformed_normal);
 
 
 		if(lights[i].castShadow) {
-			global_shadow += computeShadow(lights[i], fragPos_lightspace[i], transformed_normal);
+			if(lights[i].cascades >= 0) {
+				for(int j = 0; j < MAX_CASCADED_LIGHTS; j++) { // Same constant bound for the cascade samplers
+					if(j == lights[i].cascades) global_shadow += computeCascadeShadow(lights[i], cascades[j], cascadeMaps[j], transformed_normal);
+				}
+			} else if(lights[i].cubeMap >= 0) {
+				for(int j = 0; j < MAX_CUBE_LIGHTS; j++) {
+					if(j == lights[i].cubeMap) global_shadow += computeCubeShadow(lights[i], cubeMaps[j], transformed_normal);
+				}
+			} else {
+				global_shadow += computeShadow(lights[i], transformed_normal);
+			}
 			nbr_lights_castshadow++;
 		}
 	}
@@ -155,7 +213,7 @@ vec3 computeLight(Light light, vec3 normal)
 	return attenuationFactor * light.intensity * (diffuse + specular) * light.color;
 }
 
-vec3 computeShadow(Light light, vec4 fragpos_light, vec3 normal)
+vec3 computeShadow(Light light, vec3 normal)
 {
 	vec3 lightDirScene = normalize(light.position - frag_FragmentPos); // Object -> Light in the scene pov
 
@@ -169,34 +227,142 @@ vec3 computeShadow(Light light, vec4 fragpos_light, vec3 normal)
 	}*/
 
 	// Perspective divide (in case of perspective matrix used for the shadow map generation)
+	vec4 fragpos_light = light.world * vec4(frag_FragmentPos, 1.0);
 	vec3 projCoords = fragpos_light.xyz / fragpos_light.w; // Now in range [-1; 1]
 
 	// Depth map uses range [0, 1]
 	projCoords = projCoords * 0.5 + 0.5; // Now in range [0, 1]
 	if(projCoords.z > 1.0) return vec3(0.0); // for points light, allows not to cast shadow everywhere
-
-	// Sample the depth from the shadow map
-	float closestDepth = texture(light.shadowMapTex, projCoords.xy).r; // Red or green or blue is whatever (all 3 components are always the same in the shadow map)
+	if(any(lessThan(projCoords.xy, vec2(0.0))) || any(greaterThan(projCoords.xy, vec2(1.0)))) return vec3(0.0); // Out of its tile : lit
 
 	float currentDepth = projCoords.z;
 
 	float bias = max(SHADOW_BIAS_MAX * (1.0 - dot(normal, lightDirScene)), SHADOW_BIAS_MIN);
 	float shadow = 0.0;
 
+	/* The tile of the light in the atlas : its neighbours belong to other lights, the samples are clamped to it */
+	const vec2 texelSize = vec2(1.0 / SHADOW_ATLAS_SIZE);
+	vec2 atlasCoords = light.atlasRect.xy + projCoords.xy * light.atlasRect.zw,
+		 tileMin = light.atlasRect.xy + 0.5 * texelSize,
+		 tileMax = light.atlasRect.xy + light.atlasRect.zw - 0.5 * texelSize;
+
+#if SHADOW_FILTER == SHADOW_FILTER_ESM
+	/* Exponential map : blurred exp(c * (occluder - 1)) on linear depths, the light that reaches the receiver is exp(c * (occluder - receiver)) */
+	float receiver = (light.shadowRange > 0.0) ? linearShadowDepth(currentDepth, light.shadowRange) : currentDepth;
+	float occluder = texture(shadowAtlas, clamp(atlasCoords, tileMin, tileMax)).r;
+	shadow = 1.0 - clamp(occluder * exp(SHADOW_ESM_EXPONENT * (1.0 - receiver + bias)), 0.0, 1.0);
+#else
+	if(light.shadowRange > 0.0) { // Perspective map (spot light) : the depth isn't linear, the bias is applied along the light axis
+		currentDepth = perspectiveShadowDepth(linearShadowDepth(currentDepth, light.shadowRange) - bias, light.shadowRange);
+		bias = 0.0;
+	}
+
+#if SHADOW_FILTER == SHADOW_FILTER_HARDWARE
+	/* 4 comparison fetches, each a bilinear 2x2 PCF : a 4x4 footprint */
+	for(int x = -1; x <= 1; x += 2) {
+		for(int y = -1; y <= 1; y += 2) {
+			shadow += 1.0 - texture(shadowAtlas, vec3(clamp(atlasCoords + vec2(x, y) * texelSize, tileMin, tileMax), currentDepth - bias));
+		}
+	} shadow /= 4;
+#elif SHADOW_FILTER == SHADOW_FILTER_POISSON
+	/* Comparison fetches on a Poisson disk, rotated per pixel : the banding becomes noise */
+	const vec2 poissonDisk[16] = vec2[16](
+		vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725), vec2(-0.094184101, -0.92938870), vec2(0.34495938, 0.29387760),
+		vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464), vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+		vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420), vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+		vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590), vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790));
+
+	float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715)))); // Interleaved gradient noise
+	mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+	for(int i = 0; i < SHADOW_POISSON_TAPS; i++) {
+		vec2 offset = rotation * poissonDisk[i] * SHADOW_POISSON_RADIUS * texelSize;
+		shadow += 1.0 - texture(shadowAtlas, vec3(clamp(atlasCoords + offset, tileMin, tileMax), currentDepth - bias));
+	} shadow /= SHADOW_POISSON_TAPS;
+#else
 	/* NO PCF */
 	/* 
-	float texDepth = texture(light.shadowMapTex, projCoords.xy).r;
+	float texDepth = texture(shadowAtlas, atlasCoords).r;
 	shadow = (currentDepth - bias > texDepth) ? 1.0 : 0.0;
 	*/
 
 	/* PCF Interpolation (+ or - 2 texels averaging) */
-	vec2 texelSize = 1.0 / textureSize(light.shadowMapTex, 0);
 	for(int x = -2; x <= 2; x++) {
 		for(int y = -2; y <= 2; y++) {
-			float pcfDepth = texture(light.shadowMapTex, projCoords.xy + vec2(x, y) * texelSize).r;
+			float pcfDepth = texture(shadowAtlas, clamp(atlasCoords + vec2(x, y) * texelSize, tileMin, tileMax)).r;
 			shadow += (currentDepth - bias > pcfDepth) ? 1.0 : 0.0; // Amount of shadow
 		}
 	} shadow /= 25;
+#endif
+#endif
+
+	return vec3(shadow);
+}
+
+float linearShadowDepth(float depth, float range) // Depth of a perspective map -> distance along the light axis / range (see shadow_blur.frag)
+{
+	return 2.0 * SHADOW_SPOT_NEAR / (range + SHADOW_SPOT_NEAR - (depth * 2.0 - 1.0) * (range - SHADOW_SPOT_NEAR));
+}
+
+float perspectiveShadowDepth(float linearDepth, float range) // Inverse of linearShadowDepth()
+{
+	float n = SHADOW_SPOT_NEAR, f = range;
+	return ((f + n) / (f - n) - 2.0 * n / ((f - n) * linearDepth)) * 0.5 + 0.5;
+}
+
+vec3 computeCascadeShadow(Light light, Cascades lightCascades, sampler2DArray shadowMap, vec3 normal)
+{
+	/* Cascade : the first one that reaches the view depth of the fragment */
+	float viewDepth = -(camera * vec4(frag_FragmentPos, 1.0)).z;
+	if(viewDepth > lightCascades.splits[SHADOW_CASCADES - 1]) return vec3(0.0); // Beyond the last cascade
+
+	int cascade = SHADOW_CASCADES - 1;
+	for(int c = SHADOW_CASCADES - 2; c >= 0; c--) {
+		if(viewDepth <= lightCascades.splits[c]) cascade = c;
+	}
+
+	// Orthographic projection : no perspective divide
+	vec3 projCoords = (lightCascades.world[cascade] * vec4(frag_FragmentPos, 1.0)).xyz * 0.5 + 0.5; // Now in range [0, 1]
+	if(projCoords.z > 1.0) return vec3(0.0);
+
+	float currentDepth = projCoords.z;
+
+	vec3 lightDirScene = -normalize(light.direction); // Object -> Light
+	float bias = max(SHADOW_BIAS_MAX * (1.0 - dot(normal, lightDirScene)), SHADOW_BIAS_MIN);
+	float shadow = 0.0;
+
+	/* PCF Interpolation (+ or - 2 texels averaging), in the layer of the cascade */
+	vec2 texelSize = 1.0 / textureSize(shadowMap, 0).xy;
+	for(int x = -2; x <= 2; x++) {
+		for(int y = -2; y <= 2; y++) {
+			float pcfDepth = texture(shadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, cascade)).r;
+			shadow += (currentDepth - bias > pcfDepth) ? 1.0 : 0.0; // Amount of shadow
+		}
+	} shadow /= 25;
+
+	return vec3(shadow);
+}
+
+vec3 computeCubeShadow(Light light, samplerCube shadowMap, vec3 normal)
+{
+	/* The map holds the distance to the light, along the direction Light -> Object */
+	vec3 lightToFrag = frag_FragmentPos - light.position;
+	float currentDepth = length(lightToFrag) / light.shadowRange;
+	if(currentDepth > 1.0) return vec3(0.0); // Out of the range of the light
+
+	vec3 lightDirScene = -normalize(lightToFrag); // Object -> Light
+	float bias = max(SHADOW_BIAS_MAX * (1.0 - dot(normal, lightDirScene)), SHADOW_BIAS_MIN);
+	float shadow = 0.0;
+
+	/* PCF Interpolation (+ or - 1 texel averaging, in the three directions) */
+	float texelSize = 2.0 * length(lightToFrag) / textureSize(shadowMap, 0).x; // A face spans 90 degrees
+	for(int x = -1; x <= 1; x++) {
+		for(int y = -1; y <= 1; y++) {
+			for(int z = -1; z <= 1; z++) {
+				float pcfDepth = texture(shadowMap, lightToFrag + vec3(x, y, z) * texelSize).r;
+				shadow += (currentDepth - bias > pcfDepth) ? 1.0 : 0.0; // Amount of shadow
+			}
+		}
+	} shadow /= 27;
 
 	return vec3(shadow);
 }
@@ -1,40 +1,71 @@
-#version 150 core
-#define MAX_LIGHTS 10 // Must be synced with fragment shader!
+#version 330 core
+#define MAX_LIGHTS 32 // Must be synced with fragment shader!
+#define MAX_CASCADED_LIGHTS 2 // Must be synced with scope.h
+#define SHADOW_CASCADES 4
+#define MAX_CUBE_LIGHTS 2
 
 // Inputs
 in vec3 in_Vertex;
 in vec3 in_VertexColor;
 in vec2 in_TexCoord0;
+#ifdef OCTAHEDRAL_NORMALS // VertexLayout::NORMALS_OCTAHEDRAL
+in vec2 in_VertexNormal;
+#else
 in vec3 in_VertexNormal;
+#endif
 
-// Uniforms
-uniform mat4 projection;
-uniform mat4 camera;
+#ifdef INSTANCED // InstancedMesh : one per instance
+in mat4 in_InstanceModelview;
+in mat3 in_InstanceNormalMatrix;
+#endif
 
-uniform struct Light {
-	int type;
+// Uniforms
+struct Light { // Must be synced with LightBlock (UniformBlocks.h)
+	/* Shadow */
+	mat4 world; // Light space matrix
 
 	vec3 position;
-	vec3 color;
 	float intensity;
-	
+	vec3 color;
 	float linearAttenuation; // linear (a coeff)
-	float quadAttenuation; // quadratic (b coeff)
-
-	float spotExponent;
 
 	/* Directional and cone */
 	vec3 direction;
+	float quadAttenuation; // quadratic (b coeff)
+
+	int type;
+	float spotExponent;
 	float coneAngle;
 
-	/* Shadow */
-	mat4 world; // Light space matrix
 	bool castShadow;
-	sampler2D shadowMapTex;
-} lights[MAX_LIGHTS];
+	int cascades; // Index in the cascades array, -1 : no cascades
+	int cubeMap; // Index in the cube maps array, -1 : no cube map (tile of the shadow atlas if neither)
+	float shadowRange; // The cube maps store the distance to the light divided by it, a spot light map ends there
+	vec4 atlasRect; // Tile of the light in the shadow atlas : offset (xy), scale (zw)
+};
+
+struct Cascades { // Must be synced with CascadesBlock (UniformBlocks.h)
+	mat4 world[SHADOW_CASCADES]; // Light space matrix of each cascade
+	vec4 splits; // View depth where each cascade ends
+};
+
+layout(std140) uniform Frame { // Once per frame (FrameBlock)
+	mat4 projection;
+	mat4 camera;
+	vec3 cameraPos;
+	int nbrLights;
+};
+
+layout(std140) uniform Lights { // Once per frame (LightsBlock)
+	Light lights[MAX_LIGHTS];
+	Cascades cascades[MAX_CASCADED_LIGHTS];
+};
 
 // Mesh-specific uniforms
 uniform mat4 modelview;
+#ifdef INSTANCED
+uniform mat4 normalMatrix; // The normals are transformed here, the instance matrix being an attribute
+#endif
 
 
 // Outputs
@@ -42,21 +73,36 @@ out vec3 frag_VertexColor;
 out vec2 frag_TexCoord0;
 out vec3 frag_FragmentPos; // Position of the fragment
 out vec3 frag_Normal;
-out vec4 fragPos_lightspace[MAX_LIGHTS];
+
+#ifdef OCTAHEDRAL_NORMALS
+vec3 decodeNormal(vec2 encoded) // Must be synced with VertexLayout::decodeOctahedral()
+{
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = max(-normal.z, 0.0);
+	normal.xy += mix(vec2(t), vec2(-t), greaterThanEqual(normal.xy, vec2(0.0)));
+	return normalize(normal);
+}
+#else
+vec3 decodeNormal(vec3 normal)
+{
+	return normal;
+}
+#endif
 
 void main()
 {
-	mat3 modelview3 = mat3(modelview);
+#ifdef INSTANCED
+	mat4 model = modelview * in_InstanceModelview;
+	frag_Normal = mat3(normalMatrix) * in_InstanceNormalMatrix * decodeNormal(in_VertexNormal);
+#else
+	mat4 model = modelview;
+	frag_Normal = decodeNormal(in_VertexNormal);
+#endif
 
 	// To fragment
 	frag_VertexColor = in_VertexColor;
 	frag_TexCoord0 = in_TexCoord0;
-	frag_FragmentPos = vec3(modelview * vec4(in_Vertex, 1.0));
-	frag_Normal = in_VertexNormal;
-
-	for(int i = 0;i < MAX_LIGHTS;i++) {
-		fragPos_lightspace[i] = lights[i].world * vec4(frag_FragmentPos, 1.0);
-	}
+	frag_FragmentPos = vec3(model * vec4(in_Vertex, 1.0)); // The light space positions are computed per fragment : MAX_LIGHTS varyings wouldn't fit
 
-	gl_Position = projection * camera * modelview * vec4(in_Vertex, 1.0);
+	gl_Position = projection * camera * vec4(frag_FragmentPos, 1.0);
 }
\ No newline at end of file
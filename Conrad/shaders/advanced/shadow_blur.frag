@@ -0,0 +1,47 @@
+#version 330 core
+#define SHADOW_ESM_EXPONENT 80.0 // Must be synced with scope.h
+#define SHADOW_SPOT_NEAR 0.05 // Must be synced with AbstractLight.h
+
+// Inputs
+in vec2 frag_TexCoord0;
+
+// Uniforms
+uniform sampler2D source;
+uniform vec4 sourceRect; // Region of the source read over the viewport : offset (xy), scale (zw)
+uniform vec2 texelStep; // One texel of the source along the blur direction
+uniform bool exponential; // First pass : the source is a depth map, converted to exp(c * (d - 1))
+uniform float shadowRange; // Far plane of a perspective depth map, 0 if its depth is already linear
+
+// Outputs
+out vec4 out_Color; // R32F : red only
+
+float linearShadowDepth(float depth, float range) // Must be synced with materials.frag
+{
+	return 2.0 * SHADOW_SPOT_NEAR / (range + SHADOW_SPOT_NEAR - (depth * 2.0 - 1.0) * (range - SHADOW_SPOT_NEAR));
+}
+
+float fetch(vec2 coords)
+{
+	/* Clamped to the region : the neighbouring tiles belong to other lights */
+	vec2 halfTexel = 0.5 / textureSize(source, 0);
+	float value = texture(source, clamp(coords, sourceRect.xy + halfTexel, sourceRect.xy + sourceRect.zw - halfTexel)).r;
+
+	if(exponential) {
+		if(shadowRange > 0.0) value = linearShadowDepth(value, shadowRange);
+		value = exp(SHADOW_ESM_EXPONENT * (value - 1.0)); // In ]0; 1] : the blur can't overflow
+	}
+
+	return value;
+}
+
+void main()
+{
+	vec2 coords = sourceRect.xy + frag_TexCoord0 * sourceRect.zw;
+
+	/* 5 taps binomial kernel (1 4 6 4 1) / 16 */
+	float value = (fetch(coords - 2.0 * texelStep) + fetch(coords + 2.0 * texelStep)) * 0.0625
+				+ (fetch(coords - texelStep) + fetch(coords + texelStep)) * 0.25
+				+ fetch(coords) * 0.375;
+
+	out_Color = vec4(value, 0.0, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 330 core
+
+// Full screen triangle, made from the vertex index (no vertex buffer) : covers the viewport, which is the tile being written
+
+out vec2 frag_TexCoord0; // [0; 1] over the viewport
+
+void main()
+{
+	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2); // (0, 0), (2, 0), (0, 2)
+	frag_TexCoord0 = corner;
+	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
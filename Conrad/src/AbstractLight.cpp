@@ -1,5 +1,7 @@
 #include "AbstractLight.h"
 
+#include <cstring>
+
 using namespace glm;
 using namespace std;
 
@@ -14,31 +16,49 @@ AbstractLight::AbstractLight(vec3 position, vec3 color, vec3 direction, float in
     m_lookAt = lookAt(m_position, m_position + m_direction, vec3(UP_VECTOR));
 }
 
-void AbstractLight::sendShadowUniforms(const Shader &shader, size_t index)
+/// \brief Writes the members shared by every light type into its element of the Lights uniform block.
+void AbstractLight::fillUniformBlock(LightBlock &block)
 {
-    //TODO : Save the uniform locations once for shadows, don't retrieve it each frame...
-    shader.sendMatrix(shader.getUniformLocation(uniform_str(index, "world")), m_world);
+    memcpy(block.world, value_ptr(m_world), sizeof(block.world));
+    memcpy(block.position, value_ptr(m_position), sizeof(block.position));
+    memcpy(block.direction, value_ptr(m_direction), sizeof(block.direction));
+
+    block.color[0] = m_color.r;
+    block.color[1] = m_color.g;
+    block.color[2] = m_color.b;
+
+    block.intensity = m_intensity;
+    block.linearAttenuation = m_linearAttenuation;
+    block.quadAttenuation = m_quadraticAttenuation;
+
+    block.spotExponent = 0.0;
+    block.coneAngle = 0.0;
+    block.castShadow = m_castShadow;
+    block.cascades = -1; // Set by the Renderer for the cascaded and omnidirectional lights
+    block.cubeMap = -1;
+    block.shadowRange = 0.0;
+    memset(block.atlasRect, 0, sizeof(block.atlasRect)); // Set by the Renderer for the lights of the shadow atlas
+}
 
-    /* Shadow map */
-    shader.sendInt(shader.getUniformLocation(uniform_str(index, "castShadow")), m_castShadow);
-    if(m_castShadow) {
-        shader.sendInt(shader.getUniformLocation(uniform_str(index, "shadowMapTex")), index + 10); // > 10 are for lights exclusively
-        m_depthBuffer.bindTexture(index);
-    }
+bool AbstractLight::isCascaded()
+{
+    return false;
 }
 
-const char *AbstractLight::uniform_str(size_t index, const char* property)
+bool AbstractLight::isOmnidirectional()
 {
-    ostringstream ss;
-    ss << LIGHTS_ARRAY_SHADER << "[" << index << "]." << property << '\0';
+    return false;
+}
 
-    /* ss gets deleted after this function, and so does the ss.str().c_str() pointer */
-    /* We thus need to copy the result in a memory bloc that won't get deleted by the function termination (using malloc) */
-    char *out = (char*) malloc(ss.str().size());
-    out = strncpy(out, ss.str().c_str(), ss.str().size());
-    return out;
+mat4 AbstractLight::getShadowProjection()
+{
+    float extent = SHADOW_ORTHO_EXTENT;
+    return ortho(-extent, extent, -extent, extent, 0.0f, extent);
+}
 
-    // sprintf is slower.
+float AbstractLight::getShadowRange()
+{
+    return SHADOW_ORTHO_EXTENT;
 }
 
 /* Setters */
@@ -72,17 +92,19 @@ mat4 AbstractLight::get_lookat()
 void AbstractLight::setPosition(vec3 position)
 {
     m_position = position;
+    m_revision++;
 
     // Updating the light view matrix
-    m_lookAt = m_lookAt = lookAt(m_position, m_position + m_direction, vec3(UP_VECTOR));
+    m_lookAt = lookAt(m_position, m_position + m_direction, vec3(UP_VECTOR));
 }
 
 void AbstractLight::setDirection(vec3 direction)
 {
     m_direction = direction;
+    m_revision++;
 
     // Updating the light view matrix
-    m_lookAt = m_lookAt = lookAt(m_position, m_position + m_direction, vec3(UP_VECTOR));
+    m_lookAt = lookAt(m_position, m_position + m_direction, vec3(UP_VECTOR));
 }
 
 mat4 &AbstractLight::get_world()
@@ -95,6 +117,11 @@ bool AbstractLight::castsShadow()
     return m_castShadow;
 }
 
+unsigned int AbstractLight::getRevision()
+{
+    return m_revision;
+}
+
 AbstractLight::~AbstractLight()
 {
     //dtor
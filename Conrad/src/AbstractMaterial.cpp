@@ -1,4 +1,7 @@
 #include "AbstractMaterial.h"
+#include "TextureCache.h"
+
+unsigned int AbstractMaterial::s_nextID = 0;
 
 AbstractMaterial::AbstractMaterial()
 {
@@ -13,6 +16,38 @@ AbstractMaterial::AbstractMaterial(RGB ambientColor, RGB diffuseColor, RGB specu
 
 /* #### GETTERS #### */
 
+/// \brief Writes the lighting values into a Material uniform block.
+void AbstractMaterial::fillUniformBlock(MaterialBlock &block)
+{
+    block.ambientColor[0] = m_ambientColor.r;
+    block.ambientColor[1] = m_ambientColor.g;
+    block.ambientColor[2] = m_ambientColor.b;
+
+    block.diffuseColor[0] = m_diffuseColor.r;
+    block.diffuseColor[1] = m_diffuseColor.g;
+    block.diffuseColor[2] = m_diffuseColor.b;
+
+    block.specularColor[0] = m_specularColor.r;
+    block.specularColor[1] = m_specularColor.g;
+    block.specularColor[2] = m_specularColor.b;
+
+    block.ambientStrength = m_ambientStrength;
+    block.diffuseStrength = m_diffuseStrength;
+    block.specularStrength = m_specularStrength;
+    block.specularExponent = m_specularExponent;
+    block.padding[0] = block.padding[1] = block.padding[2] = 0.0;
+}
+
+unsigned int AbstractMaterial::getRevision()
+{
+    return m_revision;
+}
+
+unsigned int AbstractMaterial::getID()
+{
+    return m_id;
+}
+
 RGB AbstractMaterial::getAmbientColor()
 {
     return m_ambientColor;
@@ -92,6 +127,7 @@ bool AbstractMaterial::isSpecularTextured()
 void AbstractMaterial::setAmbientColor(RGB color)
 {
     m_ambientColor = color;
+    m_revision++;
 }
 
 void AbstractMaterial::setAmbientColor(float r, float g, float b)
@@ -102,6 +138,7 @@ void AbstractMaterial::setAmbientColor(float r, float g, float b)
 void AbstractMaterial::setDiffuseColor(RGB color)
 {
     m_diffuseColor = color;
+    m_revision++;
 }
 
 void AbstractMaterial::setDiffuseColor(float r, float g, float b)
@@ -112,6 +149,7 @@ void AbstractMaterial::setDiffuseColor(float r, float g, float b)
 void AbstractMaterial::setSpecularColor(RGB color)
 {
     m_specularColor = color;
+    m_revision++;
 }
 
 void AbstractMaterial::setSpecularColor(float r, float g, float b)
@@ -122,6 +160,7 @@ void AbstractMaterial::setSpecularColor(float r, float g, float b)
 void AbstractMaterial::setEmitColor(RGB color)
 {
     m_emitColor = color;
+    m_revision++;
 }
 
 void AbstractMaterial::setEmitColor(float r, float g, float b)
@@ -132,46 +171,56 @@ void AbstractMaterial::setEmitColor(float r, float g, float b)
 void AbstractMaterial::setAmbientStrength(float strength)
 {
     m_ambientStrength = strength;
+    m_revision++;
 }
 
 void AbstractMaterial::setDiffuseStrength(float strength)
 {
     m_diffuseStrength = strength;
+    m_revision++;
 }
 
 void AbstractMaterial::setSpecularStrength(float strength)
 {
     m_specularStrength = strength;
+    m_revision++;
 }
 
 void AbstractMaterial::setEmitStrength(float strength)
 {
     m_emitStrength = strength;
+    m_revision++;
 }
 
 void AbstractMaterial::setSpecularExponent(float exponent)
 {
     m_specularExponent = exponent;
+    m_revision++;
 }
 
 void AbstractMaterial::setAlpha(float alpha)
 {
     m_alpha = alpha;
+    m_revision++;
 }
 
+/// \brief The material takes over the caller TextureCache reference on texture, and gives back the one of the former texture.
 void AbstractMaterial::setDiffuseTexture(AbstractTexture *texture)
 {
+    if(m_diffuseTexture != texture) TextureCache::release(m_diffuseTexture);
     m_diffuseTexture = texture;
     m_diffuseTextured = true;
 }
 
 void AbstractMaterial::setSpecularTexture(AbstractTexture *texture)
 {
+    if(m_specularTexture != texture) TextureCache::release(m_specularTexture);
     m_specularTexture = texture;
     m_specularTextured = true;
 }
 
 AbstractMaterial::~AbstractMaterial()
 {
-    //dtor
+    TextureCache::release(m_diffuseTexture);
+    TextureCache::release(m_specularTexture);
 }
@@ -1,4 +1,10 @@
 #include "AbstractMesh.h"
+#include "TextureCache.h"
+
+#include <cmath>
+#include <cstdlib>
+
+VertexLayout AbstractMesh::s_defaultVertexLayout = VertexLayout::compact();
 
 AbstractMesh::AbstractMesh(int verticesCount, int colorsCount, int texCount, GLenum meshType) :
     m_verticesCount(verticesCount), m_colorsCount(colorsCount), m_texCount(texCount), m_meshType(meshType)
@@ -25,9 +31,9 @@ void AbstractMesh::setBlankTex()
     /*m_texCoords = new float[m_texCount * 2];
     std::fill_n(m_texCoords, m_texCount * 2, 0.0); // Filling the texCoords with zeros (whatever if the texture is not used)*/
 
-    AbstractTexture *tex_blank = new AbstractTexture(BLANKONE_PATH); // Using a one pixel 100% alpha texture (so that the texture can't be seen)
+    AbstractTexture *tex_blank = TextureCache::acquire(BLANKONE_PATH); // Using a one pixel 100% alpha texture (so that the texture can't be seen). Shared by every untextured mesh.
     m_material->setDiffuseTexture(tex_blank);
-    if(!m_material->getDiffuseTexture()->load()) {
+    if(!m_material->getDiffuseTexture()->isLoaded()) {
         std::cout << "Error while loading a non-textured mesh. App may crash." << std::endl;
     }
 }
@@ -38,7 +44,9 @@ bool AbstractMesh::setVertices(float *vertices, int length)
         return false;
     }
 
+    if(vertices != m_vertices) freeArrays(MESH_ARRAY_VERTICES);
     m_vertices = vertices;
+    m_boundsSet = false; // The former bounds were the ones of the former vertices : load() computes the new ones
     return true;
 
     //TODO : AbstractMesh::setVertices() : Update VBO
@@ -50,6 +58,7 @@ bool AbstractMesh::setColors(float *colors, int length)
         return false;
     }
 
+    if(colors != m_colors) freeArrays(MESH_ARRAY_COLORS);
     m_colors = colors;
     return true;
 }
@@ -60,6 +69,7 @@ bool AbstractMesh::setTexCoords(float *texCoords, int length)
         return false;
     }
 
+    if(texCoords != m_texCoords) freeArrays(MESH_ARRAY_TEXCOORDS);
     m_texCoords = texCoords;
     return true;
 }
@@ -70,6 +80,7 @@ bool AbstractMesh::setVertexNormals(float *vertexNormals, int length)
         return false;
     }
 
+    if(vertexNormals != m_vertexNormals) freeArrays(MESH_ARRAY_NORMALS);
     m_vertexNormals = vertexNormals;
     return true;
 }
@@ -80,7 +91,147 @@ bool AbstractMesh::setMaterial(AbstractMaterial *material)
     return true; // Always succeeds
 }
 
-/// \brief Uploads the mesh data to the GPU, getting the mesh ready to be drawn (setting up VBO and VAO for the mesh).
+/*!
+ *  \brief Makes the mesh indexed : the vertex arrays then hold unique vertices and indices lists the triangles corners.
+ *  \param count Number of indices (3 per triangle)
+ *  \param indexType GL_UNSIGNED_SHORT (up to 65536 vertices) or GL_UNSIGNED_INT
+ */
+bool AbstractMesh::setIndices(void *indices, int count, GLenum indexType)
+{
+    if(m_loaded || (indexType != GL_UNSIGNED_SHORT && indexType != GL_UNSIGNED_INT)) {
+        return false;
+    }
+
+    if(indices != m_indices) freeArrays(MESH_ARRAY_INDICES);
+
+    m_indices = indices;
+    m_indicesCount = count;
+    m_indexType = indexType;
+    return true;
+}
+
+/*!
+ *  \brief Hands the current arrays (MESH_ARRAY_*) over to the mesh : they must have been allocated with malloc(). The mesh frees them when
+ *  they are replaced (set*(), optimize()) and when it is deleted.
+ */
+void AbstractMesh::adoptArrays(unsigned int arrays)
+{
+    m_ownedArrays |= arrays & MESH_ARRAYS_ALL;
+}
+
+/// \brief The mesh stops owning arrays (MESH_ARRAY_*) : the caller frees the ones returned, or adopts them into another mesh.
+unsigned int AbstractMesh::disownArrays(unsigned int arrays)
+{
+    arrays &= m_ownedArrays;
+    m_ownedArrays &= ~arrays;
+    return arrays;
+}
+
+/// \brief Keeps storage alive as long as the mesh (or until the next call) : the arrays it doesn't own may point into it.
+void AbstractMesh::setArraysStorage(std::shared_ptr<const void> storage)
+{
+    m_arraysStorage = storage;
+}
+
+/*!
+ *  \brief Optimizes the mesh for the post-transform vertex cache, overdraw and vertex fetch (see MeshOptimizer).
+ *  A non-indexed mesh is welded into an indexed one first. The vertex arrays are reordered in place and the index buffer is replaced.
+ *  \return The ACMR/ATVR before and after. stats.optimized is false if the mesh was left untouched.
+ */
+MeshOptimizer::Stats AbstractMesh::optimize()
+{
+    MeshOptimizer::Stats stats;
+
+    if(m_loaded || m_vertices == nullptr || m_verticesCount < 3) {
+        return stats;
+    }
+
+    /* Every attribute array must hold one value per vertex */
+    if((m_colors != nullptr && m_colorsCount != m_verticesCount) || (m_texCoords != nullptr && m_texCount != m_verticesCount)) {
+        return stats;
+    }
+
+    std::vector<MeshOptimizer::VertexStream> streams;
+    streams.push_back({m_vertices, 3}); // Positions first
+    if(m_colors != nullptr)         streams.push_back({m_colors, 3});
+    if(m_texCoords != nullptr)      streams.push_back({m_texCoords, 2});
+    if(m_vertexNormals != nullptr)  streams.push_back({m_vertexNormals, 3});
+
+    std::vector<unsigned int> indices;
+    size_t vertexCount = m_verticesCount;
+
+    if(m_indicesCount > 0) {
+        indices.resize(m_indicesCount);
+        for(int i = 0;i < m_indicesCount;i++) {
+            indices[i] = (m_indexType == GL_UNSIGNED_SHORT) ? ((GLushort *) m_indices)[i] : ((GLuint *) m_indices)[i];
+        }
+    } else {
+        vertexCount = MeshOptimizer::weld(streams, vertexCount, indices);
+    }
+
+    stats = MeshOptimizer::optimize(indices, vertexCount, streams);
+    if(!stats.optimized) {
+        if(m_indicesCount == 0) { // The welded copies are left unused
+            for(size_t s = 0;s < streams.size();s++) free(streams[s].data);
+        }
+        return stats;
+    }
+
+    /* The streams have been reallocated by the weld : they replace the arrays (freed if the mesh owned them) */
+    if(m_indicesCount == 0) {
+        freeArrays(MESH_ARRAY_VERTICES | MESH_ARRAY_COLORS | MESH_ARRAY_TEXCOORDS | MESH_ARRAY_NORMALS);
+
+        size_t s = 1;
+        m_vertices = streams[0].data;
+        m_ownedArrays |= MESH_ARRAY_VERTICES;
+        if(m_colors != nullptr)         { m_colors = streams[s++].data;         m_ownedArrays |= MESH_ARRAY_COLORS; }
+        if(m_texCoords != nullptr)      { m_texCoords = streams[s++].data;      m_ownedArrays |= MESH_ARRAY_TEXCOORDS; }
+        if(m_vertexNormals != nullptr)  { m_vertexNormals = streams[s++].data;  m_ownedArrays |= MESH_ARRAY_NORMALS; }
+    }
+
+    if(m_colorsCount == m_verticesCount)    m_colorsCount = vertexCount;
+    if(m_texCount == m_verticesCount)       m_texCount = vertexCount;
+    m_verticesCount = vertexCount;
+
+    /* New index buffer, 16 bits when possible */
+    if(vertexCount <= 65536) {
+        GLushort *shortIndices = (GLushort *) malloc(indices.size() * sizeof(GLushort));
+        for(size_t i = 0;i < indices.size();i++) shortIndices[i] = indices[i];
+        setIndices(shortIndices, indices.size(), GL_UNSIGNED_SHORT);
+    } else {
+        GLuint *intIndices = (GLuint *) malloc(indices.size() * sizeof(GLuint));
+        std::copy(indices.begin(), indices.end(), intIndices);
+        setIndices(intIndices, indices.size(), GL_UNSIGNED_INT);
+    }
+    m_ownedArrays |= MESH_ARRAY_INDICES; // The former index buffer was freed by setIndices() if the mesh owned it
+
+
+    return stats;
+}
+
+/// \brief Leaves the GeometryPool to the meshes of getMeshType() GL_STATIC_DRAW. Before loading only.
+void AbstractMesh::setSharedBuffersEnabled(bool enabled)
+{
+    if(!m_loaded) m_sharedBuffersEnabled = enabled;
+}
+
+/// \brief The layout of the vertices on the GPU. Before loading only.
+void AbstractMesh::setVertexLayout(const VertexLayout &layout)
+{
+    if(!m_loaded) m_vertexLayout = layout;
+}
+
+/// \brief Layout of the meshes created from now on (VertexLayout::compact() by default).
+void AbstractMesh::setDefaultVertexLayout(const VertexLayout &layout)
+{
+    s_defaultVertexLayout = layout;
+}
+
+/*!
+ *  \brief Uploads the mesh data to the GPU, getting the mesh ready to be drawn : into the shared buffers of the GeometryPool for a static
+ *  mesh, setting up its own VBO and VAO otherwise (or if the pool can't take it).
+ *  The vertices are interleaved with the layout of the mesh. Colors that are all white aren't stored : the shaders read the constant white.
+ */
 void AbstractMesh::load()
 {
     /* If no texture has been specified until here, we load a single pixel of alpha set to 1.0 with no color, in order to use the texture system but without any effect on the render */
@@ -89,10 +240,42 @@ void AbstractMesh::load()
         setBlankTex();
     }
 
-    m_verticesSize = 3 * m_verticesCount * sizeof(float);
-    m_colorsSize = 3 * m_colorsCount * sizeof(float);
-    m_texSize = 2 * m_texCount * sizeof(float);
-    m_vertexNormalsSize = m_verticesSize; // Easier for code maintenance
+    if(m_vertices == nullptr || m_verticesCount <= 0) {
+        std::cout << "(AbstractMesh) No vertices to load" << std::endl;
+        return;
+    }
+
+    if(!m_boundsSet) {
+        computeBounds();
+    }
+
+    /* Interleaved vertices (an array that doesn't have one value per vertex is left out) */
+    const float *colors = (m_colorsCount == m_verticesCount) ? m_colors : nullptr,
+                *texCoords = (m_texCount == m_verticesCount) ? m_texCoords : nullptr;
+
+    m_uploadedLayout = m_vertexLayout;
+    if(colors == nullptr || std::all_of(colors, colors + 3 * m_verticesCount, [](float channel) { return channel == 1.0f; })) {
+        m_uploadedLayout.setColors(VertexLayout::COLORS_NONE);
+    }
+
+    std::vector<char> vertices(m_verticesCount * m_uploadedLayout.getStride());
+    float decodeOffset[3], decodeScale[3];
+    m_uploadedLayout.encode(m_verticesCount, m_vertices, colors, texCoords, m_vertexNormals, vertices.data(), decodeOffset, decodeScale);
+    m_positionDecode = glm::translate(glm::make_vec3(decodeOffset)) * glm::scale(glm::make_vec3(decodeScale));
+
+    GeometryPool::free(m_sharedRange); // A former load
+
+    if(m_sharedBuffersEnabled && m_meshType == GL_STATIC_DRAW && loadShared(vertices.data())) {
+        /* Buffers of a former load */
+        glDeleteBuffers(1, &m_vboID);
+        glDeleteBuffers(1, &m_eboID);
+        GLState::forgetVertexArray(m_vaoID);
+        glDeleteVertexArrays(1, &m_vaoID);
+        m_vboID = m_vaoID = m_eboID = 0;
+
+        m_loaded = true;
+        return;
+    }
 
     /* ##### VBO ##### */
 
@@ -106,19 +289,14 @@ void AbstractMesh::load()
 
         /* Uploading datas */
         glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
-            glBufferData(GL_ARRAY_BUFFER, m_verticesSize + m_colorsSize + m_texSize + m_vertexNormalsSize, 0, m_meshType);
-
-            glBufferSubData(GL_ARRAY_BUFFER, 0, m_verticesSize, m_vertices);                                                    // VERTICES
-            glBufferSubData(GL_ARRAY_BUFFER, m_verticesSize, m_colorsSize, m_colors);                                           // COLORS
-            glBufferSubData(GL_ARRAY_BUFFER, m_verticesSize + m_colorsSize, m_texSize, m_texCoords);                            // TEXTURE COORDS
-            glBufferSubData(GL_ARRAY_BUFFER, m_verticesSize + m_colorsSize + m_texSize, m_vertexNormalsSize, m_vertexNormals);  // NORMAL OF EACH VERTEX (for light calculations)
-
+            glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), m_meshType);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     /* ##### VAO ##### */
 
         /* Deleting a potential former VAO with same ID */
         if(glIsVertexArray(m_vaoID) == GL_TRUE) {
+            GLState::forgetVertexArray(m_vaoID);
             glDeleteVertexArrays(1, &m_vaoID);
         }
 
@@ -126,55 +304,365 @@ void AbstractMesh::load()
         glGenVertexArrays(1, &m_vaoID);
 
         /* Setting up VAO */
-       glBindVertexArray(m_vaoID);
+       GLState::bindVertexArray(m_vaoID);
 
-        /* Binding VBO with the VAO */
+        /* Binding VBO with the VAO : VERTEX_BUFFER = 0 is the first accessed attribute in the shader, then COLOR_BUFFER, etc... */
             glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
-                glVertexAttribPointer(VERTEX_BUFFER, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));                                                   // VERTICES
-                glEnableVertexAttribArray(VERTEX_BUFFER); // Binding vertices (stored in the VBO) with the VAO. VERTEX_BUFFER = 0 : first accessed vec3 are vertices in the shader.
+                GeometryPool::setAttributePointers(m_uploadedLayout);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-                glVertexAttribPointer(COLOR_BUFFER, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(m_verticesSize));                                       // COLORS
-                glEnableVertexAttribArray(COLOR_BUFFER); // Second accessed is COLOR_BUFFER in the shader, etc...
+        /* ##### EBO (indexed meshes) ##### */
+            glDeleteBuffers(1, &m_eboID); // A former load (the indices may have been replaced by optimize() since). 0 is ignored
+            m_eboID = 0;
 
-                glVertexAttribPointer(TEX_BUFFER, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(m_verticesSize + m_colorsSize));                          // TEXTURE COORDS
-                glEnableVertexAttribArray(TEX_BUFFER);
+            if(m_indicesCount > 0) {
+                glGenBuffers(1, &m_eboID);
 
-                glVertexAttribPointer(VERTEX_NORMAL_BUFFER, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(m_verticesSize + m_colorsSize + m_texSize));    // NORMAL OF EACH VERTEX
-                glEnableVertexAttribArray(VERTEX_NORMAL_BUFFER);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
+                // The element buffer binding is part of the VAO state : it must stay bound until the VAO is unbound
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_eboID);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indicesCount * ((m_indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint)), m_indices, m_meshType);
+            }
 
-        glBindVertexArray(0);
+        GLState::bindVertexArray(0);
 
         m_loaded = true;
 }
 
+bool AbstractMesh::loadShared(const void *vertices)
+{
+    if(!GeometryPool::allocate(m_uploadedLayout, m_verticesCount, (m_indicesCount > 0) ? m_indicesCount : m_verticesCount, m_sharedRange)) {
+        return false;
+    }
+
+    GeometryPool::uploadVertices(m_sharedRange, vertices);
+    GeometryPool::uploadIndices(m_sharedRange, (m_indicesCount > 0) ? m_indices : nullptr, m_indexType); // A non-indexed mesh gets 0, 1, 2...
+
+    return true;
+}
+
 /// \return The modelview matrix of the mesh (reference)
 glm::mat4 &AbstractMesh::get_modelview()
 {
     return m_modelview;
 }
 
+/// \return The modelview to draw the vertices with : the stored positions are brought back to model space first (VertexLayout::POSITIONS_UNORM16)
+glm::mat4 AbstractMesh::getVertexModelview()
+{
+    return m_modelview * m_positionDecode;
+}
+
+/// \return The layout of the uploaded vertices once loaded, the one that will be used otherwise
+const VertexLayout &AbstractMesh::getVertexLayout()
+{
+    return m_loaded ? m_uploadedLayout : m_vertexLayout;
+}
+
+/// \return GPU memory of the vertices (0 if the mesh isn't loaded)
+size_t AbstractMesh::getVertexBytes()
+{
+    return m_loaded ? m_verticesCount * m_uploadedLayout.getStride() : 0;
+}
+
+size_t AbstractMesh::getIndexBytes()
+{
+    if(!m_loaded) return 0;
+    if(usesSharedBuffers()) return m_sharedRange.indexCount * sizeof(GLuint);
+
+    return m_indicesCount * ((m_indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint));
+}
+
 AbstractMaterial *AbstractMesh::getMaterial()
 {
     return m_material;
 }
 
+/// \return The VAO to bind before drawBound() : the one of its GeometryPool page for a mesh in the shared buffers
+GLuint AbstractMesh::getVertexArrayID()
+{
+    return usesSharedBuffers() ? m_sharedRange.vertexArray : m_vaoID;
+}
+
+GLenum AbstractMesh::getMeshType()
+{
+    return m_meshType;
+}
+
+/// \return The number of vertices stored in the vertex buffer (unique vertices for an indexed mesh)
+int AbstractMesh::getVerticesCount()
+{
+    return m_verticesCount;
+}
+
+int AbstractMesh::getIndicesCount()
+{
+    return m_indicesCount;
+}
+
+bool AbstractMesh::isLoaded()
+{
+    return m_loaded;
+}
+
+bool AbstractMesh::usesSharedBuffers()
+{
+    return m_sharedRange.layout >= 0;
+}
+
+const GLvoid *AbstractMesh::getIndexOffset()
+{
+    return BUFFER_OFFSET(m_sharedRange.firstIndex * sizeof(GLuint));
+}
+
+GLint AbstractMesh::getBaseVertex()
+{
+    return m_sharedRange.firstVertex;
+}
+
+bool AbstractMesh::isIndexed()
+{
+    return m_indicesCount > 0;
+}
+
+const float *AbstractMesh::getVertices()
+{
+    return m_vertices;
+}
+
+const float *AbstractMesh::getColors()
+{
+    return m_colors;
+}
+
+const float *AbstractMesh::getTexCoords()
+{
+    return m_texCoords;
+}
+
+const float *AbstractMesh::getVertexNormals()
+{
+    return m_vertexNormals;
+}
+
+/// \return The index buffer (nullptr if the mesh isn't indexed), of getIndexType() elements
+const void *AbstractMesh::getIndices()
+{
+    return m_indices;
+}
+
+GLenum AbstractMesh::getIndexType()
+{
+    return m_indexType;
+}
+
+/// \brief Computes the bounding box from the vertices. Nothing is done if there is no vertex array.
+void AbstractMesh::computeBounds()
+{
+    if(m_vertices == nullptr || m_verticesCount <= 0) {
+        return;
+    }
+
+    m_boundsMin = m_boundsMax = glm::vec3(m_vertices[0], m_vertices[1], m_vertices[2]);
+    for(int i = 1;i < m_verticesCount;i++) {
+        glm::vec3 vertex(m_vertices[3*i], m_vertices[3*i + 1], m_vertices[3*i + 2]);
+        m_boundsMin = glm::min(m_boundsMin, vertex);
+        m_boundsMax = glm::max(m_boundsMax, vertex);
+    }
+
+    /* Sphere : farthest vertex from the box center (tighter than the half diagonal) */
+    glm::vec3 center = 0.5f * (m_boundsMin + m_boundsMax);
+    float radius2 = 0.0;
+    for(int i = 0;i < m_verticesCount;i++) {
+        glm::vec3 offset = glm::vec3(m_vertices[3*i], m_vertices[3*i + 1], m_vertices[3*i + 2]) - center;
+        radius2 = std::max(radius2, glm::dot(offset, offset));
+    }
+
+    m_boundingRadius = sqrt(radius2);
+    m_boundsSet = true;
+    m_worldBoundsValid = false;
+}
+
+void AbstractMesh::setBounds(glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    m_boundsMin = boundsMin;
+    m_boundsMax = boundsMax;
+    m_boundingRadius = 0.5f * glm::length(boundsMax - boundsMin); // No vertex to do better
+    m_boundsSet = true;
+    m_worldBoundsValid = false;
+}
+
+float AbstractMesh::getBoundingRadius()
+{
+    return m_boundingRadius;
+}
+
+/*!
+ *  \brief Transforms the bounds by the modelview : the AABB is rebuilt around the transformed box (Arvo), the sphere radius is scaled by
+ *  the largest axis scale. Nothing is done if the modelview is the one of the last call.
+ */
+bool AbstractMesh::updateWorldBounds()
+{
+    if(m_worldBoundsValid && m_worldModelview == m_modelview) {
+        return false;
+    }
+
+    glm::vec3   center = 0.5f * (m_boundsMin + m_boundsMax),
+                extents = 0.5f * (m_boundsMax - m_boundsMin);
+
+    m_worldCenter = glm::vec3(m_modelview * glm::vec4(center, 1.0));
+    for(int row = 0;row < 3;row++) {
+        m_worldExtents[row] = fabs(m_modelview[0][row]) * extents[0] + fabs(m_modelview[1][row]) * extents[1] + fabs(m_modelview[2][row]) * extents[2];
+    }
+
+    float scale = std::max(glm::length(glm::vec3(m_modelview[0])), std::max(glm::length(glm::vec3(m_modelview[1])), glm::length(glm::vec3(m_modelview[2]))));
+    m_worldRadius = m_boundingRadius * scale;
+    updateNormalMatrix();
+
+    m_worldModelview = m_modelview;
+    m_worldBoundsValid = true;
+    return true;
+}
+
+glm::vec3 AbstractMesh::getWorldCenter()
+{
+    return m_worldCenter;
+}
+
+glm::vec3 AbstractMesh::getWorldExtents()
+{
+    return m_worldExtents;
+}
+
+float AbstractMesh::getWorldRadius()
+{
+    return m_worldRadius;
+}
+
+/*!
+ *  \brief The ray is brought to model space by the inverse modelview. The direction isn't normalized there, so t is the same in both spaces.
+ *  \param triangle Index of the triangle (in the index buffer for an indexed mesh, in the vertex array otherwise)
+ */
+bool AbstractMesh::intersectRay(const glm::vec3 &origin, const glm::vec3 &direction, float &t, unsigned int &triangle)
+{
+    glm::mat4 inverseModelview = glm::inverse(m_modelview);
+    return intersectLocalRay(glm::vec3(inverseModelview * glm::vec4(origin, 1.0)), glm::vec3(inverseModelview * glm::vec4(direction, 0.0)), t, triangle);
+}
+
+bool AbstractMesh::intersectLocalRay(const glm::vec3 &origin, const glm::vec3 &direction, float &t, unsigned int &triangle)
+{
+    if(m_vertices == nullptr) {
+        return false;
+    }
+
+    int triangleCount = getTriangleCount();
+    bool hit = false;
+
+    for(int i = 0;i < triangleCount;i++) {
+        unsigned int corners[3];
+        for(int corner = 0;corner < 3;corner++) {
+            if(m_indicesCount == 0)                     corners[corner] = 3*i + corner;
+            else if(m_indexType == GL_UNSIGNED_SHORT)   corners[corner] = ((const GLushort*) m_indices)[3*i + corner];
+            else                                        corners[corner] = ((const GLuint*) m_indices)[3*i + corner];
+        }
+
+        float distance;
+        if(SceneBVH::intersectTriangle(glm::value_ptr(origin), glm::value_ptr(direction),
+                                       m_vertices + 3*corners[0], m_vertices + 3*corners[1], m_vertices + 3*corners[2], distance)
+           && (!hit || distance < t)) {
+            t = distance;
+            triangle = i;
+            hit = true;
+        }
+    }
+
+    return hit;
+}
+
+int AbstractMesh::getTriangleCount()
+{
+    return (m_indicesCount > 0) ? m_indicesCount / 3 : m_verticesCount / 3;
+}
+
+/// \brief Inverse transpose of the modelview : computed once per move instead of once per draw.
+void AbstractMesh::updateNormalMatrix()
+{
+    m_normalMatrix = glm::transpose(glm::inverse(m_modelview));
+}
+
+const glm::mat4 &AbstractMesh::getNormalMatrix()
+{
+    return m_normalMatrix;
+}
+
+/// \brief For the meshes whose world bounds don't come from the modelview alone (see InstancedMesh::updateWorldBounds()).
+void AbstractMesh::setWorldBounds(glm::vec3 center, glm::vec3 extents, float radius)
+{
+    m_worldCenter = center;
+    m_worldExtents = extents;
+    m_worldRadius = radius;
+}
+
+glm::vec3 AbstractMesh::getBoundsMin()
+{
+    return m_boundsMin;
+}
+
+glm::vec3 AbstractMesh::getBoundsMax()
+{
+    return m_boundsMax;
+}
+
 void AbstractMesh::draw()
 {
     // /!\ Assumes the correct modelview matrix has already been sent
 
-    glBindVertexArray(m_vaoID); // Using the VAO
+    GLState::bindVertexArray(getVertexArrayID()); // The VAO of the GeometryPool page for a shared mesh (m_vaoID is 0 then)
 
-        glActiveTexture(GL_TEXTURE0); // Diffuse texture
+        GLState::activeTexture(0); // Diffuse texture
         m_material->getDiffuseTexture()->bind();
-            glDrawArrays(GL_TRIANGLES, 0, m_verticesCount);
+            drawBound();
         m_material->getDiffuseTexture()->unbind();
 
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
+}
+
+bool AbstractMesh::isInstanced()
+{
+    return false;
+}
+
+void AbstractMesh::cullParts(const glm::mat4 &viewProjection)
+{
+    // Drawn whole
+}
+
+void AbstractMesh::drawBound()
+{
+    if(usesSharedBuffers())     glDrawElementsBaseVertex(GL_TRIANGLES, m_sharedRange.indexCount, GL_UNSIGNED_INT, getIndexOffset(), getBaseVertex());
+    else if(m_indicesCount > 0) glDrawElements(GL_TRIANGLES, m_indicesCount, m_indexType, BUFFER_OFFSET(0));
+    else                        glDrawArrays(GL_TRIANGLES, 0, m_verticesCount);
+}
+
+/// \brief Frees the owned arrays among arrays (MESH_ARRAY_*). The arrays of the caller are left to it.
+void AbstractMesh::freeArrays(unsigned int arrays)
+{
+    arrays &= m_ownedArrays;
+
+    if(arrays & MESH_ARRAY_VERTICES)    free(m_vertices);
+    if(arrays & MESH_ARRAY_COLORS)      free(m_colors);
+    if(arrays & MESH_ARRAY_TEXCOORDS)   free(m_texCoords);
+    if(arrays & MESH_ARRAY_NORMALS)     free(m_vertexNormals);
+    if(arrays & MESH_ARRAY_INDICES)     free(m_indices);
+    m_ownedArrays &= ~arrays;
 }
 
 AbstractMesh::~AbstractMesh()
 {
+    freeArrays(MESH_ARRAYS_ALL);
+
+    GeometryPool::free(m_sharedRange);
     glDeleteBuffers(1, &m_vboID);
+    glDeleteBuffers(1, &m_eboID);
+    GLState::forgetVertexArray(m_vaoID);
     glDeleteVertexArrays(1, &m_vaoID);
 }
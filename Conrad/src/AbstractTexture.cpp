@@ -56,6 +56,22 @@ bool AbstractTexture::loadFromSDL(SDL_Surface *surface, GLvoid* &data_ptr, GLenu
         SDL_image = surface;
     }
 
+    if(!surfaceFormat(SDL_image, internalFormat, format)) {
+        return false;
+    }
+
+    m_width = SDL_image->w;
+    m_height = SDL_image->h;
+    data_ptr = (GLvoid *) SDL_image->pixels;
+
+    SDL_FreeSurface(SDL_image);
+
+    return true;
+}
+
+/// \brief Finds the GL formats of an SDL surface. \return false if the pixel format isn't supported.
+bool AbstractTexture::surfaceFormat(SDL_Surface *SDL_image, GLenum &internalFormat, GLenum &format)
+{
     /* Getting image format */
         if(SDL_image->format->BytesPerPixel == 3) {
             internalFormat = GL_SRGB; // S for gamma correction canceling on the image (it's taken care of in the shader)
@@ -80,12 +96,40 @@ bool AbstractTexture::loadFromSDL(SDL_Surface *surface, GLvoid* &data_ptr, GLenu
             return false;
         }
 
-    m_width = SDL_image->w;
-    m_height = SDL_image->h;
-    data_ptr = (GLvoid *) SDL_image->pixels;
+    return true;
+}
 
-    SDL_FreeSurface(SDL_image);
+/*!
+ *  \brief Reads the image file and converts it for OpenGL (reversed rows, formats). The image is kept until load() uploads it.
+ *  Loading textures this way on worker threads only leaves the upload to the GL thread.
+ */
+bool AbstractTexture::decode()
+{
+    if(m_mode != FILE_MODE) {
+        return false;
+    }
+
+    if(m_decoded != nullptr) {
+        return true; // Already decoded
+    }
+
+    SDL_Surface *source = IMG_Load(m_filepath.c_str());
+    if(source == 0) {
+        cout << "Error while loading texture : " << SDL_GetError() << endl;
+        return false;
+    }
+
+    SDL_Surface *SDL_image = AbstractTexture::reverse_SDL_surface(source); // Need to reverse the image as OpenGL uses a different coords system for 2D textures.
+    SDL_FreeSurface(source);
+
+    if(!surfaceFormat(SDL_image, m_internalFormat, m_format)) {
+        SDL_FreeSurface(SDL_image);
+        return false;
+    }
 
+    m_width = SDL_image->w;
+    m_height = SDL_image->h;
+    m_decoded = SDL_image;
     return true;
 }
 
@@ -96,24 +140,25 @@ bool AbstractTexture::load()
     }
 
     GLvoid *data_ptr = 0; // Blank by default
-    m_internalFormat = GL_SRGB_ALPHA;
-    m_format = GL_RGBA;
+    if(m_mode == FILE_MODE) {
+        if(!decode()) { // Nothing to do if it was decoded before
+            return false;
+        }
+
+        data_ptr = (GLvoid *) m_decoded->pixels;
+    } else {
+        m_internalFormat = GL_SRGB_ALPHA;
+        m_format = GL_RGBA;
+    }
 
     /* OpenGL texture generation */
     if(glIsTexture(m_id) == GL_TRUE) {
+        GLState::forgetTexture(m_id);
         glDeleteTextures(1, &m_id);
     } glGenTextures(1, &m_id); // Texture ID generation
 
-    SDL_Surface *SDL_image = 0; // Temporary pointer for freeing afterwards
-    if(m_mode == FILE_MODE) {
-        SDL_Surface *source = IMG_Load(m_filepath.c_str());
-        if(!loadFromSDL(source, data_ptr, m_internalFormat, m_format, true)) {
-            return false;
-        }
-    }
-
     /* Setting up texture */
-    glBindTexture(GL_TEXTURE_2D, m_id);
+    GLState::bindTexture(GL_TEXTURE_2D, m_id);
 
         glTexImage2D(GL_TEXTURE_2D, 0, m_internalFormat, m_width, m_height, 0, m_format, GL_UNSIGNED_BYTE, data_ptr);
 
@@ -121,7 +166,12 @@ bool AbstractTexture::load()
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLState::bindTexture(GL_TEXTURE_2D, 0);
+
+    if(m_decoded != nullptr) { // Uploaded
+        SDL_FreeSurface(m_decoded);
+        m_decoded = nullptr;
+    }
 
     m_loaded = true;
     return true;
@@ -132,6 +182,12 @@ GLuint AbstractTexture::getID()
     return m_id;
 }
 
+size_t AbstractTexture::getByteSize()
+{
+    size_t bytesPerPixel = (m_format == GL_RGB || m_format == GL_BGR) ? 3 : 4;
+    return (size_t) m_width * m_height * bytesPerPixel;
+}
+
 bool AbstractTexture::isLoaded()
 {
     return m_loaded;
@@ -139,12 +195,12 @@ bool AbstractTexture::isLoaded()
 
 void AbstractTexture::bind()
 {
-    glBindTexture(GL_TEXTURE_2D, m_id);
+    GLState::bindTexture(GL_TEXTURE_2D, m_id);
 }
 
 void AbstractTexture::unbind() // Could be static (and inline)
 {
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLState::bindTexture(GL_TEXTURE_2D, 0);
 }
 
 SDL_Surface *AbstractTexture::reverse_SDL_surface(SDL_Surface *source)
@@ -174,5 +230,7 @@ SDL_Surface *AbstractTexture::reverse_SDL_surface(SDL_Surface *source)
 
 AbstractTexture::~AbstractTexture()
 {
+    if(m_decoded != nullptr) SDL_FreeSurface(m_decoded);
+    GLState::forgetTexture(m_id);
     glDeleteTextures(1, &m_id);
 }
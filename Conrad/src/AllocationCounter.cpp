@@ -0,0 +1,55 @@
+#include "AllocationCounter.h"
+
+#ifdef CONRAD_COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<unsigned long long> allocations(0);
+
+    void *counted_alloc(std::size_t size)
+    {
+        allocations++;
+
+        void *pointer = std::malloc(size ? size : 1);
+        if(pointer == nullptr) throw std::bad_alloc();
+        return pointer;
+    }
+}
+
+void *operator new(std::size_t size)                                    { return counted_alloc(size); }
+void *operator new[](std::size_t size)                                  { return counted_alloc(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept   { allocations++; return std::malloc(size ? size : 1); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { allocations++; return std::malloc(size ? size : 1); }
+
+void operator delete(void *pointer) noexcept                            { std::free(pointer); }
+void operator delete[](void *pointer) noexcept                          { std::free(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept    { std::free(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept  { std::free(pointer); }
+
+unsigned long long AllocationCounter::getCount()
+{
+    return allocations;
+}
+
+bool AllocationCounter::isEnabled()
+{
+    return true;
+}
+
+#else
+
+unsigned long long AllocationCounter::getCount()
+{
+    return 0;
+}
+
+bool AllocationCounter::isEnabled()
+{
+    return false;
+}
+
+#endif // CONRAD_COUNT_ALLOCATIONS
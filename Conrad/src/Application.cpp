@@ -24,9 +24,13 @@ bool Application::init()
 
     /* OpenGL Context */
 
-    // Version OpenGL 3.1
+    // Version OpenGL 3.3 core : per-instance attributes (glVertexAttribDivisor)
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    #ifdef __APPLE__
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG); // The only core contexts macOS makes
+    #endif
 
     // Double buffering
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
@@ -38,21 +42,22 @@ bool Application::init()
     }
 
     #ifdef WIN32 /* GLEW initialization for Windows */
+        glewExperimental = GL_TRUE; // Core context : GLEW must not rely on the extensions string to load the entry points
         GLenum glew = glewInit();
         if(glew != GLEW_OK) {
             return false;
         }
     #endif // WIN32
 
-    /* OpenGL settings */
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_TEXTURE_2D);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
+    /* OpenGL settings (every state change goes through GLState from here) */
+    GLState::invalidate();
+    GLState::enable(GL_DEPTH_TEST);
+    GLState::enable(GL_CULL_FACE);
+    GLState::cullFace(GL_BACK);
 
     /* Textures (enables alpha channel) */
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::enable(GL_BLEND);
+    GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     /* SDL settings */
     SDL_GL_SetSwapInterval(0); // Disabling vsync
@@ -67,7 +72,7 @@ bool Application::init()
 /// \brief Main loop of an Application
 void Application::loop(int const fps)
 {
-    bool wireframe_pressed(false);
+    bool wireframe_pressed(false), filter_pressed(false);
     ms delay(1000.0/fps);
     std::cout << "Starting app loop at " << fps << " fps (" << delay.count() << " ms)" << std::endl;
 
@@ -89,6 +94,12 @@ void Application::loop(int const fps)
                 wireframe_pressed = true;
             }
             if(!m_inputManager->isKeyPressed(KEY_F)) wireframe_pressed = false;
+
+            if(m_inputManager->isKeyPressed(KEY_G) && !filter_pressed) { // Next shadow filter : the previous one's GPU times are printed
+                m_renderer->setShadowFilter((m_renderer->getShadowFilter() + 1) % SHADOW_FILTER_COUNT);
+                filter_pressed = true;
+            }
+            if(!m_inputManager->isKeyPressed(KEY_G)) filter_pressed = false;
             if(m_inputManager->isKeyPressed(KEY_ESCAPE)) m_run = false;
 
             m_renderer->get_camera()->move();
@@ -0,0 +1,169 @@
+#include "BatchedMesh.h"
+
+#include <map>
+#include <cstring>
+
+using namespace std;
+
+bool BatchedMesh::s_report = false;
+
+BatchedMesh::BatchedMesh(MeshBatcher::Batch &batch) :
+    StaticMesh(batch.vertices.size() / 3, batch.vertices.data(), batch.colors.data(), batch.texCoords.data(), batch.vertexNormals.data())
+{
+    // A swap keeps the arrays where they are : the pointers given to the mesh stay valid
+    m_batch.vertices.swap(batch.vertices);
+    m_batch.colors.swap(batch.colors);
+    m_batch.texCoords.swap(batch.texCoords);
+    m_batch.vertexNormals.swap(batch.vertexNormals);
+    m_batch.indices.swap(batch.indices);
+    m_batch.pieces.swap(batch.pieces);
+
+    setIndices(m_batch.indices.data(), m_batch.indices.size(), GL_UNSIGNED_INT);
+
+    /* Pieces */
+    size_t pieceCount = m_batch.pieces.size();
+    m_culler.resize(pieceCount);
+    m_visible.assign(pieceCount, 1);
+    m_rangeFirsts.resize(pieceCount);
+    m_rangeCounts.resize(pieceCount);
+    m_rangeOffsets.resize(pieceCount);
+    m_rangeBaseVertices.resize(pieceCount);
+
+    glm::vec3 boundsMin(0.0), boundsMax(0.0);
+    for(size_t i = 0;i < pieceCount;i++) {
+        const MeshBatcher::Piece &piece = m_batch.pieces[i];
+        glm::vec3 pieceMin = glm::make_vec3(piece.boundsMin), pieceMax = glm::make_vec3(piece.boundsMax);
+        glm::vec3 center = 0.5f * (pieceMin + pieceMax), extents = 0.5f * (pieceMax - pieceMin);
+
+        m_culler.setVolume(i, glm::value_ptr(center), glm::value_ptr(extents), glm::length(extents));
+
+        boundsMin = (i == 0) ? pieceMin : glm::min(boundsMin, pieceMin);
+        boundsMax = (i == 0) ? pieceMax : glm::max(boundsMax, pieceMax);
+    }
+    setBounds(boundsMin, boundsMax);
+
+    m_rangeCount = MeshBatcher::coalesce(m_batch.pieces, m_visible.data(), m_rangeFirsts.data(), m_rangeCounts.data()); // Everything until culled
+}
+
+bool BatchedMesh::isBatchable(StaticMesh *mesh)
+{
+    return !mesh->isLoaded() && !mesh->isInstanced() && mesh->getMeshType() == GL_STATIC_DRAW && mesh->getVertices() != nullptr && mesh->getVerticesCount() > 0
+           && mesh->getMaterial()->getAlpha() >= 1.0; // The translucent meshes are sorted back to front one by one
+}
+
+/*!
+ *  \brief Groups the batchable meshes by material. A group of one mesh is kept as it is. A mesh with its own VAO wouldn't be drawn
+ *  with fewer calls.
+ */
+vector<StaticMesh *> BatchedMesh::batch(const vector<StaticMesh *> &meshes, vector<size_t> &destination)
+{
+    vector<StaticMesh *> result;
+    destination.assign(meshes.size(), 0);
+
+    map<AbstractMaterial *, vector<size_t> > groups;
+    for(size_t i = 0;i < meshes.size();i++) {
+        if(isBatchable(meshes[i])) groups[meshes[i]->getMaterial()].push_back(i);
+    }
+
+    size_t merged = 0, batches = 0;
+    vector<bool> batched(meshes.size(), false);
+    for(map<AbstractMaterial *, vector<size_t> >::iterator group = groups.begin();group != groups.end();group++) {
+        const vector<size_t> &members = group->second;
+        if(members.size() < 2) continue;
+
+        vector<MeshBatcher::Source> sources(members.size());
+        for(size_t i = 0;i < members.size();i++) {
+            StaticMesh *mesh = meshes[members[i]];
+            MeshBatcher::Source &source = sources[i];
+
+            source.verticesCount = mesh->getVerticesCount();
+            source.vertices = mesh->getVertices();
+            source.colors = mesh->getColors();
+            source.texCoords = mesh->getTexCoords();
+            source.vertexNormals = mesh->getVertexNormals();
+            source.indices = mesh->getIndices();
+            source.indicesCount = mesh->getIndicesCount();
+            source.shortIndices = (mesh->getIndexType() == GL_UNSIGNED_SHORT);
+            memcpy(source.modelview, glm::value_ptr(mesh->get_modelview()), sizeof(source.modelview));
+        }
+
+        vector<MeshBatcher::Batch> groupBatches;
+        MeshBatcher::merge(sources, groupBatches);
+
+        for(size_t b = 0;b < groupBatches.size();b++) {
+            for(size_t p = 0;p < groupBatches[b].pieces.size();p++) {
+                size_t member = members[groupBatches[b].pieces[p].source];
+                destination[member] = result.size();
+                batched[member] = true;
+            }
+
+            BatchedMesh *batchedMesh = new BatchedMesh(groupBatches[b]);
+            batchedMesh->setMaterial(group->first);
+            result.push_back(batchedMesh);
+        }
+
+        merged += members.size();
+        batches += groupBatches.size();
+    }
+
+    for(size_t i = 0;i < meshes.size();i++) {
+        if(batched[i]) {
+            delete meshes[i];
+        } else {
+            destination[i] = result.size();
+            result.push_back(meshes[i]);
+        }
+    }
+
+    if(s_report && merged > 0) {
+        cout << "(BatchedMesh) " << merged << " meshes merged into " << batches << " batches : " << meshes.size() << " -> " << result.size() << " draw calls" << endl;
+    }
+
+    return result;
+}
+
+void BatchedMesh::setReport(bool report)
+{
+    s_report = report;
+}
+
+/// \brief Culls the pieces against the frustum of viewProjection (brought to the batch model space) and rebuilds the draw ranges. No allocation.
+void BatchedMesh::cullParts(const glm::mat4 &viewProjection)
+{
+    float planes[6][4];
+    glm::mat4 matrix = viewProjection * m_modelview;
+    FrustumCuller::extractPlanes(glm::value_ptr(matrix), planes);
+
+    m_culler.cull(planes, m_visible.data());
+    m_rangeCount = MeshBatcher::coalesce(m_batch.pieces, m_visible.data(), m_rangeFirsts.data(), m_rangeCounts.data());
+}
+
+void BatchedMesh::drawBound()
+{
+    if(m_rangeCount == 0) return;
+
+    /* The ranges of the batch, wherever its indices start (GeometryPool) */
+    const char *indexOffset = (const char *) getIndexOffset();
+    for(size_t i = 0;i < m_rangeCount;i++) {
+        m_rangeOffsets[i] = indexOffset + m_rangeFirsts[i] * sizeof(GLuint);
+        m_rangeBaseVertices[i] = getBaseVertex();
+    }
+
+    if(m_rangeCount == 1)   glDrawElementsBaseVertex(GL_TRIANGLES, m_rangeCounts[0], GL_UNSIGNED_INT, m_rangeOffsets[0], m_rangeBaseVertices[0]);
+    else                    glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_rangeCounts.data(), GL_UNSIGNED_INT, m_rangeOffsets.data(), m_rangeCount, m_rangeBaseVertices.data());
+}
+
+size_t BatchedMesh::getPieceCount()
+{
+    return m_batch.pieces.size();
+}
+
+size_t BatchedMesh::getDrawRangeCount()
+{
+    return m_rangeCount;
+}
+
+BatchedMesh::~BatchedMesh()
+{
+    // The arrays are owned by m_batch
+}
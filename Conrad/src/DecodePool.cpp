@@ -0,0 +1,92 @@
+#include "DecodePool.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+
+using namespace std;
+
+DecodePool::DecodePool(unsigned int threadCount) :
+    m_threadCount(threadCount)
+{
+    //ctor
+}
+
+void DecodePool::setThreadCount(unsigned int threadCount)
+{
+    m_threadCount = threadCount;
+}
+
+unsigned int DecodePool::getWorkerCount()
+{
+    return m_workerCount;
+}
+
+void DecodePool::run(size_t taskCount, const function<void(size_t)> &decode, const function<void(size_t)> &upload)
+{
+    unsigned int threadCount = m_threadCount;
+    if(threadCount == DECODE_POOL_THREADS_AUTO) {
+        threadCount = thread::hardware_concurrency();
+        if(threadCount == 0) threadCount = 1; // Unknown
+    }
+
+    if(threadCount > taskCount) threadCount = taskCount;
+
+    /* Serial : no thread is worth it */
+    if(threadCount <= 1) {
+        m_workerCount = 0;
+        for(size_t i = 0;i < taskCount;i++) {
+            decode(i);
+            upload(i);
+        }
+
+        return;
+    }
+
+    m_workerCount = threadCount;
+
+    atomic<size_t> next(0);
+    mutex readyMutex;
+    condition_variable readyCondition;
+    deque<size_t> ready; // Decoded tasks, waiting for their upload
+
+    auto work = [&]() {
+        for(size_t i = next++;i < taskCount;i = next++) {
+            decode(i);
+
+            lock_guard<mutex> lock(readyMutex);
+            ready.push_back(i);
+            readyCondition.notify_one();
+        }
+    };
+
+    vector<thread> workers;
+    for(unsigned int t = 0;t < threadCount;t++) {
+        workers.push_back(thread(work));
+    }
+
+    /* Upload loop : the calling thread keeps the GL context */
+    for(size_t uploaded = 0;uploaded < taskCount;uploaded++) {
+        size_t i;
+        {
+            unique_lock<mutex> lock(readyMutex);
+            readyCondition.wait(lock, [&]() { return !ready.empty(); });
+            i = ready.front();
+            ready.pop_front();
+        }
+
+        upload(i);
+    }
+
+    for(thread &worker : workers) {
+        worker.join();
+    }
+}
+
+DecodePool::~DecodePool()
+{
+    //dtor
+}
@@ -6,8 +6,7 @@ using namespace glm;
 DepthBuffer::DepthBuffer() :
     m_type(DEPTHBUFFER_SIMPLE)
 {
-    // Simple depth map by default
-    load();
+    // Loaded on demand : most lights render into the shadow atlas
 }
 
 DepthBuffer::DepthBuffer(depthbuffer_type type) :
@@ -27,9 +26,9 @@ void DepthBuffer::load()
     /* Generating depth map texture */
     glGenTextures(1, &m_depthMapTextureID);
     if(m_type == DEPTHBUFFER_SIMPLE) {      // Simple shadow map
-        glBindTexture(GL_TEXTURE_2D, m_depthMapTextureID);
+        GLState::bindTexture(GL_TEXTURE_2D, m_depthMapTextureID);
 
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOWMAP_SIZE, SHADOWMAP_SIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, m_shadowMapWidth, m_shadowMapHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -38,10 +37,10 @@ void DepthBuffer::load()
             float borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
             glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLState::bindTexture(GL_TEXTURE_2D, 0);
 
     } else if(m_type == DEPTHBUFFER_CUBE) { // Cubemap
-        glBindTexture(GL_TEXTURE_CUBE_MAP, m_depthMapTextureID);
+        GLState::bindTexture(GL_TEXTURE_CUBE_MAP, m_depthMapTextureID);
 
             for(size_t i = 0;i < 6;i++) { // Generating 6 faces for the cube map
                 glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, m_shadowMapWidth, m_shadowMapHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
@@ -53,35 +52,93 @@ void DepthBuffer::load()
             glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
             glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        GLState::bindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    } else if(m_type == DEPTHBUFFER_ARRAY) { // Cascades
+        GLState::bindTexture(GL_TEXTURE_2D_ARRAY, m_depthMapTextureID);
+
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT, m_shadowMapWidth, m_shadowMapHeight, m_layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+
+            float borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f}; // Out of a cascade : lit
+            glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+        GLState::bindTexture(GL_TEXTURE_2D_ARRAY, 0);
     }
 
     /* Frame buffer texture attachment */
-    glBindFramebuffer(GL_FRAMEBUFFER, m_frameBufferObjectID);
+    GLState::bindFramebuffer(m_frameBufferObjectID);
 
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthMapTextureID, 0);
+        if(m_type == DEPTHBUFFER_ARRAY)     glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthMapTextureID, 0, 0);
+        else if(m_type == DEPTHBUFFER_CUBE) glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthMapTextureID, 0); // Layered : gl_Layer picks the face
+        else                                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthMapTextureID, 0);
         glDrawBuffer(GL_NONE);
         glReadBuffer(GL_NONE);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::bindFramebuffer(0);
+}
+
+/// \brief Deletes the current textures and frame buffer, then loads new ones.
+void DepthBuffer::load(depthbuffer_type type, GLsizei size, GLsizei layers)
+{
+    GLState::forgetTexture(m_depthMapTextureID);
+    glDeleteTextures(1, &m_depthMapTextureID);
+    if(m_frameBufferObjectID != 0) {
+        GLState::forgetFramebuffer(m_frameBufferObjectID);
+        glDeleteFramebuffers(1, &m_frameBufferObjectID);
+    }
+
+    m_type = type;
+    m_shadowMapWidth = m_shadowMapHeight = size;
+    m_layers = (type == DEPTHBUFFER_ARRAY) ? layers : 1;
+
+    load();
 }
 
 /// \brief Binds the attached texture
 void DepthBuffer::bindTexture(size_t index)
 {
-    glActiveTexture(GL_TEXTURE0 + DEPTHBUFFER_TEXTURE0 + index);
-
     if(m_type == DEPTHBUFFER_SIMPLE) {
-        glBindTexture(GL_TEXTURE_2D, m_depthMapTextureID);
+        GLState::bindTexture(DEPTHBUFFER_TEXTURE0 + index, GL_TEXTURE_2D, m_depthMapTextureID);
     } else if(m_type == DEPTHBUFFER_CUBE) {
-        glBindTexture(GL_TEXTURE_CUBE_MAP, m_depthMapTextureID);
+        GLState::bindTexture(DEPTHBUFFER_TEXTURE0 + index, GL_TEXTURE_CUBE_MAP, m_depthMapTextureID);
+    } else if(m_type == DEPTHBUFFER_ARRAY) {
+        GLState::bindTexture(DEPTHBUFFER_TEXTURE0 + index, GL_TEXTURE_2D_ARRAY, m_depthMapTextureID);
     }
 }
 
 /// \brief Binds the frame buffer
 void DepthBuffer::bind()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, m_frameBufferObjectID);
+    GLState::bindFramebuffer(m_frameBufferObjectID);
+}
+
+void DepthBuffer::bindLayer(GLint layer)
+{
+    GLState::bindFramebuffer(m_frameBufferObjectID);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthMapTextureID, 0, layer);
+}
+
+/*!
+ *  \brief Hardware comparison : a texture fetch compares its reference with the stored depth (GL_LEQUAL : 1 if lit) and the linear filter
+ *  averages the four comparisons around it. Without, the fetches return the nearest depth.
+ */
+void DepthBuffer::setComparison(bool enabled)
+{
+    if(m_type != DEPTHBUFFER_SIMPLE) return;
+
+    GLenum filter = enabled ? GL_LINEAR : GL_NEAREST;
+    GLState::bindTexture(GL_TEXTURE_2D, m_depthMapTextureID);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, enabled ? GL_COMPARE_REF_TO_TEXTURE : GL_NONE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+
+    GLState::bindTexture(GL_TEXTURE_2D, 0);
 }
 
 GLsizei DepthBuffer::getShadowMapWidth()
@@ -94,6 +151,11 @@ GLsizei DepthBuffer::getShadowMapHeight()
     return m_shadowMapHeight;
 }
 
+GLsizei DepthBuffer::getLayers()
+{
+    return m_layers;
+}
+
 GLuint DepthBuffer::getTextureID()
 {
     return m_depthMapTextureID;
@@ -0,0 +1,149 @@
+#include "FrustumCuller.h"
+
+#include <cmath>
+#include <algorithm>
+
+#ifdef FRUSTUM_CULLER_SSE
+    #include <emmintrin.h>
+#endif
+
+using namespace std;
+
+FrustumCuller::FrustumCuller()
+{
+    //ctor
+}
+
+void FrustumCuller::resize(size_t count)
+{
+    m_centerX.resize(count, 0.0f); m_centerY.resize(count, 0.0f); m_centerZ.resize(count, 0.0f);
+    m_extentX.resize(count, 0.0f); m_extentY.resize(count, 0.0f); m_extentZ.resize(count, 0.0f);
+    m_radius.resize(count, 0.0f);
+}
+
+size_t FrustumCuller::size() const
+{
+    return m_radius.size();
+}
+
+void FrustumCuller::setVolume(size_t index, const float center[3], const float extents[3], float radius)
+{
+    m_centerX[index] = center[0];
+    m_centerY[index] = center[1];
+    m_centerZ[index] = center[2];
+
+    m_extentX[index] = extents[0];
+    m_extentY[index] = extents[1];
+    m_extentZ[index] = extents[2];
+
+    m_radius[index] = radius;
+}
+
+void FrustumCuller::extractPlanes(const float matrix[16], float planes[6][4])
+{
+    /* Row i of the matrix is (matrix[i], matrix[4 + i], matrix[8 + i], matrix[12 + i]) */
+    for(int plane = 0;plane < 6;plane++) {
+        int row = plane / 2;
+        float sign = (plane % 2 == 0) ? 1.0f : -1.0f; // Left, right, bottom, top, near, far
+
+        for(int column = 0;column < 4;column++) {
+            planes[plane][column] = matrix[4 * column + 3] + sign * matrix[4 * column + row];
+        }
+
+        float length = sqrt(planes[plane][0] * planes[plane][0] + planes[plane][1] * planes[plane][1] + planes[plane][2] * planes[plane][2]);
+        if(length > 0.0f) {
+            for(int column = 0;column < 4;column++) planes[plane][column] /= length;
+        }
+    }
+}
+
+size_t FrustumCuller::cullRange(const float planes[6][4], unsigned char *visible, size_t first, size_t last) const
+{
+    size_t visibleCount = 0;
+    for(size_t i = first;i < last;i++) {
+        bool inside = true;
+
+        for(int plane = 0;plane < 6 && inside;plane++) {
+            const float *p = planes[plane];
+            float distance = p[0] * m_centerX[i] + p[1] * m_centerY[i] + p[2] * m_centerZ[i] + p[3];
+            float boxRadius = fabs(p[0]) * m_extentX[i] + fabs(p[1]) * m_extentY[i] + fabs(p[2]) * m_extentZ[i];
+
+            inside = (distance >= -min(boxRadius, m_radius[i]));
+        }
+
+        visible[i] = inside ? 1 : 0;
+        visibleCount += visible[i];
+    }
+
+    return visibleCount;
+}
+
+bool FrustumCuller::intersectsBox(const float planes[6][4], const float center[3], const float extents[3])
+{
+    for(int plane = 0;plane < 6;plane++) {
+        const float *p = planes[plane];
+        float distance = p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3];
+        float boxRadius = fabs(p[0]) * extents[0] + fabs(p[1]) * extents[1] + fabs(p[2]) * extents[2];
+
+        if(distance < -boxRadius) return false;
+    }
+
+    return true;
+}
+
+size_t FrustumCuller::cullScalar(const float planes[6][4], unsigned char *visible) const
+{
+    return cullRange(planes, visible, 0, size());
+}
+
+size_t FrustumCuller::cull(const float planes[6][4], unsigned char *visible) const
+{
+#ifdef FRUSTUM_CULLER_SSE
+    size_t count = size(), blocks = count / 4 * 4, visibleCount = 0;
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+    /* The planes, broadcasted once */
+    __m128 a[6], b[6], c[6], d[6], absA[6], absB[6], absC[6];
+    for(int plane = 0;plane < 6;plane++) {
+        a[plane] = _mm_set1_ps(planes[plane][0]);
+        b[plane] = _mm_set1_ps(planes[plane][1]);
+        c[plane] = _mm_set1_ps(planes[plane][2]);
+        d[plane] = _mm_set1_ps(planes[plane][3]);
+
+        absA[plane] = _mm_and_ps(a[plane], signMask);
+        absB[plane] = _mm_and_ps(b[plane], signMask);
+        absC[plane] = _mm_and_ps(c[plane], signMask);
+    }
+
+    for(size_t i = 0;i < blocks;i += 4) {
+        __m128 x = _mm_loadu_ps(&m_centerX[i]), y = _mm_loadu_ps(&m_centerY[i]), z = _mm_loadu_ps(&m_centerZ[i]),
+               ex = _mm_loadu_ps(&m_extentX[i]), ey = _mm_loadu_ps(&m_extentY[i]), ez = _mm_loadu_ps(&m_extentZ[i]),
+               radius = _mm_loadu_ps(&m_radius[i]);
+
+        __m128 outside = _mm_setzero_ps();
+        for(int plane = 0;plane < 6;plane++) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a[plane], x), _mm_mul_ps(b[plane], y)), _mm_mul_ps(c[plane], z)), d[plane]); // Same order as the scalar kernel
+            __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absA[plane], ex), _mm_mul_ps(absB[plane], ey)), _mm_mul_ps(absC[plane], ez));
+            __m128 bound = _mm_sub_ps(_mm_setzero_ps(), _mm_min_ps(boxRadius, radius));
+
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, bound));
+        }
+
+        int mask = ~_mm_movemask_ps(outside) & 0xF; // Bit j : volume i + j is visible
+        visible[i]      = mask & 1;
+        visible[i + 1]  = (mask >> 1) & 1;
+        visible[i + 2]  = (mask >> 2) & 1;
+        visible[i + 3]  = (mask >> 3) & 1;
+        visibleCount += visible[i] + visible[i + 1] + visible[i + 2] + visible[i + 3];
+    }
+
+    return visibleCount + cullRange(planes, visible, blocks, count);
+#else
+    return cullScalar(planes, visible);
+#endif
+}
+
+FrustumCuller::~FrustumCuller()
+{
+    //dtor
+}
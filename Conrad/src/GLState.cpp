@@ -0,0 +1,291 @@
+#include "GLState.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+
+using namespace std;
+
+GLState::State GLState::s_program = {false, 0};
+GLState::State GLState::s_vertexArray = {false, 0};
+GLState::State GLState::s_activeTexture = {false, 0};
+GLState::State GLState::s_framebuffer = {false, 0};
+GLState::State GLState::s_textures[GLSTATE_TEXTURE_UNITS][3];
+GLState::State GLState::s_capabilities[3];
+GLState::State GLState::s_cullFace = {false, 0};
+GLState::State GLState::s_depthFunc = {false, 0};
+GLState::State GLState::s_depthMask = {false, 0};
+GLState::State GLState::s_polygonMode = {false, 0};
+
+bool GLState::s_viewportKnown = false;
+bool GLState::s_blendFuncKnown = false;
+GLint GLState::s_viewport[4];
+GLenum GLState::s_blendFunc[2];
+
+unsigned long long GLState::s_issued[CALL_COUNT];
+unsigned long long GLState::s_filtered[CALL_COUNT];
+unsigned long long GLState::s_frameIssued[CALL_COUNT];
+unsigned long long GLState::s_frameFiltered[CALL_COUNT];
+
+bool GLState::filter(Call call, bool redundant)
+{
+    if(redundant)   s_filtered[call]++;
+    else            s_issued[call]++;
+
+    return redundant;
+}
+
+int GLState::capabilityIndex(GLenum capability)
+{
+    switch(capability) {
+        case GL_CULL_FACE:  return 0;
+        case GL_BLEND:      return 1;
+        case GL_DEPTH_TEST: return 2;
+        default:            return -1;
+    }
+}
+
+int GLState::targetIndex(GLenum target)
+{
+    switch(target) {
+        case GL_TEXTURE_2D:         return 0;
+        case GL_TEXTURE_CUBE_MAP:   return 1;
+        case GL_TEXTURE_2D_ARRAY:   return 2;
+        default:                    return -1;
+    }
+}
+
+void GLState::useProgram(GLuint program)
+{
+    if(filter(PROGRAM, s_program.known && s_program.value == program)) return;
+
+    glUseProgram(program);
+    s_program.known = true;
+    s_program.value = program;
+}
+
+void GLState::bindVertexArray(GLuint vertexArray)
+{
+    if(filter(VERTEX_ARRAY, s_vertexArray.known && s_vertexArray.value == vertexArray)) return;
+
+    glBindVertexArray(vertexArray);
+    s_vertexArray.known = true;
+    s_vertexArray.value = vertexArray;
+}
+
+void GLState::activeTexture(GLuint unit)
+{
+    if(filter(ACTIVE_TEXTURE, s_activeTexture.known && s_activeTexture.value == unit)) return;
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    s_activeTexture.known = true;
+    s_activeTexture.value = unit;
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture)
+{
+    int index = targetIndex(target);
+    State *state = (s_activeTexture.known && s_activeTexture.value < GLSTATE_TEXTURE_UNITS && index >= 0) ? &s_textures[s_activeTexture.value][index] : nullptr;
+
+    if(filter(TEXTURE, state != nullptr && state->known && state->value == texture)) return;
+
+    glBindTexture(target, texture);
+    if(state != nullptr) {
+        state->known = true;
+        state->value = texture;
+    }
+}
+
+void GLState::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    int index = targetIndex(target);
+    if(unit < GLSTATE_TEXTURE_UNITS && index >= 0 && s_textures[unit][index].known && s_textures[unit][index].value == texture) {
+        filter(TEXTURE, true); // Already there : no need to change the active unit either
+        return;
+    }
+
+    activeTexture(unit);
+    bindTexture(target, texture);
+}
+
+void GLState::bindFramebuffer(GLuint framebuffer)
+{
+    if(filter(FRAMEBUFFER, s_framebuffer.known && s_framebuffer.value == framebuffer)) return;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    s_framebuffer.known = true;
+    s_framebuffer.value = framebuffer;
+}
+
+void GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if(filter(VIEWPORT, s_viewportKnown && s_viewport[0] == x && s_viewport[1] == y && s_viewport[2] == width && s_viewport[3] == height)) return;
+
+    glViewport(x, y, width, height);
+    s_viewportKnown = true;
+    s_viewport[0] = x;
+    s_viewport[1] = y;
+    s_viewport[2] = width;
+    s_viewport[3] = height;
+}
+
+void GLState::enable(GLenum capability)
+{
+    int index = capabilityIndex(capability);
+    if(filter(CAPABILITY, index >= 0 && s_capabilities[index].known && s_capabilities[index].value == GL_TRUE)) return;
+
+    glEnable(capability);
+    if(index >= 0) {
+        s_capabilities[index].known = true;
+        s_capabilities[index].value = GL_TRUE;
+    }
+}
+
+void GLState::disable(GLenum capability)
+{
+    int index = capabilityIndex(capability);
+    if(filter(CAPABILITY, index >= 0 && s_capabilities[index].known && s_capabilities[index].value == GL_FALSE)) return;
+
+    glDisable(capability);
+    if(index >= 0) {
+        s_capabilities[index].known = true;
+        s_capabilities[index].value = GL_FALSE;
+    }
+}
+
+void GLState::cullFace(GLenum mode)
+{
+    if(filter(CULL_FACE, s_cullFace.known && s_cullFace.value == mode)) return;
+
+    glCullFace(mode);
+    s_cullFace.known = true;
+    s_cullFace.value = mode;
+}
+
+void GLState::blendFunc(GLenum source, GLenum destination)
+{
+    if(filter(BLEND_FUNC, s_blendFuncKnown && s_blendFunc[0] == source && s_blendFunc[1] == destination)) return;
+
+    glBlendFunc(source, destination);
+    s_blendFuncKnown = true;
+    s_blendFunc[0] = source;
+    s_blendFunc[1] = destination;
+}
+
+void GLState::depthFunc(GLenum function)
+{
+    if(filter(DEPTH_FUNC, s_depthFunc.known && s_depthFunc.value == function)) return;
+
+    glDepthFunc(function);
+    s_depthFunc.known = true;
+    s_depthFunc.value = function;
+}
+
+void GLState::depthMask(GLboolean mask)
+{
+    if(filter(DEPTH_MASK, s_depthMask.known && s_depthMask.value == mask)) return;
+
+    glDepthMask(mask);
+    s_depthMask.known = true;
+    s_depthMask.value = mask;
+}
+
+void GLState::polygonMode(GLenum mode)
+{
+    if(filter(POLYGON_MODE, s_polygonMode.known && s_polygonMode.value == mode)) return;
+
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+    s_polygonMode.known = true;
+    s_polygonMode.value = mode;
+}
+
+/* Deletion : GL binds 0 in place of a deleted object */
+
+void GLState::forgetProgram(GLuint program)
+{
+    if(s_program.known && s_program.value == program) s_program.known = false; // A deleted program stays in use until another one is
+}
+
+void GLState::forgetVertexArray(GLuint vertexArray)
+{
+    if(s_vertexArray.known && s_vertexArray.value == vertexArray) s_vertexArray.value = 0;
+}
+
+void GLState::forgetTexture(GLuint texture)
+{
+    for(size_t unit = 0;unit < GLSTATE_TEXTURE_UNITS;unit++) {
+        for(size_t target = 0;target < 3;target++) {
+            if(s_textures[unit][target].known && s_textures[unit][target].value == texture) s_textures[unit][target].value = 0;
+        }
+    }
+}
+
+void GLState::forgetFramebuffer(GLuint framebuffer)
+{
+    if(s_framebuffer.known && s_framebuffer.value == framebuffer) s_framebuffer.value = 0;
+}
+
+void GLState::invalidate()
+{
+    s_program.known = s_vertexArray.known = s_activeTexture.known = s_framebuffer.known = false;
+    s_cullFace.known = s_depthFunc.known = s_depthMask.known = s_polygonMode.known = false;
+    s_viewportKnown = s_blendFuncKnown = false;
+
+    for(size_t unit = 0;unit < GLSTATE_TEXTURE_UNITS;unit++) {
+        for(size_t target = 0;target < 3;target++) s_textures[unit][target].known = false;
+    }
+    for(size_t i = 0;i < 3;i++) s_capabilities[i].known = false;
+}
+
+/* Stats */
+
+void GLState::endFrame()
+{
+    memcpy(s_frameIssued, s_issued, sizeof(s_issued));
+    memcpy(s_frameFiltered, s_filtered, sizeof(s_filtered));
+    memset(s_issued, 0, sizeof(s_issued));
+    memset(s_filtered, 0, sizeof(s_filtered));
+}
+
+unsigned long long GLState::getIssued()
+{
+    unsigned long long total = 0;
+    for(int call = 0;call < CALL_COUNT;call++) total += s_issued[call];
+    return total;
+}
+
+unsigned long long GLState::getFrameIssued(Call call)
+{
+    return s_frameIssued[call];
+}
+
+unsigned long long GLState::getFrameFiltered(Call call)
+{
+    return s_frameFiltered[call];
+}
+
+unsigned long long GLState::getFrameIssued()
+{
+    unsigned long long total = 0;
+    for(int call = 0;call < CALL_COUNT;call++) total += s_frameIssued[call];
+    return total;
+}
+
+unsigned long long GLState::getFrameFiltered()
+{
+    unsigned long long total = 0;
+    for(int call = 0;call < CALL_COUNT;call++) total += s_frameFiltered[call];
+    return total;
+}
+
+void GLState::report()
+{
+    static const char *names[CALL_COUNT] = {"program", "vertex array", "active texture", "texture", "framebuffer", "viewport",
+                                            "capability", "cull face", "blend func", "depth func", "depth mask", "polygon mode"};
+
+    cout << "(GLState) Last frame : " << getFrameIssued() << " state calls issued, " << getFrameFiltered() << " filtered" << endl;
+    for(int call = 0;call < CALL_COUNT;call++) {
+        if(s_frameIssued[call] + s_frameFiltered[call] == 0) continue;
+        cout << "    " << left << setw(16) << names[call] << right << setw(6) << s_frameIssued[call] << " issued | " << setw(6) << s_frameFiltered[call] << " filtered" << endl;
+    }
+}
@@ -0,0 +1,57 @@
+#include "GPUTimer.h"
+
+GPUTimer::GPUTimer()
+{
+    // The queries are generated by the first begin() : there may be no context yet
+}
+
+/// \brief GL 3.3 or ARB_timer_query. Checked through GLEW on Windows : its entry points are null otherwise.
+bool GPUTimer::isAvailable()
+{
+    #ifdef WIN32
+        return GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    #else
+        return true; // Linked against the GL 3.3 core headers
+    #endif // WIN32
+}
+
+void GPUTimer::begin()
+{
+    if(!isAvailable()) return;
+    if(m_queries[0] == 0) glGenQueries(GPU_TIMER_QUERIES, m_queries);
+
+    /* The query about to be reused was issued GPU_TIMER_QUERIES frames ago : its result is read first */
+    if(m_issued >= GPU_TIMER_QUERIES) {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(m_queries[m_next], GL_QUERY_RESULT, &elapsed);
+
+        m_time = elapsed / 1000000.0; // Nanoseconds
+        m_read++;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+}
+
+void GPUTimer::end()
+{
+    if(!isAvailable()) return;
+    glEndQuery(GL_TIME_ELAPSED);
+
+    m_next = (m_next + 1) % GPU_TIMER_QUERIES;
+    m_issued++;
+}
+
+double GPUTimer::getTime()
+{
+    return m_time;
+}
+
+unsigned long long GPUTimer::getCount()
+{
+    return m_read;
+}
+
+GPUTimer::~GPUTimer()
+{
+    if(m_queries[0] != 0) glDeleteQueries(GPU_TIMER_QUERIES, m_queries);
+}
@@ -18,12 +18,13 @@ void GUIRenderer::load()
 
     /* Setting up VAO */
     if(glIsVertexArray(m_vaoID) == GL_TRUE) {
+        GLState::forgetVertexArray(m_vaoID);
         glDeleteVertexArrays(1, &m_vaoID);
     }
 
     glGenVertexArrays(1, &m_vaoID);
 
-    glBindVertexArray(m_vaoID);
+    GLState::bindVertexArray(m_vaoID);
 
     /* Linking VAO and VBO */
         glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
@@ -38,7 +39,7 @@ void GUIRenderer::load()
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
 }
 
 void GUIRenderer::addGUIObject(AbstractGUIObject *object)
@@ -60,13 +61,13 @@ void GUIRenderer::addGUIObject(AbstractGUIObject *object)
         datas[4*i + 3]  = tex[2*i+1];
     }
 
-    glBindVertexArray(m_vaoID);
+    GLState::bindVertexArray(m_vaoID);
     glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
 
         glBufferData(GL_ARRAY_BUFFER, 2*size, datas, GL_STATIC_DRAW);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
 
     //free(datas);
 
@@ -87,10 +88,10 @@ void GUIRenderer::render()
 {
     // NOTE (IMPORTANT) : GUI FACES MUST BE CORRECTLY ORIENTED SO THAT CULLING DON'T INTERFERE
     // FOR NOW, CULLING IS JUST DISABLED DURING GUI RENDER TIME
-    glDisable(GL_CULL_FACE);
+    GLState::disable(GL_CULL_FACE);
 
     m_shader.bind();
-    glBindVertexArray(m_vaoID); // Using the VAO
+    GLState::bindVertexArray(m_vaoID); // Using the VAO
     // Each draw call will bind the associated texture if necessary.
 
         for(auto it = m_guiObjects.begin();it != m_guiObjects.end();it++) {
@@ -98,10 +99,10 @@ void GUIRenderer::render()
             (*it)->draw();
         }
 
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
     m_shader.unbind();
 
-    glEnable(GL_CULL_FACE);
+    GLState::enable(GL_CULL_FACE);
 }
 
 GUIRenderer::~GUIRenderer()
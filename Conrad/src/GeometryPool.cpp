@@ -0,0 +1,200 @@
+#include "GeometryPool.h"
+
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+map<int, vector<GeometryPool::Page *> > GeometryPool::s_pages;
+
+void GeometryPool::setAttributePointers(const VertexLayout &layout, GLintptr offset)
+{
+    for(const VertexLayout::Attribute &attribute : layout.getAttributes()) {
+        GLenum type = GL_FLOAT;
+        GLboolean normalized = GL_TRUE;
+
+        switch(attribute.encoding) {
+            case VertexLayout::FLOAT:   type = GL_FLOAT;            normalized = GL_FALSE;  break;
+            case VertexLayout::HALF:    type = GL_HALF_FLOAT;       normalized = GL_FALSE;  break;
+            case VertexLayout::UNORM16: type = GL_UNSIGNED_SHORT;   break;
+            case VertexLayout::SNORM16: type = GL_SHORT;            break;
+            case VertexLayout::UNORM8:  type = GL_UNSIGNED_BYTE;    break;
+        }
+
+        glVertexAttribPointer(attribute.location, attribute.components, type, normalized, layout.getStride(), BUFFER_OFFSET(offset + attribute.offset));
+        glEnableVertexAttribArray(attribute.location);
+    }
+}
+
+/*!
+ *  \brief Finds a page of the layout with room for both ranges (the first one, pages are filled in order), or creates one.
+ */
+bool GeometryPool::allocate(const VertexLayout &layout, size_t vertexCount, size_t indexCount, Range &range)
+{
+    if(vertexCount == 0 || indexCount == 0) {
+        return false;
+    }
+
+    vector<Page *> &pages = s_pages[layout.getKey()];
+    size_t pageIndex = pages.size();
+
+    for(size_t i = 0;i < pages.size() && pageIndex == pages.size();i++) {
+        if(pages[i] == nullptr || pages[i]->vertices.getLargestFree() < vertexCount || pages[i]->indices.getLargestFree() < indexCount) continue;
+        pageIndex = i;
+    }
+
+    if(pageIndex == pages.size()) {
+        Page *page = createPage(layout, max(vertexCount, (size_t) GEOMETRY_POOL_PAGE_VERTICES), max(indexCount, (size_t) GEOMETRY_POOL_PAGE_INDICES));
+        if(page == nullptr) return false;
+
+        pageIndex = find(pages.begin(), pages.end(), (Page *) nullptr) - pages.begin();
+        if(pageIndex == pages.size()) pages.push_back(page);
+        else                          pages[pageIndex] = page;
+    }
+
+    Page *page = pages[pageIndex];
+    range.layout = layout.getKey();
+    range.page = pageIndex;
+    range.vertexArray = page->vaoID;
+    range.firstVertex = page->vertices.allocate(vertexCount);
+    range.vertexCount = vertexCount;
+    range.firstIndex = page->indices.allocate(indexCount);
+    range.indexCount = indexCount;
+
+    return true;
+}
+
+GeometryPool::Page *GeometryPool::createPage(const VertexLayout &layout, size_t vertexCapacity, size_t indexCapacity)
+{
+    Page *page = new Page;
+    page->layout = layout;
+    page->vertices.reset(vertexCapacity);
+    page->indices.reset(indexCapacity);
+
+    glGenBuffers(1, &page->vboID);
+    glBindBuffer(GL_ARRAY_BUFFER, page->vboID);
+    glBufferData(GL_ARRAY_BUFFER, vertexCapacity * layout.getStride(), nullptr, GL_STATIC_DRAW);
+
+    glGenVertexArrays(1, &page->vaoID);
+    GLState::bindVertexArray(page->vaoID);
+        setAttributePointers(layout);
+
+        // The element buffer binding is part of the VAO state
+        glGenBuffers(1, &page->eboID);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->eboID);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+    GLState::bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if(glGetError() == GL_OUT_OF_MEMORY) {
+        cout << "(GeometryPool) Out of memory for a page of " << vertexCapacity << " vertices" << endl;
+        deletePage(page);
+        return nullptr;
+    }
+
+    return page;
+}
+
+void GeometryPool::deletePage(Page *page)
+{
+    glDeleteBuffers(1, &page->vboID);
+    glDeleteBuffers(1, &page->eboID);
+    GLState::forgetVertexArray(page->vaoID);
+    glDeleteVertexArrays(1, &page->vaoID);
+    delete page;
+}
+
+/// \brief Written through GL_COPY_WRITE_BUFFER : the bound VAO isn't touched.
+void GeometryPool::uploadVertices(const Range &range, const void *vertices)
+{
+    if(range.layout < 0 || vertices == nullptr) return;
+
+    Page *page = s_pages[range.layout][range.page];
+    size_t stride = page->layout.getStride();
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page->vboID);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstVertex * stride, range.vertexCount * stride, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GeometryPool::uploadIndices(const Range &range, const void *indices, GLenum indexType)
+{
+    if(range.layout < 0) return;
+
+    const void *data = indices;
+    vector<GLuint> widened;
+    if(indices == nullptr || indexType == GL_UNSIGNED_SHORT) {
+        widened.resize(range.indexCount);
+        for(size_t i = 0;i < range.indexCount;i++) widened[i] = (indices == nullptr) ? i : ((const GLushort *) indices)[i];
+        data = widened.data();
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, s_pages[range.layout][range.page]->eboID);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstIndex * sizeof(GLuint), range.indexCount * sizeof(GLuint), data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GeometryPool::free(Range &range)
+{
+    if(range.layout < 0) return;
+
+    vector<Page *> &pages = s_pages[range.layout];
+    Page *page = pages[range.page];
+    page->vertices.free(range.firstVertex);
+    page->indices.free(range.firstIndex);
+
+    if(page->vertices.isEmpty()) {
+        deletePage(page);
+        pages[range.page] = nullptr;
+    }
+
+    range = Range();
+}
+
+GeometryPool::Stats GeometryPool::getStats(const VertexLayout &layout)
+{
+    Stats stats;
+
+    for(Page *page : s_pages[layout.getKey()]) {
+        if(page == nullptr) continue;
+
+        RangeAllocator::Stats vertices = page->vertices.getStats(), indices = page->indices.getStats();
+        stats.pages++;
+        stats.ranges += vertices.allocations;
+        stats.bytes += vertices.capacity * layout.getStride() + indices.capacity * sizeof(GLuint);
+
+        stats.vertices.capacity += vertices.capacity;
+        stats.vertices.used += vertices.used;
+        stats.vertices.allocations += vertices.allocations;
+        stats.vertices.freeBlocks += vertices.freeBlocks;
+        stats.vertices.largestFree = max(stats.vertices.largestFree, vertices.largestFree);
+
+        stats.indices.capacity += indices.capacity;
+        stats.indices.used += indices.used;
+        stats.indices.allocations += indices.allocations;
+        stats.indices.freeBlocks += indices.freeBlocks;
+        stats.indices.largestFree = max(stats.indices.largestFree, indices.largestFree);
+    }
+
+    /* Over the whole pool : the free space a single range can't use */
+    size_t freeVertices = stats.vertices.capacity - stats.vertices.used, freeIndices = stats.indices.capacity - stats.indices.used;
+    if(freeVertices > 0) stats.vertices.fragmentation = 1.0f - (float) stats.vertices.largestFree / freeVertices;
+    if(freeIndices > 0) stats.indices.fragmentation = 1.0f - (float) stats.indices.largestFree / freeIndices;
+
+    return stats;
+}
+
+void GeometryPool::report()
+{
+    for(map<int, vector<Page *> >::iterator pages = s_pages.begin();pages != s_pages.end();pages++) {
+        vector<Page *>::iterator page = find_if(pages->second.begin(), pages->second.end(), [](Page *page) { return page != nullptr; });
+        if(page == pages->second.end()) continue;
+
+        const VertexLayout &layout = (*page)->layout;
+        Stats stats = getStats(layout);
+
+        cout << "(GeometryPool) " << layout.getName() << " (" << layout.getStride() << " bytes) : " << stats.ranges << " meshes in " << stats.pages << " pages (" << stats.bytes / 1024 << " KiB) | vertices "
+             << stats.vertices.used << "/" << stats.vertices.capacity << ", " << stats.vertices.freeBlocks << " free blocks, " << (int) (100 * stats.vertices.fragmentation) << "% fragmented | indices "
+             << stats.indices.used << "/" << stats.indices.capacity << ", " << stats.indices.freeBlocks << " free blocks, " << (int) (100 * stats.indices.fragmentation) << "% fragmented" << endl;
+    }
+}
@@ -0,0 +1,176 @@
+#include "InstancedMesh.h"
+
+#include <cstring>
+#include <cstddef>
+
+using namespace std;
+
+InstancedMesh::InstancedMesh(int bufferCount, float *vertices, float *colors, float *texCoords, float *vertexNormals) :
+    StaticMesh(bufferCount, vertices, colors, texCoords, vertexNormals)
+{
+    setSharedBuffersEnabled(false); // The instance attributes are added to its VAO
+
+    /* The positions and normals go through the instance matrices in the shaders : no decoding step there */
+    setVertexLayout(VertexLayout(VertexLayout::POSITIONS_FLOAT, VertexLayout::NORMALS_FLOAT, VertexLayout::TEXCOORDS_HALF, VertexLayout::COLORS_UNORM8));
+}
+
+size_t InstancedMesh::addInstance(const glm::mat4 &modelview)
+{
+    m_instances.push_back(modelview);
+    m_instancesDirty = true;
+    m_revision++;
+
+    return m_instances.size() - 1;
+}
+
+void InstancedMesh::setInstance(size_t instance, const glm::mat4 &modelview)
+{
+    m_instances[instance] = modelview;
+    m_instancesDirty = true;
+    m_revision++;
+}
+
+const glm::mat4 &InstancedMesh::getInstance(size_t instance)
+{
+    return m_instances[instance];
+}
+
+size_t InstancedMesh::getInstanceCount()
+{
+    return m_instances.size();
+}
+
+void InstancedMesh::clearInstances()
+{
+    m_instances.clear();
+    m_instancesDirty = true;
+    m_revision++;
+}
+
+/// \brief Loads the mesh, then adds the per-instance attributes to its VAO (advanced once per instance).
+void InstancedMesh::load()
+{
+    AbstractMesh::load();
+
+    if(glIsBuffer(m_instanceVboID) == GL_TRUE) {
+        glDeleteBuffers(1, &m_instanceVboID);
+    }
+    glGenBuffers(1, &m_instanceVboID);
+    m_instanceCapacity = 0;
+    m_instancesDirty = true;
+
+    GLState::bindVertexArray(getVertexArrayID());
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVboID);
+            for(int column = 0;column < 4;column++) { // A matrix attribute takes one location per column
+                glVertexAttribPointer(INSTANCE_MODELVIEW_BUFFER + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), BUFFER_OFFSET(offsetof(InstanceData, modelview) + 4 * column * sizeof(float)));
+                glEnableVertexAttribArray(INSTANCE_MODELVIEW_BUFFER + column);
+                glVertexAttribDivisor(INSTANCE_MODELVIEW_BUFFER + column, 1);
+            }
+
+            for(int column = 0;column < 3;column++) {
+                glVertexAttribPointer(INSTANCE_NORMAL_BUFFER + column, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), BUFFER_OFFSET(offsetof(InstanceData, normalMatrix) + 3 * column * sizeof(float)));
+                glEnableVertexAttribArray(INSTANCE_NORMAL_BUFFER + column);
+                glVertexAttribDivisor(INSTANCE_NORMAL_BUFFER + column, 1);
+            }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState::bindVertexArray(0);
+}
+
+/// \brief Sends the instances to the GPU if they changed. The buffer only grows (doubling) : a steady set of instances doesn't reallocate.
+void InstancedMesh::uploadInstances()
+{
+    m_instanceData.resize(m_instances.size());
+    for(size_t i = 0;i < m_instances.size();i++) {
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(m_instances[i])));
+        memcpy(m_instanceData[i].modelview, glm::value_ptr(m_instances[i]), sizeof(m_instanceData[i].modelview));
+        memcpy(m_instanceData[i].normalMatrix, glm::value_ptr(normalMatrix), sizeof(m_instanceData[i].normalMatrix));
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVboID);
+        if(m_instances.size() > m_instanceCapacity) {
+            m_instanceCapacity = std::max(m_instances.size(), 2 * m_instanceCapacity);
+            glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+        }
+
+        if(!m_instanceData.empty()) glBufferSubData(GL_ARRAY_BUFFER, 0, m_instanceData.size() * sizeof(InstanceData), &m_instanceData[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_instancesDirty = false;
+}
+
+void InstancedMesh::drawBound()
+{
+    if(m_instances.empty()) return;
+    if(m_instancesDirty) uploadInstances();
+
+    if(getIndicesCount() > 0)   glDrawElementsInstanced(GL_TRIANGLES, getIndicesCount(), getIndexType(), BUFFER_OFFSET(0), m_instances.size());
+    else                        glDrawArraysInstanced(GL_TRIANGLES, 0, getVerticesCount(), m_instances.size());
+}
+
+bool InstancedMesh::isInstanced()
+{
+    return true;
+}
+
+/// \brief Union of the world AABBs of the instances (model bounds through get_modelview() * instance). Recomputed when either changed.
+bool InstancedMesh::updateWorldBounds()
+{
+    if(m_boundsValid && m_boundsRevision == m_revision && m_boundsModelview == m_modelview) {
+        return false;
+    }
+
+    glm::vec3   center = 0.5f * (getBoundsMin() + getBoundsMax()),
+                extents = 0.5f * (getBoundsMax() - getBoundsMin());
+    glm::vec3   worldMin(0.0), worldMax(0.0);
+
+    for(size_t i = 0;i < m_instances.size();i++) {
+        glm::mat4 world = m_modelview * m_instances[i];
+
+        glm::vec3 instanceCenter = glm::vec3(world * glm::vec4(center, 1.0)), instanceExtents;
+        for(int row = 0;row < 3;row++) {
+            instanceExtents[row] = fabs(world[0][row]) * extents[0] + fabs(world[1][row]) * extents[1] + fabs(world[2][row]) * extents[2];
+        }
+
+        if(i == 0) {
+            worldMin = instanceCenter - instanceExtents;
+            worldMax = instanceCenter + instanceExtents;
+        } else {
+            worldMin = glm::min(worldMin, instanceCenter - instanceExtents);
+            worldMax = glm::max(worldMax, instanceCenter + instanceExtents);
+        }
+    }
+
+    glm::vec3 worldExtents = 0.5f * (worldMax - worldMin);
+    setWorldBounds(0.5f * (worldMin + worldMax), worldExtents, glm::length(worldExtents)); // The sphere of the union box
+    if(m_boundsModelview != m_modelview) updateNormalMatrix();
+
+    m_boundsModelview = m_modelview;
+    m_boundsRevision = m_revision;
+    m_boundsValid = true;
+    return true;
+}
+
+bool InstancedMesh::intersectRay(const glm::vec3 &origin, const glm::vec3 &direction, float &t, unsigned int &triangle)
+{
+    bool hit = false;
+
+    for(size_t i = 0;i < m_instances.size();i++) {
+        glm::mat4 inverseWorld = glm::inverse(m_modelview * m_instances[i]);
+
+        float distance;
+        unsigned int instanceTriangle;
+        if(intersectLocalRay(glm::vec3(inverseWorld * glm::vec4(origin, 1.0)), glm::vec3(inverseWorld * glm::vec4(direction, 0.0)), distance, instanceTriangle)
+           && (!hit || distance < t)) {
+            t = distance;
+            triangle = i * getTriangleCount() + instanceTriangle;
+            hit = true;
+        }
+    }
+
+    return hit;
+}
+
+InstancedMesh::~InstancedMesh()
+{
+    glDeleteBuffers(1, &m_instanceVboID);
+}
@@ -0,0 +1,151 @@
+#include "MappedFile.h"
+
+#ifdef WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile()
+{
+    //ctor
+}
+
+MappedFile::MappedFile(string filepath)
+{
+    open(filepath);
+}
+
+/// \return true if the file could be mapped. An empty file is considered opened, with a null data pointer and a size of 0.
+bool MappedFile::open(string filepath)
+{
+    close();
+
+#ifdef WIN32
+    HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER filesize;
+    if(!GetFileSizeEx(file, &filesize)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_fileHandle = file;
+    m_size = (size_t) filesize.QuadPart;
+
+    if(m_size == 0) { // Windows can't map an empty file
+        m_open = true;
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping == NULL) {
+        close();
+        return false;
+    }
+    m_mappingHandle = mapping;
+
+    m_data = (const char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(m_data == nullptr) {
+        close();
+        return false;
+    }
+#else
+    m_fd = ::open(filepath.c_str(), O_RDONLY);
+    if(m_fd < 0) {
+        return false;
+    }
+
+    struct stat infos;
+    if(fstat(m_fd, &infos) != 0) {
+        close();
+        return false;
+    }
+
+    m_size = (size_t) infos.st_size;
+
+    if(m_size == 0) { // mmap refuses empty mappings
+        m_open = true;
+        return true;
+    }
+
+    void *mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if(mapping == MAP_FAILED) {
+        close();
+        return false;
+    }
+
+    madvise(mapping, m_size, MADV_SEQUENTIAL); // Parsers read the files front to back
+    m_data = (const char *) mapping;
+#endif
+
+    m_open = true;
+    return true;
+}
+
+/*!
+ *  \brief Drops the pages of [begin; end) from the process working set once they have been consumed (uploaded, copied, ...).
+ *  The data stays valid : the pages are read again from the file if they are accessed later. Only whole pages are released.
+ */
+void MappedFile::release(const char *begin, const char *end)
+{
+    if(m_data == nullptr || begin < m_data || end > m_data + m_size || begin >= end) {
+        return;
+    }
+
+#ifdef WIN32
+    SYSTEM_INFO infos;
+    GetSystemInfo(&infos);
+    size_t pageSize = infos.dwPageSize;
+#else
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+#endif
+
+    /* Whole pages inside the range only : the neighbouring data may still be in use */
+    size_t first = ((begin - m_data) + pageSize - 1) / pageSize * pageSize,
+           last = (end - m_data) / pageSize * pageSize;
+    if(end == m_data + m_size) last = m_size; // The last page can go with the end of the file
+    if(first >= last) return;
+
+#ifdef WIN32
+    VirtualUnlock((LPVOID) (m_data + first), last - first); // Unlocking pages that aren't locked removes them from the working set
+#else
+    madvise((void *) (m_data + first), last - first, MADV_DONTNEED);
+#endif
+}
+
+/// \brief Unmaps the file. Every pointer previously returned by data() becomes invalid.
+void MappedFile::close()
+{
+#ifdef WIN32
+    if(m_data != nullptr)           UnmapViewOfFile(m_data);
+    if(m_mappingHandle != nullptr)  CloseHandle((HANDLE) m_mappingHandle);
+    if(m_fileHandle != nullptr)     CloseHandle((HANDLE) m_fileHandle);
+
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+#else
+    if(m_data != nullptr)   munmap((void *) m_data, m_size);
+    if(m_fd >= 0)           ::close(m_fd);
+
+    m_fd = -1;
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_open = false;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
@@ -0,0 +1,161 @@
+#include "MeshBatcher.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+namespace
+{
+    /* 10 bits per axis */
+    unsigned int spreadBits(unsigned int value)
+    {
+        value &= 0x3FF;
+        value = (value | (value << 16)) & 0x030000FF;
+        value = (value | (value << 8)) & 0x0300F00F;
+        value = (value | (value << 4)) & 0x030C30C3;
+        value = (value | (value << 2)) & 0x09249249;
+        return value;
+    }
+
+    unsigned int sourceIndex(const MeshBatcher::Source &source, int i)
+    {
+        if(source.indices == nullptr) return i;
+        if(source.shortIndices) return ((const unsigned short *) source.indices)[i];
+        return ((const unsigned int *) source.indices)[i];
+    }
+
+    void appendSource(const MeshBatcher::Source &source, size_t sourceID, MeshBatcher::Batch &batch)
+    {
+        const float *m = source.modelview;
+        unsigned int baseVertex = batch.vertices.size() / 3;
+
+        /* Normals : inverse transpose of the upper 3x3 (cofactors : the determinant only scales, they are normalized) */
+        float normalMatrix[9] = {
+            m[5] * m[10] - m[6] * m[9],     m[6] * m[8] - m[4] * m[10],     m[4] * m[9] - m[5] * m[8],
+            m[2] * m[9] - m[1] * m[10],     m[0] * m[10] - m[2] * m[8],     m[1] * m[8] - m[0] * m[9],
+            m[1] * m[6] - m[2] * m[5],      m[2] * m[4] - m[0] * m[6],      m[0] * m[5] - m[1] * m[4]
+        }; // Column-major, as the modelview
+        float sign = (m[0] * normalMatrix[0] + m[4] * normalMatrix[3] + m[8] * normalMatrix[6] < 0.0f) ? -1.0f : 1.0f; // Mirrored : the cofactors flip the normals
+
+        MeshBatcher::Piece piece;
+        piece.source = sourceID;
+        piece.firstIndex = batch.indices.size();
+        for(int axis = 0;axis < 3;axis++) {
+            piece.boundsMin[axis] = numeric_limits<float>::max();
+            piece.boundsMax[axis] = -numeric_limits<float>::max();
+        }
+
+        for(int i = 0;i < source.verticesCount;i++) {
+            const float *v = source.vertices + 3 * i;
+            for(int row = 0;row < 3;row++) {
+                float value = m[row] * v[0] + m[4 + row] * v[1] + m[8 + row] * v[2] + m[12 + row];
+                batch.vertices.push_back(value);
+                piece.boundsMin[row] = min(piece.boundsMin[row], value);
+                piece.boundsMax[row] = max(piece.boundsMax[row], value);
+            }
+
+            if(source.colors != nullptr)    batch.colors.insert(batch.colors.end(), source.colors + 3 * i, source.colors + 3 * i + 3);
+            else                            batch.colors.insert(batch.colors.end(), 3, 1.0f);
+
+            if(source.texCoords != nullptr) batch.texCoords.insert(batch.texCoords.end(), source.texCoords + 2 * i, source.texCoords + 2 * i + 2);
+            else                            batch.texCoords.insert(batch.texCoords.end(), 2, 0.0f);
+
+            if(source.vertexNormals != nullptr) {
+                const float *n = source.vertexNormals + 3 * i;
+                float normal[3], length = 0.0f;
+                for(int row = 0;row < 3;row++) {
+                    normal[row] = normalMatrix[row] * n[0] + normalMatrix[3 + row] * n[1] + normalMatrix[6 + row] * n[2];
+                    length += normal[row] * normal[row];
+                }
+
+                length = sqrt(length);
+                for(int row = 0;row < 3;row++) batch.vertexNormals.push_back(length > 0.0f ? sign * normal[row] / length : 0.0f);
+            } else {
+                batch.vertexNormals.push_back(0.0f); batch.vertexNormals.push_back(0.0f); batch.vertexNormals.push_back(1.0f);
+            }
+        }
+
+        int indexCount = (source.indices != nullptr) ? source.indicesCount : source.verticesCount;
+        indexCount -= indexCount % 3;
+        for(int i = 0;i < indexCount;i++) batch.indices.push_back(baseVertex + sourceIndex(source, i));
+
+        piece.indexCount = indexCount;
+        batch.pieces.push_back(piece);
+    }
+}
+
+/*!
+ *  \brief The sources are sorted along a Morton curve over the group bounds, then appended in that order, a new batch being started when
+ *  the next source would overflow MESH_BATCH_MAX_VERTICES vertices. The source order of the input isn't kept (see Piece::source).
+ */
+void MeshBatcher::merge(const vector<Source> &sources, vector<Batch> &batches)
+{
+    if(sources.empty()) return;
+
+    /* Centers of the transformed sources (transformed bounds would cost a pass : the centroid of the vertices is close enough for ordering) */
+    vector<float> centers(3 * sources.size(), 0.0f);
+    float groupMin[3], groupMax[3];
+    for(int axis = 0;axis < 3;axis++) {
+        groupMin[axis] = numeric_limits<float>::max();
+        groupMax[axis] = -numeric_limits<float>::max();
+    }
+
+    for(size_t s = 0;s < sources.size();s++) {
+        const Source &source = sources[s];
+        float local[3] = {0.0f, 0.0f, 0.0f};
+        for(int i = 0;i < source.verticesCount;i++) {
+            for(int axis = 0;axis < 3;axis++) local[axis] += source.vertices[3 * i + axis];
+        }
+        for(int axis = 0;axis < 3;axis++) local[axis] /= max(1, source.verticesCount);
+
+        const float *m = source.modelview;
+        for(int row = 0;row < 3;row++) {
+            centers[3 * s + row] = m[row] * local[0] + m[4 + row] * local[1] + m[8 + row] * local[2] + m[12 + row];
+            groupMin[row] = min(groupMin[row], centers[3 * s + row]);
+            groupMax[row] = max(groupMax[row], centers[3 * s + row]);
+        }
+    }
+
+    vector<pair<unsigned int, size_t> > order(sources.size());
+    for(size_t s = 0;s < sources.size();s++) {
+        unsigned int code = 0;
+        for(int axis = 0;axis < 3;axis++) {
+            float extent = groupMax[axis] - groupMin[axis];
+            unsigned int cell = (extent > 0.0f) ? (unsigned int) min(1023.0f, 1023.0f * (centers[3 * s + axis] - groupMin[axis]) / extent) : 0;
+            code |= spreadBits(cell) << axis;
+        }
+        order[s] = make_pair(code, s);
+    }
+    sort(order.begin(), order.end());
+
+    size_t first = batches.size();
+    for(size_t i = 0;i < order.size();i++) {
+        const Source &source = sources[order[i].second];
+
+        if(batches.size() == first || (!batches.back().pieces.empty() && batches.back().vertices.size() / 3 + source.verticesCount > MESH_BATCH_MAX_VERTICES)) {
+            batches.push_back(Batch());
+        }
+
+        appendSource(source, order[i].second, batches.back());
+    }
+}
+
+size_t MeshBatcher::coalesce(const vector<Piece> &pieces, const unsigned char *visible, unsigned int *firsts, int *counts)
+{
+    size_t rangeCount = 0;
+    for(size_t i = 0;i < pieces.size();i++) {
+        if(!visible[i] || pieces[i].indexCount == 0) continue;
+
+        if(rangeCount > 0 && firsts[rangeCount - 1] + counts[rangeCount - 1] == pieces[i].firstIndex) {
+            counts[rangeCount - 1] += pieces[i].indexCount;
+        } else {
+            firsts[rangeCount] = pieces[i].firstIndex;
+            counts[rangeCount] = pieces[i].indexCount;
+            rangeCount++;
+        }
+    }
+
+    return rangeCount;
+}
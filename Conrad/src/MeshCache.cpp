@@ -0,0 +1,251 @@
+#include "MeshCache.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+using namespace std;
+
+unsigned int MeshCache::s_hits = 0;
+unsigned int MeshCache::s_misses = 0;
+
+namespace
+{
+    struct Header {
+        uint32_t magic, version;
+        uint64_t key;
+        uint32_t meshCount, reserved;
+    };
+
+    struct MeshRecord {
+        uint32_t nameLength, materialLength, usesMaterial;
+        uint32_t verticesCount, indicesCount, indexSize;
+        float boundsMin[3], boundsMax[3];
+    };
+
+    inline uint64_t align16(uint64_t offset)
+    {
+        return (offset + 15) & ~(uint64_t) 15;
+    }
+
+    inline uint64_t rotl(uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    /* Writes size bytes and pads the stream up to the next 16 bytes boundary */
+    void writeAligned(ofstream &file, uint64_t &offset, const void *data, uint64_t size)
+    {
+        static const char zeros[16] = {0};
+
+        if(size > 0) file.write((const char *) data, size);
+        offset += size;
+
+        uint64_t padding = align16(offset) - offset;
+        file.write(zeros, padding);
+        offset += padding;
+    }
+}
+
+MeshCache::MeshCache()
+{
+    //ctor
+}
+
+/*!
+ *  \brief Maps the cooked file and checks it was built from the same sources and options.
+ *  \return true (cache hit) if the meshes can be used. false (miss) if the file is missing, stale (other key) or corrupted.
+ */
+bool MeshCache::open(const string &path, uint64_t key)
+{
+    close();
+
+    if(m_file.open(path) && read(key)) {
+        s_hits++;
+        return true;
+    }
+
+    close();
+    s_misses++;
+    return false;
+}
+
+/// \brief Validates the whole file and points every CookedMesh into the mapping. Nothing is read out of the file bounds.
+bool MeshCache::read(uint64_t key)
+{
+    const char *data = m_file.data();
+    uint64_t size = m_file.size();
+
+    Header header;
+    if(size < sizeof(Header)) return false;
+    memcpy(&header, data, sizeof(Header));
+
+    if(header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION || header.key != key) return false;
+
+    uint64_t offset = align16(sizeof(Header));
+    for(uint32_t m = 0;m < header.meshCount;m++) {
+        MeshRecord record;
+        if(offset + sizeof(MeshRecord) > size) return false;
+        memcpy(&record, data + offset, sizeof(MeshRecord));
+        offset += sizeof(MeshRecord);
+
+        if(record.indicesCount > 0 && record.indexSize != 2 && record.indexSize != 4) return false;
+
+        CookedMesh mesh;
+
+        if(offset + record.nameLength + record.materialLength > size) return false;
+        mesh.name.assign(data + offset, record.nameLength);
+        mesh.material.assign(data + offset + record.nameLength, record.materialLength);
+        mesh.usesMaterial = (record.usesMaterial != 0);
+        offset = align16(offset + record.nameLength + record.materialLength);
+
+        mesh.verticesCount = record.verticesCount;
+        mesh.indicesCount = record.indicesCount;
+        mesh.indexSize = record.indexSize;
+        memcpy(mesh.boundsMin, record.boundsMin, sizeof(mesh.boundsMin));
+        memcpy(mesh.boundsMax, record.boundsMax, sizeof(mesh.boundsMax));
+
+        /* Arrays */
+        const float **streams[4] = {&mesh.vertices, &mesh.colors, &mesh.texCoords, &mesh.vertexNormals};
+        const int components[4] = {3, 3, 2, 3};
+
+        for(int s = 0;s < 4;s++) {
+            uint64_t bytes = (uint64_t) record.verticesCount * components[s] * sizeof(float);
+            if(offset + bytes > size) return false;
+
+            *streams[s] = (const float *) (data + offset);
+            offset = align16(offset + bytes);
+        }
+
+        uint64_t indexBytes = (uint64_t) record.indicesCount * record.indexSize;
+        if(offset + indexBytes > size) return false;
+        mesh.indices = (record.indicesCount > 0) ? data + offset : nullptr;
+        offset = align16(offset + indexBytes);
+
+        m_meshes.push_back(mesh);
+    }
+
+    return true;
+}
+
+void MeshCache::close()
+{
+    m_meshes.clear();
+    m_file.close();
+}
+
+const vector<MeshCache::CookedMesh> &MeshCache::getMeshes() const
+{
+    return m_meshes;
+}
+
+/*!
+ *  \brief Writes the meshes to a cooked file (replacing it). Every mesh must have all its streams.
+ *  \return false if a mesh is incomplete or the file can't be written.
+ */
+bool MeshCache::write(const string &path, uint64_t key, const vector<CookedMesh> &meshes)
+{
+    for(size_t m = 0;m < meshes.size();m++) {
+        const CookedMesh &mesh = meshes[m];
+        if(mesh.vertices == nullptr || mesh.colors == nullptr || mesh.texCoords == nullptr || mesh.vertexNormals == nullptr) return false;
+        if(mesh.indicesCount > 0 && (mesh.indices == nullptr || (mesh.indexSize != 2 && mesh.indexSize != 4))) return false;
+    }
+
+    ofstream file(path.c_str(), ios::out | ios::binary | ios::trunc);
+    if(!file) {
+        cout << "(MeshCache) Can't write (" << path << ")" << endl;
+        return false;
+    }
+
+    Header header = {MESH_CACHE_MAGIC, MESH_CACHE_VERSION, key, (uint32_t) meshes.size(), 0};
+    uint64_t offset = 0;
+    writeAligned(file, offset, &header, sizeof(Header));
+
+    for(size_t m = 0;m < meshes.size();m++) {
+        const CookedMesh &mesh = meshes[m];
+
+        MeshRecord record;
+        record.nameLength = mesh.name.size();
+        record.materialLength = mesh.material.size();
+        record.usesMaterial = mesh.usesMaterial ? 1 : 0;
+        record.verticesCount = mesh.verticesCount;
+        record.indicesCount = mesh.indicesCount;
+        record.indexSize = (mesh.indicesCount > 0) ? mesh.indexSize : 0;
+        memcpy(record.boundsMin, mesh.boundsMin, sizeof(record.boundsMin));
+        memcpy(record.boundsMax, mesh.boundsMax, sizeof(record.boundsMax));
+
+        file.write((const char *) &record, sizeof(MeshRecord));
+        offset += sizeof(MeshRecord);
+
+        string names = mesh.name + mesh.material;
+        writeAligned(file, offset, names.data(), names.size());
+
+        writeAligned(file, offset, mesh.vertices, (uint64_t) mesh.verticesCount * 3 * sizeof(float));
+        writeAligned(file, offset, mesh.colors, (uint64_t) mesh.verticesCount * 3 * sizeof(float));
+        writeAligned(file, offset, mesh.texCoords, (uint64_t) mesh.verticesCount * 2 * sizeof(float));
+        writeAligned(file, offset, mesh.vertexNormals, (uint64_t) mesh.verticesCount * 3 * sizeof(float));
+        writeAligned(file, offset, mesh.indices, (uint64_t) record.indicesCount * record.indexSize);
+    }
+
+    if(!file) {
+        cout << "(MeshCache) Error while writing (" << path << ")" << endl;
+        file.close();
+        remove(path.c_str()); // A partial file would only be a miss, but is useless
+        return false;
+    }
+
+    return true;
+}
+
+/// \brief 64 bits content hash (8 bytes per step, MurmurHash3 style mixing). Chain calls through seed to hash several buffers.
+uint64_t MeshCache::hash(const void *data, size_t size, uint64_t seed)
+{
+    const uint64_t c1 = 0x87C37B91114253D5ULL, c2 = 0x4CF5AD432745937FULL;
+    const unsigned char *bytes = (const unsigned char *) data;
+    uint64_t h = seed ^ ((uint64_t) size * c1);
+
+    size_t blocks = size / 8;
+    for(size_t i = 0;i < blocks;i++) {
+        uint64_t k;
+        memcpy(&k, bytes + 8 * i, 8);
+
+        k *= c1; k = rotl(k, 31); k *= c2;
+        h ^= k;
+        h = rotl(h, 27) * 5 + 0x52DCE729;
+    }
+
+    if(size > 8 * blocks) { // Last bytes
+        uint64_t k = 0;
+        memcpy(&k, bytes + 8 * blocks, size - 8 * blocks);
+        k *= c1; k = rotl(k, 31); k *= c2;
+        h ^= k;
+    }
+
+    /* Finalization */
+    h ^= h >> 33; h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33; h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+
+    return h;
+}
+
+string MeshCache::cookedPath(const string &sourcePath)
+{
+    return sourcePath + MESH_CACHE_EXTENSION;
+}
+
+unsigned int MeshCache::getHits()
+{
+    return s_hits;
+}
+
+unsigned int MeshCache::getMisses()
+{
+    return s_misses;
+}
+
+MeshCache::~MeshCache()
+{
+    //dtor
+}
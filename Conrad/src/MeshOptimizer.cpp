@@ -0,0 +1,373 @@
+#include "MeshOptimizer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+
+bool MeshOptimizer::s_enabled = true;
+bool MeshOptimizer::s_report = false;
+
+/*!
+ *  \brief Optimizes an indexed triangle list and its vertex streams for the GPU (vertex cache, then overdraw, then vertex fetch).
+ *  \param streams Every attribute array of the mesh. streams[0] MUST be the positions (3 components). They are reordered in place.
+ *  \return The ACMR/ATVR before and after the optimization.
+ */
+MeshOptimizer::Stats MeshOptimizer::optimize(vector<unsigned int> &indices, size_t vertexCount, const vector<VertexStream> &streams, unsigned int cacheSize)
+{
+    Stats stats;
+    stats.vertices = vertexCount;
+    stats.triangles = indices.size() / 3;
+
+    if(stats.triangles == 0 || indices.size() % 3 != 0) {
+        return stats;
+    }
+
+    for(size_t i = 0;i < indices.size();i++) { // Invalid mesh, nothing is touched
+        if(indices[i] >= vertexCount) return stats;
+    }
+
+    stats.acmrBefore = computeACMR(indices, vertexCount, cacheSize);
+    stats.atvrBefore = computeATVR(indices, vertexCount, cacheSize);
+
+    vector<size_t> clusters;
+    indices = optimizeVertexCache(indices, vertexCount, cacheSize, clusters);
+
+    if(!streams.empty() && streams[0].components >= 3) {
+        optimizeOverdraw(indices, clusters, streams[0].data);
+    }
+
+    optimizeVertexFetch(indices, vertexCount, streams);
+
+    stats.acmrAfter = computeACMR(indices, vertexCount, cacheSize);
+    stats.atvrAfter = computeATVR(indices, vertexCount, cacheSize);
+    stats.clusters = clusters.size();
+    stats.optimized = true;
+
+    return stats;
+}
+
+/*!
+ *  \brief Tipsify : greedily fans around the vertex that is most likely to still be in the cache.
+ *  \param clusters Receives the first triangle of every cluster. A new cluster starts at each dead end (the cache is then lost anyway).
+ *  \return The reordered indices.
+ */
+vector<unsigned int> MeshOptimizer::optimizeVertexCache(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize, vector<size_t> &clusters)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    /* Vertex -> triangles adjacency */
+    vector<unsigned int> offsets(vertexCount + 1, 0);
+    for(size_t i = 0;i < indices.size();i++) offsets[indices[i] + 1]++;
+    for(size_t v = 0;v < vertexCount;v++) offsets[v + 1] += offsets[v];
+
+    vector<unsigned int> adjacency(indices.size());
+    vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for(size_t i = 0;i < indices.size();i++) adjacency[fill[indices[i]]++] = i / 3;
+
+    /* Live triangles per vertex and cache time stamps */
+    vector<int> live(vertexCount);
+    for(size_t v = 0;v < vertexCount;v++) live[v] = offsets[v + 1] - offsets[v];
+
+    vector<long long> cacheTime(vertexCount, 0);
+    vector<char> emitted(triangleCount, 0);
+    vector<unsigned int> deadEnd; // Stack of recently used vertices
+    vector<unsigned int> candidates;
+
+    vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    clusters.clear();
+    clusters.push_back(0);
+
+    long long time = cacheSize + 1;
+    size_t cursor = 0;
+    long long fanning = (vertexCount > 0) ? 0 : -1;
+
+    while(fanning >= 0) {
+        candidates.clear();
+
+        /* Emitting every remaining triangle around the fanning vertex */
+        for(unsigned int a = offsets[fanning];a < offsets[fanning + 1];a++) {
+            unsigned int t = adjacency[a];
+            if(emitted[t]) continue;
+
+            for(int k = 0;k < 3;k++) {
+                unsigned int v = indices[3*t + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+
+                if(time - cacheTime[v] > cacheSize) { // Not in the cache anymore : transformed again
+                    cacheTime[v] = time;
+                    time++;
+                }
+            }
+
+            emitted[t] = 1;
+        }
+
+        /* Next fanning vertex : the oldest candidate that will still be in the cache once its triangles are emitted */
+        long long next = -1, best = -1;
+        for(size_t i = 0;i < candidates.size();i++) {
+            unsigned int v = candidates[i];
+            if(live[v] <= 0) continue;
+
+            long long priority = 0;
+            if(time - cacheTime[v] + 2 * live[v] <= cacheSize) priority = time - cacheTime[v];
+
+            if(priority > best) {
+                best = priority;
+                next = v;
+            }
+        }
+
+        if(next == -1) { // Dead end : last used vertices first, then the next vertex in input order
+            while(!deadEnd.empty() && next == -1) {
+                unsigned int d = deadEnd.back();
+                deadEnd.pop_back();
+                if(live[d] > 0) next = d;
+            }
+
+            while(next == -1 && cursor < vertexCount) {
+                if(live[cursor] > 0)    next = cursor;
+                else                    cursor++;
+            }
+
+            if(next != -1 && output.size() / 3 > clusters.back()) clusters.push_back(output.size() / 3);
+        }
+
+        fanning = next;
+    }
+
+    return output;
+}
+
+/*!
+ *  \brief Sorts the clusters so that the ones facing away from the mesh center are drawn first : they are the most likely
+ *  to occlude the others, which then fail the early depth test (Sander, Nehab and Barczak 2007).
+ */
+void MeshOptimizer::optimizeOverdraw(vector<unsigned int> &indices, const vector<size_t> &clusters, const float *positions)
+{
+    if(clusters.size() < 2) return;
+
+    size_t triangleCount = indices.size() / 3;
+
+    struct Cluster {
+        size_t begin, end; // Triangles
+        double centroid[3] = {0.0, 0.0, 0.0}, normal[3] = {0.0, 0.0, 0.0}, area = 0.0;
+        double metric = 0.0;
+    };
+
+    vector<Cluster> infos(clusters.size());
+    double meshCentroid[3] = {0.0, 0.0, 0.0}, meshArea = 0.0;
+
+    for(size_t c = 0;c < clusters.size();c++) {
+        Cluster &cluster = infos[c];
+        cluster.begin = clusters[c];
+        cluster.end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+        for(size_t t = cluster.begin;t < cluster.end;t++) {
+            const float *a = positions + 3 * indices[3*t],
+                        *b = positions + 3 * indices[3*t + 1],
+                        *p = positions + 3 * indices[3*t + 2];
+
+            double u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]},
+                   w[3] = {p[0] - a[0], p[1] - a[1], p[2] - a[2]};
+            double n[3] = {u[1]*w[2] - u[2]*w[1], u[2]*w[0] - u[0]*w[2], u[0]*w[1] - u[1]*w[0]}; // Length is twice the area
+            double area = 0.5 * sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+
+            for(int k = 0;k < 3;k++) {
+                double center = (a[k] + b[k] + p[k]) / 3.0;
+                cluster.centroid[k] += center * area;
+                cluster.normal[k] += n[k];
+                meshCentroid[k] += center * area;
+            }
+
+            cluster.area += area;
+            meshArea += area;
+        }
+    }
+
+    if(meshArea <= 0.0) return;
+    for(int k = 0;k < 3;k++) meshCentroid[k] /= meshArea;
+
+    for(size_t c = 0;c < infos.size();c++) {
+        Cluster &cluster = infos[c];
+        if(cluster.area <= 0.0) continue;
+
+        double length = sqrt(cluster.normal[0]*cluster.normal[0] + cluster.normal[1]*cluster.normal[1] + cluster.normal[2]*cluster.normal[2]);
+        if(length <= 0.0) continue;
+
+        for(int k = 0;k < 3;k++) {
+            cluster.metric += (cluster.centroid[k] / cluster.area - meshCentroid[k]) * cluster.normal[k] / length;
+        }
+    }
+
+    stable_sort(infos.begin(), infos.end(), [](const Cluster &a, const Cluster &b) { return a.metric > b.metric; });
+
+    vector<unsigned int> sorted;
+    sorted.reserve(indices.size());
+    for(size_t c = 0;c < infos.size();c++) {
+        sorted.insert(sorted.end(), indices.begin() + 3 * infos[c].begin, indices.begin() + 3 * infos[c].end);
+    }
+
+    indices.swap(sorted);
+}
+
+/// \brief Renumbers the vertices in the order the triangles first use them, so that vertex fetches walk the buffers forward.
+void MeshOptimizer::optimizeVertexFetch(vector<unsigned int> &indices, size_t vertexCount, const vector<VertexStream> &streams)
+{
+    vector<int> remap(vertexCount, -1);
+    int next = 0;
+
+    for(size_t i = 0;i < indices.size();i++) {
+        if(remap[indices[i]] < 0) remap[indices[i]] = next++;
+        indices[i] = remap[indices[i]];
+    }
+
+    for(size_t v = 0;v < vertexCount;v++) { // Unused vertices go last
+        if(remap[v] < 0) remap[v] = next++;
+    }
+
+    for(size_t s = 0;s < streams.size();s++) {
+        int components = streams[s].components;
+        vector<float> source(streams[s].data, streams[s].data + vertexCount * components);
+
+        for(size_t v = 0;v < vertexCount;v++) {
+            memcpy(streams[s].data + remap[v] * components, &source[v * components], components * sizeof(float));
+        }
+    }
+}
+
+/*!
+ *  \brief Merges the vertices whose attributes are all bitwise identical.
+ *  \param streams Replaced by newly allocated (malloc) arrays holding the unique vertices only. The former arrays aren't freed.
+ *  \param indices Receives one index per input vertex.
+ *  \return The number of unique vertices.
+ */
+size_t MeshOptimizer::weld(vector<VertexStream> &streams, size_t vertexCount, vector<unsigned int> &indices)
+{
+    indices.resize(vertexCount);
+
+    size_t tableSize = 1;
+    while(tableSize < 2 * vertexCount) tableSize *= 2;
+    vector<long long> table(tableSize, -1); // Source vertex of each unique vertex, open addressing
+    vector<unsigned int> uniqueSource;      // Unique vertex -> first source vertex
+    vector<unsigned int> uniqueOf(tableSize);
+
+    for(size_t v = 0;v < vertexCount;v++) {
+        /* FNV-1a over every attribute bits */
+        size_t hash = 2166136261u;
+        for(size_t s = 0;s < streams.size();s++) {
+            const unsigned char *bytes = (const unsigned char *) (streams[s].data + v * streams[s].components);
+            for(size_t b = 0;b < streams[s].components * sizeof(float);b++) {
+                hash = (hash ^ bytes[b]) * 16777619u;
+            }
+        }
+
+        size_t slot = hash & (tableSize - 1);
+        while(true) {
+            if(table[slot] < 0) { // New vertex
+                table[slot] = v;
+                uniqueOf[slot] = uniqueSource.size();
+                indices[v] = uniqueSource.size();
+                uniqueSource.push_back(v);
+                break;
+            }
+
+            bool equal = true;
+            for(size_t s = 0;s < streams.size() && equal;s++) {
+                int components = streams[s].components;
+                equal = memcmp(streams[s].data + table[slot] * components, streams[s].data + v * components, components * sizeof(float)) == 0;
+            }
+
+            if(equal) {
+                indices[v] = uniqueOf[slot];
+                break;
+            }
+
+            slot = (slot + 1) & (tableSize - 1);
+        }
+    }
+
+    /* Compacted streams */
+    for(size_t s = 0;s < streams.size();s++) {
+        int components = streams[s].components;
+        float *compacted = (float *) malloc(max<size_t>(1, uniqueSource.size() * components * sizeof(float)));
+
+        for(size_t u = 0;u < uniqueSource.size();u++) {
+            memcpy(compacted + u * components, streams[s].data + uniqueSource[u] * components, components * sizeof(float));
+        }
+
+        streams[s].data = compacted;
+    }
+
+    return uniqueSource.size();
+}
+
+/// \brief Simulates a FIFO post-transform cache and counts the vertices that have to be transformed.
+size_t MeshOptimizer::cacheMisses(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize)
+{
+    vector<long long> insertedAt(vertexCount, 0);
+    long long time = cacheSize; // Every vertex starts out of the cache
+    size_t misses = 0;
+
+    for(size_t i = 0;i < indices.size();i++) {
+        unsigned int v = indices[i];
+        if(time - insertedAt[v] < cacheSize) continue; // Hit
+
+        misses++;
+        time++;
+        insertedAt[v] = time;
+    }
+
+    return misses;
+}
+
+/// \return The average cache miss ratio : transformed vertices per triangle
+float MeshOptimizer::computeACMR(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize)
+{
+    if(indices.size() < 3) return 0.0;
+    return (float) cacheMisses(indices, vertexCount, cacheSize) / (indices.size() / 3);
+}
+
+/// \return The average transformed vertex ratio : transformed vertices per vertex
+float MeshOptimizer::computeATVR(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize)
+{
+    if(vertexCount == 0) return 0.0;
+    return (float) cacheMisses(indices, vertexCount, cacheSize) / vertexCount;
+}
+
+/* Settings */
+void MeshOptimizer::setEnabled(bool enabled)
+{
+    s_enabled = enabled;
+}
+
+void MeshOptimizer::setReport(bool report)
+{
+    s_report = report;
+}
+
+bool MeshOptimizer::isEnabled()
+{
+    return s_enabled;
+}
+
+bool MeshOptimizer::isReporting()
+{
+    return s_report;
+}
+
+void MeshOptimizer::report(const string &meshname, const Stats &stats)
+{
+    if(!s_report || !stats.optimized) return;
+
+    cout << "(MeshOptimizer) " << meshname << " : " << stats.triangles << " triangles, " << stats.vertices << " vertices, " << stats.clusters << " clusters | ACMR "
+         << stats.acmrBefore << " -> " << stats.acmrAfter << " | ATVR " << stats.atvrBefore << " -> " << stats.atvrAfter << endl;
+}
@@ -0,0 +1,272 @@
+#include "OBJParser.h"
+
+#include <thread>
+#include <cstring>
+
+using namespace std;
+
+OBJParser::OBJParser(unsigned int threadCount) :
+    m_threadCount(threadCount)
+{
+    //ctor
+}
+
+void OBJParser::setThreadCount(unsigned int threadCount)
+{
+    m_threadCount = threadCount;
+}
+
+/*!
+ *  \brief Parses the .obj text in [begin; end). Any previous result is discarded.
+ *  \return false if the buffer is invalid.
+ */
+bool OBJParser::parse(const char *begin, const char *end)
+{
+    m_vertices.clear();
+    m_tex.clear();
+    m_normals.clear();
+    m_objects.clear();
+
+    if(begin == nullptr || end < begin) {
+        m_chunkCount = 0;
+        return false;
+    }
+
+    /* How many chunks */
+    size_t size = end - begin;
+    unsigned int threadCount = m_threadCount;
+    if(threadCount == OBJ_PARSER_THREADS_AUTO) {
+        threadCount = thread::hardware_concurrency();
+        if(threadCount == 0) threadCount = 1; // Unknown
+    }
+
+    size_t maxChunks = size / OBJ_PARSER_MIN_CHUNK;
+    if(maxChunks < 1) maxChunks = 1;
+    if(threadCount > maxChunks) threadCount = maxChunks;
+
+    /* Splitting at line boundaries : every chunk starts right after a '\n' */
+    vector<Chunk> chunks;
+    const char *chunk_begin = begin;
+    for(unsigned int i = 1;i <= threadCount && chunk_begin < end;i++) {
+        const char *chunk_end = end;
+        if(i < threadCount) {
+            chunk_end = begin + (size * i) / threadCount;
+            if(chunk_end < chunk_begin) chunk_end = chunk_begin;
+
+            const char *newline = (const char *) memchr(chunk_end, '\n', end - chunk_end);
+            chunk_end = (newline == nullptr) ? end : newline + 1;
+        }
+
+        Chunk chunk;
+        chunk.begin = chunk_begin;
+        chunk.end = chunk_end;
+        chunks.push_back(chunk);
+
+        chunk_begin = chunk_end;
+    }
+
+    if(chunks.empty()) { // Empty buffer
+        Chunk chunk;
+        chunk.begin = chunk.end = begin;
+        chunks.push_back(chunk);
+    }
+
+    m_chunkCount = chunks.size();
+
+    /* Tokenizing every chunk (the first one on the calling thread) */
+    vector<thread> workers;
+    for(size_t i = 1;i < chunks.size();i++) {
+        workers.push_back(thread(parseChunk, ref(chunks[i])));
+    }
+
+    parseChunk(chunks[0]);
+
+    for(size_t i = 0;i < workers.size();i++) {
+        workers[i].join();
+    }
+
+    /* Putting everything back in file order */
+    merge(chunks);
+
+    return true;
+}
+
+/// \brief Tokenizes one chunk. Only touches the chunk, so that chunks can be parsed concurrently.
+void OBJParser::parseChunk(Chunk &chunk)
+{
+    OBJTokenizer tokenizer(chunk.begin, chunk.end);
+    OBJTokenizer::Record record;
+
+    Segment *segment = &chunk.leading;
+
+    while(tokenizer.next(record)) {
+        switch(record.type) {
+            case OBJECT:
+            {
+                chunk.objects.push_back(Segment());
+                segment = &chunk.objects.back();
+                segment->name.assign(record.name, record.nameLength);
+                break;
+            }
+
+            case VERTEX:
+            {
+                chunk.vertices.push_back(make_tuple(record.values[0], record.values[1], record.values[2]));
+                break;
+            }
+
+            case TEXTURE:
+            {
+                chunk.tex.push_back(make_tuple(record.values[0], record.values[1]));
+                break;
+            }
+
+            case NORMAL:
+            {
+                chunk.normals.push_back(make_tuple(record.values[0], record.values[1], record.values[2]));
+                break;
+            }
+
+            case FACE:
+            {
+                int counts[3] = {(int) chunk.vertices.size(), (int) chunk.tex.size(), (int) chunk.normals.size()};
+
+                for(int i = 0;i < 3;i++) { // One corner
+                    for(int k = 0;k < 3;k++) { // vertex, texture, normal
+                        int index = record.indexes[i][k];
+
+                        if(index < 0) { // Relative to the last element read : made absolute within the chunk, rebased when merging
+                            index = counts[k] + index + 1;
+                            segment->relativeSlots.push_back(segment->corners.size());
+                        }
+
+                        segment->corners.push_back(index);
+                    }
+                }
+
+                break;
+            }
+
+            case USEMTL:
+            {
+                segment->usesMaterial = true;
+                segment->material.assign(record.name, record.nameLength);
+                break;
+            }
+
+            default: break;
+        }
+    }
+}
+
+/*!
+ *  \brief Concatenates the chunks attribute arrays and rebuilds the object list exactly as a single pass over the file would.
+ *  Faces found before the first "o" belong to the first object. Every later "o" closes the current object.
+ */
+void OBJParser::merge(vector<Chunk> &chunks)
+{
+    /* Prefix sum of the attribute counts : where each chunk starts in the global arrays */
+    vector<int> vertexOffset(chunks.size()), texOffset(chunks.size()), normalOffset(chunks.size());
+    size_t vertexCount = 0, texCount = 0, normalCount = 0;
+
+    for(size_t c = 0;c < chunks.size();c++) {
+        vertexOffset[c] = vertexCount;  vertexCount += chunks[c].vertices.size();
+        texOffset[c] = texCount;        texCount += chunks[c].tex.size();
+        normalOffset[c] = normalCount;  normalCount += chunks[c].normals.size();
+    }
+
+    m_vertices.reserve(vertexCount);
+    m_tex.reserve(texCount);
+    m_normals.reserve(normalCount);
+
+    for(size_t c = 0;c < chunks.size();c++) {
+        m_vertices.insert(m_vertices.end(), chunks[c].vertices.begin(), chunks[c].vertices.end());
+        m_tex.insert(m_tex.end(), chunks[c].tex.begin(), chunks[c].tex.end());
+        m_normals.insert(m_normals.end(), chunks[c].normals.begin(), chunks[c].normals.end());
+    }
+
+    /* Stitching the objects */
+    m_objects.push_back(Object()); // Receives everything until the second "o"
+    bool firstO = true;
+
+    for(size_t c = 0;c < chunks.size();c++) {
+        int offsets[3] = {vertexOffset[c], texOffset[c], normalOffset[c]};
+
+        for(int s = -1;s < (int) chunks[c].objects.size();s++) {
+            Segment &segment = (s == -1) ? chunks[c].leading : chunks[c].objects[s];
+
+            if(s != -1) { // An "o" record
+                if(firstO) {
+                    firstO = false; // The first "o" only names the current object
+                } else {
+                    m_objects.push_back(Object());
+                }
+
+                m_objects.back().name = segment.name;
+            }
+
+            Object &object = m_objects.back();
+
+            if(segment.usesMaterial) {
+                object.usesMaterial = true;
+                object.material = segment.material;
+            }
+
+            /* Rebasing the relative indexes with the chunk offsets */
+            for(size_t i = 0;i < segment.relativeSlots.size();i++) {
+                size_t slot = segment.relativeSlots[i];
+                segment.corners[slot] += offsets[slot % 3];
+            }
+
+            // Indexes start at 1 on .obj. The indexes now stored are the real indexes ready to be accessed from.
+            size_t corners = segment.corners.size() / 3;
+            object.faces_vertex_index.reserve(object.faces_vertex_index.size() + corners);
+            object.faces_tex_index.reserve(object.faces_tex_index.size() + corners);
+            object.faces_normal_index.reserve(object.faces_normal_index.size() + corners);
+            object.vertex_normals_mapper.reserve(object.vertex_normals_mapper.size() + corners);
+
+            for(size_t i = 0;i < corners;i++) {
+                int *corner = &segment.corners[3*i];
+
+                object.faces_vertex_index.push_back(corner[0] - 1);
+                object.faces_tex_index.push_back(corner[1] - 1);
+                object.faces_normal_index.push_back(corner[2] - 1);
+
+                // Associating the corresponding vertex index with the normal index (for calculating vertex normals)
+                object.vertex_normals_mapper.push_back(make_tuple(corner[0] - 1, corner[2] - 1));
+            }
+
+            vector<int>().swap(segment.corners); // Releasing the chunk memory as we go
+        }
+    }
+}
+
+vector<coordinate3d> &OBJParser::getVertices()
+{
+    return m_vertices;
+}
+
+vector<coordinate2d> &OBJParser::getTexCoords()
+{
+    return m_tex;
+}
+
+vector<coordinate3d> &OBJParser::getNormals()
+{
+    return m_normals;
+}
+
+vector<OBJParser::Object> &OBJParser::getObjects()
+{
+    return m_objects;
+}
+
+unsigned int OBJParser::getChunkCount()
+{
+    return m_chunkCount;
+}
+
+OBJParser::~OBJParser()
+{
+    //dtor
+}
@@ -0,0 +1,232 @@
+#include "OBJTokenizer.h"
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+/* Exact powers of ten as doubles (10^22 is the last one that is exactly representable) */
+static const double pow10_table[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+OBJTokenizer::OBJTokenizer(const char *begin, const char *end) :
+    m_cursor(begin), m_end(end)
+{
+    //ctor
+}
+
+/// \brief Skips spaces and tabs, stopping at the end of the line.
+inline void OBJTokenizer::skipBlanks()
+{
+    while(m_cursor < m_end && is_blank(*m_cursor)) m_cursor++;
+}
+
+/// \brief Moves the cursor right after the next '\n'.
+inline void OBJTokenizer::skipLine()
+{
+    const char *newline = (const char *) memchr(m_cursor, '\n', m_end - m_cursor);
+    m_cursor = (newline == nullptr) ? m_end : newline + 1;
+}
+
+/*!
+ *  \brief Parses a decimal float at the cursor. Simple "-1.234567" forms (everything Blender writes) are converted with a single
+ *  exact division, which gives the same result as strtof. Anything longer or with a large exponent falls back to strtof.
+ */
+inline float OBJTokenizer::parseFloat()
+{
+    skipBlanks();
+    const char *start = m_cursor;
+
+    bool negative = false;
+    if(m_cursor < m_end && (*m_cursor == '-' || *m_cursor == '+')) {
+        negative = (*m_cursor == '-');
+        m_cursor++;
+    }
+
+    unsigned long long mantissa = 0;
+    int digits = 0, exponent = 0;
+
+    while(m_cursor < m_end && is_digit(*m_cursor)) {
+        mantissa = mantissa * 10 + (*m_cursor - '0');
+        digits++; m_cursor++;
+    }
+
+    if(m_cursor < m_end && *m_cursor == '.') {
+        m_cursor++;
+        while(m_cursor < m_end && is_digit(*m_cursor)) {
+            mantissa = mantissa * 10 + (*m_cursor - '0');
+            digits++; exponent--; m_cursor++;
+        }
+    }
+
+    if(m_cursor < m_end && (*m_cursor == 'e' || *m_cursor == 'E')) {
+        const char *exp_start = m_cursor++;
+        bool exp_negative = false;
+        if(m_cursor < m_end && (*m_cursor == '-' || *m_cursor == '+')) {
+            exp_negative = (*m_cursor == '-');
+            m_cursor++;
+        }
+
+        if(m_cursor < m_end && is_digit(*m_cursor)) {
+            int value = 0;
+            while(m_cursor < m_end && is_digit(*m_cursor)) {
+                if(value < 10000) value = value * 10 + (*m_cursor - '0');
+                m_cursor++;
+            }
+            exponent += exp_negative ? -value : value;
+        } else {
+            m_cursor = exp_start; // Not an exponent after all
+        }
+    }
+
+    if(digits == 0) { // Not a number (nan, inf or garbage) : let the C library decide
+        m_cursor = start;
+    } else if(digits <= 18 && exponent >= -22 && exponent <= 22) { // Fast path : mantissa and 10^exponent are both exact doubles
+        double value = (double) mantissa;
+        value = (exponent < 0) ? value / pow10_table[-exponent] : value * pow10_table[exponent];
+        return (float) (negative ? -value : value);
+    }
+
+    /* Slow path : copy the token (the mapping isn't null terminated) */
+    char buffer[64];
+    size_t length = 0;
+    const char *it = start;
+    while(it < m_end && length < sizeof(buffer) - 1 && !is_blank(*it) && *it != '\n') {
+        buffer[length++] = *it++;
+    }
+    buffer[length] = '\0';
+
+    char *parsed_end;
+    float value = strtof(buffer, &parsed_end);
+    m_cursor = start + (parsed_end - buffer);
+
+    if(m_cursor == start) { // Nothing could be read : skip the token
+        m_cursor = it;
+        return 0.0;
+    }
+
+    return value;
+}
+
+inline int OBJTokenizer::parseInt()
+{
+    bool negative = false;
+    if(m_cursor < m_end && (*m_cursor == '-' || *m_cursor == '+')) {
+        negative = (*m_cursor == '-');
+        m_cursor++;
+    }
+
+    int value = 0;
+    while(m_cursor < m_end && is_digit(*m_cursor)) {
+        value = value * 10 + (*m_cursor - '0');
+        m_cursor++;
+    }
+
+    return negative ? -value : value;
+}
+
+/// \brief Parses a face corner "v", "v/vt", "v//vn" or "v/vt/vn". Omitted indexes are set to 0.
+inline void OBJTokenizer::parseCorner(int *corner)
+{
+    skipBlanks();
+
+    corner[0] = parseInt();
+    corner[1] = 0;
+    corner[2] = 0;
+
+    for(int i = 1;i < 3 && m_cursor < m_end && *m_cursor == '/';i++) {
+        m_cursor++;
+        corner[i] = parseInt(); // Empty "//" gives 0
+    }
+}
+
+/*!
+ *  \brief Reads the next record, skipping comments, empty lines and unsupported keywords.
+ *  \return false when the end of the buffer has been reached.
+ */
+bool OBJTokenizer::next(Record &record)
+{
+    while(m_cursor < m_end) {
+        skipBlanks();
+        if(m_cursor >= m_end) return false;
+
+        /* Keyword */
+        const char *keyword = m_cursor;
+        while(m_cursor < m_end && !is_blank(*m_cursor) && *m_cursor != '\n') m_cursor++;
+        size_t length = m_cursor - keyword;
+
+        int type = -1;
+        if(length == 1) {
+            if(keyword[0] == 'v')       type = VERTEX;
+            else if(keyword[0] == 'f')  type = FACE;
+            else if(keyword[0] == 'o')  type = OBJECT;
+        } else if(length == 2 && keyword[0] == 'v') {
+            if(keyword[1] == 't')       type = TEXTURE;
+            else if(keyword[1] == 'n')  type = NORMAL;
+        } else if(length == 6 && memcmp(keyword, "usemtl", 6) == 0) {
+            type = USEMTL;
+        }
+
+        switch(type) {
+            case VERTEX:
+            case NORMAL:
+            {
+                record.values[0] = parseFloat();
+                record.values[1] = parseFloat();
+                record.values[2] = parseFloat();
+                break;
+            }
+
+            case TEXTURE:
+            {
+                record.values[0] = parseFloat();
+                record.values[1] = parseFloat();
+                record.values[2] = 0.0;
+                break;
+            }
+
+            case FACE:
+            {
+                parseCorner(record.indexes[0]);
+                parseCorner(record.indexes[1]);
+                parseCorner(record.indexes[2]);
+                break;
+            }
+
+            case OBJECT:
+            case USEMTL:
+            {
+                skipBlanks();
+                record.name = m_cursor;
+                while(m_cursor < m_end && !is_blank(*m_cursor) && *m_cursor != '\n') m_cursor++;
+                record.nameLength = m_cursor - record.name;
+                break;
+            }
+
+            default: break; // Comment, empty line or unsupported keyword
+        }
+
+        skipLine();
+
+        if(type != -1) {
+            record.type = type;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+OBJTokenizer::~OBJTokenizer()
+{
+    //dtor
+}
@@ -1,7 +1,21 @@
 #include "OBJ_Static_Handler.h"
 
+#include <cstring>
+#include <cstdlib>
+
 using namespace std;
 
+namespace
+{
+    /* malloc'd copy of an array of the mapping, for a mesh to adopt */
+    void *copyArray(const void *source, size_t bytes)
+    {
+        void *copy = malloc(bytes);
+        if(copy != nullptr) memcpy(copy, source, bytes);
+        return copy;
+    }
+}
+
 OBJ_Static_Handler::OBJ_Static_Handler(string OBJ_path, string MTL_path) :
     m_OBJ_path(OBJ_path), m_MTL_path(MTL_path)
 {
@@ -19,160 +33,279 @@ void OBJ_Static_Handler::load(bool loadTextures, bool loadMeshes, bool computeVe
 /* IF OUT OF RANGE : REMEMBER, FACES LINES MUST HAVE A TEXTURE COORD ! */
 void OBJ_Static_Handler::loadOBJ(bool loadMeshes, bool computeVertexNormals)
 {
-    ifstream file(m_OBJ_path.c_str());
-    if(!file) {
+    MappedFile file(m_OBJ_path);
+    if(!file.isOpen()) {
         cout << "Can't load (" << m_OBJ_path << ")" << endl;
+        return;
     }
 
-    /* Getting the file in memory */
-    string line;
-    vector<string> lines;
-    while(getline(file, line)) {
-        lines.push_back(line);
-    } file.close();
+    /* Cooked meshes, if they were built from the same files and options */
+    uint64_t key = 0;
+    if(m_meshCacheEnabled) {
+        key = cacheKey(file, computeVertexNormals);
 
-    /* Parsing the .obj lines */
-    vector<coordinate3d> vertices;
-    vector<coordinate2d> tex;
-    vector<coordinate3d> normals;
+        if(m_cache.open(MeshCache::cookedPath(m_OBJ_path), key)) {
+            loadCooked(loadMeshes);
+            cout << "(MeshCache) Hit : " << m_OBJ_path << " (" << MeshCache::getHits() << " hits, " << MeshCache::getMisses() << " misses)" << endl;
+            return;
+        }
+    }
 
-    vector<mapper> vertex_normals_mapper; // (vertex index, normal index)
+    /* Parsing the .obj records (straight from the mapped file, split across m_parserThreadCount threads) */
+    OBJParser parser(m_parserThreadCount);
+    parser.parse(file.data(), file.end());
+
+    vector<coordinate3d> &vertices  = parser.getVertices();
+    vector<coordinate2d> &tex       = parser.getTexCoords();
+    vector<coordinate3d> &normals   = parser.getNormals();
+
+    /* One mesh per object, in file order */
+    vector<MeshCache::CookedMesh> cooked;
+    vector<OBJParser::Object> &objects = parser.getObjects();
+    for(vector<OBJParser::Object>::iterator object = objects.begin();object != objects.end();object++) {
+        StaticMesh *mesh;
+        if(computeVertexNormals)    mesh = StaticMeshFromArrays(&vertices, &tex, &normals, &object->faces_vertex_index, &object->faces_tex_index, &object->faces_normal_index, &object->vertex_normals_mapper, m_normalsWeighting);
+        else                        mesh = StaticMeshFromArrays(&vertices, &tex, &normals, &object->faces_vertex_index, &object->faces_tex_index, &object->faces_normal_index);
+
+        if(m_MTL_loaded && object->usesMaterial) {
+            AbstractMaterial *material = m_materials[object->material];
+            if(material != nullptr) mesh->setMaterial(material);
+        }
 
-    vector<int> faces_vertex_index;
-    vector<int> faces_tex_index;
-    vector<int> faces_normal_index;
+        if(MeshOptimizer::isEnabled()) MeshOptimizer::report(object->name, mesh->optimize());
+
+        if(m_meshCacheEnabled) {
+            mesh->computeBounds();
+
+            MeshCache::CookedMesh cookedMesh;
+            cookedMesh.name = object->name;
+            cookedMesh.usesMaterial = object->usesMaterial;
+            cookedMesh.material = object->material;
+            cookedMesh.verticesCount = mesh->getVerticesCount();
+            cookedMesh.indicesCount = mesh->getIndicesCount();
+            cookedMesh.indexSize = (mesh->getIndexType() == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+            cookedMesh.vertices = mesh->getVertices();
+            cookedMesh.colors = mesh->getColors();
+            cookedMesh.texCoords = mesh->getTexCoords();
+            cookedMesh.vertexNormals = mesh->getVertexNormals();
+            cookedMesh.indices = mesh->getIndices();
+
+            glm::vec3 boundsMin = mesh->getBoundsMin(), boundsMax = mesh->getBoundsMax();
+            cookedMesh.boundsMin[0] = boundsMin.x; cookedMesh.boundsMin[1] = boundsMin.y; cookedMesh.boundsMin[2] = boundsMin.z;
+            cookedMesh.boundsMax[0] = boundsMax.x; cookedMesh.boundsMax[1] = boundsMax.y; cookedMesh.boundsMax[2] = boundsMax.z;
+
+            cooked.push_back(cookedMesh);
+        }
 
-    AbstractMaterial *currentMaterial = nullptr;
-    string name;
+        m_meshes[object->name] = mesh;
+    }
 
-    bool firstO = true; // Checks if the first "o.." has been read (in order not to create an invalid mesh with the infos above the first object). true = we are still at the first one
-    for(vector<string>::iterator it = lines.begin(); it != lines.end(); it++) {
-        line = (*it);
-        stringstream stream(line);
-        string c; stream >> c; // First char of the string
+    if(m_meshCacheEnabled) {
+        bool written = MeshCache::write(MeshCache::cookedPath(m_OBJ_path), key, cooked);
+        cout << "(MeshCache) Miss : " << m_OBJ_path << (written ? " cooked (" : " NOT cooked (") << MeshCache::getHits() << " hits, " << MeshCache::getMisses() << " misses)" << endl;
+    }
 
-        int index = -1;
-        if(c == "v")            index = VERTEX;
-        else if(c == "vt")      index = TEXTURE;
-        else if(c == "vn")      index = NORMAL;
-        else if(c == "f")       index = FACE;
-        else if(c == "o")       index = OBJECT;
-        else if(c == "usemtl")  index = USEMTL;
-
-        switch(index) { // First char of the line
-            case OBJECT: // Next object has been detected
-            {
-                if(firstO)  { // We don't want to create "last" object if it's the first one
-                    firstO = false;
-                    stream >> name;
-                    break;
-                }
+    if(m_instancingEnabled) collapseInstances();
+    if(m_staticBatchingEnabled) batchMeshes();
 
-                // Creating last object
-                StaticMesh *mesh;
-                if(computeVertexNormals)    mesh = StaticMeshFromArrays(&vertices, &tex, &normals, &faces_vertex_index, &faces_tex_index, &faces_normal_index, &vertex_normals_mapper);
-                else                        mesh = StaticMeshFromArrays(&vertices, &tex, &normals, &faces_vertex_index, &faces_tex_index, &faces_normal_index);
+    if(loadMeshes) {
+        for(map<string, StaticMesh *>::iterator it = m_meshes.begin();it != m_meshes.end();it++) it->second->load();
+    }
+}
 
-                if(m_MTL_loaded && currentMaterial != nullptr) mesh->setMaterial(currentMaterial);
-                if(loadMeshes) mesh->load();
+/*!
+ *  \brief Creates the meshes from the cooked file (already indexed and optimized). Each mesh owns a copy of its arrays (one memcpy per array,
+ *  no parsing) : the meshes outlive the mapping, which is closed once they are created.
+ */
+void OBJ_Static_Handler::loadCooked(bool loadMeshes)
+{
+    const vector<MeshCache::CookedMesh> &cooked = m_cache.getMeshes();
+    for(vector<MeshCache::CookedMesh>::const_iterator it = cooked.begin();it != cooked.end();it++) {
+        size_t vertexBytes = it->verticesCount * sizeof(float);
+        float *vertices = (float *) copyArray(it->vertices, 3 * vertexBytes),
+              *colors = (float *) copyArray(it->colors, 3 * vertexBytes),
+              *texCoords = (float *) copyArray(it->texCoords, 2 * vertexBytes),
+              *vertexNormals = (float *) copyArray(it->vertexNormals, 3 * vertexBytes);
+        void *indices = (it->indicesCount > 0) ? copyArray(it->indices, it->indicesCount * it->indexSize) : nullptr;
+
+        StaticMesh *mesh = new StaticMesh(it->verticesCount, vertices, colors, texCoords, vertexNormals);
+        if(it->indicesCount > 0) mesh->setIndices(indices, it->indicesCount, (it->indexSize == sizeof(GLushort)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+        mesh->adoptArrays(MESH_ARRAYS_ALL);
+
+        if(vertices == nullptr || colors == nullptr || texCoords == nullptr || vertexNormals == nullptr || (it->indicesCount > 0 && indices == nullptr)) {
+            cout << "(OBJ_Static_Handler) Can't load the cooked mesh " << it->name << " : out of memory" << endl;
+            delete mesh; // Frees the copies that were made
+            continue;
+        }
+        mesh->setBounds(glm::vec3(it->boundsMin[0], it->boundsMin[1], it->boundsMin[2]), glm::vec3(it->boundsMax[0], it->boundsMax[1], it->boundsMax[2]));
 
-                m_meshes[name] = mesh;
+        if(m_MTL_loaded && it->usesMaterial) {
+            AbstractMaterial *material = m_materials[it->material];
+            if(material != nullptr) mesh->setMaterial(material);
+        }
 
-                stream >> name;
+        m_meshes[it->name] = mesh;
+    }
+    m_cache.close(); // Nothing points into it anymore
 
-                /* Reseting everything for next mesh */
-                faces_vertex_index.clear();
-                faces_tex_index.clear();
-                faces_normal_index.clear();
-                vertex_normals_mapper.clear();
-                currentMaterial = nullptr;
+    if(m_instancingEnabled) collapseInstances();
+    if(m_staticBatchingEnabled) batchMeshes();
 
-                break;
-            }
+    if(loadMeshes) {
+        for(map<string, StaticMesh *>::iterator it = m_meshes.begin();it != m_meshes.end();it++) it->second->load();
+    }
+}
 
-            case VERTEX: // Vertex
-            {
-                float x, y, z;
-                stream >> x >> y >> z;
-                vertices.push_back(make_tuple(x, y, z));
+/*!
+ *  \brief Replaces the groups of identical meshes (same material, same data but the positions, which are translated) by one InstancedMesh
+ *  each, with one instance per copy. The candidates are grouped by a hash of their topology, then compared.
+ *  Must run before the meshes are loaded.
+ */
+void OBJ_Static_Handler::collapseInstances()
+{
+    map<uint64_t, vector<string> > candidates;
+    for(map<string, StaticMesh *>::iterator it = m_meshes.begin();it != m_meshes.end();it++) {
+        StaticMesh *mesh = it->second;
+        int counts[] = {mesh->getVerticesCount(), mesh->getIndicesCount(), (int) mesh->getIndexType()};
+
+        uint64_t key = MeshCache::hash(counts, sizeof(counts));
+        AbstractMaterial *material = mesh->getMaterial();
+        key = MeshCache::hash(&material, sizeof(material), key);
+        if(mesh->getIndicesCount() > 0) {
+            key = MeshCache::hash(mesh->getIndices(), mesh->getIndicesCount() * ((mesh->getIndexType() == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint)), key);
+        }
 
-                break;
-            }
+        candidates[key].push_back(it->first);
+    }
 
-            case TEXTURE:  // Texture coordinate
-            {
-                float u, v;
-                stream >> u >> v;
-                tex.push_back(make_tuple(u, v));
+    size_t collapsed = 0, instancedMeshes = 0;
+    for(map<uint64_t, vector<string> >::iterator group = candidates.begin();group != candidates.end();group++) {
+        vector<string> &names = group->second;
+        vector<bool> taken(names.size(), false);
 
-                break;
+        for(size_t i = 0;i < names.size();i++) {
+            if(taken[i]) continue;
+            StaticMesh *reference = m_meshes[names[i]];
+
+            vector<pair<size_t, glm::vec3> > copies;
+            for(size_t j = i + 1;j < names.size();j++) {
+                glm::vec3 offset;
+                if(!taken[j] && sameGeometry(reference, m_meshes[names[j]], offset)) copies.push_back(make_pair(j, offset));
             }
 
-            case NORMAL: // Normal
-            {
-                float x, y, z;
-                stream >> x >> y >> z;
-                normals.push_back(make_tuple(x, y, z));
+            if(copies.size() + 1 < OBJ_INSTANCING_MIN_COPIES) continue;
 
-                break;
-            }
+            // The instanced mesh takes the arrays of the reference over, with the ownership of the ones it owned : deleting it leaves them alone
+            InstancedMesh *instanced = new InstancedMesh(reference->getVerticesCount(), (float *) reference->getVertices(), (float *) reference->getColors(),
+                                                         (float *) reference->getTexCoords(), (float *) reference->getVertexNormals());
+            if(reference->getIndicesCount() > 0) instanced->setIndices((void *) reference->getIndices(), reference->getIndicesCount(), reference->getIndexType());
+            instanced->adoptArrays(reference->disownArrays(MESH_ARRAYS_ALL));
+            instanced->setMaterial(reference->getMaterial());
 
-            case FACE: // Face
-            {
-                string vert[3];
-                stream >> vert[0] >> vert[1] >> vert[2];
+            m_instances[names[i]] = make_pair(instanced, instanced->addInstance(glm::mat4(1.0)));
+            for(size_t k = 0;k < copies.size();k++) {
+                const string &name = names[copies[k].first];
+                taken[copies[k].first] = true;
 
-                for(int i = 0;i < 3;i++) { // One vertex
-                    stringstream sub_stream(vert[i]);
-                    int indexes[3];
+                m_instances[name] = make_pair(instanced, instanced->addInstance(glm::translate(copies[k].second)));
+                delete m_meshes[name];
+                m_meshes.erase(name);
+            }
 
-                    /* Parsing "1/2/3" */
-                    int value, j = 0;
-                    while(sub_stream >> value) {
-                        indexes[j] = value;
+            delete reference;
+            m_meshes[names[i]] = instanced;
 
-                        if(sub_stream.peek() == '/') sub_stream.ignore();
-                        j++;
-                    }
-                    /* Now indexes[0] is vertex ; indexes[1] is texture ; indexes[2] is normal */
+            collapsed += copies.size() + 1;
+            instancedMeshes++;
+        }
+    }
 
-                    // Indexes start at 1 on .obj. The indexes now stored are the real indexes ready to be accessed from.
+    if(instancedMeshes > 0) {
+        cout << "(OBJ_Static_Handler) " << collapsed << " identical objects collapsed into " << instancedMeshes << " instanced meshes" << endl;
+    }
+}
 
-                    faces_vertex_index.push_back(indexes[0] - 1);   // One vertex  (3 coords)
-                    faces_tex_index.push_back(indexes[1] - 1);      // One texture (2 coords)
-                    faces_normal_index.push_back(indexes[2] - 1);   // One normal  (3 coords)
+/// \brief Merges the meshes per material (see BatchedMesh::batch() : the instanced meshes are kept). A batch is registered under the name of its first object.
+void OBJ_Static_Handler::batchMeshes()
+{
+    vector<string> names;
+    vector<StaticMesh *> meshes;
+    for(map<string, StaticMesh *>::iterator it = m_meshes.begin();it != m_meshes.end();it++) {
+        names.push_back(it->first);
+        meshes.push_back(it->second);
+    }
 
-                    // Associating the corresponding vertex index with the normal index (for calculating vertex normals)
-                    vertex_normals_mapper.push_back(make_tuple(indexes[0] - 1, indexes[2] - 1));
-                }
+    vector<size_t> destination;
+    vector<StaticMesh *> batched = BatchedMesh::batch(meshes, destination);
 
-                break;
-            }
+    vector<bool> registered(batched.size(), false);
+    m_meshes.clear();
+    for(size_t i = 0;i < names.size();i++) {
+        StaticMesh *mesh = batched[destination[i]];
 
-            case USEMTL:
-            {
-                if(!m_MTL_loaded) break;
+        if(!registered[destination[i]]) {
+            m_meshes[names[i]] = mesh;
+            registered[destination[i]] = true;
+        } else {
+            m_batches[names[i]] = mesh;
+        }
+    }
+}
 
-                string materialName;
-                stream >> materialName;
+bool OBJ_Static_Handler::sameGeometry(StaticMesh *reference, StaticMesh *mesh, glm::vec3 &offset)
+{
+    int count = reference->getVerticesCount();
+    if(mesh->getVerticesCount() != count || mesh->getIndicesCount() != reference->getIndicesCount() || mesh->getIndexType() != reference->getIndexType()
+       || mesh->getMaterial() != reference->getMaterial() || count == 0) {
+        return false;
+    }
 
-                currentMaterial = m_materials[materialName];
-                break;
-            }
+    if(reference->getIndicesCount() > 0
+       && memcmp(mesh->getIndices(), reference->getIndices(), reference->getIndicesCount() * ((reference->getIndexType() == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint))) != 0) {
+        return false;
+    }
 
-            default: break;
+    struct {
+        const float *a, *b;
+        int components;
+    } streams[] = {
+        {reference->getColors(), mesh->getColors(), 3},
+        {reference->getTexCoords(), mesh->getTexCoords(), 2},
+        {reference->getVertexNormals(), mesh->getVertexNormals(), 3},
+    };
+
+    for(size_t s = 0;s < sizeof(streams) / sizeof(streams[0]);s++) {
+        if((streams[s].a == nullptr) != (streams[s].b == nullptr)) return false;
+        if(streams[s].a == nullptr) continue;
+
+        for(int i = 0;i < count * streams[s].components;i++) {
+            float a = streams[s].a[i], b = streams[s].b[i];
+            if(fabs(a - b) > OBJ_INSTANCING_TOLERANCE * std::max(1.0f, std::max(fabs(a), fabs(b)))) return false;
         }
     }
 
-    /* Don't forget the very last one ! (there is no "o" to trigger it ! */
-    StaticMesh *mesh;
-    if(computeVertexNormals)    mesh = StaticMeshFromArrays(&vertices, &tex, &normals, &faces_vertex_index, &faces_tex_index, &faces_normal_index, &vertex_normals_mapper);
-    else                        mesh = StaticMeshFromArrays(&vertices, &tex, &normals, &faces_vertex_index, &faces_tex_index, &faces_normal_index);
+    /* Positions : the same offset for every vertex */
+    const float *a = reference->getVertices(), *b = mesh->getVertices();
+    offset = glm::vec3(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
 
-    if(m_MTL_loaded && currentMaterial != nullptr) mesh->setMaterial(currentMaterial);
-    if(loadMeshes) mesh->load();
+    for(int i = 0;i < 3 * count;i++) {
+        float translated = a[i] + offset[i % 3];
+        if(fabs(translated - b[i]) > OBJ_INSTANCING_TOLERANCE * std::max(1.0f, std::max(fabs(translated), fabs(b[i])))) return false;
+    }
 
-    m_meshes[name] = mesh;
+    return true;
+}
+
+/// \return The cache key : a hash of the .obj and .mtl contents and of every option that changes the meshes.
+uint64_t OBJ_Static_Handler::cacheKey(const MappedFile &objFile, bool computeVertexNormals)
+{
+    uint64_t key = MeshCache::hash(objFile.data(), objFile.size());
+
+    MappedFile mtlFile(m_MTL_path);
+    if(mtlFile.isOpen()) key = MeshCache::hash(mtlFile.data(), mtlFile.size(), key);
+
+    int options[] = {computeVertexNormals ? 1 : 0, m_normalsWeighting, MeshOptimizer::isEnabled() ? 1 : 0, VERTEX_CACHE_SIZE};
+    return MeshCache::hash(options, sizeof(options), key);
 }
 
 void OBJ_Static_Handler::loadMTL(bool loadTextures)
@@ -298,8 +431,8 @@ void OBJ_Static_Handler::loadMTL(bool loadTextures)
                 string path;
                 stream >> path;
 
-                diffuseTexture = new AbstractTexture(path);
-                if(loadTextures)   diffuseTexture->load();
+                if(setDiffTex) TextureCache::release(diffuseTexture); // Overridden before being used
+                diffuseTexture = TextureCache::acquire(path, loadTextures);
 
                 setDiffTex = true;
                 break;
@@ -310,8 +443,8 @@ void OBJ_Static_Handler::loadMTL(bool loadTextures)
                 string path;
                 stream >> path;
 
-                specularTexture = new AbstractTexture(path);
-                if(loadTextures)   specularTexture->load();
+                if(setSpecTex) TextureCache::release(specularTexture);
+                specularTexture = TextureCache::acquire(path, loadTextures);
 
                 setSpecTex = true;
                 break;
@@ -329,11 +462,56 @@ void OBJ_Static_Handler::loadMTL(bool loadTextures)
     m_MTL_loaded = true;
 }
 
+/// \brief Sets how many threads parse the .obj (OBJ_PARSER_THREADS_AUTO for one per core, 1 for a serial parse). The meshes don't depend on it.
+void OBJ_Static_Handler::setParserThreadCount(unsigned int threadCount)
+{
+    m_parserThreadCount = threadCount;
+}
+
+void OBJ_Static_Handler::setNormalsWeighting(int weighting)
+{
+    m_normalsWeighting = weighting;
+}
+
+/// \brief Enables (default) or disables the cooked meshes cache.
+void OBJ_Static_Handler::setMeshCacheEnabled(bool enabled)
+{
+    m_meshCacheEnabled = enabled;
+}
+
+/// \brief Enables (default) or disables the collapsing of identical objects into instanced meshes. Before load().
+void OBJ_Static_Handler::setInstancingEnabled(bool enabled)
+{
+    m_instancingEnabled = enabled;
+}
+
+/// \brief Enables or disables (default) the static batching. Before load().
+void OBJ_Static_Handler::setStaticBatchingEnabled(bool enabled)
+{
+    m_staticBatchingEnabled = enabled;
+}
+
 StaticMesh *OBJ_Static_Handler::getMesh(string meshname)
 {
+    map<string, StaticMesh *>::iterator batch = m_batches.find(meshname);
+    if(batch != m_batches.end()) return batch->second;
+
+    map<string, pair<InstancedMesh *, size_t> >::iterator instance = m_instances.find(meshname);
+    if(instance != m_instances.end()) return instance->second.first;
+
     return m_meshes.at(meshname); // ->at() checks existence
 }
 
+bool OBJ_Static_Handler::findInstance(string meshname, InstancedMesh *&mesh, size_t &instance)
+{
+    map<string, pair<InstancedMesh *, size_t> >::iterator found = m_instances.find(meshname);
+    if(found == m_instances.end()) return false;
+
+    mesh = found->second.first;
+    instance = found->second.second;
+    return true;
+}
+
 vector<StaticMesh *> OBJ_Static_Handler::getAllMeshes()
 {
     vector<StaticMesh *> v;
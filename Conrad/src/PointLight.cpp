@@ -3,21 +3,39 @@
 using namespace glm;
 
 PointLight::PointLight(vec3 position, vec3 color, float intensity, bool castShadow, float linearAttenuation, float minIntensity, float maxDistance) :
-    AbstractLight(position, color, vec3(0.0), intensity, castShadow, linearAttenuation, (intensity / (minIntensity * maxDistance * maxDistance)))
+    AbstractLight(position, color, vec3(0.0), intensity, castShadow, linearAttenuation, (intensity / (minIntensity * maxDistance * maxDistance))), m_shadowRange(maxDistance)
 {
-    //ctor
+    if(castShadow) getDepthBuffer().load(DEPTHBUFFER_CUBE, SHADOW_CUBE_SIZE);
 }
 
-void PointLight::sendUniforms(const Shader &shader, size_t index)
+void PointLight::fillUniformBlock(LightBlock &block)
 {
-    shader.sendInt(shader.getUniformLocation(uniform_str(index, "type")), LIGHT_POINT);
-    shader.sendVector(shader.getUniformLocation(uniform_str(index, "position")), m_position);
-    shader.sendRGB(shader.getUniformLocation(uniform_str(index, "color")), m_color);
-    shader.sendFloat(shader.getUniformLocation(uniform_str(index, "intensity")), m_intensity);
-    shader.sendFloat(shader.getUniformLocation(uniform_str(index, "linearAttenuation")), m_linearAttenuation);
-    shader.sendFloat(shader.getUniformLocation(uniform_str(index, "quadAttenuation")), m_quadraticAttenuation);
-
-    sendShadowUniforms(shader, index);
+    AbstractLight::fillUniformBlock(block);
+
+    block.type = LIGHT_POINT;
+    block.shadowRange = m_shadowRange;
+}
+
+bool PointLight::isOmnidirectional()
+{
+    return castsShadow();
+}
+
+float PointLight::getShadowRange()
+{
+    return m_shadowRange;
+}
+
+void PointLight::getCubeFaces(mat4 faces[6])
+{
+    /* Directions and up vectors of the cube map faces (the faces are looked at from the inside, hence the flipped ups) */
+    const vec3 directions[6] = {vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0), vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0)},
+               ups[6] = {vec3(0.0, -1.0, 0.0), vec3(0.0, -1.0, 0.0), vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0), vec3(0.0, -1.0, 0.0), vec3(0.0, -1.0, 0.0)};
+
+    mat4 projection = perspective((float) radians(90.0), 1.0f, (float) SHADOW_CUBE_NEAR, m_shadowRange);
+    for(int face = 0;face < 6;face++) {
+        faces[face] = projection * lookAt(m_position, m_position + directions[face], ups[face]);
+    }
 }
 
 PointLight::~PointLight()
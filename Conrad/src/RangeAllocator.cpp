@@ -0,0 +1,137 @@
+#include "RangeAllocator.h"
+
+using namespace std;
+
+RangeAllocator::RangeAllocator()
+{
+    //ctor
+}
+
+RangeAllocator::RangeAllocator(size_t capacity)
+{
+    reset(capacity);
+}
+
+void RangeAllocator::reset(size_t capacity)
+{
+    m_freeByOffset.clear();
+    m_freeBySize.clear();
+    m_allocations.clear();
+
+    m_capacity = capacity;
+    m_used = 0;
+    if(capacity > 0) addFree(0, capacity);
+}
+
+/// \brief Best fit : the smallest free block that can hold size units. The range is taken from its start, the rest stays free.
+size_t RangeAllocator::allocate(size_t size)
+{
+    if(size == 0) return RANGE_ALLOCATOR_FAILED;
+
+    multimap<size_t, size_t>::iterator fit = m_freeBySize.lower_bound(size);
+    if(fit == m_freeBySize.end()) return RANGE_ALLOCATOR_FAILED;
+
+    size_t offset = fit->second, blockSize = fit->first;
+    removeFree(m_freeByOffset.find(offset));
+    if(blockSize > size) addFree(offset + size, blockSize - size);
+
+    m_allocations[offset] = size;
+    m_used += size;
+    return offset;
+}
+
+/// \brief Gives the range back. It is merged with the free blocks right before and after it.
+bool RangeAllocator::free(size_t offset)
+{
+    map<size_t, size_t>::iterator allocation = m_allocations.find(offset);
+    if(allocation == m_allocations.end()) return false;
+
+    size_t size = allocation->second;
+    m_allocations.erase(allocation);
+    m_used -= size;
+
+    map<size_t, size_t>::iterator next = m_freeByOffset.lower_bound(offset);
+    if(next != m_freeByOffset.end() && next->first == offset + size) {
+        size += next->second;
+        removeFree(next);
+    }
+
+    next = m_freeByOffset.lower_bound(offset);
+    if(next != m_freeByOffset.begin()) {
+        map<size_t, size_t>::iterator previous = next;
+        previous--;
+        if(previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            removeFree(previous);
+        }
+    }
+
+    addFree(offset, size);
+    return true;
+}
+
+size_t RangeAllocator::getSize(size_t offset) const
+{
+    map<size_t, size_t>::const_iterator allocation = m_allocations.find(offset);
+    return (allocation != m_allocations.end()) ? allocation->second : 0;
+}
+
+void RangeAllocator::addFree(size_t offset, size_t size)
+{
+    m_freeByOffset[offset] = size;
+    m_freeBySize.insert(make_pair(size, offset));
+}
+
+void RangeAllocator::removeFree(map<size_t, size_t>::iterator block)
+{
+    pair<multimap<size_t, size_t>::iterator, multimap<size_t, size_t>::iterator> sameSize = m_freeBySize.equal_range(block->second);
+    for(multimap<size_t, size_t>::iterator it = sameSize.first;it != sameSize.second;it++) {
+        if(it->second == block->first) {
+            m_freeBySize.erase(it);
+            break;
+        }
+    }
+
+    m_freeByOffset.erase(block);
+}
+
+size_t RangeAllocator::getCapacity() const
+{
+    return m_capacity;
+}
+
+size_t RangeAllocator::getUsed() const
+{
+    return m_used;
+}
+
+size_t RangeAllocator::getLargestFree() const
+{
+    return m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first;
+}
+
+bool RangeAllocator::isEmpty() const
+{
+    return m_allocations.empty();
+}
+
+RangeAllocator::Stats RangeAllocator::getStats() const
+{
+    Stats stats;
+    stats.capacity = m_capacity;
+    stats.used = m_used;
+    stats.allocations = m_allocations.size();
+    stats.freeBlocks = m_freeByOffset.size();
+    stats.largestFree = getLargestFree();
+
+    size_t freeUnits = m_capacity - m_used;
+    if(freeUnits > 0) stats.fragmentation = 1.0f - (float) stats.largestFree / freeUnits;
+
+    return stats;
+}
+
+RangeAllocator::~RangeAllocator()
+{
+    //dtor
+}
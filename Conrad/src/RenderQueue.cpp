@@ -0,0 +1,119 @@
+#include "RenderQueue.h"
+
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+RenderQueue::RenderQueue()
+{
+    //ctor
+}
+
+void RenderQueue::clear()
+{
+    m_items.clear();
+}
+
+void RenderQueue::push(uint64_t key, AbstractMesh *mesh)
+{
+    DrawItem item;
+    item.key = key;
+    item.mesh = mesh;
+
+    m_items.push_back(item);
+}
+
+/*!
+ *  \brief Sorts the items by increasing key. Large queues go through an LSD radix sort, 8 bits per pass : a pass is skipped when every
+ *  key has the same byte there, which is the common case for the pass and shader fields.
+ */
+void RenderQueue::sort()
+{
+    size_t count = m_items.size();
+    if(count < 2) return;
+
+    if(count < RENDER_QUEUE_RADIX_MIN) {
+        std::sort(m_items.begin(), m_items.end(), [](const DrawItem &a, const DrawItem &b) { return a.key < b.key; });
+        return;
+    }
+
+    m_scratch.resize(count);
+
+    /* One histogram per byte, in a single read of the keys */
+    size_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+
+    for(size_t i = 0;i < count;i++) {
+        uint64_t key = m_items[i].key;
+        for(int byte = 0;byte < 8;byte++) {
+            histograms[byte][(key >> (8 * byte)) & 0xFF]++;
+        }
+    }
+
+    DrawItem *source = &m_items[0],
+             *target = &m_scratch[0];
+
+    for(int byte = 0;byte < 8;byte++) {
+        size_t *histogram = histograms[byte];
+        if(histogram[(source[0].key >> (8 * byte)) & 0xFF] == count) continue; // Same byte everywhere
+
+        /* Counts to offsets */
+        size_t offset = 0;
+        for(int value = 0;value < 256;value++) {
+            size_t valueCount = histogram[value];
+            histogram[value] = offset;
+            offset += valueCount;
+        }
+
+        for(size_t i = 0;i < count;i++) {
+            target[histogram[(source[i].key >> (8 * byte)) & 0xFF]++] = source[i];
+        }
+
+        DrawItem *swap = source;
+        source = target;
+        target = swap;
+    }
+
+    if(source != &m_items[0]) m_items.swap(m_scratch); // Odd number of passes : the result is in the scratch buffer
+}
+
+size_t RenderQueue::size() const
+{
+    return m_items.size();
+}
+
+const RenderQueue::DrawItem &RenderQueue::operator[](size_t index) const
+{
+    return m_items[index];
+}
+
+uint64_t RenderQueue::makeKey(unsigned int pass, unsigned int shader, unsigned int texture, unsigned int material, float depth)
+{
+    const uint64_t depthMax = (1ull << RENDER_KEY_DEPTH_BITS) - 1;
+
+    if(depth < 0.0) depth = 0.0;
+    if(depth > 1.0) depth = 1.0;
+
+    uint64_t depthBucket = (uint64_t) (depth * depthMax);
+
+    uint64_t state = shader & ((1u << RENDER_KEY_SHADER_BITS) - 1);
+    state = (state << RENDER_KEY_TEXTURE_BITS)  | (texture & ((1u << RENDER_KEY_TEXTURE_BITS) - 1));
+    state = (state << RENDER_KEY_MATERIAL_BITS) | (material & ((1u << RENDER_KEY_MATERIAL_BITS) - 1));
+
+    uint64_t key = pass & ((1u << RENDER_KEY_PASS_BITS) - 1);
+    if(pass == RENDER_PASS_TRANSLUCENT) { // Back to front first : the states only order the surfaces at the same depth
+        key = (key << RENDER_KEY_DEPTH_BITS)    | (depthMax - depthBucket);
+        key = (key << RENDER_KEY_STATE_BITS)    | state;
+    } else {
+        key = (key << RENDER_KEY_STATE_BITS)    | state;
+        key = (key << RENDER_KEY_DEPTH_BITS)    | depthBucket;
+    }
+
+    return key;
+}
+
+RenderQueue::~RenderQueue()
+{
+    //dtor
+}
@@ -1,13 +1,19 @@
 #include "Renderer.h"
 
+#include <sstream>
+#include <cassert>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <limits>
+
 using namespace std;
 using namespace glm;
 
 Renderer::Renderer(float viewport_width, float viewport_height) :
     m_viewport_width(viewport_width), m_viewport_height(viewport_height)
 {
-    m_perspective   = perspective(70.0, 16.0/9, 0.001, 100.0);
-    m_ortho         = ortho(-50.0, 50.0, -50.0, 50.0, 0.0, 50.0);
+    m_perspective   = perspective(70.0, 16.0/9, RENDER_NEAR_PLANE, RENDER_FAR_PLANE);
 
     m_camera = new AbstractCamera;
     // Z UP Y FORWARD
@@ -23,40 +29,287 @@ Renderer::Renderer(AbstractCamera *camera) :
 
 void Renderer::setShader(Shader shader)
 {
+    m_instancedShader = shader; // Not loaded yet : gets its own program
+    m_instancedShader.addDefine(INSTANCED_SHADER_DEFINE);
+    m_octahedralShader = shader;
+    m_octahedralShader.setVertexLayout(VertexLayout::compact());
+
     m_shader = shader;
-    if(!m_shader.load()) {
+    loadMeshShaders();
+
+    if(!m_shader.hasUniformBlock(FRAME_BLOCK_NAME) || !m_shader.hasUniformBlock(LIGHTS_BLOCK_NAME) || !m_shader.hasUniformBlock(MATERIAL_BLOCK_NAME)) {
+        cout << "(Renderer) The shader doesn't declare the Frame, Lights and Material uniform blocks (see UniformBlocks.h)" << endl;
+    }
+
+    /* Uniform blocks : the per frame ones keep their binding, the materials one is bound by range per mesh */
+    m_frameBuffer.allocate(sizeof(FrameBlock));
+    m_lightsBuffer.allocate(sizeof(LightsBlock));
+    m_frameBuffer.bindBase(FRAME_BLOCK_BINDING);
+    m_lightsBuffer.bindBase(LIGHTS_BLOCK_BINDING);
+
+    GLsizeiptr alignment = UniformBuffer::getOffsetAlignment();
+    m_materialStride = (sizeof(MaterialBlock) + alignment - 1) / alignment * alignment;
+    m_materialSlots.clear();
+    m_freeMaterialSlots.clear();
+    m_materialsData.clear();
+    for(size_t i = 0;i < m_meshes.size();i++) {
+        registerMaterial(m_meshes[i]->getMaterial());
+    }
+
+    glVertexAttrib4f(COLOR_BUFFER, 1.0, 1.0, 1.0, 1.0); // Read by the meshes that have no color stream (context state, not VAO state)
+}
+
+/// \brief (Re)loads the three variants of the materials shader, with the defines of the shadow filter.
+void Renderer::loadMeshShaders()
+{
+    Shader *shaders[3] = {&m_shader, &m_instancedShader, &m_octahedralShader};
+    for(int i = 0;i < 3;i++) {
+        shaders[i]->setDefine("SHADOW_FILTER", m_shadowFilter);
+        shaders[i]->setDefine("SHADOW_POISSON_TAPS", m_poissonTaps);
+    }
+
+    if(!m_shader.load() || !m_instancedShader.load() || !m_octahedralShader.load()) {
         cout << "Error loading the shader (app will most likely crash, please make sure your GLSL is valid)." << endl;
     }
 
     /* Uniforms */
-    m_uniformLocations.cameraPos = m_shader.getUniformLocation("cameraPos");
-    m_uniformLocations.projection = m_shader.getUniformLocation("projection");
-    m_uniformLocations.camera = m_shader.getUniformLocation("camera");
     m_uniformLocations.modelview = m_shader.getUniformLocation("modelview");
     m_uniformLocations.normalMatrix = m_shader.getUniformLocation("normalMatrix");
-    m_uniformLocations.nbrLights = m_shader.getUniformLocation("nbrLights");
+    m_instancedUniformLocations.modelview = m_instancedShader.getUniformLocation("modelview");
+    m_instancedUniformLocations.normalMatrix = m_instancedShader.getUniformLocation("normalMatrix");
+    m_octahedralUniformLocations.modelview = m_octahedralShader.getUniformLocation("modelview");
+    m_octahedralUniformLocations.normalMatrix = m_octahedralShader.getUniformLocation("normalMatrix");
+
+    setSamplers(m_shader);
+    setSamplers(m_instancedShader);
+    setSamplers(m_octahedralShader);
+}
 
-    m_uniformLocations.ambientColor = m_shader.getUniformLocation("ambientColor");
-    m_uniformLocations.diffuseColor = m_shader.getUniformLocation("diffuseColor");
-    m_uniformLocations.specularColor = m_shader.getUniformLocation("specularColor");
+/*!
+ *  \brief Selects how the shadows of the atlas are filtered (SHADOW_FILTER_*) : the materials shaders are built again, the atlas maps
+ *  rendered again (for SHADOW_FILTER_ESM, they go through the blur). The GPU times of the previous filter are reported first.
+ *  poissonTaps : SHADOW_FILTER_POISSON only, [1; SHADOW_POISSON_MAX_TAPS].
+ */
+void Renderer::setShadowFilter(int filter, int poissonTaps)
+{
+    if(filter < 0 || filter >= SHADOW_FILTER_COUNT) return;
 
-    m_uniformLocations.ambientStrength = m_shader.getUniformLocation("ambientStrength");
-    m_uniformLocations.diffuseStrength = m_shader.getUniformLocation("diffuseStrength");
-    m_uniformLocations.specularStrength = m_shader.getUniformLocation("specularStrength");
-    m_uniformLocations.specularExponent = m_shader.getUniformLocation("specularExponent");
+    if(filter == SHADOW_FILTER_ESM && !m_shadowBlur.load(m_shadowAtlas.getSize(), SHADOW_ATLAS_MAX_TILE)) {
+        cout << "(Renderer) The ESM shadow filter needs the shadow blur shader (see setShadowBlurShader())" << endl;
+        return;
+    }
 
-    // Diffuse texture : always id 0. It is a constant uniform send that doesn't have to be executed every frame.
-    m_shader.bind();
-        m_shader.sendInt(m_shader.getUniformLocation("tex"), 0); // ID 0 for diffuse textures
-    m_shader.unbind();
+    reportShadowFilter();
+
+    m_shadowFilter = filter;
+    m_poissonTaps = std::max(1, std::min(poissonTaps, SHADOW_POISSON_MAX_TAPS));
+    if(m_atlasBuffer.getTextureID() != 0) m_atlasBuffer.setComparison(filter == SHADOW_FILTER_HARDWARE || filter == SHADOW_FILTER_POISSON); // Otherwise setDepthShader() will
+
+    for(map<AbstractLight*, ShadowState>::iterator state = m_shadowStates.begin();state != m_shadowStates.end();++state) {
+        state->second.tile = ShadowAtlas::Tile(); // Rendered again in their tile
+    }
+
+    if(m_shader.getProgramID() != 0) loadMeshShaders(); // Otherwise setShader() will
+}
+
+int Renderer::getShadowFilter()
+{
+    return m_shadowFilter;
+}
+
+const char *Renderer::getShadowFilterName(int filter)
+{
+    switch(filter) {
+        case SHADOW_FILTER_PCF:         return "PCF 5x5";
+        case SHADOW_FILTER_HARDWARE:    return "hardware PCF";
+        case SHADOW_FILTER_POISSON:     return "Poisson";
+        case SHADOW_FILTER_ESM:         return "ESM";
+        default:                        return "unknown";
+    }
+}
+
+/// \brief Prints the average GPU times of the frames rendered since the current shadow filter was selected, then starts a new average.
+void Renderer::reportShadowFilter()
+{
+    if(m_filterFrames > 0) {
+        cout << "(Renderer) Shadow filter " << getShadowFilterName(m_shadowFilter);
+        if(m_shadowFilter == SHADOW_FILTER_POISSON) cout << " (" << m_poissonTaps << " taps)";
+
+        if(m_filterMeasures > 0) {
+            cout << " : " << m_filterSceneTime / m_filterMeasures << " ms scene, " << m_filterShadowTime / m_filterMeasures << " ms shadow maps (GPU, average of "
+                 << m_filterMeasures << " frames)" << endl;
+        } else {
+            cout << " : GPU times n/a (" << (GPUTimer::isAvailable() ? "too few frames" : "no timer queries") << ", " << m_filterFrames << " frames)" << endl;
+        }
+    }
+
+    m_filterFrames = m_filterMeasures = 0;
+    m_filterShadowTime = m_filterSceneTime = 0.0;
+    m_filterTimerStart = m_sceneTimer.getCount();
+}
+
+/// \brief The variant of the shader for the mesh : instanced, or decoding its normals (VertexLayout::NORMALS_OCTAHEDRAL), or the plain one.
+Shader &Renderer::getMeshShader(AbstractMesh *mesh)
+{
+    if(mesh->isInstanced()) return m_instancedShader;
+    if(mesh->getVertexLayout().getNormals() == VertexLayout::NORMALS_OCTAHEDRAL) return m_octahedralShader;
+
+    return m_shader;
+}
+
+const Renderer::UniformLocations &Renderer::getMeshUniformLocations(AbstractMesh *mesh)
+{
+    if(mesh->isInstanced()) return m_instancedUniformLocations;
+    if(mesh->getVertexLayout().getNormals() == VertexLayout::NORMALS_OCTAHEDRAL) return m_octahedralUniformLocations;
+
+    return m_uniformLocations;
+}
+
+/// \brief Samplers : constant uniform sends that don't have to be executed every frame.
+void Renderer::setSamplers(Shader &shader)
+{
+    shader.bind();
+        shader.sendInt(shader.getUniformLocation("tex"), 0); // ID 0 for diffuse textures
+
+        shader.sendInt(shader.getUniformLocation("shadowAtlas"), DEPTHBUFFER_TEXTURE0 + RENDER_ATLAS_UNIT); // DepthBuffer::bindTexture() units
+
+        for(int i = 0;i < MAX_CASCADED_LIGHTS;i++) {
+            ostringstream name;
+            name << "cascadeMaps[" << i << "]";
+            shader.sendInt(shader.getUniformLocation(name.str().c_str()), DEPTHBUFFER_TEXTURE0 + RENDER_CASCADES_UNIT + i);
+        }
+
+        for(int i = 0;i < MAX_CUBE_LIGHTS;i++) {
+            ostringstream name;
+            name << "cubeMaps[" << i << "]";
+            shader.sendInt(shader.getUniformLocation(name.str().c_str()), DEPTHBUFFER_TEXTURE0 + RENDER_CUBES_UNIT + i);
+        }
+    shader.unbind();
+}
+
+/*!
+ * \brief Gives material its slot in the materials buffer (grown, and uploaded again, when full) or refreshes it if the material changed
+ * since it was written.
+ */
+GLintptr Renderer::registerMaterial(AbstractMaterial *material)
+{
+    MaterialBlock block;
+    map<unsigned int, MaterialSlot>::iterator slot = m_materialSlots.find(material->getID());
+
+    if(slot != m_materialSlots.end()) {
+        if(slot->second.revision != material->getRevision()) {
+            material->fillUniformBlock(block);
+            memcpy(&m_materialsData[slot->second.offset], &block, sizeof(MaterialBlock));
+            m_materialsBuffer.update(slot->second.offset, sizeof(MaterialBlock), &block);
+            slot->second.revision = material->getRevision();
+        }
+
+        return slot->second.offset;
+    }
+
+    /* More slots than twice the meshes : some belong to materials no mesh uses anymore (amortized, the sweep is linear) */
+    if(m_materialSlots.size() >= 2 * m_meshes.size()) reclaimMaterialSlots();
+
+    MaterialSlot newSlot;
+    newSlot.revision = material->getRevision();
+    material->fillUniformBlock(block);
+
+    if(!m_freeMaterialSlots.empty()) {
+        newSlot.offset = m_freeMaterialSlots.back();
+        m_freeMaterialSlots.pop_back();
+        memcpy(&m_materialsData[newSlot.offset], &block, sizeof(MaterialBlock));
+        m_materialsBuffer.update(newSlot.offset, sizeof(MaterialBlock), &block);
+
+        m_materialSlots[material->getID()] = newSlot;
+        return newSlot.offset;
+    }
+
+    newSlot.offset = m_materialsData.size();
+    m_materialsData.resize(m_materialsData.size() + m_materialStride, 0);
+    memcpy(&m_materialsData[newSlot.offset], &block, sizeof(MaterialBlock));
+
+    if((GLsizeiptr) m_materialsData.size() > m_materialsBuffer.getSize()) {
+        m_materialsBuffer.allocate(m_materialsData.capacity(), nullptr); // Grows as the CPU copy does
+        m_materialsBuffer.update(0, m_materialsData.size(), &m_materialsData[0]);
+    } else {
+        m_materialsBuffer.update(newSlot.offset, sizeof(MaterialBlock), &block);
+    }
+
+    m_materialSlots[material->getID()] = newSlot;
+    return newSlot.offset;
+}
+
+/// \brief Frees the slots whose material isn't the one of any mesh anymore (deleted, or replaced : if it comes back, it gets a slot again).
+void Renderer::reclaimMaterialSlots()
+{
+    vector<unsigned int> used;
+    used.reserve(m_meshes.size());
+    for(size_t i = 0;i < m_meshes.size();i++) used.push_back(m_meshes[i]->getMaterial()->getID());
+    sort(used.begin(), used.end());
+
+    for(map<unsigned int, MaterialSlot>::iterator slot = m_materialSlots.begin();slot != m_materialSlots.end();) {
+        if(binary_search(used.begin(), used.end(), slot->first)) {
+            ++slot;
+        } else {
+            m_freeMaterialSlots.push_back(slot->second.offset);
+            m_materialSlots.erase(slot++);
+        }
+    }
 }
 
 void Renderer::setDepthShader(Shader shader)
 {
+    m_instancedDepthShader = shader;
+    m_instancedDepthShader.addDefine(INSTANCED_SHADER_DEFINE);
+
     m_depthShader = shader;
-    if(!m_depthShader.load()) {
+    if(!m_depthShader.load() || !m_instancedDepthShader.load()) {
         cout << "Error loading the depth shader." << endl;
     }
+
+    m_depthUniformLocations.world = m_depthShader.getUniformLocation("world");
+    m_depthUniformLocations.modelview = m_depthShader.getUniformLocation("modelview");
+    m_instancedDepthUniformLocations.world = m_instancedDepthShader.getUniformLocation("world");
+    m_instancedDepthUniformLocations.modelview = m_instancedDepthShader.getUniformLocation("modelview");
+
+    /* Shadow atlas : its texture doesn't change, its view is made once */
+    if(m_atlasBuffer.getTextureID() == 0) {
+        m_atlasBuffer.load(DEPTHBUFFER_SIMPLE, m_shadowAtlas.getSize());
+        m_atlasBuffer.setComparison(m_shadowFilter == SHADOW_FILTER_HARDWARE || m_shadowFilter == SHADOW_FILTER_POISSON);
+
+        AbstractTexture *tex = new AbstractTexture();
+        tex->setID(m_atlasBuffer.getTextureID());
+        m_atlasPreview = new SimpleTextureGUI(tex);
+        m_guiRenderer->addGUIObject(m_atlasPreview);
+
+        m_atlasPreview->scale(0.5);
+    }
+}
+
+void Renderer::setCubeDepthShader(Shader shader)
+{
+    m_instancedCubeDepthShader = shader;
+    m_instancedCubeDepthShader.addDefine(INSTANCED_SHADER_DEFINE);
+
+    m_cubeDepthShader = shader;
+    if(!m_cubeDepthShader.load() || !m_instancedCubeDepthShader.load()) {
+        cout << "Error loading the cube depth shader." << endl;
+    }
+
+    Shader *shaders[2] = {&m_cubeDepthShader, &m_instancedCubeDepthShader};
+    CubeDepthUniformLocations *locations[2] = {&m_cubeDepthUniformLocations, &m_instancedCubeDepthUniformLocations};
+    for(int i = 0;i < 2;i++) {
+        locations[i]->modelview = shaders[i]->getUniformLocation("modelview");
+        locations[i]->faces = shaders[i]->getUniformLocation("faces");
+        locations[i]->faceMask = shaders[i]->getUniformLocation("faceMask");
+        locations[i]->lightPos = shaders[i]->getUniformLocation("lightPos");
+        locations[i]->shadowRange = shaders[i]->getUniformLocation("shadowRange");
+    }
+}
+
+void Renderer::setShadowBlurShader(Shader shader)
+{
+    m_shadowBlur.setShader(shader);
 }
 
 void Renderer::setGUIShader(Shader shader)
@@ -67,98 +320,605 @@ void Renderer::setGUIShader(Shader shader)
 
 void Renderer::render()
 {
-    glCullFace(GL_BACK);
+    unsigned long long allocations = AllocationCounter::getCount(),
+                       uniformCalls = Shader::getUniformCallCount(),
+                       bufferCalls = UniformBuffer::getCallCount();
+
+    m_shadowTimer.begin();
+    updateShadowMaps(); // Before the Lights block : a rendered map updates the world matrix of its light
+    m_shadowTimer.end();
+
+    GLState::cullFace(GL_BACK);
     m_shader.bind();
+    unsigned long long binds = 1, drawCalls = 0; // The program
 
-    /* Camera */
+    /* Camera (Frame block) */
     vec3 cameraPos = m_camera->getPos();
-    m_shader.sendVector(m_uniformLocations.cameraPos, cameraPos);
+    size_t nbrLights = std::min(m_lights.size(), (size_t) MAX_LIGHTS);
+
+    memcpy(m_frameBlock.projection, value_ptr(m_perspective), sizeof(m_frameBlock.projection));
+    memcpy(m_frameBlock.camera, value_ptr(m_camera->get_lookat()), sizeof(m_frameBlock.camera));
+    memcpy(m_frameBlock.cameraPos, value_ptr(cameraPos), sizeof(m_frameBlock.cameraPos));
+    m_frameBlock.nbrLights = nbrLights;
+    m_frameBuffer.update(0, sizeof(FrameBlock), &m_frameBlock);
+
+    /* Lights (Lights block) : only the used elements are uploaded */
+    size_t nbrCascaded = 0, nbrCubes = 0;
+    if(m_shadowFilter == SHADOW_FILTER_ESM) m_shadowBlur.bindTexture(RENDER_ATLAS_UNIT); // shadowAtlas in the shader
+    else                                    m_atlasBuffer.bindTexture(RENDER_ATLAS_UNIT);
+    for(size_t i = 0;i < nbrLights;i++) {
+        m_lights[i]->fillUniformBlock(m_lightsBlock.lights[i]);
+
+        if(m_lights[i]->isCascaded()) {
+            if(nbrCascaded < MAX_CASCADED_LIGHTS) {
+                SunLight *sun = static_cast<SunLight*>(m_lights[i]);
+                sun->fillCascadesBlock(m_lightsBlock.cascades[nbrCascaded]);
+                sun->getDepthBuffer().bindTexture(RENDER_CASCADES_UNIT + nbrCascaded); // cascadeMaps[nbrCascaded] in the shader
+
+                m_lightsBlock.lights[i].cascades = nbrCascaded++;
+            } else {
+                m_lightsBlock.lights[i].castShadow = false; // No sampler left for its cascades
+            }
+        } else if(m_lights[i]->isOmnidirectional()) {
+            if(nbrCubes < MAX_CUBE_LIGHTS) {
+                m_lights[i]->getDepthBuffer().bindTexture(RENDER_CUBES_UNIT + nbrCubes); // cubeMaps[nbrCubes] in the shader
+                m_lightsBlock.lights[i].cubeMap = nbrCubes++;
+            } else {
+                m_lightsBlock.lights[i].castShadow = false;
+            }
+        } else if(m_lights[i]->castsShadow()) {
+            ShadowState &state = m_shadowStates[m_lights[i]]; // Made by assignAtlasTiles()
+            if(state.tile.size > 0) m_shadowAtlas.getRect(state.atlasRequest, m_lightsBlock.lights[i].atlasRect);
+            else                    m_lightsBlock.lights[i].castShadow = false; // No tile this frame
+        }
+    }
+    if(nbrLights > 0) m_lightsBuffer.update(0, nbrLights * sizeof(LightBlock), &m_lightsBlock);
+    if(nbrCascaded > 0) m_lightsBuffer.update(offsetof(LightsBlock, cascades), nbrCascaded * sizeof(CascadesBlock), m_lightsBlock.cascades);
 
-        // VBOs and AttribPointers are token care of in AbstractMesh (by the VAO). Here we just send the matrices and call AbstractMesh::draw()
+    /* Render queue : one item per visible mesh, sorted to group the states */
+    mat4 view = m_camera->get_lookat();
+    m_frameVisible = cullMeshes(m_perspective * view);
+    m_frameCulled = m_meshes.size() - m_frameVisible;
+    m_queue.clear();
 
-        for(vector<AbstractMesh*>::iterator mesh = m_meshes.begin();mesh != m_meshes.end();mesh++) { // Iterating over meshes
-            // Sending matrices to the Shader
-            m_shader.sendMatrix(m_uniformLocations.projection, m_perspective);
-            m_shader.sendMatrix(m_uniformLocations.camera, m_camera->get_lookat());
-            m_shader.sendMatrix(m_uniformLocations.modelview, (*mesh)->get_modelview());
+    for(size_t i = 0;i < m_meshes.size();i++) {
+        if(!m_visible[i]) continue;
 
-            m_shader.sendMatrix(m_uniformLocations.normalMatrix, glm::transpose(glm::inverse((*mesh)->get_modelview())));
+        AbstractMesh *mesh = m_meshes[i];
+        AbstractMaterial *material = mesh->getMaterial();
+        AbstractTexture *texture = material->getDiffuseTexture();
 
-            /* Lights */
-            m_shader.sendInt(m_uniformLocations.nbrLights, m_lights.size());
-            for(int i = 0;i < m_lights.size();i++) {
-                m_lights[i]->sendUniforms(m_shader, i);
-            }
+        float depth = -(view * vec4(mesh->getWorldCenter(), 1.0)).z / RENDER_FAR_PLANE; // The camera looks down -z
+
+        unsigned int pass = (material->getAlpha() < 1.0) ? RENDER_PASS_TRANSLUCENT : RENDER_PASS_OPAQUE;
+        GLuint program = getMeshShader(mesh).getProgramID();
+        m_queue.push(RenderQueue::makeKey(pass, program, (texture != nullptr) ? texture->getID() : 0, registerMaterial(material) / m_materialStride, depth), mesh);
+    }
+    m_queue.sort();
 
-            /* Material */
-            RGB ambientColor = (*mesh)->getMaterial()->getAmbientColor(),
-                diffuseColor = (*mesh)->getMaterial()->getDiffuseColor(),
-                specularColor = (*mesh)->getMaterial()->getSpecularColor();
+        // VBOs and AttribPointers are token care of in AbstractMesh (by the VAO). Here we just send the matrices, bind what changed and draw
 
-            float   ambientStrength = (*mesh)->getMaterial()->getAmbientStrength(),
-                    diffuseStrength = (*mesh)->getMaterial()->getDiffuseStrength(),
-                    specularStrength = (*mesh)->getMaterial()->getSpecularStrength(),
-                    specularExponent = (*mesh)->getMaterial()->getSpecularExponent();
+        m_sceneTimer.begin();
+        GLState::activeTexture(0); // Diffuse texture
 
+        /* GLState drops the program, texture and VAO binds that wouldn't change anything : the binds are what it issued */
+        unsigned long long stateCalls = GLState::getIssued();
+        AbstractMaterial *boundMaterial = nullptr; // The materials buffer range isn't tracked by GLState
+        for(size_t i = 0;i < m_queue.size();i++) {
+            AbstractMesh *mesh = m_queue[i].mesh;
+            AbstractMaterial *material = mesh->getMaterial();
 
-            m_shader.sendRGB(m_uniformLocations.ambientColor, ambientColor);
-            m_shader.sendRGB(m_uniformLocations.diffuseColor, diffuseColor);
-            m_shader.sendRGB(m_uniformLocations.specularColor, specularColor);
+            /* Program : the meshes of a variant are grouped by the key */
+            Shader &shader = getMeshShader(mesh);
+            const UniformLocations &locations = getMeshUniformLocations(mesh);
+            shader.bind();
 
-            m_shader.sendFloat(m_uniformLocations.ambientStrength, ambientStrength);
-            m_shader.sendFloat(m_uniformLocations.diffuseStrength, diffuseStrength);
-            m_shader.sendFloat(m_uniformLocations.specularStrength, specularStrength);
-            m_shader.sendFloat(m_uniformLocations.specularExponent, specularExponent);
+            // Sending matrices to the Shader
+            shader.sendMatrix(locations.modelview, mesh->getVertexModelview());
+            shader.sendMatrix(locations.normalMatrix, mesh->getNormalMatrix()); // Up to date : cullMeshes() updated the world bounds
+
+            /* Material : its slot of the materials buffer */
+            if(material != boundMaterial) {
+                m_materialsBuffer.bindRange(MATERIAL_BLOCK_BINDING, registerMaterial(material), sizeof(MaterialBlock));
+                boundMaterial = material;
+                binds++;
+            }
 
-            (*mesh)->draw();
+            GLState::bindTexture(GL_TEXTURE_2D, (material->getDiffuseTexture() != nullptr) ? material->getDiffuseTexture()->getID() : 0);
+            GLState::bindVertexArray(mesh->getVertexArrayID());
+
+            mesh->drawBound();
+            drawCalls++;
         }
+        binds += GLState::getIssued() - stateCalls; // Only program, texture and VAO binds in the loop
+
+        GLState::bindVertexArray(0);
+        GLState::bindTexture(GL_TEXTURE_2D, 0);
+        m_sceneTimer.end();
 
 
     m_shader.unbind();
 
+    /* GPU times of the shadow filter, once the measures come back (never without timer queries) */
+    m_filterFrames++;
+    if(m_sceneTimer.getCount() > m_filterTimerStart + GPU_TIMER_QUERIES) { // The first ones may still be of the previous filter
+        m_filterShadowTime += m_shadowTimer.getTime();
+        m_filterSceneTime += m_sceneTimer.getTime();
+        m_filterMeasures++;
+    }
+
+    m_frameDrawCalls = drawCalls;
+    m_frameBinds = binds;
+
+    m_frameShadowPasses = m_shadowPasses - m_shadowPassesAtFrame;
+    m_shadowPassesAtFrame = m_shadowPasses;
+
+    m_frameUniformCalls = Shader::getUniformCallCount() - uniformCalls;
+    m_frameBufferCalls = UniformBuffer::getCallCount() - bufferCalls;
+
     m_guiRenderer->render();
+    GLState::endFrame();
+
+    /* Steady state : a frame must not touch the heap */
+    m_frameAllocations = AllocationCounter::getCount() - allocations;
+    m_frameCount++;
+
+    if(m_frameCount > RENDER_WARMUP_FRAMES && m_frameAllocations > 0 && !m_allocationReported) {
+        cout << "(Renderer) " << m_frameAllocations << " heap allocations in render() at frame " << m_frameCount << endl;
+        m_allocationReported = true; // Once
+        assert(m_frameAllocations == 0 && "render() allocates in the steady state"); // Debug target only (NDEBUG elsewhere) : a regression stops the app
+    }
+
+    if(m_frameCount == RENDER_WARMUP_FRAMES) {
+        cout << "(Renderer) " << m_meshes.size() << " meshes (" << m_frameVisible << " visible, " << m_frameCulled << " culled) : " << m_frameDrawCalls << " draw calls, " << m_frameBinds << " binds, "
+             << m_frameUniformCalls << " uniform calls, " << m_frameBufferCalls << " uniform buffer calls, " << m_frameShadowPasses << " shadow passes per frame" << endl;
+        cout << "(Renderer) Shadow atlas : " << m_frameAtlasTiles << " tiles, " << 100.0 * m_shadowAtlas.getUsedTexels() / ((double) m_shadowAtlas.getSize() * m_shadowAtlas.getSize()) << "% of "
+             << m_shadowAtlas.getSize() << "x" << m_shadowAtlas.getSize() << " texels used" << endl;
+        GLState::report();
+        GeometryPool::report();
+        reportMemory(false);
+    }
+}
+
+unsigned long long Renderer::getFrameCount()
+{
+    return m_frameCount;
+}
+
+unsigned long long Renderer::getFrameAllocations()
+{
+    return m_frameAllocations;
+}
+
+unsigned long long Renderer::getFrameUniformCalls()
+{
+    return m_frameUniformCalls;
+}
+
+unsigned long long Renderer::getFrameBufferCalls()
+{
+    return m_frameBufferCalls;
+}
+
+unsigned long long Renderer::getFrameDrawCalls()
+{
+    return m_frameDrawCalls;
+}
+
+unsigned long long Renderer::getFrameBinds()
+{
+    return m_frameBinds;
+}
+
+unsigned long long Renderer::getFrameVisible()
+{
+    return m_frameVisible;
+}
+
+unsigned long long Renderer::getFrameCulled()
+{
+    return m_frameCulled;
 }
 
+unsigned long long Renderer::getFrameShadowPasses()
+{
+    return m_frameShadowPasses;
+}
+
+double Renderer::getFrameShadowGPUTime()
+{
+    return m_shadowTimer.getTime();
+}
+
+double Renderer::getFrameSceneGPUTime()
+{
+    return m_sceneTimer.getTime();
+}
+
+unsigned int Renderer::getFrameAtlasTiles()
+{
+    return m_frameAtlasTiles;
+}
+
+/*!
+ *  \brief Vertex and index memory of the loaded meshes, one line per mesh if perMesh, then the scene total. Compared with the same
+ *  meshes in the float layout (VertexLayout(), 44 bytes per vertex).
+ */
+void Renderer::reportMemory(bool perMesh)
+{
+    size_t floatStride = VertexLayout().getStride();
+    size_t vertices = 0, bytes = 0, floatBytes = 0;
+
+    for(size_t i = 0;i < m_meshes.size();i++) {
+        AbstractMesh *mesh = m_meshes[i];
+        size_t meshBytes = mesh->getVertexBytes() + mesh->getIndexBytes(),
+               meshFloatBytes = (mesh->getVertexBytes() > 0) ? mesh->getVerticesCount() * floatStride + mesh->getIndexBytes() : 0;
+
+        if(perMesh) {
+            cout << "(Renderer) Mesh " << i << " : " << mesh->getVerticesCount() << " vertices x " << mesh->getVertexLayout().getStride() << " bytes ("
+                 << mesh->getVertexLayout().getName() << ") + " << mesh->getIndexBytes() << " bytes of indices = " << meshBytes / 1024 << " KiB ("
+                 << meshFloatBytes / 1024 << " KiB as floats)" << endl;
+        }
+
+        if(mesh->getVertexBytes() > 0) vertices += mesh->getVerticesCount();
+        bytes += meshBytes;
+        floatBytes += meshFloatBytes;
+    }
+
+    cout << "(Renderer) Geometry : " << m_meshes.size() << " meshes, " << vertices << " vertices, " << bytes / 1024 << " KiB (" << floatBytes / 1024 << " KiB as floats)" << endl;
+}
+
+/// \brief Refreshes the volumes of the meshes that moved (or got new bounds) : refitted in the BVH, which is rebuilt if meshes were added.
+void Renderer::updateVolumes()
+{
+    for(size_t i = 0;i < m_meshes.size();i++) {
+        if(m_meshes[i]->updateWorldBounds()) {
+            invalidateShadowMaps(&m_worldMin[3*i], &m_worldMax[3*i]); // Where it was
+
+            vec3 center = m_meshes[i]->getWorldCenter(), extents = m_meshes[i]->getWorldExtents();
+            m_culler.setVolume(i, value_ptr(center), value_ptr(extents), m_meshes[i]->getWorldRadius());
+
+            vec3 boundsMin = center - extents, boundsMax = center + extents;
+            memcpy(&m_worldMin[3*i], value_ptr(boundsMin), 3 * sizeof(float));
+            memcpy(&m_worldMax[3*i], value_ptr(boundsMax), 3 * sizeof(float));
+            if(!m_bvhDirty) m_bvh.refit(i, &m_worldMin[3*i], &m_worldMax[3*i]);
+
+            invalidateShadowMaps(&m_worldMin[3*i], &m_worldMax[3*i]); // Where it is
+        }
+    }
+
+    if(m_bvhDirty) {
+        m_bvh.build(m_meshes.size(), m_worldMin.data(), m_worldMax.data());
+        m_bvhDirty = false;
+    }
+}
+
+/// \brief Tests the mesh volumes against the frustum of viewProjection : through the BVH for large scenes (boxes only), one by one otherwise.
+/// The visible meshes then cull their parts.
+size_t Renderer::cullMeshes(const mat4 &viewProjection)
+{
+    updateVolumes();
+
+    float planes[6][4];
+    FrustumCuller::extractPlanes(value_ptr(viewProjection), planes);
+
+    size_t visibleCount;
+    if(m_meshes.size() >= RENDER_BVH_MIN_MESHES)   visibleCount = m_bvh.cullFrustum(planes, m_visible.data());
+    else                                            visibleCount = m_culler.cull(planes, m_visible.data());
+
+    for(size_t i = 0;i < m_meshes.size();i++) {
+        if(m_visible[i]) m_meshes[i]->cullParts(viewProjection); // The pieces of a BatchedMesh
+    }
+
+    return visibleCount;
+}
+
+/*!
+ *  \brief Casts a world space ray : the BVH gives the meshes whose bounds it crosses, nearest first, and their triangles are tested.
+ */
+bool Renderer::raycast(vec3 origin, vec3 direction, RayHit &hit)
+{
+    updateVolumes();
+
+    SceneBVH::RayHit bvhHit;
+    bool found = m_bvh.raycast(value_ptr(origin), value_ptr(direction), numeric_limits<float>::max(),
+        [&](size_t primitive, float tMax, float &t, unsigned int &triangle) {
+            return m_meshes[primitive]->intersectRay(origin, direction, t, triangle) && t < tMax;
+        }, bvhHit);
+
+    if(!found) return false;
+
+    hit.mesh = m_meshes[bvhHit.primitive];
+    hit.triangle = bvhHit.triangle;
+    hit.distance = bvhHit.distance;
+    return true;
+}
+
+/// \brief Flags the rendered shadow maps whose light frustum intersects the given world AABB : they are rendered again by the next render().
+void Renderer::invalidateShadowMaps(const float boundsMin[3], const float boundsMax[3])
+{
+    float center[3], extents[3];
+    for(int axis = 0;axis < 3;axis++) {
+        center[axis] = 0.5f * (boundsMin[axis] + boundsMax[axis]);
+        extents[axis] = 0.5f * (boundsMax[axis] - boundsMin[axis]);
+    }
+
+    for(map<AbstractLight*, ShadowState>::iterator state = m_shadowStates.begin();state != m_shadowStates.end();++state) {
+        if(!state->second.rendered) continue;
+
+        for(unsigned int layer = 0;layer < state->second.layers;layer++) {
+            if(FrustumCuller::intersectsBox(state->second.planes[layer], center, extents)) state->second.dirtyLayers |= 1u << layer;
+        }
+    }
+}
+
+/*!
+ *  \brief Renders the shadow maps of the lights that moved, or that a caster moved in, since their map was rendered. The others are kept.
+ *  The cascades are fitted to the camera first : only the ones whose matrix changed, or that a caster moved in, are rendered.
+ *  The lights of the atlas get their tile first : a light whose tile changed is rendered again, a light without tile isn't rendered.
+ */
+void Renderer::updateShadowMaps()
+{
+    updateVolumes(); // Flags the maps the moved meshes were or are in
+    assignAtlasTiles();
+
+    size_t nbrLights = std::min(m_lights.size(), (size_t) MAX_LIGHTS), nbrCascaded = 0, nbrCubes = 0;
+    for(size_t i = 0;i < nbrLights;i++) {
+        AbstractLight *light = m_lights[i];
+
+        /* Counted as render() does : the lights past the samplers of the shader don't cast their shadow, their maps would be wasted */
+        if(light->isCascaded() && nbrCascaded++ >= MAX_CASCADED_LIGHTS) continue;
+        if(light->isOmnidirectional() && nbrCubes++ >= MAX_CUBE_LIGHTS) continue;
+
+        if(!light->castsShadow()) continue;
+        if(light->isCascaded()) fitCascades(static_cast<SunLight*>(light));
+
+        map<AbstractLight*, ShadowState>::iterator state = m_shadowStates.find(light);
+        if(state != m_shadowStates.end() && state->second.atlasRequest >= 0) {
+            const ShadowAtlas::Tile &tile = m_shadowAtlas.getTile(state->second.atlasRequest);
+            if(tile.size == 0) continue;
+
+            if(tile.x != state->second.tile.x || tile.y != state->second.tile.y || tile.size != state->second.tile.size) {
+                renderShadowMap(light, ~0u);
+                continue;
+            }
+        }
+
+        if(state == m_shadowStates.end() || !state->second.rendered || state->second.revision != light->getRevision()) {
+            renderShadowMap(light, ~0u);
+            continue;
+        }
+
+        unsigned int stale = state->second.dirtyLayers;
+        if(light->isCascaded()) {
+            ShadowCascades &cascades = static_cast<SunLight*>(light)->getCascades();
+            for(unsigned int layer = 0;layer < state->second.layers;layer++) {
+                if(make_mat4(cascades.getMatrix(layer)) != state->second.worlds[layer]) stale |= 1u << layer;
+            }
+        }
+
+        if(stale != 0) renderShadowMap(light, stale);
+    }
+}
+
+/*!
+ *  \brief Asks the atlas for a tile per shadow casting light that has neither cascades nor a cube map : its importance is the screen size
+ *  of its range, 0 if the range is out of the camera frustum (nothing it lights is seen).
+ *  A light without tile forgets where its map was : another light may have been rendered there.
+ */
+void Renderer::assignAtlasTiles()
+{
+    float planes[6][4];
+    FrustumCuller::extractPlanes(value_ptr(m_perspective * m_camera->get_lookat()), planes);
+    vec3 cameraPos = m_camera->getPos();
+
+    m_shadowAtlas.clear();
+
+    size_t nbrLights = std::min(m_lights.size(), (size_t) MAX_LIGHTS);
+    for(size_t i = 0;i < nbrLights;i++) {
+        AbstractLight *light = m_lights[i];
+        if(!light->castsShadow() || light->isCascaded() || light->isOmnidirectional()) continue;
+
+        vec3 position = light->getPosition();
+        float range = light->getShadowRange();
+        vec3 extents(range);
+
+        float importance = 0.0;
+        if(FrustumCuller::intersectsBox(planes, value_ptr(position), value_ptr(extents))) {
+            importance = ShadowAtlas::importance(glm::distance(cameraPos, position), range, m_perspective[1][1]);
+        }
+
+        m_shadowStates[light].atlasRequest = m_shadowAtlas.request(importance);
+    }
+
+    m_frameAtlasTiles = m_shadowAtlas.pack();
+
+    for(map<AbstractLight*, ShadowState>::iterator state = m_shadowStates.begin();state != m_shadowStates.end();++state) {
+        if(state->second.atlasRequest >= 0 && m_shadowAtlas.getTile(state->second.atlasRequest).size == 0) state->second.tile = ShadowAtlas::Tile();
+    }
+}
+
+/// \brief Fits the cascades of sun to the camera frustum. The scene bounds are the union of the world bounds of the meshes.
+void Renderer::fitCascades(SunLight *sun)
+{
+    vec3 sceneMin(0.0), sceneMax(0.0);
+    for(size_t i = 0;i < m_meshes.size();i++) {
+        vec3 boundsMin = make_vec3(&m_worldMin[3*i]), boundsMax = make_vec3(&m_worldMax[3*i]);
+        sceneMin = (i == 0) ? boundsMin : glm::min(sceneMin, boundsMin);
+        sceneMax = (i == 0) ? boundsMax : glm::max(sceneMax, boundsMax);
+    }
+
+    sun->fitCascades(m_perspective * m_camera->get_lookat(), RENDER_NEAR_PLANE, RENDER_FAR_PLANE, sceneMin, sceneMax);
+}
+
+/// \brief Renders every layer of the shadow map of source now (the cascades of a SunLight are fitted to the camera first).
 void Renderer::generateShadowMap(AbstractLight *source)
 {
     if(!source->castsShadow()) return; // No DepthBuffer, no depth texture...
 
-    mat4 source_world = m_ortho * source->get_lookat();
-    source->set_world(source_world);
+    if(source->isCascaded()) {
+        updateVolumes(); // The scene bounds
+        fitCascades(static_cast<SunLight*>(source));
+    }
+
+    renderShadowMap(source, ~0u);
+}
+
+void Renderer::renderShadowMap(AbstractLight *source, unsigned int layers)
+{
+    if(source->isOmnidirectional()) {
+        renderCubeShadowMap(static_cast<PointLight*>(source)); // A single layer
+        return;
+    }
+
+    ShadowState &state = m_shadowStates[source];
+    ShadowCascades *cascades = source->isCascaded() ? &static_cast<SunLight*>(source)->getCascades() : nullptr;
+    state.layers = (cascades != nullptr) ? std::min(cascades->getCount(), (unsigned int) RENDER_SHADOW_MAX_LAYERS) : 1;
+
+    /* A light of the atlas renders into its tile only : the clear too (scissor) */
+    ShadowAtlas::Tile tile;
+    if(cascades == nullptr) {
+        if(state.atlasRequest >= 0) tile = m_shadowAtlas.getTile(state.atlasRequest);
+        if(tile.size == 0) return;
+
+        GLState::viewport(tile.x, tile.y, tile.size, tile.size);
+        GLState::enable(GL_SCISSOR_TEST);
+        glScissor(tile.x, tile.y, tile.size, tile.size);
+    } else {
+        GLState::viewport(0, 0, source->getDepthBuffer().getShadowMapWidth(), source->getDepthBuffer().getShadowMapHeight());
+    }
+
+    for(unsigned int layer = 0;layer < state.layers;layer++) {
+        if(!(layers & (1u << layer))) continue;
+
+        mat4 source_world = (cascades != nullptr) ? make_mat4(cascades->getMatrix(layer)) : source->getShadowProjection() * source->get_lookat();
+        if(cascades == nullptr) source->set_world(source_world);
 
-    /* Rendering */
-    //glCullFace(GL_FRONT);
-    m_depthShader.bind();
-    glUniformMatrix4fv(glGetUniformLocation(m_depthShader.getProgramID(), "world"), 1, GL_FALSE, value_ptr(source_world));
+        /* Rendering */
+        //glCullFace(GL_FRONT);
+        m_instancedDepthShader.bind();
+        m_instancedDepthShader.sendMatrix(m_instancedDepthUniformLocations.world, source_world);
+        m_depthShader.bind();
+        m_depthShader.sendMatrix(m_depthUniformLocations.world, source_world);
 
-    glViewport(0, 0, source->getDepthBuffer().getShadowMapWidth(), source->getDepthBuffer().getShadowMapHeight());
-    source->getDepthBuffer().bind();
+        if(cascades != nullptr) source->getDepthBuffer().bindLayer(layer);
+        else                    m_atlasBuffer.bind();
 
         glClear(GL_DEPTH_BUFFER_BIT);
 
-        for(vector<AbstractMesh*>::iterator mesh = m_meshes.begin();mesh != m_meshes.end();mesh++) { // Iterating over meshes
-            glUniformMatrix4fv(glGetUniformLocation(m_depthShader.getProgramID(), "modelview"), 1, GL_FALSE, value_ptr((*mesh)->get_modelview())); // modelview of the mesh
-            (*mesh)->draw();
+        cullMeshes(source_world); // Out of the light frustum : can't cast a shadow in the map
+        for(size_t i = 0;i < m_meshes.size();i++) { // Iterating over meshes
+            if(!m_visible[i]) continue;
+
+            bool instanced = m_meshes[i]->isInstanced();
+            Shader &depthShader = instanced ? m_instancedDepthShader : m_depthShader;
+            depthShader.bind(); // Filtered by GLState when it is already in use
+
+            depthShader.sendMatrix(instanced ? m_instancedDepthUniformLocations.modelview : m_depthUniformLocations.modelview, m_meshes[i]->getVertexModelview()); // modelview of the mesh
+            m_meshes[i]->draw();
         }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        /* Cache : up to date until the light, the layer matrix or a caster in source_world changes */
+        state.worlds[layer] = source_world;
+        FrustumCuller::extractPlanes(value_ptr(source_world), state.planes[layer]);
+        state.dirtyLayers &= ~(1u << layer);
+        m_shadowPasses++;
+    }
+
+    GLState::bindFramebuffer(0);
     m_depthShader.unbind();
 
-    glCullFace(GL_BACK);
-    glViewport(0, 0, m_viewport_width, m_viewport_height);
+    if(cascades == nullptr) {
+        GLState::disable(GL_SCISSOR_TEST);
+        state.tile = tile;
+
+        if(m_shadowFilter == SHADOW_FILTER_ESM) { // Perspective projection : its depth must be made linear (m[3][3] is 0)
+            m_shadowBlur.filter(m_atlasBuffer.getTextureID(), tile, (source->getShadowProjection()[3][3] == 0.0f) ? source->getShadowRange() : 0.0f);
+        }
+    }
+
+    GLState::cullFace(GL_BACK);
+    GLState::viewport(0, 0, m_viewport_width, m_viewport_height);
+
+    state.revision = source->getRevision();
+    state.rendered = true;
+}
+
+/*!
+ *  \brief The meshes in the range of the light are drawn once : the geometry shader projects their triangles on the faces whose frustum
+ *  intersects their bounds (faceMask). The map stores the distance to the light : the Lights block only needs its position and range.
+ *  The cache keeps a single layer, the box of the range : any face may see a caster that moves in it.
+ */
+void Renderer::renderCubeShadowMap(PointLight *light)
+{
+    ShadowState &state = m_shadowStates[light];
+    state.layers = 1;
+
+    vec3 position = light->getPosition();
+    float range = light->getShadowRange();
 
-    AbstractTexture *tex = new AbstractTexture();
-    tex->setID(source->getDepthBuffer().getTextureID());
-    SimpleTextureGUI *guiObj = new SimpleTextureGUI(tex);
-    m_guiRenderer->addGUIObject(guiObj);
+    mat4 faces[6];
+    light->getCubeFaces(faces);
 
-    guiObj->scale(0.5);
+    float planes[6][6][4];
+    for(int face = 0;face < 6;face++) FrustumCuller::extractPlanes(value_ptr(faces[face]), planes[face]);
+
+    /* The range of the light as a frustum (box), for the culling */
+    mat4 rangeBox = ortho(position.x - range, position.x + range, position.y - range, position.y + range, -(position.z + range), -(position.z - range));
+
+    Shader *shaders[2] = {&m_cubeDepthShader, &m_instancedCubeDepthShader};
+    CubeDepthUniformLocations *locations[2] = {&m_cubeDepthUniformLocations, &m_instancedCubeDepthUniformLocations};
+    for(int i = 0;i < 2;i++) {
+        shaders[i]->bind();
+        shaders[i]->sendMatrices(locations[i]->faces, 6, faces);
+        shaders[i]->sendVector(locations[i]->lightPos, position);
+        shaders[i]->sendFloat(locations[i]->shadowRange, range);
+    }
+
+    GLState::viewport(0, 0, light->getDepthBuffer().getShadowMapWidth(), light->getDepthBuffer().getShadowMapHeight());
+    light->getDepthBuffer().bind();
+
+        glClear(GL_DEPTH_BUFFER_BIT); // Every face of the layered attachment
+
+        cullMeshes(rangeBox);
+        for(size_t i = 0;i < m_meshes.size();i++) {
+            if(!m_visible[i]) continue;
+
+            /* Faces the mesh may cast a shadow in */
+            vec3 center = m_meshes[i]->getWorldCenter(), extents = m_meshes[i]->getWorldExtents();
+            int faceMask = 0;
+            for(int face = 0;face < 6;face++) {
+                if(FrustumCuller::intersectsBox(planes[face], value_ptr(center), value_ptr(extents))) faceMask |= 1 << face;
+            }
+            if(faceMask == 0) continue;
+
+            int variant = m_meshes[i]->isInstanced() ? 1 : 0;
+            shaders[variant]->bind(); // Filtered by GLState when it is already in use
+
+            shaders[variant]->sendMatrix(locations[variant]->modelview, m_meshes[i]->getVertexModelview());
+            shaders[variant]->sendInt(locations[variant]->faceMask, faceMask);
+            m_meshes[i]->draw();
+        }
+
+    GLState::bindFramebuffer(0);
+    Shader::unbind();
+
+    GLState::cullFace(GL_BACK);
+    GLState::viewport(0, 0, m_viewport_width, m_viewport_height);
+
+    /* Cache */
+    state.worlds[0] = rangeBox;
+    FrustumCuller::extractPlanes(value_ptr(rangeBox), state.planes[0]);
+    state.dirtyLayers = 0;
+    state.revision = light->getRevision();
+    state.rendered = true;
+    m_shadowPasses++;
 }
 
 void Renderer::toggleWireframe()
 {
-    if(m_wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    else            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    if(m_wireframe) GLState::polygonMode(GL_FILL);
+    else            GLState::polygonMode(GL_LINE);
 
     m_wireframe = !m_wireframe;
 }
@@ -170,6 +930,20 @@ void Renderer::toggleWireframe()
 int Renderer::addMesh(AbstractMesh *mesh)
 {
     m_meshes.push_back(mesh);
+    m_culler.resize(m_meshes.size());
+    m_visible.resize(m_meshes.size(), 1);
+    mesh->updateWorldBounds();
+    vec3 center = mesh->getWorldCenter(), extents = mesh->getWorldExtents();
+    m_culler.setVolume(m_meshes.size() - 1, value_ptr(center), value_ptr(extents), mesh->getWorldRadius());
+
+    vec3 boundsMin = center - extents, boundsMax = center + extents;
+    m_worldMin.insert(m_worldMin.end(), value_ptr(boundsMin), value_ptr(boundsMin) + 3);
+    m_worldMax.insert(m_worldMax.end(), value_ptr(boundsMax), value_ptr(boundsMax) + 3);
+    m_bvhDirty = true;
+    invalidateShadowMaps(value_ptr(boundsMin), value_ptr(boundsMax)); // A new caster
+
+    if(m_frameBuffer.getID() != 0) registerMaterial(mesh->getMaterial()); // Not before setShader()
+
     return m_meshes.size() - 1; // location of the mesh in the vector
 }
 
@@ -0,0 +1,419 @@
+#include "SceneBVH.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+namespace
+{
+    float surfaceArea(const float boundsMin[3], const float boundsMax[3])
+    {
+        float dx = boundsMax[0] - boundsMin[0], dy = boundsMax[1] - boundsMin[1], dz = boundsMax[2] - boundsMin[2];
+        return dx * dy + dy * dz + dz * dx; // Half the area : only the ratios matter
+    }
+
+    void grow(float boundsMin[3], float boundsMax[3], const float *otherMin, const float *otherMax)
+    {
+        for(int axis = 0;axis < 3;axis++) {
+            boundsMin[axis] = min(boundsMin[axis], otherMin[axis]);
+            boundsMax[axis] = max(boundsMax[axis], otherMax[axis]);
+        }
+    }
+
+    void emptyBounds(float boundsMin[3], float boundsMax[3])
+    {
+        for(int axis = 0;axis < 3;axis++) {
+            boundsMin[axis] = numeric_limits<float>::max();
+            boundsMax[axis] = -numeric_limits<float>::max();
+        }
+    }
+
+    /* Box against the planes of planeMask. \return false if the box is behind one of them. The planes it is fully in front of leave the mask. */
+    bool classifyBox(const float boundsMin[3], const float boundsMax[3], const float planes[6][4], unsigned char &planeMask)
+    {
+        for(int plane = 0;plane < 6;plane++) {
+            if(!(planeMask & (1 << plane))) continue;
+
+            const float *p = planes[plane];
+            float distance = p[3], radius = 0.0f;
+            for(int axis = 0;axis < 3;axis++) {
+                distance += p[axis] * 0.5f * (boundsMin[axis] + boundsMax[axis]);
+                radius += fabs(p[axis]) * 0.5f * (boundsMax[axis] - boundsMin[axis]);
+            }
+
+            if(distance < -radius) return false;
+            if(distance >= radius) planeMask &= ~(1 << plane);
+        }
+
+        return true;
+    }
+
+    /* Slab test. \return The entry distance, or infinity if the ray misses the box before tMax */
+    float intersectBox(const SceneBVH::Node &node, const float origin[3], const float inverseDirection[3], float tMax)
+    {
+        float tNear = 0.0f, tFar = tMax;
+        for(int axis = 0;axis < 3;axis++) {
+            float t0 = (node.boundsMin[axis] - origin[axis]) * inverseDirection[axis],
+                  t1 = (node.boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+            if(t0 > t1) swap(t0, t1);
+
+            tNear = max(tNear, t0);
+            tFar = min(tFar, t1);
+        }
+
+        return (tNear <= tFar) ? tNear : numeric_limits<float>::infinity();
+    }
+}
+
+SceneBVH::SceneBVH()
+{
+    //ctor
+}
+
+void SceneBVH::clear()
+{
+    m_nodes.clear();
+    m_parents.clear();
+    m_first.clear();
+    m_subtreeCount.clear();
+
+    m_indices.clear();
+    m_leafOf.clear();
+    m_primitiveMin.clear();
+    m_primitiveMax.clear();
+    m_centroids.clear();
+}
+
+/*!
+ *  \brief Builds the hierarchy over count boxes. The bounds are copied : refit() updates them.
+ */
+void SceneBVH::build(size_t count, const float *boundsMin, const float *boundsMax)
+{
+    clear();
+    if(count == 0) return;
+
+    m_primitiveMin.assign(boundsMin, boundsMin + 3 * count);
+    m_primitiveMax.assign(boundsMax, boundsMax + 3 * count);
+    m_centroids.resize(3 * count);
+    for(size_t i = 0;i < 3 * count;i++) m_centroids[i] = 0.5f * (boundsMin[i] + boundsMax[i]);
+
+    m_indices.resize(count);
+    for(size_t i = 0;i < count;i++) m_indices[i] = i;
+    m_leafOf.resize(count, 0);
+
+    m_nodes.reserve(2 * count - 1); // A binary tree with count leaves at most
+    m_parents.reserve(2 * count - 1);
+    m_first.reserve(2 * count - 1);
+    m_subtreeCount.reserve(2 * count - 1);
+
+    m_nodes.push_back(Node());
+    m_parents.push_back(0);
+    m_first.push_back(0);
+    m_subtreeCount.push_back(count);
+
+    subdivide(0, 0, count, 0);
+}
+
+void SceneBVH::fitNode(unsigned int node, unsigned int first, unsigned int count)
+{
+    Node &target = m_nodes[node];
+    emptyBounds(target.boundsMin, target.boundsMax);
+
+    for(unsigned int i = first;i < first + count;i++) {
+        unsigned int primitive = m_indices[i];
+        grow(target.boundsMin, target.boundsMax, &m_primitiveMin[3 * primitive], &m_primitiveMax[3 * primitive]);
+    }
+}
+
+/*!
+ *  \brief Splits the node along the cheapest of the BVH_BINS planes of each axis (binned SAH on the centroids).
+ *  The node stays a leaf when no split beats intersecting all its primitives, unless it holds more than BVH_MAX_LEAF_SIZE of them.
+ *  The depth is capped so that the traversal stacks (one entry per level, plus one) never overflow.
+ */
+void SceneBVH::subdivide(unsigned int node, unsigned int first, unsigned int count, unsigned int depth)
+{
+    fitNode(node, first, count);
+    m_nodes[node].left = 0;
+    m_nodes[node].count = count;
+    for(unsigned int i = first;i < first + count;i++) m_leafOf[m_indices[i]] = node;
+
+    if(count <= 1 || depth >= BVH_STACK_SIZE - 2) return;
+
+    float centroidMin[3], centroidMax[3];
+    emptyBounds(centroidMin, centroidMax);
+    for(unsigned int i = first;i < first + count;i++) {
+        const float *centroid = &m_centroids[3 * m_indices[i]];
+        grow(centroidMin, centroidMax, centroid, centroid);
+    }
+
+    int bestAxis = -1, bestSplit = 0;
+    float bestCost = numeric_limits<float>::max();
+
+    for(int axis = 0;axis < 3;axis++) {
+        float extent = centroidMax[axis] - centroidMin[axis];
+        if(extent <= 0.0f) continue;
+
+        float binMin[BVH_BINS][3], binMax[BVH_BINS][3];
+        unsigned int binCount[BVH_BINS] = {0};
+        for(int bin = 0;bin < BVH_BINS;bin++) emptyBounds(binMin[bin], binMax[bin]);
+
+        float scale = BVH_BINS / extent;
+        for(unsigned int i = first;i < first + count;i++) {
+            unsigned int primitive = m_indices[i];
+            int bin = min(BVH_BINS - 1, (int) ((m_centroids[3 * primitive + axis] - centroidMin[axis]) * scale));
+            binCount[bin]++;
+            grow(binMin[bin], binMax[bin], &m_primitiveMin[3 * primitive], &m_primitiveMax[3 * primitive]);
+        }
+
+        /* Sweep from the right, then from the left : cost of each split plane */
+        float rightArea[BVH_BINS - 1];
+        unsigned int rightCount[BVH_BINS - 1];
+        float sweepMin[3], sweepMax[3];
+        unsigned int sweepCount = 0;
+
+        emptyBounds(sweepMin, sweepMax);
+        for(int split = BVH_BINS - 1;split > 0;split--) {
+            sweepCount += binCount[split];
+            grow(sweepMin, sweepMax, binMin[split], binMax[split]);
+            rightCount[split - 1] = sweepCount;
+            rightArea[split - 1] = sweepCount > 0 ? surfaceArea(sweepMin, sweepMax) : 0.0f;
+        }
+
+        emptyBounds(sweepMin, sweepMax);
+        sweepCount = 0;
+        for(int split = 0;split < BVH_BINS - 1;split++) {
+            sweepCount += binCount[split];
+            grow(sweepMin, sweepMax, binMin[split], binMax[split]);
+            if(sweepCount == 0 || rightCount[split] == 0) continue;
+
+            float cost = sweepCount * surfaceArea(sweepMin, sweepMax) + rightCount[split] * rightArea[split];
+            if(cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    if(bestAxis < 0) return; // Every centroid at the same place
+
+    float leafCost = count * surfaceArea(m_nodes[node].boundsMin, m_nodes[node].boundsMax);
+    if(bestCost >= leafCost && count <= BVH_MAX_LEAF_SIZE) return;
+
+    /* Partition the range : bins [0; bestSplit] on the left */
+    float scale = BVH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+    unsigned int *middle = partition(m_indices.data() + first, m_indices.data() + first + count, [&](unsigned int primitive) {
+        int bin = min(BVH_BINS - 1, (int) ((m_centroids[3 * primitive + bestAxis] - centroidMin[bestAxis]) * scale));
+        return bin <= bestSplit;
+    });
+    unsigned int leftCount = middle - (m_indices.data() + first);
+
+    unsigned int left = m_nodes.size();
+    m_nodes.resize(left + 2);
+    m_parents.resize(left + 2, node);
+    m_first.push_back(first);
+    m_first.push_back(first + leftCount);
+    m_subtreeCount.push_back(leftCount);
+    m_subtreeCount.push_back(count - leftCount);
+
+    m_nodes[node].left = left;
+    m_nodes[node].count = 0;
+
+    subdivide(left, first, leftCount, depth + 1);
+    subdivide(left + 1, first + leftCount, count - leftCount, depth + 1);
+}
+
+/*!
+ *  \brief Moves the box of a primitive. Its leaf and the ancestors are refitted, up to the first one whose bounds don't change.
+ *  The tree doesn't adapt to the new layout : rebuild it when the primitives have moved far from where they were built.
+ */
+void SceneBVH::refit(size_t primitive, const float boundsMin[3], const float boundsMax[3])
+{
+    if(primitive >= m_leafOf.size()) return;
+
+    memcpy(&m_primitiveMin[3 * primitive], boundsMin, 3 * sizeof(float));
+    memcpy(&m_primitiveMax[3 * primitive], boundsMax, 3 * sizeof(float));
+
+    unsigned int node = m_leafOf[primitive];
+    fitNode(node, m_first[node], m_nodes[node].count);
+
+    while(node != 0) {
+        node = m_parents[node];
+
+        Node &parent = m_nodes[node];
+        const Node &left = m_nodes[parent.left], &right = m_nodes[parent.left + 1];
+
+        float newMin[3], newMax[3];
+        for(int axis = 0;axis < 3;axis++) {
+            newMin[axis] = min(left.boundsMin[axis], right.boundsMin[axis]);
+            newMax[axis] = max(left.boundsMax[axis], right.boundsMax[axis]);
+        }
+
+        if(memcmp(newMin, parent.boundsMin, sizeof(newMin)) == 0 && memcmp(newMax, parent.boundsMax, sizeof(newMax)) == 0) break;
+
+        memcpy(parent.boundsMin, newMin, sizeof(newMin));
+        memcpy(parent.boundsMax, newMax, sizeof(newMax));
+    }
+}
+
+void SceneBVH::markVisible(unsigned int node, unsigned char *visible, size_t &visibleCount) const
+{
+    for(unsigned int i = m_first[node];i < m_first[node] + m_subtreeCount[node];i++) visible[m_indices[i]] = 1;
+    visibleCount += m_subtreeCount[node];
+}
+
+/*!
+ *  \brief Box against each plane as FrustumCuller (without the bounding sphere), top-down. A plane the node is fully in front of is skipped for its subtree,
+ *  a node in front of all the planes is visible with all its primitives without any further test, a node behind one plane is culled with them.
+ *  \param visible 1 per primitive
+ */
+size_t SceneBVH::cullFrustum(const float planes[6][4], unsigned char *visible) const
+{
+    size_t visibleCount = 0;
+    memset(visible, 0, m_leafOf.size());
+    if(m_nodes.empty()) return 0;
+
+    struct Entry {
+        unsigned int node;
+        unsigned char planeMask; // Planes left to test
+    } stack[BVH_STACK_SIZE];
+
+    unsigned int stackSize = 0;
+    stack[stackSize++] = {0, 0x3F};
+
+    while(stackSize > 0) {
+        Entry entry = stack[--stackSize];
+        const Node &node = m_nodes[entry.node];
+
+        if(!classifyBox(node.boundsMin, node.boundsMax, planes, entry.planeMask)) continue;
+
+        if(entry.planeMask == 0) { // Inside
+            markVisible(entry.node, visible, visibleCount);
+            continue;
+        }
+
+        if(node.left == 0) {
+            for(unsigned int i = m_first[entry.node];i < m_first[entry.node] + node.count;i++) {
+                unsigned int primitive = m_indices[i];
+                unsigned char planeMask = entry.planeMask;
+
+                if(classifyBox(&m_primitiveMin[3 * primitive], &m_primitiveMax[3 * primitive], planes, planeMask)) {
+                    visible[primitive] = 1;
+                    visibleCount++;
+                }
+            }
+            continue;
+        }
+
+        stack[stackSize++] = {node.left + 1, entry.planeMask};
+        stack[stackSize++] = {node.left, entry.planeMask};
+    }
+
+    return visibleCount;
+}
+
+/*!
+ *  \brief Nearest hit of the ray origin + t * direction, t in [0; tMax). The children are visited nearest box first, and the boxes farther
+ *  than the closest hit so far are skipped.
+ *  \param intersect Tests the primitive itself (its triangles)
+ *  \return false if nothing is hit
+ */
+bool SceneBVH::raycast(const float origin[3], const float direction[3], float tMax, const RayCallback &intersect, RayHit &hit) const
+{
+    if(m_nodes.empty()) return false;
+
+    float inverseDirection[3];
+    for(int axis = 0;axis < 3;axis++) inverseDirection[axis] = 1.0f / direction[axis]; // +-inf on a null component : the slabs still work
+
+    bool found = false;
+    hit.distance = tMax;
+
+    unsigned int stack[BVH_STACK_SIZE];
+    unsigned int stackSize = 0;
+    if(intersectBox(m_nodes[0], origin, inverseDirection, tMax) < tMax) stack[stackSize++] = 0;
+
+    while(stackSize > 0) {
+        unsigned int nodeIndex = stack[--stackSize];
+        const Node &node = m_nodes[nodeIndex];
+
+        if(node.left == 0) {
+            for(unsigned int i = 0;i < node.count;i++) {
+                unsigned int primitive = m_indices[m_first[nodeIndex] + i];
+                float t;
+                unsigned int triangle;
+
+                if(intersect(primitive, hit.distance, t, triangle) && t < hit.distance) {
+                    hit.primitive = primitive;
+                    hit.triangle = triangle;
+                    hit.distance = t;
+                    found = true;
+                }
+            }
+            continue;
+        }
+
+        unsigned int nearChild = node.left, farChild = node.left + 1;
+        float tNear = intersectBox(m_nodes[nearChild], origin, inverseDirection, hit.distance),
+              tFar = intersectBox(m_nodes[farChild], origin, inverseDirection, hit.distance);
+        if(tFar < tNear) {
+            swap(nearChild, farChild);
+            swap(tNear, tFar);
+        }
+
+        if(tFar < hit.distance) stack[stackSize++] = farChild; // Popped last
+        if(tNear < hit.distance) stack[stackSize++] = nearChild;
+    }
+
+    return found;
+}
+
+bool SceneBVH::intersectTriangle(const float origin[3], const float direction[3], const float *v0, const float *v1, const float *v2, float &t)
+{
+    const float epsilon = 1e-8f;
+
+    float edge1[3] = {v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2]},
+          edge2[3] = {v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2]};
+
+    float p[3] = {direction[1] * edge2[2] - direction[2] * edge2[1],
+                  direction[2] * edge2[0] - direction[0] * edge2[2],
+                  direction[0] * edge2[1] - direction[1] * edge2[0]};
+    float determinant = edge1[0] * p[0] + edge1[1] * p[1] + edge1[2] * p[2];
+    if(fabs(determinant) < epsilon) return false; // Parallel (both faces are hit)
+
+    float inverseDeterminant = 1.0f / determinant;
+    float s[3] = {origin[0] - v0[0], origin[1] - v0[1], origin[2] - v0[2]};
+    float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverseDeterminant;
+    if(u < 0.0f || u > 1.0f) return false;
+
+    float q[3] = {s[1] * edge1[2] - s[2] * edge1[1],
+                  s[2] * edge1[0] - s[0] * edge1[2],
+                  s[0] * edge1[1] - s[1] * edge1[0]};
+    float v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inverseDeterminant;
+    if(v < 0.0f || u + v > 1.0f) return false;
+
+    t = (edge2[0] * q[0] + edge2[1] * q[1] + edge2[2] * q[2]) * inverseDeterminant;
+    return t > 0.0f;
+}
+
+size_t SceneBVH::getPrimitiveCount() const
+{
+    return m_leafOf.size();
+}
+
+size_t SceneBVH::getNodeCount() const
+{
+    return m_nodes.size();
+}
+
+bool SceneBVH::isBuilt() const
+{
+    return !m_nodes.empty();
+}
+
+SceneBVH::~SceneBVH()
+{
+    //dtor
+}
@@ -1,4 +1,7 @@
 #include "SceneFormatParser.h"
+#include "TextureCache.h"
+
+#include <set>
 
 using namespace std;
 using namespace glm;
@@ -17,19 +20,19 @@ SceneFormatParser::SceneFormatParser(string filepath)
 
 bool SceneFormatParser::load(string filepath)
 {
-    m_file.open(filepath.c_str(), ios::in | ios::binary);
-    if(!m_file.good()) {
-        m_loaded = false;
-        return false;
-    }
+    if(m_reader->isOpen()) m_reader = make_shared<SceneFormatReader>(); // The former mapping stays with the meshes that use it
+    m_loaded = m_reader->open(filepath);
+    return m_loaded;
+}
 
-    /* Retrieving the size of the file */
-    m_file.seekg(0, m_file.end);
-    m_filesize = m_file.tellg();
-    m_file.seekg(0, m_file.beg);
+void SceneFormatParser::setThreadCount(unsigned int threadCount)
+{
+    m_pool.setThreadCount(threadCount);
+}
 
-    m_loaded = true;
-    return true;
+void SceneFormatParser::setStaticBatchingEnabled(bool enabled)
+{
+    m_staticBatchingEnabled = enabled;
 }
 
 bool SceneFormatParser::parse()
@@ -40,30 +43,45 @@ bool SceneFormatParser::parse()
 
     cout << "Starting parsing" << endl;
 
-    Object object_buffer;
-    while(read_object(object_buffer)) {
+    /* Phase 1 : materials and lights are built here (small objects, and the meshes need their materials). Textures and meshes become tasks */
+    vector<LoadTask> tasks;
+    set<AbstractTexture *> scheduledTextures; // Materials may share a texture (TextureCache)
+
+    SceneFormatReader::Object object_buffer;
+    while(m_reader->read_object(object_buffer)) {
         cout << object_buffer.datasize << endl;
         switch(object_buffer.type) {
             case MESH_OBJECT_CODE:
             {
-                StaticMesh *mesh = parseMesh(object_buffer);
-                cout << "Found mesh." << endl;
-                m_meshes.push_back(mesh);
+                LoadTask task;
+                task.object = object_buffer;
+                tasks.push_back(task);
                 break;
             }
 
             case MATERIAL_OBJECT_CODE:
             {
-                AbstractMaterial *material = parseMaterial(object_buffer);
+                AbstractMaterial *material = buildMaterial(object_buffer);
+                if(material == nullptr) break;
+
+                AbstractTexture *texture = material->getDiffuseTexture();
+                if(!texture->isLoaded() && scheduledTextures.insert(texture).second) { // Its texture is to be loaded, once
+                    LoadTask task;
+                    task.object = object_buffer;
+                    task.texture = texture;
+                    tasks.push_back(task);
+                }
 
-                m_materials[material->getName()] = material;
                 cout << "Found material " << material->getName() << endl;
                 break;
             }
 
             case LIGHT_OBJECT_CODE:
             {
-                m_lights.push_back(parseLight(object_buffer));
+                AbstractLight *light = parseLight(object_buffer);
+                if(light == nullptr) break;
+
+                m_lights.push_back(light);
                 cout << "Found light" << endl;
                 break;
             }
@@ -93,96 +111,149 @@ bool SceneFormatParser::parse()
             }
 
         }
-
-        free(object_buffer.data_pointer);
     }
 
-    m_file.close();
+    /* Phase 2 : decoded on the workers, uploaded here as they are ready. m_materials is only read until the end of run(). */
+    m_pool.run(tasks.size(),
+        [&](size_t i) {
+            LoadTask &task = tasks[i];
+            if(task.texture != nullptr) {
+                task.decoded = task.texture->decode();
+                return;
+            }
 
-}
+            if(!decodeMesh(task.object, task.data)) return;
 
-bool SceneFormatParser::read_object(Object &object)
-{
-    char type; m_file.get(type);
-    if(m_file.eof()) return false;
+            map<string, AbstractMaterial *>::iterator material = m_materials.find(task.data.material);
+            task.mesh = prepareMesh(task.data, (material != m_materials.end()) ? material->second : nullptr, task.stats, m_reader);
+        },
+        [&](size_t i) {
+            LoadTask &task = tasks[i];
+            if(task.texture != nullptr) {
+                if(task.decoded) task.texture->load();
+                return;
+            }
 
-    char *buffer = new char[4];
-    m_file.read(buffer, 4);
-    size_t size = *reinterpret_cast<unsigned int*>(buffer);
-    if(m_file.eof()) return false;
+            if(task.mesh == nullptr) {
+                cout << "(SceneFormatParser) Malformed mesh object " << task.data.name << endl;
+                return;
+            }
 
-    char *data_pointer;
-    data_pointer = (char *) malloc(size);
-    m_file.read(data_pointer, size);
-    if(m_file.eof()) return false;
+            uploadMesh(task.mesh, task.object, task.data.name, task.stats, !m_staticBatchingEnabled);
+            cout << "Found mesh." << endl;
+        });
 
-    object.type = type;
-    object.datasize = size;
-    object.data_pointer = data_pointer;
+    if(m_staticBatchingEnabled) {
+        batchMeshes();
 
+        for(size_t i = 0;i < tasks.size();i++) {
+            if(tasks[i].texture == nullptr && tasks[i].mesh != nullptr) m_reader->release(tasks[i].object); // Uploaded
+        }
+    }
+
+    // The mapping stays open : loadMesh(), and the meshes that weren't welded point into it
     return true;
 }
 
+StaticMesh *SceneFormatParser::loadMesh(string name)
+{
+    map<string, StaticMesh *>::iterator loaded = m_meshesByName.find(name);
+    if(loaded != m_meshesByName.end()) return loaded->second;
+
+    SceneFormatReader::Object meshObject;
+    if(!m_loaded || !m_reader->find_object(MESH_OBJECT_CODE, name, meshObject)) {
+        cout << "(SceneFormatParser) No mesh named " << name << endl;
+        return nullptr;
+    }
 
+    return parseMesh(meshObject);
+}
 
-AbstractMaterial *SceneFormatParser::parseMaterial(Object materialObject)
+AbstractMaterial *SceneFormatParser::loadMaterial(string name)
 {
-    string material_name;
-    materialObject.data_pointer = extractString(materialObject.data_pointer, material_name);
-
-    int dimension;
-    float *color_pointer;
+    map<string, AbstractMaterial *>::iterator loaded = m_materials.find(name);
+    if(loaded != m_materials.end()) return loaded->second;
 
-    // Ambient color
-    materialObject.data_pointer = extractVector(materialObject.data_pointer, dimension, color_pointer);
-    RGB ambientColor(color_pointer[0], color_pointer[1], color_pointer[2]);
+    SceneFormatReader::Object materialObject;
+    if(!m_loaded || !m_reader->find_object(MATERIAL_OBJECT_CODE, name, materialObject)) {
+        cout << "(SceneFormatParser) No material named " << name << endl;
+        return nullptr;
+    }
 
-    // Diffuse color
-    materialObject.data_pointer = extractVector(materialObject.data_pointer, dimension, color_pointer);
-    RGB diffuseColor(color_pointer[0], color_pointer[1], color_pointer[2]);
+    return parseMaterial(materialObject);
+}
 
-    // Specular intensity
-    float specularIntensity;
-    materialObject.data_pointer = extract(materialObject.data_pointer, specularIntensity);
+/// \brief Builds the material, loads its texture and registers it. An already built material of the same name is returned instead.
+AbstractMaterial *SceneFormatParser::parseMaterial(SceneFormatReader::Object materialObject)
+{
+    AbstractMaterial *material = buildMaterial(materialObject);
 
-    // Specular color
-    materialObject.data_pointer = extractVector(materialObject.data_pointer, dimension, color_pointer);
-    RGB specularColor(color_pointer[0], color_pointer[1], color_pointer[2]);
+    if(material != nullptr && !material->getDiffuseTexture()->isLoaded()) {
+        material->getDiffuseTexture()->load();
+    }
 
-    // Emit color
-    materialObject.data_pointer = extractVector(materialObject.data_pointer, dimension, color_pointer);
-    RGB emitColor(color_pointer[0], color_pointer[1], color_pointer[2]);
+    return material;
+}
 
-    int specularExponent;
-    materialObject.data_pointer = extract(materialObject.data_pointer, specularExponent);
+AbstractMaterial *SceneFormatParser::buildMaterial(SceneFormatReader::Object materialObject)
+{
+    SceneFormatReader::MaterialData data;
+    if(!SceneFormatReader::decodeMaterial(materialObject, data)) {
+        cout << "(SceneFormatParser) Malformed material object" << endl;
+        return nullptr;
+    }
 
-    // Texture path
-    string texture_path;
-    materialObject.data_pointer = extractString(materialObject.data_pointer, texture_path);
+    map<string, AbstractMaterial *>::iterator loaded = m_materials.find(data.name);
+    if(loaded != m_materials.end()) return loaded->second;
 
-    AbstractMaterial *material = new AbstractMaterial(ambientColor, diffuseColor, specularColor, emitColor, specularExponent, 1.0, 0.01, 1.0, specularIntensity, 1.0, material_name);
+    RGB ambientColor(data.ambient[0], data.ambient[1], data.ambient[2]);
+    RGB diffuseColor(data.diffuse[0], data.diffuse[1], data.diffuse[2]);
+    RGB specularColor(data.specular[0], data.specular[1], data.specular[2]);
+    RGB emitColor(data.emit[0], data.emit[1], data.emit[2]);
 
-    AbstractTexture *texture = new AbstractTexture(texture_path);
-    texture->load();
+    AbstractMaterial *material = new AbstractMaterial(ambientColor, diffuseColor, specularColor, emitColor, data.specularExponent, 1.0, 0.01, 1.0, data.specularIntensity, 1.0, data.name);
 
+    AbstractTexture *texture = TextureCache::acquire(data.texturePath, false); // Decoded and uploaded by the caller
     material->setDiffuseTexture(texture);
 
+    m_materials[data.name] = material;
     return material;
 }
 
-StaticMesh *SceneFormatParser::parseMesh(Object meshObject)
+/// \brief Builds and uploads the mesh, then registers it. An already built mesh of the same name is returned instead.
+StaticMesh *SceneFormatParser::parseMesh(SceneFormatReader::Object meshObject)
 {
-    char mesh_type;
-    meshObject.data_pointer = extract(meshObject.data_pointer, mesh_type);
+    SceneFormatReader::MeshData data;
+    if(!decodeMesh(meshObject, data)) {
+        cout << "(SceneFormatParser) Malformed mesh object " << data.name << endl;
+        return nullptr;
+    }
 
-    GLenum meshType;
-    switch(mesh_type) {
-        case OBJTYPE_STATIC:
-        {
-            meshType = GL_STATIC_DRAW;
-            break;
-        }
+    map<string, StaticMesh *>::iterator loaded = m_meshesByName.find(data.name);
+    if(loaded != m_meshesByName.end()) return loaded->second;
+
+    AbstractMaterial *material = loadMaterial(data.material); // Already built when the materials come first in the file
+
+    MeshOptimizer::Stats stats;
+    StaticMesh *mesh = prepareMesh(data, material, stats, m_reader);
 
+    return uploadMesh(mesh, meshObject, data.name, stats);
+}
+
+bool SceneFormatParser::decodeMesh(SceneFormatReader::Object meshObject, SceneFormatReader::MeshData &data)
+{
+    return SceneFormatReader::decodeMesh(meshObject, data) && data.texCount == data.verticesCount && data.normalsCount == data.verticesCount;
+}
+
+/*!
+ *  \brief CPU side of a mesh : everything but the upload. No GL call and no parser state : safe on a worker thread.
+ *  \param material nullptr to keep the default material
+ */
+StaticMesh *SceneFormatParser::prepareMesh(const SceneFormatReader::MeshData &data, AbstractMaterial *material, MeshOptimizer::Stats &stats,
+                                           const shared_ptr<SceneFormatReader> &reader)
+{
+    GLenum meshType;
+    switch(data.meshType) {
         case OBJTYPE_DYNAMIC:
         {
             meshType = GL_DYNAMIC_DRAW;
@@ -194,78 +265,91 @@ StaticMesh *SceneFormatParser::parseMesh(Object meshObject)
             meshType = GL_STREAM_DRAW;
             break;
         }
+
+        default:
+        {
+            meshType = GL_STATIC_DRAW;
+            break;
+        }
     }
 
-    string mesh_name;
-    meshObject.data_pointer = extractString(meshObject.data_pointer, mesh_name);
+    float *colors = (float *) malloc(data.verticesCount * 3 * sizeof(float));
+    fill_n(colors, data.verticesCount * 3, 1.0);
 
-    // Vertices
-    int verticesCount, dimension;
-    float *vertices;
-    meshObject.data_pointer = extractVectorArray(meshObject.data_pointer, verticesCount, dimension, vertices);
+    /* No copy : the arrays are views into the mapping (read-only). The optimizer welds them into new arrays, it never writes them. */
+    StaticMesh *mesh = new StaticMesh(data.verticesCount, (float *) data.vertices, colors, (float *) data.texCoords, (float *) data.vertexNormals);
+    mesh->adoptArrays(MESH_ARRAY_COLORS); // Freed with the mesh, or by optimize() when the weld replaces them
+    if(material != nullptr) mesh->setMaterial(material);
 
-    // Material name
-    string material_name;
-    meshObject.data_pointer = extractString(meshObject.data_pointer, material_name);
+    if(MeshOptimizer::isEnabled()) stats = mesh->optimize();
+    if(mesh->getVertices() == data.vertices) mesh->setArraysStorage(reader); // Not welded into copies : still views into the mapping
+    mesh->computeBounds(); // Not left to load()
 
-    // Textures (dimension 2 vector array)
-    int texCount;
-    float *texCoords;
-    meshObject.data_pointer = extractVectorArray(meshObject.data_pointer, texCount, dimension, texCoords);
+    return mesh;
+}
 
-    // Normals
-    int normalsCount;
-    float *vertexNormals;
-    meshObject.data_pointer = extractVectorArray(meshObject.data_pointer, normalsCount, dimension, vertexNormals);
+/// \brief GL side of a mesh (GL thread only) : uploads the prepared mesh and registers it. A duplicate name keeps the first mesh (the other one is deleted).
+StaticMesh *SceneFormatParser::uploadMesh(StaticMesh *mesh, const SceneFormatReader::Object &meshObject, const string &name, const MeshOptimizer::Stats &stats, bool load)
+{
+    map<string, StaticMesh *>::iterator loaded = m_meshesByName.find(name);
+    if(loaded != m_meshesByName.end()) {
+        delete mesh;
+        return loaded->second;
+    }
 
-    float *colors = (float *) malloc(verticesCount * 3 * sizeof(float));
-    fill_n(colors, verticesCount * 3, 1.0);
+    if(MeshOptimizer::isEnabled()) MeshOptimizer::report(name, stats);
 
-    StaticMesh *mesh = new StaticMesh(verticesCount, vertices, colors, texCoords, vertexNormals);
-    mesh->setMaterial(m_materials.at(material_name));
-    mesh->load(); // <<-- LOADS IT FOR NOW
+    if(load) {
+        mesh->load(); // <<-- LOADS IT FOR NOW
+        m_reader->release(meshObject); // Uploaded : the mapped pages aren't needed in memory anymore
+    }
 
+    m_meshes.push_back(mesh);
+    m_meshesByName[name] = mesh;
     return mesh;
 }
 
-AbstractLight *SceneFormatParser::parseLight(Object lightObject)
+/// \brief Replaces the registered meshes by their batches (see BatchedMesh::batch()), each name pointing to what its mesh became, and loads them.
+void SceneFormatParser::batchMeshes()
 {
-    char light_type;
-    lightObject.data_pointer = extract(lightObject.data_pointer, light_type);
-
-    float *vec3_buffer;
-    int dimension;
+    vector<size_t> destination;
+    vector<StaticMesh *> batched = BatchedMesh::batch(m_meshes, destination);
 
-    /* Position */
-    lightObject.data_pointer = extractVector(lightObject.data_pointer, dimension, vec3_buffer);
-    vec3 position(vec3_buffer[0], vec3_buffer[1], vec3_buffer[2]);
-    cout << vec3_buffer[0] << " " << vec3_buffer[1] << " " << vec3_buffer[2] << endl;
+    map<StaticMesh *, size_t> indices;
+    for(size_t i = 0;i < m_meshes.size();i++) indices[m_meshes[i]] = i;
+    for(map<string, StaticMesh *>::iterator it = m_meshesByName.begin();it != m_meshesByName.end();it++) {
+        it->second = batched[destination[indices[it->second]]];
+    }
 
-    /* Color */
-    lightObject.data_pointer = extractVector(lightObject.data_pointer, dimension, vec3_buffer);
-    vec3 color(vec3_buffer[0], vec3_buffer[1], vec3_buffer[2]);
+    m_meshes = batched;
+    for(size_t i = 0;i < m_meshes.size();i++) {
+        if(!m_meshes[i]->isLoaded()) m_meshes[i]->load(); // Some may come from loadMesh()
+    }
+}
 
-    /* Direction */
-    lightObject.data_pointer = extractVector(lightObject.data_pointer, dimension, vec3_buffer);
-    vec3 direction(vec3_buffer[0], vec3_buffer[1], vec3_buffer[2]);
-    cout << vec3_buffer[0] << " " << vec3_buffer[1] << " " << vec3_buffer[2] << endl;
+AbstractLight *SceneFormatParser::parseLight(SceneFormatReader::Object lightObject)
+{
+    SceneFormatReader::LightData data;
+    if(!SceneFormatReader::decodeLight(lightObject, data)) {
+        cout << "(SceneFormatParser) Malformed light object" << endl;
+        return nullptr;
+    }
 
-    /* Maximum angle */
-    float intensity;
-    lightObject.data_pointer = extract(lightObject.data_pointer, intensity);
-    cout << "Intensity : " << intensity << endl;
+    vec3 position(data.position[0], data.position[1], data.position[2]);
+    vec3 color(data.color[0], data.color[1], data.color[2]);
+    vec3 direction(data.direction[0], data.direction[1], data.direction[2]);
 
-    /* Cast Shadow */
-    bool castShadow;
-    lightObject.data_pointer = extract(lightObject.data_pointer, castShadow);
-    cout << "Cast shadow : " << castShadow << endl;
+    cout << position.x << " " << position.y << " " << position.z << endl;
+    cout << direction.x << " " << direction.y << " " << direction.z << endl;
+    cout << "Intensity : " << data.intensity << endl;
+    cout << "Cast shadow : " << data.castShadow << endl;
 
-    switch(light_type)
+    switch(data.lightType)
     {
         case LIGHT_POINT_CODE:
         {
             cout << "Type : point" << endl;
-            PointLight *light = new PointLight(position, color, intensity, castShadow);
+            PointLight *light = new PointLight(position, color, data.intensity, data.castShadow);
             return light;
 
             break;
@@ -274,7 +358,7 @@ AbstractLight *SceneFormatParser::parseLight(Object lightObject)
         case LIGHT_SUN_CODE:
         {
             cout << "Type : sun" << endl;
-            SunLight *light = new SunLight(position, direction, color, intensity, castShadow);
+            SunLight *light = new SunLight(position, direction, color, data.intensity, data.castShadow);
             return light;
 
             break;
@@ -283,13 +367,15 @@ AbstractLight *SceneFormatParser::parseLight(Object lightObject)
         case LIGHT_SPOT_CODE:
         {
             cout << "Type : spot" << endl;
-            SpotLight *light = new SpotLight(position, color, direction, 45, 60, intensity, castShadow, 0.08, 0.08, 1000.0);
+            SpotLight *light = new SpotLight(position, color, direction, 45, 60, data.intensity, data.castShadow, 0.08, 0.08, 1000.0);
             return light;
 
             break;
         }
 
     }
+
+    return nullptr; // Unknown light type
 }
 
 vector<StaticMesh *> *SceneFormatParser::getMeshes()
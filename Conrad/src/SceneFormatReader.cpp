@@ -0,0 +1,265 @@
+#include "SceneFormatReader.h"
+
+#include <iostream>
+
+using namespace std;
+
+SceneFormatReader::SceneFormatReader()
+{
+    //ctor
+}
+
+bool SceneFormatReader::open(string filepath)
+{
+    close();
+
+    if(!m_file.open(filepath)) {
+        return false;
+    }
+
+    if(m_file.size() >= SCENE_HEADER_SIZE && memcmp(m_file.data(), SCENE_MAGIC, 4) == 0) { // v1 starts with an object code
+        memcpy(&m_version, m_file.data() + 4, sizeof(int));
+        if(m_version < 2 || m_version > SCENE_VERSION) {
+            cout << "(SceneFormatReader) Unsupported .scene version " << m_version << endl;
+            close();
+            return false;
+        }
+
+        readTableOfContents();
+    } else {
+        m_version = 1;
+        buildTableOfContents();
+    }
+
+    return true;
+}
+
+void SceneFormatReader::close()
+{
+    m_file.close();
+    m_version = 0;
+
+    m_toc.clear();
+    m_index.clear();
+    m_next = 0;
+}
+
+bool SceneFormatReader::isOpen()
+{
+    return m_file.isOpen();
+}
+
+size_t SceneFormatReader::size()
+{
+    return m_file.size();
+}
+
+int SceneFormatReader::getVersion()
+{
+    return m_version;
+}
+
+const vector<SceneFormatReader::Entry> &SceneFormatReader::getTableOfContents()
+{
+    return m_toc;
+}
+
+/*!
+ *  \brief v2 header : magic (4 chars), version, object count, table offset (3 unsigned int).
+ *  Table entries : type (1 byte), data offset, data size (2 unsigned int), null terminated name.
+ *  An entry that doesn't fit in the file stops the reading : the previous ones are kept.
+ */
+bool SceneFormatReader::readTableOfContents()
+{
+    unsigned int count, tableOffset;
+    memcpy(&count, m_file.data() + 8, sizeof(unsigned int));
+    memcpy(&tableOffset, m_file.data() + 12, sizeof(unsigned int));
+
+    if(tableOffset < SCENE_HEADER_SIZE || tableOffset > m_file.size()) {
+        cout << "(SceneFormatReader) Invalid table of contents offset" << endl;
+        return false;
+    }
+
+    Object table;
+    table.data_pointer = m_file.data() + tableOffset;
+    table.data_end = m_file.end();
+
+    for(unsigned int i = 0;i < count;i++) {
+        Entry entry;
+        unsigned int offset;
+
+        extract(table, entry.type);
+        extract(table, offset);
+        extract(table, entry.size);
+        extractString(table, entry.name);
+
+        if(table.overflow) {
+            cout << "(SceneFormatReader) Truncated table of contents (" << i << "/" << count << " objects)" << endl;
+            return false;
+        }
+
+        if(offset < SCENE_HEADER_SIZE || offset > m_file.size() || entry.size > m_file.size() - offset) {
+            cout << "(SceneFormatReader) Object " << entry.name << " is out of the file" << endl;
+            continue;
+        }
+
+        entry.offset = offset;
+        addEntry(entry);
+    }
+
+    return true;
+}
+
+/*!
+ *  \brief Walks the v1 object headers (1 byte type, 4 bytes size). Only the names are read from the data : a mesh name follows its type (1 byte),
+ *  a material starts with its name.
+ */
+void SceneFormatReader::buildTableOfContents()
+{
+    const char *iterator = m_file.data();
+
+    while(iterator != nullptr && iterator != m_file.end()) {
+        size_t remaining = m_file.end() - iterator;
+        if(remaining < 1 + sizeof(unsigned int)) {
+            cout << "(SceneFormatReader) Truncated object header" << endl;
+            return;
+        }
+
+        Entry entry;
+        entry.type = iterator[0];
+        memcpy(&entry.size, iterator + 1, sizeof(unsigned int));
+
+        if(entry.size > remaining - 1 - sizeof(unsigned int)) {
+            cout << "(SceneFormatReader) Truncated object (" << entry.size << " bytes announced, " << remaining - 1 - sizeof(unsigned int) << " left)" << endl;
+            return;
+        }
+
+        entry.offset = (iterator - m_file.data()) + 1 + sizeof(unsigned int);
+
+        Object object = view(entry);
+        if(entry.type == MESH_OBJECT_CODE) {
+            char meshType;
+            extract(object, meshType);
+            extractString(object, entry.name);
+        } else if(entry.type == MATERIAL_OBJECT_CODE) {
+            extractString(object, entry.name);
+        }
+
+        addEntry(entry);
+        iterator = object.data_end;
+    }
+}
+
+void SceneFormatReader::addEntry(const Entry &entry)
+{
+    m_toc.push_back(entry);
+    if(!entry.name.empty()) m_index.insert(make_pair(make_pair(entry.type, entry.name), m_toc.size() - 1));
+}
+
+SceneFormatReader::Object SceneFormatReader::view(const Entry &entry)
+{
+    Object object;
+    object.type = entry.type;
+    object.datasize = entry.size;
+    object.data_pointer = m_file.data() + entry.offset;
+    object.data_end = object.data_pointer + entry.size;
+    object.overflow = false;
+    object.aligned = (m_version >= 2);
+
+    return object;
+}
+
+/// \brief Goes back to the first object of the file.
+void SceneFormatReader::rewind()
+{
+    m_next = 0;
+}
+
+void SceneFormatReader::release(const Object &object)
+{
+    m_file.release(object.data_end - object.datasize, object.data_end);
+}
+
+/// \brief Makes object a view on the data of the next object, in the file order. \return false after the last object.
+bool SceneFormatReader::read_object(Object &object)
+{
+    if(m_next >= m_toc.size()) return false;
+
+    object = view(m_toc[m_next++]);
+    return true;
+}
+
+/// \brief Makes object a view on the data of the object named name. Nothing before it is read. \return false if there is no such object.
+bool SceneFormatReader::find_object(char type, const string &name, Object &object)
+{
+    map<pair<char, string>, size_t>::iterator entry = m_index.find(make_pair(type, name));
+    if(entry == m_index.end()) return false;
+
+    object = view(m_toc[entry->second]);
+    return true;
+}
+
+/// \return false if the object is malformed. The arrays of mesh are views into the mapping.
+bool SceneFormatReader::decodeMesh(Object meshObject, MeshData &mesh)
+{
+    int dimension;
+
+    extract(meshObject, mesh.meshType);
+    extractString(meshObject, mesh.name);
+
+    // Vertices
+    extractVectorArray(meshObject, mesh.verticesCount, dimension, mesh.vertices);
+    if(dimension != 3) meshObject.overflow = true;
+
+    // Material name
+    extractString(meshObject, mesh.material);
+
+    // Textures (dimension 2 vector array)
+    extractVectorArray(meshObject, mesh.texCount, dimension, mesh.texCoords);
+    if(dimension != 2) meshObject.overflow = true;
+
+    // Normals
+    extractVectorArray(meshObject, mesh.normalsCount, dimension, mesh.vertexNormals);
+    if(dimension != 3) meshObject.overflow = true;
+
+    return !meshObject.overflow;
+}
+
+bool SceneFormatReader::decodeMaterial(Object materialObject, MaterialData &material)
+{
+    extractString(materialObject, material.name);
+
+    extractVec3(materialObject, material.ambient);
+    extractVec3(materialObject, material.diffuse);
+    extract(materialObject, material.specularIntensity);
+    extractVec3(materialObject, material.specular);
+    extractVec3(materialObject, material.emit);
+    extract(materialObject, material.specularExponent);
+
+    // Texture path
+    extractString(materialObject, material.texturePath);
+
+    return !materialObject.overflow;
+}
+
+bool SceneFormatReader::decodeLight(Object lightObject, LightData &light)
+{
+    extract(lightObject, light.lightType);
+
+    extractVec3(lightObject, light.position);
+    extractVec3(lightObject, light.color);
+    extractVec3(lightObject, light.direction);
+
+    extract(lightObject, light.intensity);
+
+    char castShadow; // 1 byte
+    extract(lightObject, castShadow);
+    light.castShadow = (castShadow != 0);
+
+    return !lightObject.overflow;
+}
+
+SceneFormatReader::~SceneFormatReader()
+{
+    //dtor
+}
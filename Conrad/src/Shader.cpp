@@ -1,8 +1,13 @@
 #include "Shader.h"
+#include "UniformBlocks.h"
+
+#include <sstream>
 
 using namespace std;
 using namespace glm;
 
+unsigned long long Shader::s_uniformCalls = 0;
+
 Shader::Shader()
 {
 
@@ -36,6 +41,27 @@ void Shader::setGeometryPath(string geometryPath)
     m_usesGeometryShader = true;
 }
 
+void Shader::addDefine(string name)
+{
+    m_defines += "#define " + name + "\n";
+}
+
+/// \brief Adds "#define name value", or replaces the value of a define set by a previous call. Effective at the next load().
+void Shader::setDefine(string name, int value)
+{
+    ostringstream line;
+    line << "#define " << name << " " << value << "\n";
+
+    size_t position = m_defines.find("#define " + name + " ");
+    if(position == string::npos)    m_defines += line.str();
+    else                            m_defines.replace(position, m_defines.find('\n', position) + 1 - position, line.str());
+}
+
+void Shader::setVertexLayout(const VertexLayout &layout)
+{
+    for(const string &define : layout.getShaderDefines()) addDefine(define);
+}
+
 bool Shader::load()
 {
     cout << glIsShader(m_vertexID) << endl;
@@ -56,20 +82,21 @@ bool Shader::load()
     }
 
     if(glIsProgram(m_programID) == GL_TRUE) {
+        GLState::forgetProgram(m_programID);
         glDeleteProgram(m_programID);
     }
 
     /* Compiling vertex and fragment shaders */
-    if(!Shader::compile(m_vertexID, GL_VERTEX_SHADER, m_vertexPath)) {
+    if(!Shader::compile(m_vertexID, GL_VERTEX_SHADER, m_vertexPath, m_defines)) {
         return false;
     }
 
-    if(!Shader::compile(m_fragmentID, GL_FRAGMENT_SHADER, m_fragmentPath)) {
+    if(!Shader::compile(m_fragmentID, GL_FRAGMENT_SHADER, m_fragmentPath, m_defines)) {
         return false;
     }
 
     if(m_usesGeometryShader) {
-        if(!Shader::compile(m_geometryID, GL_GEOMETRY_SHADER, m_geometryPath)) {
+        if(!Shader::compile(m_geometryID, GL_GEOMETRY_SHADER, m_geometryPath, m_defines)) {
             return false;
         }
     }
@@ -83,11 +110,13 @@ bool Shader::load()
     if(m_usesGeometryShader)    glAttachShader(m_programID, m_geometryID);
 
     /* VertexAttribPointer IDs (those are universal in the engine) */
-    // Links "in" variable in the shader with the VertexAttribPointer IDs
-    glBindAttribLocation(m_programID, VERTEX_BUFFER, "in_Vertex");
-    glBindAttribLocation(m_programID, COLOR_BUFFER, "in_Color");
-    glBindAttribLocation(m_programID, TEX_BUFFER, "in_TexCoord0"); // Multitexturing isn't supported for now
-    glBindAttribLocation(m_programID, VERTEX_NORMAL_BUFFER, "in_VertexNormal");
+    // Links "in" variable in the shader with the VertexAttribPointer IDs : every attribute a VertexLayout can hold, whatever its encoding
+    for(const VertexLayout::Attribute &attribute : VertexLayout().getAttributes()) { // Multitexturing isn't supported for now
+        glBindAttribLocation(m_programID, attribute.location, attribute.name);
+    }
+    glBindAttribLocation(m_programID, COLOR_BUFFER, "in_Color"); // shaders/basic
+    glBindAttribLocation(m_programID, INSTANCE_MODELVIEW_BUFFER, "in_InstanceModelview"); // Instanced variants only
+    glBindAttribLocation(m_programID, INSTANCE_NORMAL_BUFFER, "in_InstanceNormalMatrix");
     // TODO : Add multitexturing
 
     /* Linking */
@@ -107,15 +136,46 @@ bool Shader::load()
             cout << error << endl;
 
             delete[] error;
+            GLState::forgetProgram(m_programID);
             glDeleteProgram(m_programID);
 
             return false;
         }
 
+    bindUniformBlocks();
+
     return true;
 }
 
-bool Shader::compile(GLuint &id, GLenum type, string const path)
+/// \brief Attaches the uniform blocks the program declares to the engine binding points (UniformBlocks.h).
+void Shader::bindUniformBlocks()
+{
+    struct {
+        const char *name;
+        GLuint binding;
+    } blocks[] = {
+        {FRAME_BLOCK_NAME, FRAME_BLOCK_BINDING},
+        {LIGHTS_BLOCK_NAME, LIGHTS_BLOCK_BINDING},
+        {MATERIAL_BLOCK_NAME, MATERIAL_BLOCK_BINDING},
+    };
+
+    for(size_t i = 0;i < sizeof(blocks) / sizeof(blocks[0]);i++) {
+        GLuint index = glGetUniformBlockIndex(m_programID, blocks[i].name);
+        if(index != GL_INVALID_INDEX) glUniformBlockBinding(m_programID, index, blocks[i].binding);
+    }
+}
+
+bool Shader::hasUniformBlock(const GLchar *name) const
+{
+    return glGetUniformBlockIndex(m_programID, name) != GL_INVALID_INDEX;
+}
+
+unsigned long long Shader::getUniformCallCount()
+{
+    return s_uniformCalls;
+}
+
+bool Shader::compile(GLuint &id, GLenum type, string const path, string const defines)
 {
     id = glCreateShader(type);
     if(id == 0) {
@@ -137,6 +197,11 @@ bool Shader::compile(GLuint &id, GLenum type, string const path)
 
         file.close();
 
+        if(!defines.empty()) { // After #version, which must stay first
+            size_t position = (source.compare(0, 8, "#version") == 0) ? source.find('\n') + 1 : 0;
+            source.insert(position, defines);
+        }
+
     /* Compiling shader */
         const GLchar *source_cstr = source.c_str();
         glShaderSource(id, 1, &source_cstr, 0);
@@ -167,7 +232,7 @@ bool Shader::compile(GLuint &id, GLenum type, string const path)
 
 void Shader::bind()
 {
-    glUseProgram(m_programID);
+    GLState::useProgram(m_programID);
 }
 
 GLuint Shader::getProgramID()
@@ -199,5 +264,6 @@ Shader::~Shader()
 {
     glDeleteShader(m_vertexID);
     glDeleteShader(m_fragmentID);
+    GLState::forgetProgram(m_programID);
     glDeleteProgram(m_programID);
 }
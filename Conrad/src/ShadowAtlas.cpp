@@ -0,0 +1,148 @@
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+
+using namespace std;
+
+ShadowAtlas::ShadowAtlas(unsigned int size, unsigned int maxTile, unsigned int minTile) :
+    m_size(size), m_maxTile(std::min(maxTile, size)), m_minTile(std::min(minTile, maxTile))
+{
+
+}
+
+void ShadowAtlas::clear()
+{
+    m_importances.clear();
+    m_tiles.clear();
+    m_order.clear();
+    m_usedTexels = 0;
+}
+
+size_t ShadowAtlas::request(float importance)
+{
+    m_importances.push_back(importance);
+    m_tiles.push_back(Tile());
+    return m_tiles.size() - 1;
+}
+
+/*!
+ *  \brief Screen size of the range of a light seen from distance, as a fraction of the screen height : 1 when the camera is in its range.
+ */
+float ShadowAtlas::importance(float distance, float range, float projectionScale)
+{
+    if(distance <= range) return 1.0;
+    return std::min(1.0f, range * projectionScale / distance);
+}
+
+/// \brief The power of two that covers importance * maxTile texels, clamped to [minTile; maxTile]. 0 for no importance.
+unsigned int ShadowAtlas::tileSize(float importance, unsigned int minTile, unsigned int maxTile)
+{
+    if(importance <= 0.0) return 0;
+
+    float target = importance * maxTile;
+    unsigned int size = minTile;
+    while(size < target && size < maxTile) size *= 2;
+
+    return size;
+}
+
+/*!
+ *  \brief Gives the tiles : the wanted sizes are reduced, least important first, until they fit in the atlas, then placed from the largest.
+ *  A tile of side s starts on a multiple of s² cells of the Z-order curve (the previous tiles are as large or larger) : that's an aligned
+ *  s x s square of the atlas.
+ */
+unsigned int ShadowAtlas::pack()
+{
+    m_order.clear();
+    unsigned long long capacity = (unsigned long long) m_size * m_size, total = 0;
+
+    for(size_t i = 0;i < m_tiles.size();i++) {
+        m_tiles[i] = Tile();
+        m_tiles[i].size = tileSize(m_importances[i], m_minTile, m_maxTile);
+        if(m_tiles[i].size == 0) continue;
+
+        total += (unsigned long long) m_tiles[i].size * m_tiles[i].size;
+        m_order.push_back(i);
+    }
+
+    /* Most important first (the index breaks the ties : the same lights give the same atlas) */
+    sort(m_order.begin(), m_order.end(), [this](size_t a, size_t b) {
+        if(m_importances[a] != m_importances[b]) return m_importances[a] > m_importances[b];
+        return a < b;
+    });
+
+    while(total > capacity) {
+        bool halved = false;
+        for(size_t k = m_order.size();k-- > 0 && total > capacity;) {
+            Tile &tile = m_tiles[m_order[k]];
+            if(tile.size <= m_minTile) continue;
+
+            total -= 3ull * tile.size * tile.size / 4;
+            tile.size /= 2;
+            halved = true;
+        }
+
+        if(!halved) { // Every tile is at the minimum : the least important light gets none
+            Tile &tile = m_tiles[m_order.back()];
+            total -= (unsigned long long) tile.size * tile.size;
+            tile.size = 0;
+            m_order.pop_back();
+        }
+    }
+
+    /* Largest first, in importance order for a given size (not stable_sort : it may allocate, and pack() runs every frame) */
+    sort(m_order.begin(), m_order.end(), [this](size_t a, size_t b) {
+        if(m_tiles[a].size != m_tiles[b].size) return m_tiles[a].size > m_tiles[b].size;
+        if(m_importances[a] != m_importances[b]) return m_importances[a] > m_importances[b];
+        return a < b;
+    });
+
+    unsigned long long cursor = 0; // Z-order index, in cells of m_minTile texels
+    for(size_t k = 0;k < m_order.size();k++) {
+        Tile &tile = m_tiles[m_order[k]];
+
+        /* De-interleaving the index : even bits are x, odd bits are y */
+        unsigned int x = 0, y = 0;
+        for(unsigned int bit = 0;(cursor >> (2 * bit)) != 0;bit++) {
+            x |= ((cursor >> (2 * bit)) & 1) << bit;
+            y |= ((cursor >> (2 * bit + 1)) & 1) << bit;
+        }
+
+        tile.x = x * m_minTile;
+        tile.y = y * m_minTile;
+
+        unsigned long long cells = tile.size / m_minTile;
+        cursor += cells * cells;
+    }
+
+    m_usedTexels = total;
+    return m_order.size();
+}
+
+unsigned int ShadowAtlas::getSize() const
+{
+    return m_size;
+}
+
+const ShadowAtlas::Tile &ShadowAtlas::getTile(size_t request) const
+{
+    return m_tiles[request];
+}
+
+void ShadowAtlas::getRect(size_t request, float rect[4]) const
+{
+    const Tile &tile = m_tiles[request];
+    rect[0] = (float) tile.x / m_size;
+    rect[1] = (float) tile.y / m_size;
+    rect[2] = rect[3] = (float) tile.size / m_size;
+}
+
+unsigned int ShadowAtlas::getUsedTexels() const
+{
+    return m_usedTexels;
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+    //dtor
+}
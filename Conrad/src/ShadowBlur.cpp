@@ -0,0 +1,126 @@
+#include "ShadowBlur.h"
+
+using namespace std;
+using namespace glm;
+
+ShadowBlur::ShadowBlur()
+{
+    //ctor
+}
+
+void ShadowBlur::setShader(Shader shader)
+{
+    m_shader = shader;
+    if(!m_shader.load()) {
+        cout << "(ShadowBlur) Error loading the blur shader." << endl;
+    }
+
+    m_locations.source = m_shader.getUniformLocation("source");
+    m_locations.sourceRect = m_shader.getUniformLocation("sourceRect");
+    m_locations.texelStep = m_shader.getUniformLocation("texelStep");
+    m_locations.exponential = m_shader.getUniformLocation("exponential");
+    m_locations.shadowRange = m_shader.getUniformLocation("shadowRange");
+
+    m_shader.bind();
+    m_shader.sendInt(m_locations.source, 0);
+    m_shader.unbind();
+
+    if(m_vertexArray == 0) glGenVertexArrays(1, &m_vertexArray);
+}
+
+/// \return false if there is no blur shader (see setShader()).
+bool ShadowBlur::load(GLsizei atlasSize, GLsizei maxTile)
+{
+    if(m_shader.getProgramID() == 0) return false;
+    if(isLoaded()) return true;
+
+    loadTarget(m_atlas, atlasSize);
+    loadTarget(m_temporary, maxTile);
+    return true;
+}
+
+bool ShadowBlur::isLoaded()
+{
+    return m_atlas.texture != 0;
+}
+
+void ShadowBlur::loadTarget(Target &target, GLsizei size)
+{
+    target.size = size;
+
+    glGenTextures(1, &target.texture);
+    GLState::bindTexture(GL_TEXTURE_2D, target.texture);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, size, size, 0, GL_RED, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // The receivers filter with one bilinear fetch
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    GLState::bindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &target.frameBuffer);
+    GLState::bindFramebuffer(target.frameBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+    GLState::bindFramebuffer(0);
+}
+
+/// \brief Horizontal pass from the depth atlas into the temporary texture, then vertical pass into the tile of the exponential atlas.
+void ShadowBlur::filter(GLuint depthAtlas, const ShadowAtlas::Tile &tile, float shadowRange)
+{
+    if(!isLoaded() || tile.size == 0) return;
+
+    GLState::disable(GL_DEPTH_TEST);
+    GLState::disable(GL_BLEND);
+    GLState::disable(GL_CULL_FACE);
+    m_shader.bind();
+    GLState::bindVertexArray(m_vertexArray);
+
+        float atlasSize = m_atlas.size;
+        float tileRect[4] = {tile.x / atlasSize, tile.y / atlasSize, tile.size / atlasSize, tile.size / atlasSize};
+        GLState::bindFramebuffer(m_temporary.frameBuffer);
+        GLState::viewport(0, 0, tile.size, tile.size);
+        pass(depthAtlas, m_atlas.size, tileRect, true, true, shadowRange);
+
+        float temporaryRect[4] = {0.0f, 0.0f, (float) tile.size / m_temporary.size, (float) tile.size / m_temporary.size};
+        GLState::bindFramebuffer(m_atlas.frameBuffer);
+        GLState::viewport(tile.x, tile.y, tile.size, tile.size);
+        pass(m_temporary.texture, m_temporary.size, temporaryRect, false, false, 0.0);
+
+    GLState::bindVertexArray(0);
+    GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+    GLState::bindFramebuffer(0);
+    Shader::unbind();
+
+    GLState::enable(GL_DEPTH_TEST);
+    GLState::enable(GL_BLEND);
+    GLState::enable(GL_CULL_FACE);
+}
+
+void ShadowBlur::pass(GLuint source, GLsizei sourceSize, const float sourceRect[4], bool horizontal, bool exponential, float shadowRange)
+{
+    GLState::bindTexture(0, GL_TEXTURE_2D, source);
+
+    float step = 1.0f / sourceSize;
+    Shader::sendVector(m_locations.sourceRect, vec4(sourceRect[0], sourceRect[1], sourceRect[2], sourceRect[3]));
+    Shader::sendVector(m_locations.texelStep, horizontal ? vec2(step, 0.0f) : vec2(0.0f, step));
+    Shader::sendBool(m_locations.exponential, exponential);
+    Shader::sendFloat(m_locations.shadowRange, shadowRange);
+
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void ShadowBlur::bindTexture(size_t index)
+{
+    GLState::bindTexture(DEPTHBUFFER_TEXTURE0 + index, GL_TEXTURE_2D, m_atlas.texture);
+}
+
+GLuint ShadowBlur::getTextureID()
+{
+    return m_atlas.texture;
+}
+
+ShadowBlur::~ShadowBlur()
+{
+    //dtor
+}
@@ -0,0 +1,152 @@
+#include "ShadowCascades.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+ShadowCascades::ShadowCascades(unsigned int count, unsigned int resolution, float lambda) :
+    m_count(count), m_resolution(resolution), m_lambda(lambda)
+{
+    m_matrices.resize(16 * m_count, 0.0f);
+    m_splits.resize(m_count + 1, 0.0f);
+    m_texelSizes.resize(m_count, 0.0f);
+
+    for(unsigned int i = 0;i < m_count;i++) { // Identity until the first fit
+        for(int diagonal = 0;diagonal < 4;diagonal++) m_matrices[16 * i + 5 * diagonal] = 1.0f;
+    }
+}
+
+void ShadowCascades::setSplitLambda(float lambda)
+{
+    m_lambda = lambda;
+}
+
+void ShadowCascades::setTexelSnapping(bool enabled)
+{
+    m_texelSnapping = enabled;
+}
+
+/// \brief Split i = lambda * near * (far / near)^(i / count) + (1 - lambda) * (near + (far - near) * i / count).
+void ShadowCascades::computeSplits(unsigned int count, float nearDepth, float farDepth, float lambda, float *splits)
+{
+    for(unsigned int i = 0;i <= count;i++) {
+        float fraction = (float) i / count;
+        float logarithmic = nearDepth * pow(farDepth / nearDepth, fraction),
+              uniform = nearDepth + (farDepth - nearDepth) * fraction;
+
+        splits[i] = lambda * logarithmic + (1.0f - lambda) * uniform;
+    }
+
+    splits[0] = nearDepth;
+    splits[count] = farDepth;
+}
+
+void ShadowCascades::fit(const float corners[8][3], float nearDepth, float farDepth, const float lightView[16], const float sceneMin[3], const float sceneMax[3])
+{
+    computeSplits(m_count, nearDepth, farDepth, m_lambda, m_splits.data());
+
+    /* Light space depth range of the casters (the light looks down -z) */
+    float sceneTop = -numeric_limits<float>::max();
+    for(int corner = 0;corner < 8;corner++) {
+        float x = (corner & 1) ? sceneMax[0] : sceneMin[0],
+              y = (corner & 2) ? sceneMax[1] : sceneMin[1],
+              z = (corner & 4) ? sceneMax[2] : sceneMin[2];
+        sceneTop = max(sceneTop, lightView[2] * x + lightView[6] * y + lightView[10] * z + lightView[14]);
+    }
+
+    for(unsigned int i = 0;i < m_count;i++) {
+        /* Slice corners : a point at view depth d slides linearly along its edge, from the near corner to the far one */
+        float slice[8][3], center[3] = {0.0f, 0.0f, 0.0f};
+        for(int corner = 0;corner < 8;corner++) {
+            float depth = (corner < 4) ? m_splits[i] : m_splits[i + 1];
+            float t = (depth - nearDepth) / (farDepth - nearDepth);
+
+            for(int axis = 0;axis < 3;axis++) {
+                slice[corner][axis] = corners[corner % 4][axis] + (corners[4 + corner % 4][axis] - corners[corner % 4][axis]) * t;
+                center[axis] += slice[corner][axis] / 8.0f;
+            }
+        }
+
+        float radius = 0.0f;
+        for(int corner = 0;corner < 8;corner++) {
+            float dx = slice[corner][0] - center[0], dy = slice[corner][1] - center[1], dz = slice[corner][2] - center[2];
+            radius = max(radius, sqrt(dx * dx + dy * dy + dz * dz));
+        }
+        radius = ceil(radius * 16.0f) / 16.0f; // The rounding errors of the corners must not resize the map
+
+        /* Center in light space, snapped to the texels */
+        float lightCenter[3];
+        for(int row = 0;row < 3;row++) {
+            lightCenter[row] = lightView[row] * center[0] + lightView[4 + row] * center[1] + lightView[8 + row] * center[2] + lightView[12 + row];
+        }
+
+        float texelSize = 2.0f * radius / (m_resolution - 2), // One texel of margin on each side : snapping moves the center by less
+              halfSize = 0.5f * texelSize * m_resolution;
+        float depthMin = lightCenter[2] - radius, depthMax = max(lightCenter[2] + radius, sceneTop);
+        if(m_texelSnapping) {
+            lightCenter[0] = floor(lightCenter[0] / texelSize) * texelSize;
+            lightCenter[1] = floor(lightCenter[1] / texelSize) * texelSize;
+
+            /* The depth range too, outwards : the matrix only changes when the map moves by a texel (the Renderer re-renders the
+               cascades whose matrix changed) */
+            float depthStep = radius / SHADOW_CASCADE_DEPTH_STEPS;
+            depthMin = floor(depthMin / depthStep) * depthStep;
+            depthMax = ceil(depthMax / depthStep) * depthStep;
+        }
+        m_texelSizes[i] = texelSize;
+
+        /* Orthographic projection : the sphere, and every caster between it and the light */
+        float left = lightCenter[0] - halfSize, right = lightCenter[0] + halfSize,
+              bottom = lightCenter[1] - halfSize, top = lightCenter[1] + halfSize,
+              zNear = -depthMax, zFar = -depthMin;
+
+        float projection[16] = {0.0f};
+        projection[0] = 2.0f / (right - left);
+        projection[5] = 2.0f / (top - bottom);
+        projection[10] = -2.0f / (zFar - zNear);
+        projection[12] = -(right + left) / (right - left);
+        projection[13] = -(top + bottom) / (top - bottom);
+        projection[14] = -(zFar + zNear) / (zFar - zNear);
+        projection[15] = 1.0f;
+
+        float *matrix = &m_matrices[16 * i];
+        for(int column = 0;column < 4;column++) {
+            for(int row = 0;row < 4;row++) {
+                matrix[4 * column + row] = 0.0f;
+                for(int k = 0;k < 4;k++) matrix[4 * column + row] += projection[4 * k + row] * lightView[4 * column + k];
+            }
+        }
+    }
+}
+
+unsigned int ShadowCascades::getCount() const
+{
+    return m_count;
+}
+
+unsigned int ShadowCascades::getResolution() const
+{
+    return m_resolution;
+}
+
+const float *ShadowCascades::getMatrix(unsigned int cascade) const
+{
+    return &m_matrices[16 * cascade];
+}
+
+float ShadowCascades::getSplit(unsigned int cascade) const
+{
+    return m_splits[cascade + 1];
+}
+
+float ShadowCascades::getTexelSize(unsigned int cascade) const
+{
+    return m_texelSizes[cascade];
+}
+
+ShadowCascades::~ShadowCascades()
+{
+    //dtor
+}
@@ -1,28 +1,35 @@
 #include "SpotLight.h"
 
+#include <algorithm>
+
 using namespace glm;
 
 SpotLight::SpotLight(vec3 position, vec3 color, vec3 direction, float coneAngle, float spotExponent, float intensity, bool castShadow, float linearAttenuation, float minIntensity, float maxDistance) :
-    AbstractLight(position, color, direction, intensity, castShadow, linearAttenuation, (intensity / (minIntensity * maxDistance * maxDistance))), m_coneAngle(coneAngle), m_spotExponent(spotExponent)
+    AbstractLight(position, color, direction, intensity, castShadow, linearAttenuation, (intensity / (minIntensity * maxDistance * maxDistance))), m_coneAngle(coneAngle), m_spotExponent(spotExponent), m_shadowRange(maxDistance)
 {
 
 }
 
-void SpotLight::sendUniforms(const Shader &shader, size_t index)
+void SpotLight::fillUniformBlock(LightBlock &block)
 {
-    shader.sendInt(shader.getUniformLocation(uniform_str(index, "type")), LIGHT_SPOT);
+    AbstractLight::fillUniformBlock(block);
 
-    shader.sendVector(shader.getUniformLocation(uniform_str(index, "position")), m_position);
-    shader.sendRGB(shader.getUniformLocation(uniform_str(index, "color")), m_color);
-    shader.sendFloat(shader.getUniformLocation(uniform_str(index, "intensity")), m_intensity);
-    shader.sendFloat(shader.getUniformLocation(uniform_str(index, "linearAttenuation")), m_linearAttenuation);
-    shader.sendFloat(shader.getUniformLocation(uniform_str(index, "quadAttenuation")), m_quadraticAttenuation);
-    shader.sendFloat(shader.getUniformLocation(uniform_str(index, "spotExponent")), m_spotExponent);
+    block.type = LIGHT_SPOT;
+    block.spotExponent = m_spotExponent;
+    block.coneAngle = m_coneAngle;
+    block.shadowRange = m_shadowRange; // Far plane of its perspective map
+}
 
-    shader.sendVector(shader.getUniformLocation(uniform_str(index, "direction")), m_direction);
-    shader.sendFloat(shader.getUniformLocation(uniform_str(index, "coneAngle")), m_coneAngle);
+/// \brief The cone (twice its half angle) up to the range of the light.
+mat4 SpotLight::getShadowProjection()
+{
+    float fov = std::min(2.0f * m_coneAngle, (float) SHADOW_SPOT_MAX_FOV);
+    return perspective((float) radians(fov), 1.0f, (float) SHADOW_SPOT_NEAR, m_shadowRange);
+}
 
-    sendShadowUniforms(shader, index);
+float SpotLight::getShadowRange()
+{
+    return m_shadowRange;
 }
 
 SpotLight::~SpotLight()
@@ -1,21 +1,58 @@
 #include "SunLight.h"
 
+#include <cstring>
+#include <algorithm>
+
 using namespace glm;
 
 SunLight::SunLight(vec3 position, vec3 direction, vec3 color, float intensity, bool castShadow) :
     AbstractLight(position, color, direction, intensity, castShadow)
 {
+    if(castShadow) getDepthBuffer().load(DEPTHBUFFER_ARRAY, m_cascades.getResolution(), m_cascades.getCount());
+}
+
+void SunLight::fillUniformBlock(LightBlock &block)
+{
+    AbstractLight::fillUniformBlock(block);
+
+    block.type = LIGHT_SUN;
+}
+
+/// \brief The unused splits are the last one : no fragment picks their cascade.
+void SunLight::fillCascadesBlock(CascadesBlock &block)
+{
+    for(unsigned int i = 0;i < SHADOW_CASCADES;i++) {
+        unsigned int cascade = std::min(i, m_cascades.getCount() - 1);
 
+        memcpy(block.world[i], m_cascades.getMatrix(cascade), sizeof(block.world[i]));
+        block.splits[i] = m_cascades.getSplit(cascade);
+    }
 }
 
-void SunLight::sendUniforms(const Shader &shader, size_t index)
+bool SunLight::isCascaded()
 {
-    shader.sendInt(shader.getUniformLocation(uniform_str(index, "type")), LIGHT_SUN);
-    shader.sendRGB(shader.getUniformLocation(uniform_str(index, "color")), m_color);
-    shader.sendFloat(shader.getUniformLocation(uniform_str(index, "intensity")), m_intensity);
-    shader.sendVector(shader.getUniformLocation(uniform_str(index, "direction")), m_direction);
+    return castsShadow();
+}
+
+/// \brief The corners of the camera frustum are brought back to world space by the inverse view-projection (near plane, then far plane).
+void SunLight::fitCascades(const mat4 &cameraViewProjection, float nearDepth, float farDepth, vec3 sceneMin, vec3 sceneMax)
+{
+    mat4 inverseViewProjection = inverse(cameraViewProjection);
+
+    float corners[8][3];
+    for(int corner = 0;corner < 8;corner++) {
+        vec4 ndc((corner & 1) ? 1.0 : -1.0, (corner & 2) ? 1.0 : -1.0, (corner < 4) ? -1.0 : 1.0, 1.0);
+        vec4 world = inverseViewProjection * ndc;
 
-    sendShadowUniforms(shader, index);
+        for(int axis = 0;axis < 3;axis++) corners[corner][axis] = world[axis] / world.w;
+    }
+
+    m_cascades.fit(corners, nearDepth, farDepth, value_ptr(m_lookAt), value_ptr(sceneMin), value_ptr(sceneMax));
+}
+
+ShadowCascades &SunLight::getCascades()
+{
+    return m_cascades;
 }
 
 SunLight::~SunLight()
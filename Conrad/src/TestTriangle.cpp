@@ -1,4 +1,5 @@
 #include "TestTriangle.h"
+#include "TextureCache.h"
 
 TestTriangle::TestTriangle(int size) :
     StaticMesh(3)
@@ -16,9 +17,8 @@ TestTriangle::TestTriangle(int size) :
     setColors(colors, 3*3);
     setTexCoords(tex, 3*2);
 
-    AbstractTexture *texture = new AbstractTexture("textures/crate13.jpg");
+    AbstractTexture *texture = TextureCache::acquire("textures/crate13.jpg");
     getMaterial()->setDiffuseTexture(texture);
-    getMaterial()->getDiffuseTexture()->load();
 
     load();
 }
@@ -0,0 +1,89 @@
+#include "TextureCache.h"
+
+#include <iostream>
+
+using namespace std;
+
+map<string, TextureCache::Entry> TextureCache::s_entries;
+map<AbstractTexture *, string> TextureCache::s_paths;
+
+unsigned int TextureCache::s_hits = 0;
+unsigned int TextureCache::s_misses = 0;
+
+/*!
+ *  \brief Returns the texture of filepath, creating it on the first request. The caller gets one reference.
+ *  A texture that failed to load stays in the cache (it isn't tried again on every request) : check isLoaded().
+ */
+AbstractTexture *TextureCache::acquire(const string &filepath, bool load)
+{
+    map<string, Entry>::iterator entry = s_entries.find(filepath);
+
+    if(entry != s_entries.end()) {
+        s_hits++;
+        entry->second.references++;
+    } else {
+        s_misses++;
+
+        Entry created;
+        created.texture = new AbstractTexture(filepath);
+        created.references = 1;
+
+        entry = s_entries.insert(make_pair(filepath, created)).first;
+        s_paths[created.texture] = filepath;
+    }
+
+    AbstractTexture *texture = entry->second.texture;
+    if(load && !texture->isLoaded()) {
+        texture->load();
+    }
+
+    return texture;
+}
+
+void TextureCache::release(AbstractTexture *texture)
+{
+    map<AbstractTexture *, string>::iterator path = s_paths.find(texture);
+    if(path == s_paths.end()) {
+        return;
+    }
+
+    map<string, Entry>::iterator entry = s_entries.find(path->second);
+    if(--entry->second.references > 0) {
+        return;
+    }
+
+    delete texture; // Last user gone : the GL texture goes with it
+    s_entries.erase(entry);
+    s_paths.erase(path);
+}
+
+unsigned int TextureCache::getHits()
+{
+    return s_hits;
+}
+
+unsigned int TextureCache::getMisses()
+{
+    return s_misses;
+}
+
+size_t TextureCache::getResidentBytes()
+{
+    size_t bytes = 0;
+    for(map<string, Entry>::iterator entry = s_entries.begin();entry != s_entries.end();entry++) {
+        if(entry->second.texture->isLoaded()) bytes += entry->second.texture->getByteSize();
+    }
+
+    return bytes;
+}
+
+size_t TextureCache::getTextureCount()
+{
+    return s_entries.size();
+}
+
+void TextureCache::report()
+{
+    cout << "(TextureCache) " << s_entries.size() << " textures, " << getResidentBytes() / 1024 << " KB resident | " << s_hits << " hits, "
+         << s_misses << " misses" << endl;
+}
@@ -0,0 +1,74 @@
+#include "UniformBuffer.h"
+
+unsigned long long UniformBuffer::s_calls = 0;
+
+UniformBuffer::UniformBuffer()
+{
+    //ctor
+}
+
+void UniformBuffer::allocate(GLsizeiptr size, const void *data)
+{
+    if(m_id == 0) {
+        glGenBuffers(1, &m_id);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_id);
+        glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    m_size = size;
+    s_calls++;
+}
+
+void UniformBuffer::update(GLintptr offset, GLsizeiptr size, const void *data)
+{
+    if(m_id == 0 || size <= 0 || offset + size > m_size) {
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_id);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    s_calls++;
+}
+
+void UniformBuffer::bindBase(GLuint binding)
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_id);
+    s_calls++;
+}
+
+void UniformBuffer::bindRange(GLuint binding, GLintptr offset, GLsizeiptr size)
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_id, offset, size);
+    s_calls++;
+}
+
+GLuint UniformBuffer::getID()
+{
+    return m_id;
+}
+
+GLsizeiptr UniformBuffer::getSize()
+{
+    return m_size;
+}
+
+GLint UniformBuffer::getOffsetAlignment()
+{
+    GLint alignment = 256; // The largest value in use
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return alignment;
+}
+
+unsigned long long UniformBuffer::getCallCount()
+{
+    return s_calls;
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    glDeleteBuffers(1, &m_id);
+}
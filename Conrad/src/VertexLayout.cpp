@@ -0,0 +1,271 @@
+#include "VertexLayout.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+VertexLayout::VertexLayout(Positions positions, Normals normals, TexCoords texCoords, Colors colors) :
+    m_positions(positions), m_normals(normals), m_texCoords(texCoords), m_colors(colors)
+{
+    build();
+}
+
+VertexLayout VertexLayout::compact()
+{
+    return VertexLayout(POSITIONS_UNORM16, NORMALS_OCTAHEDRAL, TEXCOORDS_HALF, COLORS_NONE);
+}
+
+/// \brief Attributes in the location order, each on 4 bytes. A 16 bits position takes 8 bytes (the 4th component is padding).
+void VertexLayout::build()
+{
+    m_attributes.clear();
+    m_stride = 0;
+
+    auto add = [this](unsigned int location, const char *name, int components, Encoding encoding, size_t size) {
+        m_attributes.push_back({location, name, components, encoding, m_stride});
+        m_stride += size;
+    };
+
+    if(m_positions == POSITIONS_FLOAT)  add(VERTEX_BUFFER, "in_Vertex", 3, FLOAT, 3 * sizeof(float));
+    else                                add(VERTEX_BUFFER, "in_Vertex", 3, UNORM16, 4 * sizeof(uint16_t));
+
+    if(m_colors == COLORS_FLOAT)        add(COLOR_BUFFER, "in_VertexColor", 3, FLOAT, 3 * sizeof(float));
+    else if(m_colors == COLORS_UNORM8)  add(COLOR_BUFFER, "in_VertexColor", 4, UNORM8, 4 * sizeof(uint8_t));
+
+    if(m_texCoords == TEXCOORDS_FLOAT)  add(TEX_BUFFER, "in_TexCoord0", 2, FLOAT, 2 * sizeof(float));
+    else                                add(TEX_BUFFER, "in_TexCoord0", 2, HALF, 2 * sizeof(uint16_t));
+
+    if(m_normals == NORMALS_FLOAT)      add(VERTEX_NORMAL_BUFFER, "in_VertexNormal", 3, FLOAT, 3 * sizeof(float));
+    else                                add(VERTEX_NORMAL_BUFFER, "in_VertexNormal", 2, SNORM16, 2 * sizeof(int16_t));
+}
+
+VertexLayout::Positions VertexLayout::getPositions() const
+{
+    return m_positions;
+}
+
+VertexLayout::Normals VertexLayout::getNormals() const
+{
+    return m_normals;
+}
+
+VertexLayout::TexCoords VertexLayout::getTexCoords() const
+{
+    return m_texCoords;
+}
+
+VertexLayout::Colors VertexLayout::getColors() const
+{
+    return m_colors;
+}
+
+void VertexLayout::setColors(Colors colors)
+{
+    m_colors = colors;
+    build();
+}
+
+const vector<VertexLayout::Attribute> &VertexLayout::getAttributes() const
+{
+    return m_attributes;
+}
+
+size_t VertexLayout::getStride() const
+{
+    return m_stride;
+}
+
+int VertexLayout::getKey() const
+{
+    return m_positions | (m_normals << 1) | (m_texCoords << 2) | (m_colors << 3);
+}
+
+string VertexLayout::getName() const
+{
+    static const char *colors[] = {"none", "float", "unorm8"};
+
+    return string("positions ") + ((m_positions == POSITIONS_FLOAT) ? "float" : "unorm16")
+           + ", normals " + ((m_normals == NORMALS_FLOAT) ? "float" : "octahedral")
+           + ", uv " + ((m_texCoords == TEXCOORDS_FLOAT) ? "float" : "half")
+           + ", colors " + colors[m_colors];
+}
+
+vector<string> VertexLayout::getShaderDefines() const
+{
+    vector<string> defines;
+    if(m_normals == NORMALS_OCTAHEDRAL) defines.push_back(OCTAHEDRAL_NORMALS_SHADER_DEFINE);
+
+    return defines;
+}
+
+bool VertexLayout::operator==(const VertexLayout &layout) const
+{
+    return getKey() == layout.getKey();
+}
+
+bool VertexLayout::operator!=(const VertexLayout &layout) const
+{
+    return getKey() != layout.getKey();
+}
+
+void VertexLayout::encode(size_t count, const float *positions, const float *colors, const float *texCoords, const float *normals,
+                          void *destination, float decodeOffset[3], float decodeScale[3]) const
+{
+    /* Box of the positions */
+    for(int axis = 0;axis < 3;axis++) {
+        decodeOffset[axis] = 0.0f;
+        decodeScale[axis] = 1.0f;
+    }
+
+    if(m_positions == POSITIONS_UNORM16 && count > 0) {
+        float boundsMax[3];
+        for(int axis = 0;axis < 3;axis++) decodeOffset[axis] = boundsMax[axis] = positions[axis];
+
+        for(size_t i = 1;i < count;i++) {
+            for(int axis = 0;axis < 3;axis++) {
+                decodeOffset[axis] = min(decodeOffset[axis], positions[3*i + axis]);
+                boundsMax[axis] = max(boundsMax[axis], positions[3*i + axis]);
+            }
+        }
+
+        for(int axis = 0;axis < 3;axis++) decodeScale[axis] = boundsMax[axis] - decodeOffset[axis]; // 0 for a flat axis : every value decodes to the offset
+    }
+
+    static const float white[3] = {1.0f, 1.0f, 1.0f}, noTexCoord[2] = {0.0f, 0.0f}, up[3] = {0.0f, 0.0f, 1.0f};
+
+    char *vertex = (char *) destination;
+    for(size_t i = 0;i < count;i++, vertex += m_stride) {
+        const float *position = positions + 3*i,
+                    *color = (colors != nullptr) ? colors + 3*i : white,
+                    *texCoord = (texCoords != nullptr) ? texCoords + 2*i : noTexCoord,
+                    *normal = (normals != nullptr) ? normals + 3*i : up;
+
+        for(const Attribute &attribute : m_attributes) {
+            char *target = vertex + attribute.offset;
+
+            switch(attribute.location) {
+                case VERTEX_BUFFER:
+                    if(attribute.encoding == FLOAT) {
+                        memcpy(target, position, 3 * sizeof(float));
+                    } else {
+                        uint16_t stored[4] = {0, 0, 0, 0};
+                        for(int axis = 0;axis < 3;axis++) {
+                            float unit = (decodeScale[axis] > 0.0f) ? (position[axis] - decodeOffset[axis]) / decodeScale[axis] : 0.0f;
+                            stored[axis] = (uint16_t) lround(min(max(unit, 0.0f), 1.0f) * 65535.0f);
+                        }
+                        memcpy(target, stored, sizeof(stored));
+                    }
+                    break;
+
+                case COLOR_BUFFER:
+                    if(attribute.encoding == FLOAT) {
+                        memcpy(target, color, 3 * sizeof(float));
+                    } else {
+                        uint8_t stored[4] = {0, 0, 0, 255};
+                        for(int channel = 0;channel < 3;channel++) stored[channel] = (uint8_t) lround(min(max(color[channel], 0.0f), 1.0f) * 255.0f);
+                        memcpy(target, stored, sizeof(stored));
+                    }
+                    break;
+
+                case TEX_BUFFER:
+                    if(attribute.encoding == FLOAT) {
+                        memcpy(target, texCoord, 2 * sizeof(float));
+                    } else {
+                        uint16_t stored[2] = {toHalf(texCoord[0]), toHalf(texCoord[1])};
+                        memcpy(target, stored, sizeof(stored));
+                    }
+                    break;
+
+                case VERTEX_NORMAL_BUFFER:
+                    if(attribute.encoding == FLOAT) {
+                        memcpy(target, normal, 3 * sizeof(float));
+                    } else {
+                        int16_t stored[2];
+                        encodeOctahedral(normal, stored);
+                        memcpy(target, stored, sizeof(stored));
+                    }
+                    break;
+            }
+        }
+    }
+}
+
+uint16_t VertexLayout::toHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int exponent = (int) ((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if(((bits >> 23) & 0xff) == 0xff) return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0); // Infinity, NaN
+    if(exponent >= 31) return sign | 0x7c00;
+
+    if(exponent <= 0) { // Subnormal
+        if(exponent < -10) return sign;
+
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift, rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+        if(rest > halfway || (rest == halfway && (half & 1))) half++;
+        return sign | half;
+    }
+
+    uint32_t half = (exponent << 10) | (mantissa >> 13), rest = mantissa & 0x1fff;
+    if(rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++; // A carry goes into the exponent, as it should
+    return sign | half;
+}
+
+float VertexLayout::fromHalf(uint16_t half)
+{
+    uint32_t sign = (uint32_t) (half & 0x8000) << 16, exponent = (half >> 10) & 0x1f, mantissa = half & 0x3ff;
+
+    if(exponent == 0) {
+        float value = ldexp((float) mantissa, -24);
+        return sign ? -value : value;
+    }
+
+    uint32_t bits = (exponent == 31) ? (sign | 0x7f800000 | (mantissa << 13)) : (sign | ((exponent - 15 + 127) << 23) | (mantissa << 13));
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+/// \brief Projects the normal on the octahedron |x| + |y| + |z| = 1, the lower half folded over the upper one, then unfolded on the square.
+void VertexLayout::encodeOctahedral(const float normal[3], int16_t encoded[2])
+{
+    float length = fabs(normal[0]) + fabs(normal[1]) + fabs(normal[2]);
+    if(length == 0.0f) {
+        encoded[0] = encoded[1] = 0;
+        return;
+    }
+
+    float x = normal[0] / length, y = normal[1] / length;
+    if(normal[2] < 0.0f) {
+        float foldedX = (1.0f - fabs(y)) * ((x >= 0.0f) ? 1.0f : -1.0f),
+              foldedY = (1.0f - fabs(x)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    encoded[0] = (int16_t) lround(min(max(x, -1.0f), 1.0f) * 32767.0f);
+    encoded[1] = (int16_t) lround(min(max(y, -1.0f), 1.0f) * 32767.0f);
+}
+
+void VertexLayout::decodeOctahedral(const int16_t encoded[2], float normal[3])
+{
+    float x = max(encoded[0] / 32767.0f, -1.0f), y = max(encoded[1] / 32767.0f, -1.0f);
+    float z = 1.0f - fabs(x) - fabs(y);
+
+    float t = max(-z, 0.0f);
+    x += (x >= 0.0f) ? -t : t;
+    y += (y >= 0.0f) ? -t : t;
+
+    float length = sqrt(x*x + y*y + z*z);
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
@@ -0,0 +1,140 @@
+#include "VertexNormals.h"
+
+#include <thread>
+#include <cmath>
+
+using namespace std;
+
+void VertexNormals::average(const vector<coordinate3d> &normals, const vector<mapper> &vertex_normals_mapper, size_t vertexCount,
+                            vector<float> &out, size_t &firstVertex, int weighting, const vector<coordinate3d> *positions, unsigned int threadCount)
+{
+    if(positions == nullptr) weighting = NORMALS_WEIGHT_NONE; // Nothing to weight with
+
+    /* Range of vertices used */
+    size_t corners = vertex_normals_mapper.size();
+    size_t last = 0;
+    firstVertex = vertexCount;
+
+    for(size_t i = 0;i < corners;i++) {
+        int vertex_index = get<0>(vertex_normals_mapper[i]);
+        if(vertex_index < 0 || (size_t) vertex_index >= vertexCount) continue;
+
+        if((size_t) vertex_index < firstVertex) firstVertex = vertex_index;
+        if((size_t) vertex_index > last)        last = vertex_index;
+    }
+
+    if(firstVertex == vertexCount) { // No valid corner
+        firstVertex = 0;
+        out.clear();
+        return;
+    }
+
+    size_t rangeCount = last - firstVertex + 1;
+    out.assign(3 * rangeCount, 0.0f);
+
+    /* How many threads */
+    if(threadCount == NORMALS_THREADS_AUTO) {
+        threadCount = thread::hardware_concurrency();
+        if(threadCount == 0) threadCount = 1; // Unknown
+    }
+
+    size_t maxThreads = corners / NORMALS_MIN_CORNERS_PER_THREAD;
+    if(maxThreads < 1) maxThreads = 1;
+    if(threadCount > maxThreads) threadCount = maxThreads;
+
+    if(threadCount <= 1) {
+        accumulate(normals, vertex_normals_mapper, 0, corners, out.data(), firstVertex, vertexCount, weighting, positions);
+        return;
+    }
+
+    /* Accumulation : one corner range and one private array per thread (the first thread sums straight into out) */
+    vector<vector<float> > partial(threadCount - 1, vector<float>(3 * rangeCount, 0.0f));
+    vector<thread> workers;
+
+    for(unsigned int t = 1;t < threadCount;t++) {
+        size_t begin = (corners * t) / threadCount, end = (corners * (t + 1)) / threadCount;
+        workers.push_back(thread(accumulate, cref(normals), cref(vertex_normals_mapper), begin, end, partial[t - 1].data(), firstVertex, vertexCount, weighting, positions));
+    }
+
+    accumulate(normals, vertex_normals_mapper, 0, corners / threadCount, out.data(), firstVertex, vertexCount, weighting, positions);
+
+    for(size_t i = 0;i < workers.size();i++) {
+        workers[i].join();
+    }
+    workers.clear();
+
+    /* Reduction : one vertex range per thread */
+    auto reduce = [&](size_t begin, size_t end) {
+        for(size_t t = 0;t < partial.size();t++) {
+            const float *sums = partial[t].data();
+            for(size_t i = begin;i < end;i++) out[i] += sums[i];
+        }
+    };
+
+    size_t components = out.size();
+    for(unsigned int t = 1;t < threadCount;t++) {
+        workers.push_back(thread(reduce, (components * t) / threadCount, (components * (t + 1)) / threadCount));
+    }
+
+    reduce(0, components / threadCount);
+
+    for(size_t i = 0;i < workers.size();i++) {
+        workers[i].join();
+    }
+}
+
+/// \brief Adds the (weighted) normals of the corners [begin; end) to sums. Corners with an invalid vertex or normal index are skipped.
+void VertexNormals::accumulate(const vector<coordinate3d> &normals, const vector<mapper> &vertex_normals_mapper, size_t begin, size_t end,
+                               float *sums, size_t firstVertex, size_t vertexCount, int weighting, const vector<coordinate3d> *positions)
+{
+    for(size_t i = begin;i < end;i++) {
+        int vertex_index = get<0>(vertex_normals_mapper[i]);
+        int normal_index = get<1>(vertex_normals_mapper[i]);
+        if(vertex_index < 0 || (size_t) vertex_index >= vertexCount || normal_index < 0 || (size_t) normal_index >= normals.size()) continue;
+
+        float weight = (weighting == NORMALS_WEIGHT_NONE) ? 1.0f : cornerWeight(vertex_normals_mapper, i, weighting, *positions);
+
+        const coordinate3d &normal = normals[normal_index];
+        float *sum = sums + 3 * (vertex_index - firstVertex);
+        sum[0] += weight * get<0>(normal);
+        sum[1] += weight * get<1>(normal);
+        sum[2] += weight * get<2>(normal);
+    }
+}
+
+/// \return The area of the corner triangle, or its angle at the corner (radians). 1 if the triangle can't be read.
+float VertexNormals::cornerWeight(const vector<mapper> &vertex_normals_mapper, size_t corner, int weighting, const vector<coordinate3d> &positions)
+{
+    size_t first = corner - corner % 3; // Corners are stored 3 by 3 (triangulated faces)
+    if(first + 2 >= vertex_normals_mapper.size()) return 1.0f;
+
+    float p[3][3];
+    for(int k = 0;k < 3;k++) {
+        int vertex_index = get<0>(vertex_normals_mapper[first + k]);
+        if(vertex_index < 0 || (size_t) vertex_index >= positions.size()) return 1.0f;
+
+        p[k][0] = get<0>(positions[vertex_index]);
+        p[k][1] = get<1>(positions[vertex_index]);
+        p[k][2] = get<2>(positions[vertex_index]);
+    }
+
+    /* Edges leaving the corner */
+    int c = corner - first;
+    const float *o = p[c], *a = p[(c + 1) % 3], *b = p[(c + 2) % 3];
+    float u[3] = {a[0] - o[0], a[1] - o[1], a[2] - o[2]},
+          v[3] = {b[0] - o[0], b[1] - o[1], b[2] - o[2]};
+
+    if(weighting == NORMALS_WEIGHT_AREA) {
+        float n[3] = {u[1]*v[2] - u[2]*v[1], u[2]*v[0] - u[0]*v[2], u[0]*v[1] - u[1]*v[0]};
+        return 0.5f * sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    }
+
+    float lengths = sqrt((u[0]*u[0] + u[1]*u[1] + u[2]*u[2]) * (v[0]*v[0] + v[1]*v[1] + v[2]*v[2]));
+    if(lengths <= 0.0f) return 0.0f; // Degenerate triangle
+
+    float cosine = (u[0]*v[0] + u[1]*v[1] + u[2]*v[2]) / lengths;
+    if(cosine > 1.0f) cosine = 1.0f;
+    if(cosine < -1.0f) cosine = -1.0f;
+
+    return acos(cosine);
+}